@@ -0,0 +1,5 @@
+MESSAGE(STATUS "Searching SDK for JPEG ...")
+
+FIND_PATH(JPEG_INC NAMES jpeglib.h)
+
+FIND_LIBRARY(JPEG_LIB NAMES jpeg)
@@ -1214,73 +1214,140 @@ double ATimeSpace::SphereAngle(double l1, double b1, double l2, double b2) {
 }
 
 void ATimeSpace::EqTransfer(double rai, double deci, double& rao, double& deco) {
+	EqTransferBatch(1, &rai, &deci, &rao, &deco);
+}
+
+void ATimeSpace::EqReTransfer(double rai, double deci, double& rao, double& deco) {
+	EqReTransferBatch(1, &rai, &deci, &rao, &deco);
+}
+
+/*------------------------- 批量转换: 同一历元的多个坐标 -------------------------*/
+void ATimeSpace::Horizon2EqBatch(int n, const double azi[], const double alt[], double ra[], double dec[]) {
+	double lst = LocalSiderealTime();
+	double slat = sin(lat_), clat = cos(lat_);
+	double saz, caz, ha;
+
+	for (int i = 0; i < n; ++i) {
+		saz = sin(azi[i]);
+		caz = cos(azi[i]);
+		ha  = atan2(saz, caz * slat + tan(alt[i]) * clat);
+		dec[i] = asin(slat * sin(alt[i]) - clat * cos(alt[i]) * caz);
+		ra[i]  = cycmod(lst - ha, AU_2PI);
+	}
+}
+
+void ATimeSpace::EqTransferBatch(int n, const double rai[], const double deci[], double rao[], double deco[]) {
 	double t = JulianCentury();			// 输出历元与输入历元之间的儒略世纪数
 	double eps0= 84381.406 * AU_AS2R;		// J2000对应的黄赤交角
-	double eps = MeanObliquity();		// 输出历元对应的黄赤交角
+	double eps = MeanObliquity() + NutationObliquity();	// 输出历元对应的真黄赤交角
 	double nl = NutationLongitude();	// 黄经章动
-	double no = NutationObliquity();	// 交角章动
 	double lsun = MeanLongSun() + CenterSun();	// 太阳真黄经
 	double ec = EccentricityEarth();		// 地球偏心率
 	double pl = PerihelionLongEarth();	// 地球轨道近日点黄经
 	double K = -20.49552 * AU_AS2R;
-	double x, y, z, A, B, C, l, b, dl, db;
-	double syml, sx, cx, sb, cb;
-
-	Eq2Eclip(rai, deci, eps0, l, b);
-	/* 岁差 */
-	x = ((47.0029 - (0.03302 - 6E-5 * t) * t) * t) * AU_AS2R;
-	y = (629554.9824 - (869.8089 - 0.03536 * t) * t) * AU_AS2R;
-	z = (5029.0966 + (1.11113 - 6E-6 * t) * t) * t * AU_AS2R;
-	A = (cx = cos(x)) * (cb = cos(b)) * (syml = sin(y - l)) - (sx = sin(x)) * (sb = sin(b));
-	B = cb * cos(y - l);
-	C = cx * sb + sx * cb * syml;
-	l = y + z - atan2(A, B);
-	b = asin(C);
-
-	/* 章动和光行差 */
-	dl = K * (cos(lsun - l) - ec * cos(pl - l)) / cos(b);
-	db = K * sin(b) * (sin(lsun - l) - ec * sin(pl - l));
-	l += nl + dl;	// nl是章动改正
-	b += db;
-	/* 黄道坐标转换为赤道坐标 */
-	Eclip2Eq(l, b, eps + no, rao, deco);
+	/* 与历元相关的三角函数 */
+	double se0 = sin(eps0), ce0 = cos(eps0), se = sin(eps), ce = cos(eps);
+	double x = ((47.0029 - (0.03302 - 6E-5 * t) * t) * t) * AU_AS2R;
+	double y = (629554.9824 - (869.8089 - 0.03536 * t) * t) * AU_AS2R;
+	double z = (5029.0966 + (1.11113 - 6E-6 * t) * t) * t * AU_AS2R;
+	double sx = sin(x), cx = cos(x);
+	double sls = sin(lsun), cls = cos(lsun), spl = sin(pl), cpl = cos(pl);
+	double sra, l, b, sl, cl, sb, cb, syml, A, B, C;
+
+	for (int i = 0; i < n; ++i) {
+		/* 赤道坐标转换为J2000黄道坐标 */
+		sra = sin(rai[i]);
+		l = atan2(sra * ce0 + tan(deci[i]) * se0, cos(rai[i]));
+		b = asin(sin(deci[i]) * ce0 - cos(deci[i]) * se0 * sra);
+		/* 岁差 */
+		syml = sin(y - l);
+		cb = cos(b);
+		sb = sin(b);
+		A = cx * cb * syml - sx * sb;
+		B = cb * cos(y - l);
+		C = cx * sb + sx * cb * syml;
+		l = y + z - atan2(A, B);
+		b = asin(C);
+		/* 章动和光行差. cos(lsun - l)等按和差公式展开 */
+		sl = sin(l);
+		cl = cos(l);
+		cb = cos(b);
+		sb = sin(b);
+		l += nl + K * ((cls * cl + sls * sl) - ec * (cpl * cl + spl * sl)) / cb;
+		b += K * sb * ((sls * cl - cls * sl) - ec * (spl * cl - cpl * sl));
+		/* 黄道坐标转换为赤道坐标 */
+		sl = sin(l);
+		rao[i]  = cycmod(atan2(sl * ce - tan(b) * se, cos(l)), AU_2PI);
+		deco[i] = asin(sin(b) * ce + cos(b) * se * sl);
+	}
 }
 
-void ATimeSpace::EqReTransfer(double rai, double deci, double& rao, double& deco) {
+void ATimeSpace::EqReTransferBatch(int n, const double rai[], const double deci[], double rao[], double deco[]) {
 	double t = -1 * JulianCentury();	// 输出历元与输入历元之间的儒略世纪数
 	double eps0= 84381.406 * AU_AS2R;		// J2000对应的黄赤交角
-	double eps = MeanObliquity();		// 输出历元对应的黄赤交角
+	double eps = MeanObliquity() + NutationObliquity();	// 输入历元对应的真黄赤交角
 	double nl = NutationLongitude();	// 黄经章动
-	double no = NutationObliquity();	// 交角章动
 	double lsun = MeanLongSun() + CenterSun();	// 太阳真黄经
 	double ec = EccentricityEarth();		// 地球偏心率
 	double pl = PerihelionLongEarth();	// 地球轨道近日点黄经
 	double K = -20.49552 * AU_AS2R;
-	double x, y, z, A, B, C, l0, b0, l, b, dl, db, syml, sx, sb, cx, cb;
-
-	Eq2Eclip(rai, deci, eps + no, l0, b0);	// 当前历元黄道坐标
-
-	/* 光行差 */
-	dl = K * (cos(lsun - l0) - ec * cos(pl - l0)) / cos(b0);
-	db = K * sin(b0) * (sin(lsun - l0) - ec * sin(pl - l0));
-	l = l0 - nl - dl;
-	b = b0 - db;
-	dl = K * (cos(lsun - l) - ec * cos(pl - l)) / cos(b);
-	db = K * sin(b) * (sin(lsun - l) - ec * sin(pl - l));
-	l = l0 - nl - dl;	// nl是章动项
-	b = b0 - db;
-
-	/* 岁差 */
-	x = (47.0029 + (0.03301 + 6E-5 * t) * t) * t * AU_AS2R;
-	y = (629554.9824 - (4159.2878 - 1.14649 * t) * t) * AU_AS2R;
-	z = (5029.0966 - (1.11113 + 6E-6 * t) * t) * t * AU_AS2R;
-	A = (cx = cos(x)) * (cb = cos(b)) * (syml = sin(y - l)) - (sx = sin(x)) * (sb = sin(b));
-	B = cb * cos(y - l);
-	C = cx * sb + sx * cb * syml;
-	l = y + z - atan2(A, B);
-	b = asin(C);
-
-	Eclip2Eq(l, b, eps0, rao, deco);
+	/* 与历元相关的三角函数 */
+	double se0 = sin(eps0), ce0 = cos(eps0), se = sin(eps), ce = cos(eps);
+	double x = (47.0029 + (0.03301 + 6E-5 * t) * t) * t * AU_AS2R;
+	double y = (629554.9824 - (4159.2878 - 1.14649 * t) * t) * AU_AS2R;
+	double z = (5029.0966 - (1.11113 + 6E-6 * t) * t) * t * AU_AS2R;
+	double sx = sin(x), cx = cos(x);
+	double sls = sin(lsun), cls = cos(lsun), spl = sin(pl), cpl = cos(pl);
+	double sra, l0, b0, l, b, sl, cl, sb, cb, syml, A, B, C;
+
+	for (int i = 0; i < n; ++i) {
+		/* 当前历元黄道坐标 */
+		sra = sin(rai[i]);
+		l0 = atan2(sra * ce + tan(deci[i]) * se, cos(rai[i]));
+		b0 = asin(sin(deci[i]) * ce - cos(deci[i]) * se * sra);
+		/* 光行差: 迭代一次 */
+		sl = sin(l0);
+		cl = cos(l0);
+		l = l0 - nl - K * ((cls * cl + sls * sl) - ec * (cpl * cl + spl * sl)) / cos(b0);
+		b = b0 - K * sin(b0) * ((sls * cl - cls * sl) - ec * (spl * cl - cpl * sl));
+		sl = sin(l);
+		cl = cos(l);
+		sb = sin(b);
+		cb = cos(b);
+		l = l0 - nl - K * ((cls * cl + sls * sl) - ec * (cpl * cl + spl * sl)) / cb;	// nl是章动项
+		b = b0 - K * sb * ((sls * cl - cls * sl) - ec * (spl * cl - cpl * sl));
+		/* 岁差 */
+		syml = sin(y - l);
+		cb = cos(b);
+		sb = sin(b);
+		A = cx * cb * syml - sx * sb;
+		B = cb * cos(y - l);
+		C = cx * sb + sx * cb * syml;
+		l = y + z - atan2(A, B);
+		b = asin(C);
+		/* 黄道坐标转换为J2000赤道坐标 */
+		sl = sin(l);
+		rao[i]  = cycmod(atan2(sl * ce0 - tan(b) * se0, cos(l)), AU_2PI);
+		deco[i] = asin(sin(b) * ce0 + cos(b) * se0 * sl);
+	}
+}
+
+void ATimeSpace::SphereAngleBatch(int n, double l0, double b0, const double l[], const double b[], double angle[]) {
+	double sb0 = sin(b0), cb0 = cos(b0), x;
+
+	for (int i = 0; i < n; ++i) {
+		x = sb0 * sin(b[i]) + cb0 * cos(b[i]) * cos(l[i] - l0);
+		angle[i] = acos(x > 1.0 ? 1.0 : (x < -1.0 ? -1.0 : x));
+	}
+}
+
+void ATimeSpace::AirmassBatch(int n, const double alt[], double airmass[]) {
+	double h;
+
+	for (int i = 0; i < n; ++i) {
+		h = alt[i] * AU_R2D;
+		airmass[i] = h < 0.0 ? NAN : 1.0 / (sin(alt[i]) + 0.50572 * pow(h + 6.07995, -1.6364));
+	}
 }
 
 int ATimeSpace::TwilightTime(double& sunrise, double& sunset, int type) {
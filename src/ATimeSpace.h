@@ -614,6 +614,53 @@ public:
 	 */
 	int TimeOfSunAlt(double& sunrise, double& sunset, double alt);
 
+public:
+	/*------------------------- 批量转换: 同一历元的多个坐标 -------------------------*/
+	/*!
+	 * @brief 批量地平坐标转换为赤道坐标
+	 * @param n    坐标数量
+	 * @param azi  方位角, 量纲: 弧度. 南零点
+	 * @param alt  高度角, 量纲: 弧度
+	 * @param ra   赤经, 量纲: 弧度. UTC对应历元
+	 * @param dec  赤纬, 量纲: 弧度
+	 * @note
+	 * 本地真恒星时和测站纬度的三角函数只计算一次
+	 */
+	void Horizon2EqBatch(int n, const double azi[], const double alt[], double ra[], double dec[]);
+	/*!
+	 * @brief 批量赤道坐标历元转换. 输入坐标系: J2000, 输出坐标系: UTC对应历元
+	 * @note
+	 * - 岁差、章动、光行差等与历元相关的量只计算一次
+	 * - 逐点计算不调用成员函数, 便于编译器展开和向量化
+	 * - 与EqTransfer()结果一致
+	 */
+	void EqTransferBatch(int n, const double rai[], const double deci[], double rao[], double deco[]);
+	/*!
+	 * @brief 批量赤道坐标历元转换. 输入坐标系: UTC对应历元, 输出坐标系: J2000
+	 * @note
+	 * 与EqReTransfer()结果一致
+	 */
+	void EqReTransferBatch(int n, const double rai[], const double deci[], double rao[], double deco[]);
+	/*!
+	 * @brief 批量计算到同一参考点的大圆距离
+	 * @param n      坐标数量
+	 * @param l0     参考点经度, 量纲: 弧度
+	 * @param b0     参考点纬度, 量纲: 弧度
+	 * @param l      经度, 量纲: 弧度
+	 * @param b      纬度, 量纲: 弧度
+	 * @param angle  大圆距离, 量纲: 弧度
+	 */
+	void SphereAngleBatch(int n, double l0, double b0, const double l[], const double b[], double angle[]);
+	/*!
+	 * @brief 批量计算大气质量
+	 * @param n        坐标数量
+	 * @param alt      高度角, 量纲: 弧度
+	 * @param airmass  大气质量. 地平线以下为NAN
+	 * @note
+	 * Kasten & Young (1989): X = 1 / (sin(h) + 0.50572 * (h + 6.07995)^-1.6364), h量纲为角度
+	 */
+	void AirmassBatch(int n, const double alt[], double airmass[]);
+
 public:
 	/*!
 	 * @brief 将字符串格式的小时转换为小时数
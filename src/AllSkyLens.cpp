@@ -0,0 +1,64 @@
+/**
+ * @file AllSkyLens.cpp 全天镜头模型: 图像像元与地平坐标的转换
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include "ADefine.h"
+#include "AllSkyLens.h"
+#include "Parameter.h"
+
+using namespace AstroUtil;
+
+void AllSkyLens::Reset(const Parameter* param, int width, int height) {
+	x0       = param->lensX0 > 0.0 ? param->lensX0 : (width - 1) * 0.5;
+	y0       = param->lensY0 > 0.0 ? param->lensY0 : (height - 1) * 0.5;
+	scale    = param->lensScale > 0.0 ? param->lensScale : 0.5 * (width < height ? width : height) / 90.0;
+	rotation = param->lensRotation;
+	flip     = param->lensFlip;
+	k2       = param->lensK2;
+	k3       = param->lensK3;
+}
+
+void AllSkyLens::Pixel2Horizon(double x, double y, double& azi, double& ele) const {
+	double dx = x - x0, dy = y0 - y;
+	double pa = atan2(dx, dy) * AU_R2D;	// 自图像向上方向顺时针
+	azi = cycmod(rotation + (flip ? -pa : pa), 360.0);
+	ele = 90.0 - ZenithDistance(sqrt(dx * dx + dy * dy));
+}
+
+void AllSkyLens::Horizon2Pixel(double azi, double ele, double& x, double& y) const {
+	double pa = (flip ? rotation - azi : azi - rotation) * AU_D2R;
+	double r  = Radius(90.0 - ele);
+	x = x0 + r * sin(pa);
+	y = y0 - r * cos(pa);
+}
+
+double AllSkyLens::PixelArea(double ele) const {
+	double z = 90.0 - ele, u = z / 90.0;
+	double dr = scale * (1.0 + 2.0 * k2 * u + 3.0 * k3 * u * u);	// 像元/度
+	double r0 = scale * (1.0 + k2 * u + k3 * u * u);	// r / z
+	double s  = z < 1E-6 ? 1.0 : sin(z * AU_D2R) / (z * AU_D2R);
+	return s / (r0 * dr);
+}
+
+double AllSkyLens::Radius(double z) const {
+	double u = z / 90.0;
+	return scale * z * (1.0 + k2 * u + k3 * u * u);
+}
+
+double AllSkyLens::ZenithDistance(double r) const {
+	double z = r / scale, u, f, df;
+	if (k2 == 0.0 && k3 == 0.0) return z;
+	// 牛顿迭代: 畸变为小量, 数次收敛
+	for (int i = 0; i < 8; ++i) {
+		u  = z / 90.0;
+		f  = scale * z * (1.0 + k2 * u + k3 * u * u) - r;
+		df = scale * (1.0 + 2.0 * k2 * u + 3.0 * k3 * u * u);
+		if (df <= 0.0) break;
+		z -= f / df;
+		if (fabs(f) < 1E-6) break;
+	}
+	return z;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file AllSkyLens.h 全天镜头模型: 图像像元与地平坐标的转换
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 等距投影叠加径向畸变: r = scale * z * (1 + k2 * u + k3 * u^2), u = z / 90.
+ *   r为像元到天顶像元的距离, z为天顶距(角度)
+ * - 像元坐标: x为列号, y为行号, 原点为首个像元的中心
+ * - 方位角: 角度, 北零点, 向东为正
+ */
+
+#ifndef ALLSKY_LENS_H_
+#define ALLSKY_LENS_H_
+
+struct Parameter;
+
+struct AllSkyLens {
+	double x0, y0;		///< 天顶像元坐标
+	double scale;		///< 投影比例, 像元/度
+	double rotation;	///< 图像向上方向(行号减小)的方位角, 角度
+	bool flip;			///< 方位角沿图像逆时针增加
+	double k2, k3;		///< 径向畸变系数
+
+public:
+	AllSkyLens() {
+		x0 = y0 = 0.0;
+		scale = 1.0;
+		rotation = 0.0;
+		flip = false;
+		k2 = k3 = 0.0;
+	}
+	/*!
+	 * @brief 由配置参数和图像尺寸设置镜头模型
+	 * @note
+	 * 未标定的天顶坐标取图像中心, 未标定的比例使地平圈内切于图像
+	 */
+	void Reset(const Parameter* param, int width, int height);
+	/*!
+	 * @brief 像元坐标转换为地平坐标
+	 * @param x    列号
+	 * @param y    行号
+	 * @param azi  方位角, 角度
+	 * @param ele  高度角, 角度
+	 */
+	void Pixel2Horizon(double x, double y, double& azi, double& ele) const;
+	/*!
+	 * @brief 地平坐标转换为像元坐标
+	 */
+	void Horizon2Pixel(double azi, double ele, double& x, double& y) const;
+	/*!
+	 * @brief 单个像元对应的立体角, 平方度
+	 * @param ele  像元中心的高度角, 角度
+	 * @note
+	 * 径向映射的面元: dΩ = sin(z)dz / (r dr)
+	 */
+	double PixelArea(double ele) const;
+	/*!
+	 * @brief 天顶距对应的像元距离
+	 * @param z  天顶距, 角度
+	 */
+	double Radius(double z) const;
+	/*!
+	 * @brief 像元距离对应的天顶距, 角度
+	 */
+	double ZenithDistance(double r) const;
+};
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * @file AppendLog.cpp 测量记录文本文件: 追加写入与持久化策略
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <boost/bind/bind.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include "AppendLog.h"
+#include "Scheduler.h"
+#include "GLog.h"
+
+#define RECOVER_CHUNK	4096	///< 恢复扫描: 每次自末尾向前读取的字节数
+
+boost::mutex AppendLog::mtxPolicy_;
+AppendLog::PolicyMap AppendLog::policies_;
+
+/*
+ * 同步目录, 使新建文件的目录项持久
+ */
+static void sync_dir(const string& filePath) {
+	string dirName = boost::filesystem::path(filePath).parent_path().string();
+	int fd = open(dirName.empty() ? "." : dirName.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+}
+
+AppendLog::AppendLog() {
+	fd_       = -1;
+	dirty_    = false;
+	failed_   = false;
+	idCommit_ = 0;
+	policy_.mode   = LOG_SYNC_DATA;
+	policy_.period = 60;
+}
+
+AppendLog::~AppendLog() {
+	Close();
+	keep_.Stop();
+}
+
+void AppendLog::SetPolicy(const string& stream, const string& mode, int period) {
+	Policy policy;
+	if (boost::iequals(mode, "group")) policy.mode = LOG_SYNC_GROUP;
+	else if (boost::iequals(mode, "dsync")) policy.mode = LOG_SYNC_DSYNC;
+	else {
+		if (!boost::iequals(mode, "datasync"))
+			_gLog.Write(LOG_WARN, "unknown sync policy [%s] for [%s], use datasync", mode.c_str(), stream.c_str());
+		policy.mode = LOG_SYNC_DATA;
+	}
+	policy.period = period;
+
+	MtxLck lck(mtxPolicy_);
+	policies_[stream] = policy;
+}
+
+int AppendLog::Recover(const string& filePath) {
+	int fd = open(filePath.c_str(), O_RDWR);
+	if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+
+	// 自末尾向前: 跳过空字节, 定位最后一个换行符
+	std::vector<char> buff(RECOVER_CHUNK);
+	off_t size = st.st_size, end = size, keep = 0, pos;
+	bool content = false;	// 已遇到非空字节
+	bool found   = false;
+	while (end > 0 && !found) {
+		off_t beg = end > RECOVER_CHUNK ? end - RECOVER_CHUNK : 0;
+		ssize_t n = pread(fd, &buff[0], end - beg, beg);
+		if (n != end - beg) {
+			close(fd);
+			return -1;
+		}
+		for (pos = end - beg - 1; pos >= 0; --pos) {
+			char ch = buff[pos];
+			if (!content && ch == 0) continue;
+			content = true;
+			if (ch == '\n') {
+				keep  = beg + pos + 1;
+				found = true;
+				break;
+			}
+		}
+		end = beg;
+	}
+
+	int removed = int(size - keep);
+	if (removed > 0) {
+		if (ftruncate(fd, keep) || fdatasync(fd)) removed = -1;
+		else _gLog.Write(LOG_WARN, "%d bytes of torn line truncated from [%s]", removed, filePath.c_str());
+	}
+	close(fd);
+	return removed;
+}
+
+bool AppendLog::Open(const string& filePath, const string& stream) {
+	Close();
+
+	Policy policy;
+	{
+		MtxLck lck(mtxPolicy_);
+		PolicyMap::iterator it = policies_.find(stream);
+		if (it != policies_.end()) policy = it->second;
+		else {
+			policy.mode   = LOG_SYNC_DATA;
+			policy.period = 60;
+		}
+	}
+
+	struct stat st;
+	bool created = stat(filePath.c_str(), &st) != 0;
+	if (!created && Recover(filePath) < 0)
+		_gLog.Write(LOG_WARN, "[%s:%s], failed to check [%s]", __FILE__, __FUNCTION__, filePath.c_str());
+
+	int flags = O_WRONLY | O_CREAT | O_APPEND;
+	if (policy.mode == LOG_SYNC_DSYNC) flags |= O_DSYNC;
+	int fd = open(filePath.c_str(), flags, 0666);
+	if (fd < 0) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to open [%s], %s", __FILE__, __FUNCTION__,
+			filePath.c_str(), strerror(errno));
+		return false;
+	}
+	if (created) sync_dir(filePath);
+
+	{
+		MtxLck lck(mtx_);
+		filePath_ = filePath;
+		fd_       = fd;
+		policy_   = policy;
+		dirty_    = false;
+		failed_   = false;
+		buff_.clear();
+	}
+	if (policy.mode != LOG_SYNC_DSYNC && policy.period > 0) {
+		keep_.Reset();
+		idCommit_ = _gSched.Every(keep_, "append log", policy.period * 1000, boost::bind(&AppendLog::Commit, this));
+	}
+	return true;
+}
+
+void AppendLog::Close() {
+	_gSched.Cancel(idCommit_);
+
+	MtxLck lck(mtx_);
+	if (fd_ >= 0) {
+		commit();
+		close(fd_);
+		fd_ = -1;
+	}
+}
+
+bool AppendLog::IsOpen() {
+	MtxLck lck(mtx_);
+	return fd_ >= 0;
+}
+
+void AppendLog::Write(const char* format, ...) {
+	char line[1024];
+	va_list vl;
+	va_start(vl, format);
+	int n = vsnprintf(line, sizeof(line), format, vl);
+	va_end(vl);
+	if (n < 0) return;
+
+	std::vector<char> longer;
+	const char* text = line;
+	if (n >= int(sizeof(line))) {// 超长的行
+		longer.resize(n + 1);
+		va_start(vl, format);
+		vsnprintf(&longer[0], n + 1, format, vl);
+		va_end(vl);
+		text = &longer[0];
+	}
+
+	MtxLck lck(mtx_);
+	if (fd_ < 0) return;
+	if (policy_.mode == LOG_SYNC_GROUP) {
+		buff_.append(text, n);
+		if (buff_.size() >= APPEND_LOG_BUFF) commit();
+	}
+	else if (write_all(text, n)) dirty_ = policy_.mode != LOG_SYNC_DSYNC;
+	if (policy_.period <= 0) commit();
+}
+
+void AppendLog::Commit() {
+	MtxLck lck(mtx_);
+	if (fd_ >= 0) commit();
+}
+
+void AppendLog::commit() {
+	if (!buff_.empty()) {
+		if (write_all(buff_.data(), buff_.size())) dirty_ = true;
+		buff_.clear();
+	}
+	if (dirty_) {
+		if (fdatasync(fd_) && !failed_) {
+			_gLog.Write(LOG_FAULT, "[%s:%s], failed to sync [%s], %s", __FILE__, __FUNCTION__,
+				filePath_.c_str(), strerror(errno));
+			failed_ = true;
+		}
+		dirty_ = false;
+	}
+}
+
+bool AppendLog::write_all(const char* data, size_t n) {
+	while (n > 0) {
+		ssize_t m = write(fd_, data, n);
+		if (m < 0) {
+			if (errno == EINTR) continue;
+			if (!failed_) {
+				_gLog.Write(LOG_FAULT, "[%s:%s], failed to write [%s], %s", __FILE__, __FUNCTION__,
+					filePath_.c_str(), strerror(errno));
+				failed_ = true;
+			}
+			return false;
+		}
+		data += m;
+		n    -= m;
+	}
+	failed_ = false;
+	return true;
+}
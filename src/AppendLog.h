@@ -0,0 +1,112 @@
+/**
+ * @file AppendLog.h 测量记录文本文件: 追加写入与持久化策略
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 持久化策略按数据流名称配置, 打开文件时生效:
+ *   group:    行缓存在内存中, 周期性批量写入并fdatasync. 系统调用最少
+ *   datasync: 逐行写入内核, 周期性fdatasync. 其它进程可即时读到新行
+ *   dsync:    以O_DSYNC打开, 逐行写入即持久
+ * - 同步周期 <= 0时每行提交并同步
+ * - 打开已有文件时先做恢复扫描: 截去断电残留的不完整末行及末尾的空字节
+ * - 新建文件时同步所在目录, 保证目录项持久
+ */
+
+#ifndef APPEND_LOG_H_
+#define APPEND_LOG_H_
+
+#include <map>
+#include <string>
+#include "BoostInclude.h"
+#include "BoostAsioKeep.h"
+
+using std::string;
+
+#define APPEND_LOG_BUFF		65536	///< group策略: 缓存超过该字节数时提前提交
+
+/**
+ * @brief 持久化策略
+ */
+enum {
+	LOG_SYNC_GROUP,	///< 内存缓存, 周期性批量写入并fdatasync
+	LOG_SYNC_DATA,	///< 逐行写入, 周期性fdatasync
+	LOG_SYNC_DSYNC	///< O_DSYNC, 逐行持久
+};
+
+class AppendLog {
+public:
+	AppendLog();
+	virtual ~AppendLog();
+
+protected:
+	/* 数据类型 */
+	struct Policy {
+		int mode;	///< 持久化策略
+		int period;	///< 同步周期, 秒
+	};
+	typedef std::map<string, Policy> PolicyMap;
+
+protected:
+	/* 成员变量 */
+	boost::mutex mtx_;	///< 互斥锁
+	string filePath_;	///< 文件路径
+	int fd_;			///< 文件描述符
+	Policy policy_;		///< 本文件的持久化策略
+	string buff_;		///< group策略: 待写入的行
+	bool dirty_;		///< 有未同步的写入
+	bool failed_;		///< 写入失败. 避免重复记录日志
+	BoostAsioKeep keep_;	///< 线程池句柄
+	int idCommit_;		///< 调度任务: 周期提交
+
+	static boost::mutex mtxPolicy_;	///< 互斥锁: 策略表
+	static PolicyMap policies_;		///< 各数据流的持久化策略
+
+public:
+	/* 接口 */
+	/*!
+	 * @brief 设置数据流的持久化策略
+	 * @param stream  数据流名称
+	 * @param mode    策略名称: group, datasync, dsync
+	 * @param period  同步周期, 秒
+	 */
+	static void SetPolicy(const string& stream, const string& mode, int period);
+	/*!
+	 * @brief 恢复扫描: 截去不完整的末行
+	 * @return
+	 * 截去的字节数. 文件无法访问时返回-1
+	 */
+	static int Recover(const string& filePath);
+	/*!
+	 * @brief 打开文件, 按数据流的策略追加写入. 已打开的文件先提交并关闭
+	 * @param stream  数据流名称. 未设置策略时使用datasync, 周期60秒
+	 */
+	bool Open(const string& filePath, const string& stream);
+	/*!
+	 * @brief 提交并关闭文件
+	 */
+	void Close();
+	/*!
+	 * @brief 检查文件是否已打开
+	 */
+	bool IsOpen();
+	/*!
+	 * @brief 追加一行或多行. 格式与printf相同, 应以换行符结束
+	 */
+	void Write(const char* format, ...);
+	/*!
+	 * @brief 写入缓存的行并同步
+	 */
+	void Commit();
+
+protected:
+	/*!
+	 * @brief 提交. 调用者持有互斥锁
+	 */
+	void commit();
+	/*!
+	 * @brief 完整写入, 处理部分写入与中断
+	 */
+	bool write_all(const char* data, size_t n);
+};
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file AsioPool.cpp 进程级boost::asio线程池
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <exception>
+#include <boost/bind/bind.hpp>
+#include <boost/asio/placeholders.hpp>
+#include "AsioPool.h"
+#include "GLog.h"
+
+#define POOL_THREAD_DEFAULT		4
+#define POOL_THREAD_MAX			64
+#define POOL_STAT_CYCLE			600		// 统计周期, 秒
+
+using namespace boost::asio;
+
+AsioPool::AsioPool()
+	: tmrStat_(ios_) {
+	count_        = 0;
+	countDefault_ = POOL_THREAD_DEFAULT;
+	wakeups_      = 0;
+	wakeupsLast_  = 0;
+}
+
+AsioPool::~AsioPool() {
+	Stop();
+}
+
+bool AsioPool::Start(int n) {
+	MtxLck lck(mtx_);
+	if (count_) return true;
+
+	if (n > 0) countDefault_ = n > POOL_THREAD_MAX ? POOL_THREAD_MAX : n;
+	if (ios_.stopped()) ios_.restart();
+	work_.reset(new io_service::work(ios_));
+	for (int i = 0; i < countDefault_; ++i)
+		thrds_.create_thread(boost::bind(&AsioPool::thread_run, this));
+	count_ = countDefault_;
+	wakeupsLast_ = wakeups_;
+	tmrStat_.expires_after(chrono::seconds(POOL_STAT_CYCLE));
+	tmrStat_.async_wait(boost::bind(&AsioPool::report, this, placeholders::error));
+	_gLog.Write("asio pool: %d threads", count_);
+	return true;
+}
+
+void AsioPool::Stop() {
+	MtxLck lck(mtx_);
+	if (!count_) return;
+
+	boost::system::error_code ec;
+	tmrStat_.cancel(ec);
+	work_.reset();
+	ios_.stop();
+	thrds_.join_all();
+	count_ = 0;
+}
+
+bool AsioPool::IsRunning() {
+	return count_ > 0 && !ios_.stopped();
+}
+
+io_service& AsioPool::GetIOService() {
+	return ios_;
+}
+
+int AsioPool::ThreadCount() {
+	return count_;
+}
+
+unsigned long long AsioPool::Wakeups() {
+	return wakeups_;
+}
+
+void AsioPool::thread_run() {
+	boost::system::error_code ec;
+
+	while (1) {
+		try {
+			if (!ios_.run_one(ec)) break;
+			++wakeups_;
+		}
+		catch(std::exception& ex) {// 回调函数抛出的异常不应终止工作线程
+			_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		}
+	}
+}
+
+void AsioPool::report(const boost::system::error_code& ec) {
+	if (ec) return;
+
+	unsigned long long now = wakeups_;
+	_gLog.Write("asio pool: threads = %d, wakeups = %.2f/s",
+		count_, double(now - wakeupsLast_) / POOL_STAT_CYCLE);
+	wakeupsLast_ = now;
+	tmrStat_.expires_at(tmrStat_.expiry() + chrono::seconds(POOL_STAT_CYCLE));
+	tmrStat_.async_wait(boost::bind(&AsioPool::report, this, placeholders::error));
+}
@@ -0,0 +1,84 @@
+/**
+ * @file AsioPool.h 进程级boost::asio线程池
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 全部网络、串口和定时任务共用同一io_service及N个线程, 替代每个对象独占的io_service线程
+ * - 线程数量由配置文件设置
+ * - 统计并定时记录线程数量和唤醒(处理回调函数)频率
+ * - 各设备通过BoostAsioKeep使用线程池, 并以strand串行化本设备的回调函数
+ */
+
+#ifndef ASIO_POOL_H_
+#define ASIO_POOL_H_
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
+#include "BoostInclude.h"
+
+using boost::asio::io_service;
+
+class AsioPool {
+public:
+	AsioPool();
+	virtual ~AsioPool();
+
+protected:
+	/* 成员变量 */
+	io_service ios_;	///< 共享的io_service
+	boost::scoped_ptr<io_service::work> work_;	///< 维持run()有效性
+	boost::thread_group thrds_;	///< 工作线程
+	boost::mutex mtx_;	///< 互斥锁: 启动/停止
+	int count_;			///< 工作线程数量
+	int countDefault_;	///< 默认线程数量
+	boost::atomic<unsigned long long> wakeups_;	///< 累计唤醒次数
+	unsigned long long wakeupsLast_;	///< 上次统计时的唤醒次数
+	boost::asio::steady_timer tmrStat_;	///< 定时器: 统计唤醒频率
+
+public:
+	/**
+	 * @brief 启动线程池. 已启动时无操作
+	 * @param n  线程数量. n <= 0时使用默认数量
+	 * @return
+	 * 线程池启动结果
+	 */
+	bool Start(int n = 0);
+	/**
+	 * @brief 停止线程池. 尚未执行的回调函数被丢弃
+	 * @note
+	 * 不可在线程池的回调函数中调用
+	 */
+	void Stop();
+	/**
+	 * @brief 检查线程池是否正在运行
+	 */
+	bool IsRunning();
+	/**
+	 * @brief 查看共享的io_service
+	 */
+	io_service& GetIOService();
+	/**
+	 * @brief 查看工作线程数量
+	 */
+	int ThreadCount();
+	/**
+	 * @brief 查看累计唤醒次数
+	 */
+	unsigned long long Wakeups();
+
+protected:
+	/**
+	 * @brief 线程: 逐个执行回调函数并计数
+	 */
+	void thread_run();
+	/**
+	 * @brief 定时记录唤醒频率
+	 */
+	void report(const boost::system::error_code& ec);
+};
+
+extern AsioPool _gPool;
+
+#endif
@@ -6,6 +6,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/array.hpp>
 #include <string.h>
 #include "AsioTCP.h"
 
@@ -18,8 +19,18 @@ using namespace boost::asio;
 TcpClient::TcpClient()
 	: sock_(keep_.GetIOService()) {
 	pckRead_.reset(new char[TCP_PACK_SIZE]);
-	crcBufRead_.set_capacity (TCP_PACK_SIZE * 50);
-	crcBufWrite_.set_capacity(TCP_PACK_SIZE * 50);
+	bufRead_.SetCapacity (TCP_RING_SIZE);
+	bufWrite_.SetCapacity(TCP_RING_SIZE);
+	rdptr_      = NULL;
+	writing_    = false;
+	frmMode_    = TCP_FRAME_NONE;
+	frmLen_     = 0;
+	frmBigEndian_ = true;
+	frmMax_     = TCP_PACK_SIZE;
+	frmScan_    = 0;
+	frmSkip_    = false;
+	frmDropped_ = 0;
+	errCode_    = 0;
 }
 
 TcpClient::~TcpClient() {
@@ -37,8 +48,19 @@ bool TcpClient::Connect(const char* host, uint16_t port, bool async) {
 		BoostTcp::resolver::iterator itertor = rslv.resolve(query);
 
 		if (!keep_.IsKeeping()) keep_.Reset();
+		{
+			MtxLck lck(mtxRead_);
+			bufRead_.Clear();
+			frmScan_ = 0;
+			frmSkip_ = false;
+		}
+		{
+			MtxLck lck(mtxWrite_);
+			bufWrite_.Clear();
+			writing_ = false;
+		}
 		if (async) {
-			sock_.async_connect(*itertor, boost::bind(&TcpClient::handle_connect, this, placeholders::error));
+			sock_.async_connect(*itertor, keep_.Wrap(boost::bind(&TcpClient::handle_connect, this, placeholders::error)));
 		}
 		else {
 			sock_.connect(*itertor);
@@ -87,35 +109,27 @@ bool TcpClient::IsOpen() {
 }
 
 int TcpClient::Read(char* data, int n, int from) {
-	if (!data || n <= 0 || from < 0 || crcBufRead_.empty()) return 0;
+	if (!data || n <= 0 || from < 0) return 0;
 
 	MtxLck lck(mtxRead_);
-	int end(from + n), to_read;
-
-	to_read = crcBufRead_.size() > end ? n : crcBufRead_.size() - from;
-	for (int i = 0, j = from; i < to_read; ++i, ++j) data[i] = crcBufRead_[j];
-	crcBufRead_.erase_begin(from + to_read);
+	int to_read = bufRead_.Peek(data, n, from);
+	if (to_read) bufRead_.Erase(from + to_read);
 	return to_read;
 }
 
 int TcpClient::Write(const char* data, const int n) {
-	if (!data || n <= 0 || crcBufWrite_.full()) return 0;
+	if (!data || n <= 0) return 0;
 
 	MtxLck lck(mtxWrite_);
-	int had_write(n);
-	int wait_write(crcBufWrite_.size());
-	int capacity(crcBufWrite_.capacity() - wait_write);
-
-	if (had_write > capacity) had_write = capacity;
-	for (int i = 0; i < had_write; ++i) crcBufWrite_.push_back(data[i]);
-	if (!wait_write) start_write();
+	int had_write = bufWrite_.Push(data, n);
+	if (had_write && !writing_) start_write();
 	return had_write;
 }
 
 int TcpClient::Lookup(char* first) {
 	MtxLck lck(mtxRead_);
-	int n = crcBufRead_.size();
-	if (first && n) *first = crcBufRead_[0];
+	int n = bufRead_.Size();
+	if (first && n) *first = bufRead_[0];
 	return n;
 }
 
@@ -123,31 +137,24 @@ int TcpClient::Lookup(const char* flag, int n, int from) {
 	if (!flag || n <= 0 || from < 0) return -1;
 
 	MtxLck lck(mtxRead_);
-	int end =crcBufRead_.size() - n;
-	int pos(0), i(0), j(0);
-
-	for (pos = from; pos <= end; ++pos) {
-		for (i = 0, j = pos; i < n && flag[i] == crcBufRead_[j]; ++i, ++j);
-		if (i == n) break;
-	}
-	return (i == n ? pos : -1);
+	return bufRead_.Find(flag, n, from);
 }
 
 int TcpClient::Lookup(char chBegin, char chEnd, int &posBegin, int &posEnd)
 {
 	MtxLck lck(mtxRead_);
 
-	int end = crcBufRead_.size();
+	int end = bufRead_.Size();
 	int pos(0), n1(0), n2(0);
 
 	posBegin = 1;
 	posEnd   = 0;
 
 	for (pos = 0; pos < end && (!n2 || n2 != n1); ++pos) {
-		if (crcBufRead_[pos] == chBegin) {
+		if (bufRead_[pos] == chBegin) {
 			if (++n1 == 1) posBegin = pos;
 		}
-		else if (crcBufRead_[pos] == chEnd) {
+		else if (bufRead_[pos] == chEnd) {
 			if (++n2 == n1) posEnd = pos;
 		}
 	}
@@ -169,21 +176,132 @@ void TcpClient::RegisterWrite(const CBSlot& slot) {
 	cbfWrite_.connect(slot);
 }
 
+void TcpClient::RegisterMessage(const MsgSlot& slot) {
+	cbfMsg_.disconnect_all_slots();
+	cbfMsg_.connect(slot);
+}
+
+void TcpClient::SetFixedFrame(size_t length) {
+	MtxLck lck(mtxRead_);
+	frmMode_ = length ? TCP_FRAME_FIXED : TCP_FRAME_NONE;
+	frmLen_  = length < bufRead_.Capacity() ? length : bufRead_.Capacity();
+}
+
+void TcpClient::SetDelimFrame(const char* delim, size_t n, size_t maxLen) {
+	MtxLck lck(mtxRead_);
+	frmMode_  = delim && n ? TCP_FRAME_DELIM : TCP_FRAME_NONE;
+	frmDelim_ = frmMode_ == TCP_FRAME_DELIM ? string(delim, n) : string();
+	frmMax_   = maxLen < bufRead_.Capacity() / 2 ? maxLen : bufRead_.Capacity() / 2;
+	frmScan_  = 0;
+	frmSkip_  = false;
+}
+
+void TcpClient::SetLengthFrame(int bytes, bool bigEndian, size_t maxLen) {
+	MtxLck lck(mtxRead_);
+	frmMode_      = bytes == 1 || bytes == 2 || bytes == 4 ? TCP_FRAME_LENGTH : TCP_FRAME_NONE;
+	frmLen_       = bytes;
+	frmBigEndian_ = bigEndian;
+	frmMax_       = maxLen < bufRead_.Capacity() / 2 ? maxLen : bufRead_.Capacity() / 2;
+}
+
 void TcpClient::start_read() {
-	sock_.async_read_some(buffer(pckRead_.get(), TCP_PACK_SIZE),
-			boost::bind(&TcpClient::handle_read, this,
-				placeholders::error, placeholders::bytes_transferred));
+	size_t n;
+	{// 优先直接写入接收缓冲区的空闲区
+		MtxLck lck(mtxRead_);
+		rdptr_ = bufRead_.WriteSpan(n);
+		if (!n) {
+			rdptr_ = pckRead_.get();
+			n = TCP_PACK_SIZE;
+		}
+	}
+	sock_.async_read_some(buffer(rdptr_, n),
+			keep_.Wrap(boost::bind(&TcpClient::handle_read, this,
+				placeholders::error, placeholders::bytes_transferred)));
 }
 
 void TcpClient::start_write() {
-	int towrite(crcBufWrite_.size());
-	if (towrite) {
-		sock_.async_write_some(buffer(crcBufWrite_.linearize(), towrite),
-				boost::bind(&TcpClient::handle_write, this,
-					placeholders::error, placeholders::bytes_transferred));
+	const char *p1, *p2;
+	size_t n1, n2;
+	if ((writing_ = bufWrite_.Spans(p1, n1, p2, n2) > 0)) {
+		boost::array<const_buffer, 2> bufs = {{ buffer(p1, n1), buffer(p2, n2) }};
+		sock_.async_write_some(bufs,
+				keep_.Wrap(boost::bind(&TcpClient::handle_write, this,
+					placeholders::error, placeholders::bytes_transferred)));
+	}
+}
+
+void TcpClient::extract_frames() {
+	unsigned char head[4];
+	size_t size, len, ndelim(frmDelim_.size());
+	int pos;
+
+	while (true) {
+		{
+			MtxLck lck(mtxRead_);
+			size = bufRead_.Size();
+			pos  = -1;
+			if (frmMode_ == TCP_FRAME_DELIM && size >= ndelim) {// 仅查找新到达的数据
+				pos = bufRead_.Find(frmDelim_.data(), ndelim, frmScan_ >= ndelim ? frmScan_ - ndelim + 1 : 0);
+				frmScan_ = pos < 0 ? size : 0;
+			}
+			else if (frmMode_ == TCP_FRAME_LENGTH && size >= frmLen_) bufRead_.Peek((char*) head, frmLen_);
+		}
+
+		if (frmMode_ == TCP_FRAME_FIXED) {
+			if (size < frmLen_) break;
+			deliver(0, frmLen_, 0);
+		}
+		else if (frmMode_ == TCP_FRAME_DELIM) {
+			if (pos >= 0 && size_t(pos) <= frmMax_ && !frmSkip_) deliver(0, pos, ndelim);
+			else if (pos >= 0 || size > frmMax_ + ndelim) {// 超长: 丢弃至下一个分隔符. 保留可能是分隔符前部的数据
+				len = pos >= 0 ? pos + ndelim : size - ndelim + 1;
+				MtxLck lck(mtxRead_);
+				bufRead_.Erase(len);
+				frmDropped_ += len;
+				frmScan_ = 0;
+				frmSkip_ = pos < 0;
+			}
+			else break;
+		}
+		else if (frmMode_ == TCP_FRAME_LENGTH) {
+			if (size < frmLen_) break;
+			len = 0;
+			for (size_t i = 0; i < frmLen_; ++i) {
+				if (frmBigEndian_) len = (len << 8) | head[i];
+				else len |= size_t(head[i]) << (8 * i);
+			}
+			if (len > frmMax_) {// 失步: 清空
+				MtxLck lck(mtxRead_);
+				bufRead_.Erase(size);
+				frmDropped_ += size;
+				break;
+			}
+			if (size < frmLen_ + len) break;
+			deliver(frmLen_, len, 0);
+		}
+		else break;
 	}
 }
 
+void TcpClient::deliver(size_t skip, size_t len, size_t tail) {
+	const char *p1, *p2, *msg;
+	size_t n1, n2;
+	{
+		MtxLck lck(mtxRead_);
+		bufRead_.Spans(p1, n1, p2, n2);
+		if (skip + len <= n1) msg = p1 + skip;
+		else if (skip >= n1)  msg = p2 + (skip - n1);
+		else {// 跨越回绕点: 复制为连续内存
+			if (frmCopy_.size() < len) frmCopy_.resize(len);
+			bufRead_.Peek(&frmCopy_[0], len, skip);
+			msg = &frmCopy_[0];
+		}
+	}
+	cbfMsg_(this, msg, len);
+	MtxLck lck(mtxRead_);
+	bufRead_.Erase(skip + len + tail);
+}
+
 /* 响应async_函数的回调函数 */
 void TcpClient::handle_connect(const error_code& ec) {
 	cbfConn_(this, ec);
@@ -196,17 +314,25 @@ void TcpClient::handle_connect(const error_code& ec) {
 void TcpClient::handle_read(const error_code& ec, int n) {
 	if (!ec) {
 		MtxLck lck(mtxRead_);
-		for (int i = 0; i < n; ++i) crcBufRead_.push_back(pckRead_[i]);
+		if (rdptr_ == pckRead_.get()) {// 接收缓冲区已满: 覆盖最早的数据
+			bufRead_.Push(rdptr_, n, true);
+			frmScan_ = 0;
+		}
+		else bufRead_.Commit(n);
 	}
+	if (!ec && frmMode_ != TCP_FRAME_NONE) extract_frames();
 	cbfRead_(this, ec);
 	if (!ec) start_read();
 }
 
 void TcpClient::handle_write(const error_code& ec, int n) {
-	if (!ec) {
+	{
 		MtxLck lck(mtxWrite_);
-		crcBufWrite_.erase_begin(n);
-		start_write();
+		if (!ec) {
+			bufWrite_.Erase(n);
+			start_write();
+		}
+		else writing_ = false;
 	}
 	cbfWrite_(this, ec);
 }
@@ -250,7 +376,7 @@ void TcpServer::start_accept() {
 	if (accept_.is_open()) {
 		TcpClient* client = new TcpClient;
 		accept_.async_accept(client->Socket(),
-				boost::bind(&TcpServer::handle_accept, this, client, placeholders::error));
+				keep_.Wrap(boost::bind(&TcpServer::handle_accept, this, client, placeholders::error)));
 	}
 }
 
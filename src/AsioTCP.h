@@ -27,6 +27,13 @@
  *
  * @version 1.3
  * @date 2023-11-03
+ *
+ * @version 1.4
+ * @date 2026-10-18
+ * @note
+ * - 收发缓冲区改为连续存储的ByteRing: 异步读操作直接写入空闲区, 发送时以两段连续内存整块写出
+ * - 客户端可选的消息分帧: 定长、分隔符、长度前缀. 完整消息以零拷贝视图投递给回调函数,
+ *   处理被拆分或合并的TCP报文段
  */
 
 #ifndef ASIOTCP_H_
@@ -36,14 +43,27 @@
 #include <boost/system/error_code.hpp>
 #include <boost/signals2/signal.hpp>
 #include <string>
+#include <vector>
 #include "BoostAsioKeep.h"
 #include "BoostInclude.h"
+#include "ByteRing.h"
 
 using std::string;
 /////////////////////////////////////////////////////////////////////
 typedef boost::asio::ip::tcp	BoostTcp;		// boost::ip::tcp
 typedef BoostTcp::socket		BoostTcpSock;	// boost::ip::tcp::socket
 #define TCP_PACK_SIZE		1500
+#define TCP_RING_SIZE		(TCP_PACK_SIZE * 32)	// 收发缓冲区容量, 取整为2的整数次幂
+
+/*!
+ * @brief 客户端消息分帧方式
+ */
+enum {
+	TCP_FRAME_NONE,		///< 不分帧: 由RegisterRead的回调函数自行调用Lookup()/Read()
+	TCP_FRAME_FIXED,	///< 定长消息
+	TCP_FRAME_DELIM,	///< 以分隔符结尾的消息. 投递的消息不含分隔符
+	TCP_FRAME_LENGTH	///< 长度前缀: 1/2/4字节无符号数表示其后的消息长度. 投递的消息不含前缀
+};
 /////////////////////////////////////////////////////////////////////
 /*--------------------- 客户端 ---------------------*/
 class TcpClient {
@@ -57,23 +77,45 @@ public:
 	 */
 	typedef boost::signals2::signal<void (TcpClient*, boost::system::error_code)> CBF;
 	typedef CBF::slot_type CBSlot;
+	/*!
+	 * @brief 声明消息回调函数及插槽
+	 * @param 1 客户端对象
+	 * @param 2 消息首地址. 仅在回调函数内有效
+	 * @param 3 消息长度
+	 */
+	typedef boost::signals2::signal<void (TcpClient*, const char*, size_t)> CBMsg;
+	typedef CBMsg::slot_type MsgSlot;
 
 protected:
 	/* socket资源 */
-	BoostAsioKeep keep_;	//< 提供boost::asio::io_contexts对象, 并在实例存在期间保持其运行
+	BoostAsioKeep keep_;	//< 线程池句柄: 串行化回调函数, 并在实例销毁前丢弃未执行的回调函数
 	BoostTcpSock sock_;		//< 套接口
 
 	/* 读写缓冲区 */
-	ArrayChar pckRead_;			//< 缓冲区: 单次接收
-	ArrayCharCrc crcBufRead_;	//< 缓冲区: 所有接收
-	ArrayCharCrc crcBufWrite_;	//< 缓冲区: 所有待写入
+	ArrayChar pckRead_;			//< 缓冲区: 单次接收. 接收缓冲区已满时使用
+	char* rdptr_;				//< 正在执行的异步读操作的写入位置
+	ByteRing bufRead_;			//< 缓冲区: 所有接收. 异步读操作直接写入其空闲区
+	ByteRing bufWrite_;			//< 缓冲区: 所有待写入
+	bool writing_;				//< 正在执行异步写操作
 	boost::mutex mtxRead_;		//< 互斥锁: 从套接口读取
 	boost::mutex mtxWrite_;		//< 互斥锁: 向套接口写入
 
+	/* 消息分帧 */
+	int frmMode_;			//< 分帧方式
+	size_t frmLen_;			//< 定长: 消息长度; 长度前缀: 前缀字节数
+	string frmDelim_;		//< 分隔符
+	bool frmBigEndian_;		//< 长度前缀: 高字节在前
+	size_t frmMax_;			//< 最大消息长度
+	size_t frmScan_;		//< 分隔符分帧: 已查找过分隔符的数据长度, 避免重复查找
+	bool frmSkip_;			//< 分隔符分帧: 正在丢弃超长消息的剩余部分
+	std::vector<char> frmCopy_;	//< 跨越回绕点的消息的连续副本. 重复使用, 不逐条分配
+	unsigned long long frmDropped_;	//< 因超长被丢弃的字节数
+
 	/* 回调接口 */
 	CBF  cbfConn_;	//< connect回调函数
 	CBF  cbfRead_;	//< read回调函数
 	CBF  cbfWrite_;	//< write回调函数
+	CBMsg cbfMsg_;	//< 消息回调函数
 
 	// 故障描述
 	string errDesc_;	///< 故障描述
@@ -183,6 +225,39 @@ public:
 	 * @param slot 函数插槽
 	 */
 	void RegisterWrite(const CBSlot& slot);
+	/*!
+	 * @brief 注册消息回调函数, 处理分帧后的完整消息
+	 * @param slot 函数插槽
+	 * @note
+	 * - 回调函数在本实例的strand中执行, 消息视图仅在回调函数内有效
+	 * - 分帧模式下不应再调用Read()/Lookup()
+	 */
+	void RegisterMessage(const MsgSlot& slot);
+	/*!
+	 * @brief 定长分帧
+	 * @param length  消息长度
+	 */
+	void SetFixedFrame(size_t length);
+	/*!
+	 * @brief 分隔符分帧
+	 * @param delim   分隔符
+	 * @param n       分隔符长度
+	 * @param maxLen  最大消息长度. 超过此长度仍未找到分隔符时丢弃数据
+	 */
+	void SetDelimFrame(const char* delim, size_t n, size_t maxLen = TCP_PACK_SIZE);
+	/*!
+	 * @brief 长度前缀分帧
+	 * @param bytes      前缀字节数: 1, 2或4
+	 * @param bigEndian  高字节在前
+	 * @param maxLen     最大消息长度. 超过此长度时视为失步, 清空接收缓冲区
+	 */
+	void SetLengthFrame(int bytes, bool bigEndian = true, size_t maxLen = TCP_PACK_SIZE);
+	/*!
+	 * @brief 因超长或失步被丢弃的字节数
+	 */
+	unsigned long long DroppedBytes() const {
+		return frmDropped_;
+	}
 
 protected:
 	/*!
@@ -191,8 +266,21 @@ protected:
 	void start_read();
 	/*!
 	 * @brief 尝试发送缓冲区数据
+	 * @note
+	 * 调用者持有发送互斥锁
 	 */
 	void start_write();
+	/*!
+	 * @brief 从接收缓冲区中提取完整消息, 并投递给消息回调函数
+	 */
+	void extract_frames();
+	/*!
+	 * @brief 投递从接收缓冲区起始处开始的消息, 并删除该消息及其前后缀
+	 * @param skip  消息前的前缀长度
+	 * @param len   消息长度
+	 * @param tail  消息后的后缀长度
+	 */
+	void deliver(size_t skip, size_t len, size_t tail);
 	/* 响应async_函数的回调函数 */
 	/*!
 	 * @brief 处理网络连接结果
@@ -228,7 +316,7 @@ public:
 	typedef CallbackFunc::slot_type CBSlot;
 
 protected:
-	BoostAsioKeep keep_;		//< 提供boost::asio::io_service对象, 并在实例存在期间保持其运行
+	BoostAsioKeep keep_;		//< 线程池句柄: 串行化回调函数, 并在实例销毁前丢弃未执行的回调函数
 	BoostTcp::acceptor accept_;	//< 网络服务
 	CallbackFunc cbfAccept_;	//< 回调函数
 	// 故障描述
@@ -176,13 +176,13 @@ int UdpSession::WriteTo(const void* data, const int toWrite, const char* ipPeer,
 void UdpSession::start_read() {
 	if (connected_) {
 		sock_.async_receive(buffer(buffPack_.get(), UDP_PACK_SIZE),
-			bind(&UdpSession::handle_read, this,
-				asio::placeholders::error, asio::placeholders::bytes_transferred));
+			keep_.Wrap(bind(&UdpSession::handle_read, this,
+				asio::placeholders::error, asio::placeholders::bytes_transferred)));
 	}
 	else {
 		sock_.async_receive_from(buffer(buffPack_.get(), UDP_PACK_SIZE), remote_,
-			bind(&UdpSession::handle_read, this,
-				asio::placeholders::error, asio::placeholders::bytes_transferred));
+			keep_.Wrap(bind(&UdpSession::handle_read, this,
+				asio::placeholders::error, asio::placeholders::bytes_transferred)));
 	}
 }
 
@@ -193,5 +193,6 @@ void UdpSession::handle_read(const error_code& ec, const int bytes) {
 		if (blockRead_) cvRcv_.notify_one();
 		else cbfRcv_(buffPack_.get(), bytes);
 	}
-	start_read();
+	// 套接口已关闭或操作被取消时不再继续接收
+	if (sock_.is_open() && ec != error::operation_aborted) start_read();
 }
@@ -75,7 +75,7 @@ public:
 // 成员变量
 protected:
 	// 套接口和连接标志
-	BoostAsioKeep keep_;		//< 提供boost::asio::io_service对象, 并在实例存在期间保持其运行
+	BoostAsioKeep keep_;		//< 线程池句柄: 串行化回调函数, 并在实例销毁前丢弃未执行的回调函数
 	BoostUdpSock sock_;			//< 套接口
 	BoostUdp::endpoint remote_;	//< 远程套接口
 	bool connected_;			///< 面向连接的UDP
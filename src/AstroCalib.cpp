@@ -0,0 +1,583 @@
+/**
+ * @file AstroCalib.cpp 全天相机天文标定: 由晴夜星像自动拟合镜头模型
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <complex>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include "ADefine.h"
+#include "AMath.h"
+#include "Ephemeris.h"
+#include "AstroCalib.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::property_tree;
+using namespace AstroUtil;
+
+#define ASTRO_PARAMS	6		///< 拟合参数: 天顶坐标, 比例, 方位, 径向畸变
+
+typedef std::complex<double> Point;	///< 平面坐标
+
+/*--------------------------------------------------------------------------*/
+/* 三角形匹配 */
+struct Triangle {
+	double u, v;	///< 边长比: 中边/长边, 短边/长边
+	int vtx[3];		///< 顶点: 依次对应短边、中边、长边
+	int orient;		///< 顶点环绕方向
+};
+typedef std::vector<Triangle> TriangleVec;
+
+/*!
+ * @brief 构建点集的三角形
+ * @param sideMin  长边下限
+ * @note
+ * 剔除狭长三角形和近似等腰三角形: 前者方向不稳定, 后者顶点次序不确定
+ */
+static void make_triangles(const std::vector<Point>& pts, double sideMin, TriangleVec& tris) {
+	int n = pts.size(), i, j, k, s0, s1, s2;
+	double d[3], gap = 3.0 * ASTRO_TRI_TOL;
+
+	tris.clear();
+	for (i = 0; i < n; ++i) {
+		for (j = i + 1; j < n; ++j) {
+			for (k = j + 1; k < n; ++k) {
+				int o[3] = {i, j, k};
+				d[0] = std::abs(pts[j] - pts[k]);
+				d[1] = std::abs(pts[i] - pts[k]);
+				d[2] = std::abs(pts[i] - pts[j]);
+				s0 = 0, s1 = 1, s2 = 2;
+				if (d[s0] > d[s1]) std::swap(s0, s1);
+				if (d[s1] > d[s2]) std::swap(s1, s2);
+				if (d[s0] > d[s1]) std::swap(s0, s1);
+				if (d[s2] < sideMin || d[s0] < 0.1 * d[s2]) continue;
+				if (d[s1] - d[s0] < gap * d[s2] || d[s2] - d[s1] < gap * d[s2]) continue;
+
+				Triangle tri;
+				tri.u = d[s1] / d[s2];
+				tri.v = d[s0] / d[s2];
+				tri.vtx[0] = o[s0];
+				tri.vtx[1] = o[s1];
+				tri.vtx[2] = o[s2];
+				Point e1 = pts[tri.vtx[1]] - pts[tri.vtx[0]];
+				Point e2 = pts[tri.vtx[2]] - pts[tri.vtx[0]];
+				tri.orient = e1.real() * e2.imag() - e1.imag() * e2.real() > 0.0 ? 1 : -1;
+				tris.push_back(tri);
+			}
+		}
+	}
+}
+
+static int triangle_key(int iu, int iv) {
+	return iu * 1024 + iv;
+}
+
+/*--------------------------------------------------------------------------*/
+/* 镜头模型与拟合参数 */
+static void lens2param(const AllSkyLens& lens, double p[]) {
+	p[0] = lens.x0;
+	p[1] = lens.y0;
+	p[2] = lens.scale;
+	p[3] = lens.rotation;
+	p[4] = lens.k2;
+	p[5] = lens.k3;
+}
+
+static void param2lens(const double p[], AllSkyLens& lens) {
+	lens.x0       = p[0];
+	lens.y0       = p[1];
+	lens.scale    = p[2];
+	lens.rotation = p[3];
+	lens.k2       = p[4];
+	lens.k3       = p[5];
+}
+
+/* 配对参考星的预测位置: x0, y0, x1, y1, ... */
+static void predict(const AllSkyLens& lens, const std::deque<AstroPair>& pairs, std::vector<double>& f) {
+	int n = pairs.size(), i;
+	f.resize(2 * n);
+	for (i = 0; i < n; ++i) lens.Horizon2Pixel(pairs[i].azi, pairs[i].ele, f[2 * i], f[2 * i + 1]);
+}
+
+/*--------------------------------------------------------------------------*/
+AstroCalibrator::AstroCalibrator(const Parameter* param) {
+	param_ = param;
+	boost::filesystem::path pathModel(param->sampleDir);
+	pathModel /= ASTRO_MODEL_FILE;
+	pathModel_ = pathModel.string();
+	airp_ = SitePressure(param->siteAlt);
+	ats_.SetSite(param->siteLon, param->siteLat, param->siteAlt, 0);
+	width_ = height_ = 0;
+	calibrated_ = hasPublished_ = false;
+	rms_ = 0.0;
+}
+
+AstroCalibrator::~AstroCalibrator() {
+	Stop();
+}
+
+bool AstroCalibrator::Start() {
+	LoadBrightStars(param_->astroCatalog, catalog_);
+	if (catalog_.size() < 2 * ASTRO_TRI_STARS) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], too few catalog stars[%d]", __FILE__, __FUNCTION__, int(catalog_.size()));
+		return false;
+	}
+	queFrm_.Clear();
+	thrdCalib_.reset(new boost::thread(boost::bind(&AstroCalibrator::thread_calib, this)));
+	return true;
+}
+
+void AstroCalibrator::Stop() {
+	if (!thrdCalib_.unique()) return;
+	interrupt_thread(thrdCalib_);
+}
+
+void AstroCalibrator::RegisterModel(const CBSlot& slot) {
+	cbfModel_.connect(slot);
+}
+
+void AstroCalibrator::Push(xmFrmPtr frame) {
+	// 标定耗时可能超过曝光周期, 丢弃未处理的较早帧是预期行为
+	queFrm_.Push(frame);
+}
+
+bool AstroCalibrator::LoadModel(const std::string& filePath, int width, int height, AllSkyLens& lens) {
+	try {
+		if (!boost::filesystem::exists(filePath)) return false;
+
+		ptree pt;
+		read_xml(filePath, pt);
+		if (pt.get("LensModel.Image.<xmlattr>.Width", 0) != width
+			|| pt.get("LensModel.Image.<xmlattr>.Height", 0) != height) return false;
+
+		AllSkyLens model;
+		model.x0       = pt.get<double>("LensModel.Lens.<xmlattr>.CenterX");
+		model.y0       = pt.get<double>("LensModel.Lens.<xmlattr>.CenterY");
+		model.scale    = pt.get<double>("LensModel.Lens.<xmlattr>.Scale");
+		model.rotation = pt.get<double>("LensModel.Lens.<xmlattr>.Rotation");
+		model.flip     = pt.get<bool>("LensModel.Lens.<xmlattr>.Flip");
+		model.k2       = pt.get("LensModel.Lens.<xmlattr>.K2", 0.0);
+		model.k3       = pt.get("LensModel.Lens.<xmlattr>.K3", 0.0);
+		if (model.scale <= 0.0) return false;
+		lens = model;
+		return true;
+	}
+	catch(std::exception& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		return false;
+	}
+}
+
+void AstroCalibrator::thread_calib() {
+	xmFrmPtr frame;
+
+	while (true) {
+		queFrm_.Wait(frame);
+		if (frame) calibrate(frame);
+		frame.reset();
+		boost::this_thread::interruption_point();
+	}
+}
+
+void AstroCalibrator::calibrate(xmFrmPtr frame) {
+	ptime tmStart = microsec_clock::universal_time();
+	ptime utc;
+	try {
+		utc = from_iso_extended_string(frame->dateObs);
+	}
+	catch(std::exception& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], invalid DATE-OBS[%s]", __FILE__, __FUNCTION__, frame->dateObs.c_str());
+		return;
+	}
+	utc += microseconds(int64_t(frame->expTime * 5E5));	// 曝光中间时刻
+
+	// 图像尺寸变化: 重新加载标定结果
+	if (frame->width != width_ || frame->height != height_) {
+		width_  = frame->width;
+		height_ = frame->height;
+		pairs_.clear();
+		rms_ = 0.0;
+		calibrated_ = hasPublished_ = LoadModel(pathModel_, width_, height_, model_);
+		if (calibrated_) published_ = model_;
+	}
+
+	reference_stars(utc);
+	if (int(refs_.size()) < ASTRO_PAIRS_MIN || int(frame->stars.size()) < ASTRO_PAIRS_MIN) return;
+
+	// 匹配: 已标定时预测位置, 失败后重新三角形匹配
+	MatchVec matches;
+	if (calibrated_) match_predict(frame.get(), model_, matches);
+	if (int(matches.size()) < ASTRO_PAIRS_MIN) {
+		AllSkyLens lens;
+		lens.Reset(param_, width_, height_);
+		if (!match_triangle(frame.get(), lens)) return;
+		match_predict(frame.get(), lens, matches);
+		if (int(matches.size()) < ASTRO_PAIRS_MIN) return;
+		if (calibrated_) _gLog.Write(LOG_WARN, "lens model does not match stars, camera may have moved. Recalibrating");
+		pairs_.clear();
+		model_ = lens;
+		calibrated_ = false;
+	}
+
+	// 累计配对并拟合
+	for (MatchVec::iterator it = matches.begin(); it != matches.end(); ++it) {
+		const xmStarPtr& star = frame->stars[it->first];
+		const StarHorizon& ref = refs_[it->second];
+		AstroPair pair;
+		pair.azi = ref.azi;
+		pair.ele = ref.ele;
+		pair.x   = star->x;
+		pair.y   = star->y;
+		pairs_.push_back(pair);
+	}
+	while (pairs_.size() > ASTRO_PAIRS_MAX) pairs_.pop_front();
+
+	AllSkyLens lens(model_);
+	double rms = fit(lens);
+	if (rms < 0.0 || rms > ASTRO_RMS_MAX) {
+		if (calibrated_) _gLog.Write(LOG_WARN, "lens model fit failed, %d pairs, rms = %.2f pixel", int(pairs_.size()), rms);
+		return;
+	}
+	model_ = lens;
+	rms_   = rms;
+	calibrated_ = true;
+
+	match_predict(frame.get(), model_, matches);
+	fill_frame(frame.get(), matches);
+	publish(utc);
+
+	double secs = (microsec_clock::universal_time() - tmStart).total_microseconds() * 1E-6;
+	if (secs > param_->sampleCycle)
+		_gLog.Write(LOG_WARN, "astrometric calibration took %.1f seconds, longer than sample cycle", secs);
+}
+
+void AstroCalibrator::reference_stars(const ptime& utc) {
+	ats_.SetMJD(Ephemeris::MJD(utc));
+	BrightStarHorizon(ats_, catalog_, airp_, ASTRO_ELE_MIN, refs_);
+}
+
+void AstroCalibrator::match_predict(const xmFrame* frame, const AllSkyLens& lens, MatchVec& matches) {
+	const xmStarPtrVec& stars = frame->stars;
+	int n = stars.size(), nref = refs_.size(), i, j, k, cx, cy, best;
+	double r = ASTRO_MATCH_DIST * lens.scale, r2 = r * r, x, y, d2, dmin;
+	int cols = int(frame->width / r) + 1;
+	boost::unordered_map<int, std::vector<int> > grid;
+	std::vector<int> owner(n, -1);
+	std::vector<double> dist(n);
+
+	matches.clear();
+	for (k = 0; k < n; ++k) {
+		x = stars[k]->x, y = stars[k]->y;
+		if (x < 0.0 || y < 0.0 || x >= frame->width || y >= frame->height) continue;
+		grid[int(y / r) * cols + int(x / r)].push_back(k);
+	}
+
+	for (k = 0; k < nref; ++k) {
+		lens.Horizon2Pixel(refs_[k].azi, refs_[k].ele, x, y);
+		if (x < 0.0 || y < 0.0 || x >= frame->width || y >= frame->height) continue;
+		cx = int(x / r), cy = int(y / r);
+		best = -1, dmin = r2;
+		for (j = cy - 1; j <= cy + 1; ++j) {
+			for (i = cx - 1; i <= cx + 1; ++i) {
+				if (i < 0 || j < 0 || i >= cols) continue;
+				boost::unordered_map<int, std::vector<int> >::const_iterator it = grid.find(j * cols + i);
+				if (it == grid.end()) continue;
+				for (std::vector<int>::const_iterator s = it->second.begin(); s != it->second.end(); ++s) {
+					d2 = pow(stars[*s]->x - x, 2) + pow(stars[*s]->y - y, 2);
+					if (d2 < dmin) dmin = d2, best = *s;
+				}
+			}
+		}
+		// 多颗参考星指向同一星像时保留最近者
+		if (best >= 0 && (owner[best] < 0 || dmin < dist[best])) {
+			owner[best] = k;
+			dist[best]  = dmin;
+		}
+	}
+	for (k = 0; k < n; ++k) {
+		if (owner[k] >= 0) matches.push_back(std::make_pair(k, owner[k]));
+	}
+}
+
+bool AstroCalibrator::match_triangle(const xmFrame* frame, AllSkyLens& lens) {
+	const xmStarPtrVec& stars = frame->stars;
+	int nd, nr, i, j, k, p, iu, iv;
+	std::vector<int> order(stars.size());
+	std::vector<Point> ptDet, ptRef;
+	TriangleVec triDet, triRef;
+
+	// 最亮星像: 平面坐标(x, -y). 参考星取两倍数量, 补偿低空消光造成的亮度次序差异
+	for (i = 0; i < int(order.size()); ++i) order[i] = i;
+	std::sort(order.begin(), order.end(), [&stars](int a, int b) {
+		return stars[a]->flux > stars[b]->flux;
+	});
+	nd = std::min(int(order.size()), ASTRO_TRI_STARS);
+	for (i = 0; i < nd; ++i) ptDet.push_back(Point(stars[order[i]]->x, -stars[order[i]]->y));
+	// 参考星: 等距投影平面坐标(z * sinA, z * cosA), 角度
+	nr = std::min(int(refs_.size()), 2 * ASTRO_TRI_STARS);
+	for (i = 0; i < nr; ++i) {
+		double z = 90.0 - refs_[i].ele, a = refs_[i].azi * AU_D2R;
+		ptRef.push_back(Point(z * sin(a), z * cos(a)));
+	}
+	make_triangles(ptDet, 10.0, triDet);
+	make_triangles(ptRef, 3.0, triRef);
+
+	// 网格散列检索边长比相近的三角形, 按顶点对应关系投票. 镜像与否分别计票
+	boost::unordered_map<int, std::vector<int> > hash;
+	for (i = 0; i < int(triRef.size()); ++i)
+		hash[triangle_key(int(triRef[i].u / ASTRO_TRI_TOL), int(triRef[i].v / ASTRO_TRI_TOL))].push_back(i);
+	std::vector<int> votes[2];
+	votes[0].assign(nd * nr, 0);
+	votes[1].assign(nd * nr, 0);
+	for (TriangleVec::iterator td = triDet.begin(); td != triDet.end(); ++td) {
+		iu = int(td->u / ASTRO_TRI_TOL);
+		iv = int(td->v / ASTRO_TRI_TOL);
+		for (j = iu - 1; j <= iu + 1; ++j) {
+			for (k = iv - 1; k <= iv + 1; ++k) {
+				boost::unordered_map<int, std::vector<int> >::const_iterator it = hash.find(triangle_key(j, k));
+				if (it == hash.end()) continue;
+				for (std::vector<int>::const_iterator c = it->second.begin(); c != it->second.end(); ++c) {
+					const Triangle& tr = triRef[*c];
+					if (fabs(tr.u - td->u) > ASTRO_TRI_TOL || fabs(tr.v - td->v) > ASTRO_TRI_TOL) continue;
+					p = td->orient == tr.orient ? 0 : 1;
+					for (i = 0; i < 3; ++i) ++votes[p][td->vtx[i] * nr + tr.vtx[i]];
+				}
+			}
+		}
+	}
+	p = *std::max_element(votes[0].begin(), votes[0].end()) >= *std::max_element(votes[1].begin(), votes[1].end()) ? 0 : 1;
+
+	// 候选对应: 按票数降序, 星像和参考星均不重复
+	std::vector<std::pair<int, int> > cand;	// 票数, 星像 * nr + 参考星
+	std::vector<int> candDet, candRef;
+	std::vector<bool> usedDet(nd, false), usedRef(nr, false);
+	for (i = 0; i < nd * nr; ++i) {
+		if (votes[p][i] >= 2) cand.push_back(std::make_pair(votes[p][i], i));
+	}
+	std::sort(cand.begin(), cand.end(), std::greater<std::pair<int, int> >());
+	for (i = 0; i < int(cand.size()) && int(candDet.size()) < 15; ++i) {
+		int d = cand[i].second / nr, r = cand[i].second % nr;
+		if (usedDet[d] || usedRef[r]) continue;
+		usedDet[d] = usedRef[r] = true;
+		candDet.push_back(d);
+		candRef.push_back(r);
+	}
+	int nc = candDet.size();
+	if (nc < 4) return false;
+
+	// 相似变换: D = a * Q + t. 镜像时Q = (-z * sinA, z * cosA)
+	std::vector<Point> D(nc), Q(nc);
+	for (i = 0; i < nc; ++i) {
+		D[i] = ptDet[candDet[i]];
+		Q[i] = p ? Point(-ptRef[candRef[i]].real(), ptRef[candRef[i]].imag()) : ptRef[candRef[i]];
+	}
+	// 两点确定变换, 选择内点最多者
+	std::vector<int> inlier, inlierBest;
+	for (i = 0; i < nc; ++i) {
+		for (j = i + 1; j < nc; ++j) {
+			if (std::abs(Q[i] - Q[j]) < 1.0) continue;
+			Point a = (D[i] - D[j]) / (Q[i] - Q[j]);
+			Point t = D[i] - a * Q[i];
+			double tol = ASTRO_MATCH_DIST * std::abs(a);
+			inlier.clear();
+			for (k = 0; k < nc; ++k) {
+				if (std::abs(a * Q[k] + t - D[k]) < tol) inlier.push_back(k);
+			}
+			if (inlier.size() > inlierBest.size()) inlierBest.swap(inlier);
+		}
+	}
+	int m = inlierBest.size();
+	if (m < 4) return false;
+
+	// 最小二乘: X = a_re * Qx - a_im * Qy + t_re, Y = a_im * Qx + a_re * Qy + t_im
+	AMath math;
+	std::vector<double> x(4 * 2 * m), y(2 * m);
+	double c[4];
+	for (i = 0; i < m; ++i) {
+		const Point& q = Q[inlierBest[i]];
+		const Point& d = D[inlierBest[i]];
+		for (k = 0; k < 2; ++k) {
+			int row = 2 * i + k;
+			x[row]         = k ? q.imag() : q.real();
+			x[2 * m + row] = k ? q.real() : -q.imag();
+			x[4 * m + row] = k ? 0.0 : 1.0;
+			x[6 * m + row] = k ? 1.0 : 0.0;
+			y[row]         = k ? d.imag() : d.real();
+		}
+	}
+	if (!math.LSFitLinear(2 * m, 4, &x[0], &y[0], c)) return false;
+
+	double scale = sqrt(c[0] * c[0] + c[1] * c[1]);
+	double phi   = atan2(c[1], c[0]) * AU_R2D;
+	if (scale < 0.5 * lens.scale || scale > 2.0 * lens.scale) return false;
+	lens.x0       = c[2];
+	lens.y0       = -c[3];
+	lens.scale    = scale;
+	lens.flip     = p == 1;
+	lens.rotation = cycmod(p ? -phi : phi, 360.0);
+	lens.k2 = lens.k3 = 0.0;
+	return lens.x0 >= 0.0 && lens.y0 >= 0.0 && lens.x0 < frame->width && lens.y0 < frame->height;
+}
+
+double AstroCalibrator::fit(AllSkyLens& lens) {
+	AMath math;
+	int n, m, np, i, j, iter, round;
+	double p[ASTRO_PARAMS], q[ASTRO_PARAMS], dp[ASTRO_PARAMS], step[ASTRO_PARAMS];
+	double rms(-1.0), thresh, dmax;
+	std::vector<double> x, y, f0, f1;
+	AllSkyLens trial(lens);
+
+	for (round = 0; round < 5; ++round) {
+		n  = pairs_.size();
+		if (n < ASTRO_PAIRS_MIN) return -1.0;
+		m  = 2 * n;
+		np = n >= ASTRO_PAIRS_DIST ? ASTRO_PARAMS : 4;	// 配对较少时固定径向畸变
+		x.resize(np * m);
+		y.resize(m);
+
+		// 高斯-牛顿迭代, 数值偏导
+		for (iter = 0; iter < 20; ++iter) {
+			lens2param(lens, p);
+			step[0] = step[1] = 0.1;
+			step[2] = 1E-4 * lens.scale;
+			step[3] = 1E-3;
+			step[4] = step[5] = 1E-4;
+			predict(lens, pairs_, f0);
+			for (i = 0; i < n; ++i) {
+				y[2 * i]     = pairs_[i].x - f0[2 * i];
+				y[2 * i + 1] = pairs_[i].y - f0[2 * i + 1];
+			}
+			for (j = 0; j < np; ++j) {
+				std::copy(p, p + ASTRO_PARAMS, q);
+				q[j] += step[j];
+				param2lens(q, trial);
+				predict(trial, pairs_, f1);
+				for (i = 0; i < m; ++i) x[j * m + i] = (f1[i] - f0[i]) / step[j];
+			}
+			if (!math.LSFitLinear(m, np, &x[0], &y[0], dp)) return -1.0;
+			for (j = 0, dmax = 0.0; j < np; ++j) {
+				p[j] += dp[j];
+				if (fabs(dp[j]) / step[j] > dmax) dmax = fabs(dp[j]) / step[j];
+			}
+			param2lens(p, lens);
+			if (lens.scale <= 0.0) return -1.0;
+			if (dmax < 1E-3) break;
+		}
+
+		// 残差及离群配对
+		predict(lens, pairs_, f0);
+		std::vector<double> resid(n);
+		for (i = 0, rms = 0.0; i < n; ++i) {
+			resid[i] = pow(pairs_[i].x - f0[2 * i], 2) + pow(pairs_[i].y - f0[2 * i + 1], 2);
+			rms += resid[i];
+		}
+		rms = sqrt(rms / n);
+		thresh = 3.0 * rms > 1.0 ? 3.0 * rms : 1.0;
+		thresh *= thresh;
+		std::deque<AstroPair> kept;
+		for (i = 0; i < n; ++i) {
+			if (resid[i] <= thresh) kept.push_back(pairs_[i]);
+		}
+		if (int(kept.size()) == n) break;
+		pairs_.swap(kept);
+	}
+	lens.rotation = cycmod(lens.rotation, 360.0);
+	return rms;
+}
+
+void AstroCalibrator::fill_frame(xmFrame* frame, const MatchVec& matches) {
+	double lst = ats_.LocalSiderealTime();
+	double azi, ele, alt, ha, ra, dec, dra, ddec;
+	double sra(0.0), sdec(0.0);
+	int n = matches.size();
+
+	for (xmStarPtrVec::iterator it = frame->stars.begin(); it != frame->stars.end(); ++it) (*it)->matched = 0;
+	for (MatchVec::const_iterator it = matches.begin(); it != matches.end(); ++it) {
+		xmStarPtr star = frame->stars[it->first];
+		const BrightStar& cat = catalog_[refs_[it->second].idx];
+		// 像元 -> 视地平坐标 -> 真地平坐标 -> 当前历元赤道坐标 -> J2000
+		model_.Pixel2Horizon(star->x, star->y, azi, ele);
+		alt = ele * AU_D2R;
+		alt -= ats_.VisualRefract(alt, airp_, STAR_TEMP) / 60.0 * AU_D2R;
+		ats_.Horizon2Eq(cycmod(azi + 180.0, 360.0) * AU_D2R, alt, ha, dec);
+		ats_.EqReTransfer(cycmod(lst - ha, AU_2PI), dec, ra, dec);
+
+		star->matched = 1;
+		star->raCat   = cat.ra;
+		star->decCat  = cat.dec;
+		star->magCat  = cat.mag;
+		star->raFit   = cycmod(ra * AU_R2D, 360.0);
+		star->decFit  = dec * AU_R2D;
+		dra = star->raFit - cat.ra;
+		if (dra > 180.0) dra -= 360.0;
+		else if (dra < -180.0) dra += 360.0;
+		dra *= cos(cat.dec * AU_D2R);
+		ddec = star->decFit - cat.dec;
+		sra  += dra * dra;
+		sdec += ddec * ddec;
+	}
+
+	// 天顶的J2000坐标
+	ats_.EqReTransfer(lst, param_->siteLat * AU_D2R, ra, dec);
+	frame->astroFix = n >= ASTRO_PAIRS_MIN;
+	frame->ra0    = cycmod(ra * AU_R2D, 360.0);
+	frame->dec0   = dec * AU_R2D;
+	frame->raErr  = n ? sqrt(sra / n) * 3600.0 : 0.0;
+	frame->decErr = n ? sqrt(sdec / n) * 3600.0 : 0.0;
+}
+
+void AstroCalibrator::publish(const ptime& utc) {
+	// 比较天顶距0、40、80度处的像元位置
+	if (hasPublished_) {
+		double x1, y1, x2, y2, d, dmax(0.0);
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				model_.Horizon2Pixel(j * 90.0, 90.0 - i * 40.0, x1, y1);
+				published_.Horizon2Pixel(j * 90.0, 90.0 - i * 40.0, x2, y2);
+				if ((d = sqrt(pow(x1 - x2, 2) + pow(y1 - y2, 2))) > dmax) dmax = d;
+			}
+		}
+		if (dmax < ASTRO_PUBLISH_PX) return;
+	}
+
+	try {
+		ptree pt;
+		pt.add("LensModel.Image.<xmlattr>.Width",   width_);
+		pt.add("LensModel.Image.<xmlattr>.Height",  height_);
+		pt.add("LensModel.Lens.<xmlattr>.CenterX",  model_.x0);
+		pt.add("LensModel.Lens.<xmlattr>.CenterY",  model_.y0);
+		pt.add("LensModel.Lens.<xmlattr>.Scale",    model_.scale);
+		pt.add("LensModel.Lens.<xmlattr>.Rotation", model_.rotation);
+		pt.add("LensModel.Lens.<xmlattr>.Flip",     model_.flip);
+		pt.add("LensModel.Lens.<xmlattr>.K2",       model_.k2);
+		pt.add("LensModel.Lens.<xmlattr>.K3",       model_.k3);
+		pt.add("LensModel.Fit.<xmlattr>.Pairs",     int(pairs_.size()));
+		pt.add("LensModel.Fit.<xmlattr>.RMS",       rms_);
+		pt.add("LensModel.Fit.<xmlattr>.UTC",       to_iso_extended_string(utc));
+
+		// 写入临时文件后替换, 避免云量引擎读取到不完整的文件
+		std::string pathTmp = pathModel_ + ".tmp";
+		xml_writer_settings<std::string> settings(' ', 4);
+		write_xml(pathTmp, pt, std::locale(), settings);
+		boost::filesystem::rename(pathTmp, pathModel_);
+	}
+	catch(std::exception& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		return;
+	}
+
+	published_ = model_;
+	hasPublished_ = true;
+	_gLog.Write("Lens model: zenith = (%.2f, %.2f), scale = %.4f pixel/deg, rotation = %.3f%s, k2 = %.4f, k3 = %.4f, %d pairs, rms = %.2f pixel",
+		model_.x0, model_.y0, model_.scale, model_.rotation, model_.flip ? " flip" : "",
+		model_.k2, model_.k3, int(pairs_.size()), rms_);
+	cbfModel_(model_);
+}
@@ -0,0 +1,162 @@
+/**
+ * @file AstroCalib.h 全天相机天文标定: 由晴夜星像自动拟合镜头模型
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 参考星: 亮星表(BrightStar)转换为曝光中间时刻的视地平坐标, 含大气折射
+ * - 初次标定: 亮星三角形匹配. 三角形边长比不随旋转、缩放和镜像变化,
+ *   以网格散列检索星表三角形, 按顶点对应关系投票, 再由相似变换得到镜头模型初值
+ * - 持续标定: 由当前模型预测参考星的像元位置, 以网格散列检索最近的星像.
+ *   预测匹配失败时(如相机被移动)重新进行三角形匹配, 并丢弃已累计的配对
+ * - 累计近期晴夜帧的配对, 以高斯-牛顿迭代拟合天顶坐标、比例、方位和径向畸变,
+ *   迭代剔除离群配对. 配对较少时不拟合径向畸变
+ * - 标定结果存储为测量数据目录下的LensModel.xml, 模型变化超过ASTRO_PUBLISH_PX时回调通知
+ * - 独立线程处理, 仅保留最新提交的帧. 单帧耗时超过采样周期时记录日志
+ */
+
+#ifndef ASTRO_CALIB_H_
+#define ASTRO_CALIB_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/signals2/signal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "BoostInclude.h"
+#include "BoundedQueue.h"
+#include "ATimeSpace.h"
+#include "AllSkyLens.h"
+#include "BrightStar.h"
+#include "Parameter.h"
+#include "xmFrame.h"
+
+#define ASTRO_MODEL_FILE	"LensModel.xml"	///< 标定结果文件名
+#define ASTRO_ELE_MIN		15.0	///< 参考星最低高度角, 角度
+#define ASTRO_TRI_STARS		25		///< 三角形匹配使用的最亮星像/参考星数量
+#define ASTRO_TRI_TOL		0.008	///< 三角形边长比容差
+#define ASTRO_MATCH_DIST	1.0		///< 预测位置匹配半径, 角度
+#define ASTRO_PAIRS_MIN		12		///< 单帧及拟合的最少配对数
+#define ASTRO_PAIRS_DIST	60		///< 拟合径向畸变的最少配对数
+#define ASTRO_PAIRS_MAX		2000	///< 累计配对数上限
+#define ASTRO_RMS_MAX		3.0		///< 接受标定结果的残差上限, 像元
+#define ASTRO_PUBLISH_PX	0.5		///< 发布新模型的位置变化阈值, 像元
+
+/**
+ * @brief 参考星与星像的配对
+ */
+struct AstroPair {
+	double azi, ele;	///< 参考星视地平坐标, 角度
+	double x, y;		///< 星像坐标
+};
+
+class AstroCalibrator {
+public:
+	typedef boost::shared_ptr<AstroCalibrator> Pointer;
+	/*!
+	 * @brief 声明回调函数及插槽: 镜头模型变化
+	 */
+	typedef boost::signals2::signal<void (const AllSkyLens&)> CBF;
+	typedef CBF::slot_type CBSlot;
+
+public:
+	AstroCalibrator(const Parameter* param);
+	~AstroCalibrator();
+	static Pointer Create(const Parameter* param) {
+		return Pointer(new AstroCalibrator(param));
+	}
+
+public:
+	/**
+	 * @brief 加载亮星表并启动标定线程
+	 */
+	bool Start();
+	/**
+	 * @brief 停止标定线程
+	 */
+	void Stop();
+	/**
+	 * @brief 注册回调函数: 镜头模型变化
+	 * @note
+	 * 在标定线程中回调. 回调时标定结果已写入文件
+	 */
+	void RegisterModel(const CBSlot& slot);
+	/**
+	 * @brief 提交晴夜帧
+	 * @param frame  图像尺寸、曝光时间及星像坐标/流量
+	 * @note
+	 * 标定完成后填写frame的定位结果和匹配星像的星表/定位坐标
+	 */
+	void Push(xmFrmPtr frame);
+	/**
+	 * @brief 加载标定结果
+	 * @param filePath  标定结果文件路径
+	 * @param width     图像宽度
+	 * @param height    图像高度
+	 * @param lens      镜头模型
+	 * @return
+	 * 文件存在且图像尺寸一致时返回true
+	 */
+	static bool LoadModel(const std::string& filePath, int width, int height, AllSkyLens& lens);
+
+protected:
+	typedef std::vector<std::pair<int, int> > MatchVec;	///< 配对: 星像索引, 参考星索引
+
+protected:
+	/**
+	 * @brief 线程: 处理提交的帧
+	 */
+	void thread_calib();
+	/**
+	 * @brief 单帧标定
+	 */
+	void calibrate(xmFrmPtr frame);
+	/**
+	 * @brief 计算曝光中间时刻的可见参考星
+	 */
+	void reference_stars(const boost::posix_time::ptime& utc);
+	/**
+	 * @brief 由镜头模型预测参考星位置, 匹配最近的星像
+	 */
+	void match_predict(const xmFrame* frame, const AllSkyLens& lens, MatchVec& matches);
+	/**
+	 * @brief 三角形匹配, 得到不含畸变的镜头模型初值
+	 */
+	bool match_triangle(const xmFrame* frame, AllSkyLens& lens);
+	/**
+	 * @brief 由累计配对拟合镜头模型, 剔除离群配对
+	 * @return
+	 * 拟合残差, 像元. < 0: 拟合失败
+	 */
+	double fit(AllSkyLens& lens);
+	/**
+	 * @brief 填写帧的定位结果
+	 */
+	void fill_frame(xmFrame* frame, const MatchVec& matches);
+	/**
+	 * @brief 检查并发布标定结果
+	 */
+	void publish(const boost::posix_time::ptime& utc);
+
+protected:
+	const Parameter* param_;	///< 配置参数
+	CBF cbfModel_;			///< 回调函数: 镜头模型变化
+	BoundedQueue<xmFrmPtr> queFrm_;	///< 待处理帧. 有界, 总是处理最新的帧
+	ThrdPtr thrdCalib_;		///< 线程: 标定
+	std::string pathModel_;	///< 标定结果文件路径
+
+	BrightStarVec catalog_;	///< 亮星表
+	AstroUtil::ATimeSpace ats_;	///< 时空坐标转换
+	double airp_;			///< 测站气压, 毫巴
+	StarHorizonVec refs_;	///< 可见参考星
+
+	int width_, height_;	///< 图像尺寸
+	bool calibrated_;		///< 已标定
+	AllSkyLens model_;		///< 当前模型
+	AllSkyLens published_;	///< 已发布模型
+	bool hasPublished_;		///< 已发布过模型
+	double rms_;			///< 当前模型的拟合残差, 像元
+	std::deque<AstroPair> pairs_;	///< 累计配对
+};
+typedef AstroCalibrator::Pointer AstroCalibPtr;
+
+#endif
@@ -4,20 +4,36 @@
  * @version 0.1
  * @author Xiaomeng Lu
  * @date 2023-11-03
+ * @version 2.0
+ * @date 2026-10-18
  */
-#include <boost/bind/bind.hpp>
+#include <algorithm>
 #include "BoostAsioKeep.h"
 
 using namespace boost::asio;
 
+/////////////////////////////////////////////////////////////////////
+bool KeepGuard::Enter(int gen) {
+	MtxLck lck(mtx);
+	if (!alive || gen != generation) return false;
+	running.push_back(boost::this_thread::get_id());
+	return true;
+}
+
+void KeepGuard::Leave() {
+	MtxLck lck(mtx);
+	std::vector<boost::thread::id>::iterator it = std::find(running.begin(), running.end(), boost::this_thread::get_id());
+	if (it != running.end()) running.erase(it);
+	cvLeave.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////
 BoostAsioKeep::BoostAsioKeep()
-	: work_(ios_) {
-	thrdKeep_ = boost::thread(boost::bind(&io_service::run, boost::ref(ios_)));
+	: ios_(_gPool.GetIOService()), strand_(ios_), guard_(new KeepGuard) {
 }
 
 BoostAsioKeep::~BoostAsioKeep() {
-	ios_.stop();
-	thrdKeep_.join();
+	Stop();
 }
 
 io_service& BoostAsioKeep::GetIOService() {
@@ -25,14 +41,25 @@ io_service& BoostAsioKeep::GetIOService() {
 }
 
 bool BoostAsioKeep::IsKeeping() {
-	return thrdKeep_.joinable();
+	MtxLck lck(guard_->mtx);
+	return guard_->alive && _gPool.IsRunning();
 }
 
 void BoostAsioKeep::Stop() {
-	ios_.stop();
-	thrdKeep_.join();
+	MtxLck lck(guard_->mtx);
+	boost::thread::id self = boost::this_thread::get_id();
+	std::vector<boost::thread::id>& running = guard_->running;
+
+	guard_->alive = false;
+	// 等待其它线程中的回调函数结束. 在本实例回调函数中调用时, 不等待自身
+	while (running.size() > (size_t) std::count(running.begin(), running.end(), self))
+		guard_->cvLeave.wait(lck);
 }
 
 void BoostAsioKeep::Reset() {
-	if (!thrdKeep_.joinable()) thrdKeep_ = boost::thread(boost::bind(&io_service::run, boost::ref(ios_)));
+	MtxLck lck(guard_->mtx);
+	if (!guard_->alive) {
+		guard_->alive = true;
+		++guard_->generation;
+	}
 }
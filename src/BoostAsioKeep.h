@@ -11,22 +11,93 @@
  * @version 1.0
  * @date 2023-11-03
  * - 兼容性: io_context --> io_service
+ * @version 2.0
+ * @date 2026-10-18
+ * - 不再独占io_service和线程, 改为使用进程级线程池AsioPool
+ * - 每个实例对应一个strand, 串行执行本实例的回调函数
+ * - Wrap()为回调函数附加生命周期保护: Stop()后尚未执行的回调函数被丢弃,
+ *   Stop()等待正在执行的回调函数结束. 允许在本实例的回调函数中调用Stop()
+ * - 构造时不启动线程池: 线程池由主程序在守护进程化之后启动. 全局对象不应直接持有实例
  */
 
 #ifndef BOOST_ASIO_KEEP_H_
 #define BOOST_ASIO_KEEP_H_
 
+#include <utility>
+#include <vector>
 #include <boost/asio/io_service.hpp>
-#include <boost/thread/thread.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "AsioPool.h"
 
-using boost::asio::io_service;
+typedef boost::asio::steady_timer SteadyTimer;
+
+/**
+ * @brief 回调函数的生命周期保护
+ */
+struct KeepGuard {
+	boost::mutex mtx;	///< 互斥锁
+	boost::condition_variable cvLeave;	///< 事件: 回调函数执行结束
+	bool alive;			///< 实例有效
+	int generation;		///< 代数. Reset()后, 之前注册的回调函数失效
+	std::vector<boost::thread::id> running;	///< 正在执行回调函数的线程
+
+public:
+	KeepGuard() {
+		alive      = true;
+		generation = 0;
+	}
+	/**
+	 * @brief 开始执行回调函数
+	 * @param gen  回调函数注册时的代数
+	 * @return
+	 * 是否允许执行
+	 */
+	bool Enter(int gen);
+	/**
+	 * @brief 回调函数执行结束
+	 */
+	void Leave();
+};
+typedef boost::shared_ptr<KeepGuard> KeepGuardPtr;
+
+/**
+ * @brief 附加生命周期保护的回调函数
+ */
+template <class Handler>
+class GuardedHandler {
+protected:
+	KeepGuardPtr guard_;
+	int gen_;
+	Handler handler_;
+
+	/* 异常安全: 离开作用域时结束执行 */
+	struct Leaver {
+		KeepGuard* guard;
+		~Leaver() { guard->Leave(); }
+	};
+
+public:
+	GuardedHandler(const KeepGuardPtr& guard, int gen, const Handler& handler)
+		: guard_(guard), gen_(gen), handler_(handler) {
+	}
+
+	template <class... Args>
+	void operator()(Args&&... args) {
+		if (guard_->Enter(gen_)) {
+			Leaver leaver = {guard_.get()};
+			handler_(std::forward<Args>(args)...);
+		}
+	}
+};
 
 class BoostAsioKeep {
 protected:
 	/* 成员变量 */
-	io_service ios_;
-	io_service::work work_;
-	boost::thread thrdKeep_;
+	io_service& ios_;	///< 线程池的io_service
+	io_service::strand strand_;	///< 串行化本实例的回调函数
+	KeepGuardPtr guard_;	///< 生命周期保护
 
 public:
 	BoostAsioKeep();
@@ -35,12 +106,35 @@ public:
 
 public:
 	/**
-	 * @brief 检查io_service是否仍在运行
-	 * @return io_service运行状态
+	 * @brief 为回调函数附加strand和生命周期保护
+	 * @param handler  回调函数
+	 * @return 可用于async_*()和post()的回调函数
+	 */
+	template <class Handler>
+	auto Wrap(const Handler& handler)
+		-> decltype(std::declval<io_service::strand&>().wrap(std::declval<GuardedHandler<Handler> >())) {
+		int gen;
+		{
+			boost::mutex::scoped_lock lck(guard_->mtx);
+			gen = guard_->generation;
+		}
+		return strand_.wrap(GuardedHandler<Handler>(guard_, gen, handler));
+	}
+	/**
+	 * @brief 在本实例的strand中异步执行函数
+	 * @param handler  函数
+	 */
+	template <class Handler>
+	void Post(const Handler& handler) {
+		ios_.post(Wrap(handler));
+	}
+	/**
+	 * @brief 检查服务是否有效
+	 * @return 服务状态
 	 */
 	bool IsKeeping();
 	/**
-	 * @brief 停止服务
+	 * @brief 停止服务: 丢弃尚未执行的回调函数, 并等待正在执行的回调函数结束
 	 */
 	void Stop();
 	/**
@@ -0,0 +1,148 @@
+/**
+ * @file BoundedQueue.h 定义有界阻塞队列
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 容量固定, 基于boost::circular_buffer环形存储, 不动态增长
+ * - 队列满时丢弃最早的元素, 新元素优先(latest wins)
+ * - Wait()与Push()共用同一互斥锁, 不会丢失唤醒
+ * - Wait()是boost线程中断点, 可由interrupt_thread()终止
+ * - 统计入队/出队/丢弃数量和排队延时
+ */
+
+#ifndef BOUNDED_QUEUE_H_
+#define BOUNDED_QUEUE_H_
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/chrono/chrono.hpp>
+#include "BoostInclude.h"
+
+/**
+ * @brief 队列统计量
+ */
+struct BoundedQueueStat {
+	unsigned long long enqueued;	///< 入队数量
+	unsigned long long dequeued;	///< 出队数量
+	unsigned long long dropped;		///< 因队列满而丢弃的数量
+	double latencyMean;	///< 出队元素的平均排队延时, 毫秒
+	double latencyMax;	///< 出队元素的最大排队延时, 毫秒
+
+public:
+	BoundedQueueStat() {
+		Reset();
+	}
+
+	void Reset() {
+		enqueued = dequeued = dropped = 0;
+		latencyMean = latencyMax = 0.0;
+	}
+};
+
+template <class T>
+class BoundedQueue {
+protected:
+	typedef boost::chrono::steady_clock Clock;
+	/* 队列元素及其入队时间 */
+	struct Slot {
+		T item;
+		Clock::time_point tmPush;
+	};
+
+	boost::mutex mtx_;	///< 互斥锁: 队列和统计量
+	boost::condition_variable cvPush_;	///< 有新的元素
+	boost::circular_buffer<Slot> slots_;	///< 环形存储
+	BoundedQueueStat stat_;	///< 统计量
+
+public:
+	/**
+	 * @param capacity  队列容量, 最小为1
+	 */
+	BoundedQueue(size_t capacity = 1)
+		: slots_(capacity ? capacity : 1) {
+	}
+
+	/**
+	 * @brief 元素入队. 队列满时丢弃最早的元素
+	 * @return
+	 * 是否丢弃了元素
+	 */
+	bool Push(const T& item) {
+		bool dropped;
+		{
+			MtxLck lck(mtx_);
+			Slot slot;
+			slot.item   = item;
+			slot.tmPush = Clock::now();
+			if ((dropped = slots_.full())) ++stat_.dropped;
+			slots_.push_back(slot);
+			++stat_.enqueued;
+		}
+		cvPush_.notify_one();
+		return dropped;
+	}
+
+	/**
+	 * @brief 非阻塞出队
+	 * @return
+	 * 队列为空时返回false
+	 */
+	bool Pop(T& item) {
+		MtxLck lck(mtx_);
+		return pop(item);
+	}
+
+	/**
+	 * @brief 阻塞出队, 直至队列中有元素或线程被中断
+	 */
+	void Wait(T& item) {
+		MtxLck lck(mtx_);
+		while (slots_.empty()) cvPush_.wait(lck);
+		pop(item);
+	}
+
+	/**
+	 * @brief 清空队列. 清除的元素计入丢弃数量
+	 */
+	void Clear() {
+		MtxLck lck(mtx_);
+		stat_.dropped += slots_.size();
+		slots_.clear();
+	}
+
+	bool Empty() {
+		MtxLck lck(mtx_);
+		return slots_.empty();
+	}
+
+	size_t Size() {
+		MtxLck lck(mtx_);
+		return slots_.size();
+	}
+
+	/**
+	 * @brief 查看统计量
+	 * @param reset  查看后是否复位统计量
+	 */
+	BoundedQueueStat Statistic(bool reset = false) {
+		MtxLck lck(mtx_);
+		BoundedQueueStat stat = stat_;
+		if (reset) stat_.Reset();
+		return stat;
+	}
+
+protected:
+	/* 在持有锁的条件下出队并更新延时统计 */
+	bool pop(T& item) {
+		if (slots_.empty()) return false;
+		Slot& slot = slots_.front();
+		double ms = boost::chrono::duration<double, boost::milli>(Clock::now() - slot.tmPush).count();
+		item = slot.item;
+		slots_.pop_front();
+		++stat_.dequeued;
+		stat_.latencyMean += (ms - stat_.latencyMean) / stat_.dequeued;
+		if (ms > stat_.latencyMax) stat_.latencyMax = ms;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file BrightStar.cpp 亮星表: 全天相机天文标定的参考星
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "ADefine.h"
+#include "BrightStar.h"
+#include "GLog.h"
+
+using namespace AstroUtil;
+
+/* 内置亮星表: 赤经, 赤纬, V星等 */
+static const BrightStar builtin[] = {
+	{101.2872, -16.7161, -1.46},	// Sirius
+	{ 95.9880, -52.6957, -0.74},	// Canopus
+	{219.9021, -60.8340, -0.27},	// Rigil Kentaurus
+	{213.9153,  19.1824, -0.05},	// Arcturus
+	{279.2347,  38.7837,  0.03},	// Vega
+	{ 79.1723,  45.9980,  0.08},	// Capella
+	{ 78.6345,  -8.2016,  0.13},	// Rigel
+	{114.8255,   5.2250,  0.34},	// Procyon
+	{ 24.4285, -57.2368,  0.46},	// Achernar
+	{ 88.7929,   7.4071,  0.50},	// Betelgeuse
+	{210.9559, -60.3730,  0.61},	// Hadar
+	{297.6958,   8.8683,  0.77},	// Altair
+	{186.6496, -63.0991,  0.77},	// Acrux
+	{ 68.9802,  16.5093,  0.85},	// Aldebaran
+	{247.3519, -26.4320,  0.96},	// Antares
+	{201.2983, -11.1613,  0.97},	// Spica
+	{116.3290,  28.0262,  1.14},	// Pollux
+	{344.4127, -29.6222,  1.16},	// Fomalhaut
+	{310.3580,  45.2803,  1.25},	// Deneb
+	{191.9303, -59.6888,  1.25},	// Mimosa
+	{152.0930,  11.9672,  1.35},	// Regulus
+	{104.6565, -28.9721,  1.50},	// Adhara
+	{113.6494,  31.8883,  1.58},	// Castor
+	{263.4022, -37.1038,  1.62},	// Shaula
+	{187.7915, -57.1132,  1.63},	// Gacrux
+	{ 81.2828,   6.3497,  1.64},	// Bellatrix
+	{ 81.5730,  28.6075,  1.65},	// Elnath
+	{138.2999, -69.7172,  1.67},	// Miaplacidus
+	{ 84.0534,  -1.2019,  1.69},	// Alnilam
+	{332.0583, -46.9610,  1.73},	// Alnair
+	{ 85.1897,  -1.9426,  1.77},	// Alnitak
+	{193.5073,  55.9598,  1.77},	// Alioth
+	{165.9320,  61.7510,  1.79},	// Dubhe
+	{ 51.0807,  49.8612,  1.79},	// Mirfak
+	{107.0979, -26.3932,  1.83},	// Wezen
+	{276.0430, -34.3846,  1.85},	// Kaus Australis
+	{125.6285, -59.5095,  1.86},	// Avior
+	{206.8852,  49.3133,  1.86},	// Alkaid
+	{264.3297, -42.9978,  1.87},	// Sargas
+	{ 89.8822,  44.9474,  1.90},	// Menkalinan
+	{252.1662, -69.0277,  1.91},	// Atria
+	{ 99.4280,  16.3993,  1.92},	// Alhena
+	{306.4119, -56.7351,  1.94},	// Peacock
+	{131.1759, -54.7088,  1.96},	// Alsephina
+	{ 95.6749, -17.9559,  1.98},	// Mirzam
+	{141.8968,  -8.6586,  1.98},	// Alphard
+	{ 37.9546,  89.2641,  1.98},	// Polaris
+	{ 31.7934,  23.4624,  2.00},	// Hamal
+	{154.9931,  19.8415,  2.01},	// Algieba
+	{ 10.8974, -17.9866,  2.04},	// Diphda
+	{ 17.4330,  35.6206,  2.05},	// Mirach
+	{283.8164, -26.2967,  2.05},	// Nunki
+	{211.6706, -36.3700,  2.06},	// Menkent
+	{  2.0969,  29.0904,  2.06},	// Alpheratz
+	{ 86.9391,  -9.6696,  2.07},	// Saiph
+	{222.6764,  74.1555,  2.08},	// Kochab
+	{263.7336,  12.5600,  2.08},	// Rasalhague
+	{ 47.0422,  40.9556,  2.09},	// Algol
+	{ 30.9748,  42.3297,  2.10},	// Almach
+	{340.6669, -46.8846,  2.10},	// Tiaki
+	{177.2649,  14.5721,  2.13},	// Denebola
+	{190.3794, -48.9599,  2.17},	// Muhlifain
+	{120.8960, -40.0031,  2.21},	// Naos
+	{139.2725, -59.2752,  2.21},	// Aspidiske
+	{136.9990, -43.4326,  2.21},	// Suhail
+	{233.6719,  26.7147,  2.22},	// Alphecca
+	{200.9814,  54.9254,  2.23},	// Mizar
+	{305.5571,  40.2567,  2.23},	// Sadr
+	{ 83.0017,  -0.2991,  2.23},	// Mintaka
+	{ 10.1268,  56.5373,  2.24},	// Schedar
+	{269.1516,  51.4889,  2.24},	// Eltanin
+	{  2.2945,  59.1498,  2.27},	// Caph
+	{240.0834, -22.6217,  2.29},	// Dschubba
+	{252.5409, -34.2932,  2.29},	// Larawag
+	{204.9719, -53.4664,  2.30},	// epsilon Cen
+	{220.4823, -47.3882,  2.30},	// alpha Lup
+	{165.4603,  56.3824,  2.37},	// Merak
+	{221.2467,  27.0742,  2.37},	// Izar
+	{326.0465,   9.8750,  2.39},	// Enif
+	{265.6220, -39.0300,  2.39},	// kappa Sco
+	{  6.5710, -42.3060,  2.40},	// Ankaa
+	{345.9436,  28.0828,  2.42},	// Scheat
+	{257.5945, -15.7249,  2.43},	// Sabik
+	{178.4577,  53.6948,  2.44},	// Phecda
+	{319.6449,  62.5856,  2.45},	// Alderamin
+	{111.0238, -29.3031,  2.45},	// Aludra
+	{ 14.1772,  60.7167,  2.47},	// gamma Cas
+	{346.1902,  15.2053,  2.48},	// Markab
+	{311.5528,  33.9703,  2.48},	// Aljanah
+	{ 45.5699,   4.0897,  2.54},	// Menkar
+	{168.5271,  20.5237,  2.56},	// Zosma
+	{ 83.1826, -17.8223,  2.58},	// Arneb
+	{183.9515, -17.5419,  2.59},	// Gienah
+	{285.6530, -29.8801,  2.60},	// Ascella
+	{229.2517,  -9.3829,  2.61},	// Zubeneschamali
+	{241.3593, -19.8055,  2.62},	// Acrab
+	{236.0670,   6.4256,  2.63},	// Unukalhai
+	{ 28.6600,  20.8080,  2.64},	// Sheratan
+	{188.5968, -23.3968,  2.65},	// Kraz
+	{208.6712,  18.3977,  2.68},	// Muphrid
+	{ 21.4540,  60.2353,  2.68},	// Ruchbah
+	{ 74.2484,  33.1661,  2.69},	// Hassaleh
+	{275.2485, -29.8281,  2.72},	// Kaus Media
+	{296.5649,  10.6133,  2.72},	// Tarazed
+	{190.4152,  -1.4494,  2.74},	// Porrima
+	{243.5864,  -3.6943,  2.74},	// Yed Prior
+	{222.7196, -16.0418,  2.75},	// Zubenelgenubi
+	{247.5550,  21.4896,  2.77},	// Kornephoros
+	{265.8681,   4.5673,  2.77},	// Cebalrai
+	{262.6082,  52.3014,  2.79},	// Rastaban
+	{  3.3090,  15.1836,  2.83},	// Algenib
+	{326.7602, -16.1273,  2.85},	// Deneb Algedi
+	{195.5442,  10.9591,  2.85},	// Vindemiatrix
+	{ 56.8712,  24.1051,  2.87},	// Alcyone
+	{296.2437,  45.1308,  2.87},	// delta Cyg
+	{ 95.7401,  22.5136,  2.88},	// Tejat
+	{194.0069,  38.3184,  2.89},	// Cor Caroli
+	{322.8897,  -5.5712,  2.90},	// Sadalsuud
+	{187.4661, -16.5154,  2.94},	// Algorab
+	{331.4460,  -0.3199,  2.95},	// Sadalmelik
+	{271.4520, -30.4241,  2.98},	// Alnasl
+	{218.0195,  38.3083,  3.03},	// Seginus
+	{292.6804,  27.9597,  3.05},	// Albireo
+};
+
+bool LoadBrightStars(const std::string& filePath, BrightStarVec& stars) {
+	bool rslt(true);
+
+	stars.clear();
+	if (!filePath.empty()) {
+		FILE* fp = fopen(filePath.c_str(), "r");
+		if (!fp) {
+			_gLog.Write(LOG_WARN, "[%s:%s], failed to open [%s], use built-in catalog", __FILE__, __FUNCTION__, filePath.c_str());
+			rslt = false;
+		}
+		else {
+			char line[200];
+			BrightStar star;
+			while (fgets(line, sizeof(line), fp)) {
+				if (line[0] == '#') continue;
+				if (sscanf(line, "%lf %lf %lf", &star.ra, &star.dec, &star.mag) == 3) stars.push_back(star);
+			}
+			fclose(fp);
+		}
+	}
+	if (stars.empty()) stars.assign(builtin, builtin + sizeof(builtin) / sizeof(BrightStar));
+	std::stable_sort(stars.begin(), stars.end(), [](const BrightStar& x1, const BrightStar& x2) {
+		return x1.mag < x2.mag;
+	});
+	return rslt;
+}
+
+double SitePressure(double alt) {
+	return 1013.25 * exp(-alt / 8434.0);
+}
+
+void BrightStarHorizon(ATimeSpace& ats, const BrightStarVec& stars, double airp, double eleMin, StarHorizonVec& horizon) {
+	int n = stars.size(), i;
+	double lst, azi, alt;
+	std::vector<double> ra0(n), dec0(n), ra(n), dec(n), alts, am;
+
+	horizon.clear();
+	if (!n) return;
+	for (i = 0; i < n; ++i) {
+		ra0[i]  = stars[i].ra * AU_D2R;
+		dec0[i] = stars[i].dec * AU_D2R;
+	}
+	ats.EqTransferBatch(n, &ra0[0], &dec0[0], &ra[0], &dec[0]);
+	lst = ats.LocalSiderealTime();
+	for (i = 0; i < n; ++i) {
+		ats.Eq2Horizon(lst - ra[i], dec[i], azi, alt);
+		if (alt < 0.0) continue;
+
+		StarHorizon star;
+		star.idx = i;
+		star.azi = cycmod(azi * AU_R2D + 180.0, 360.0);
+		star.ele = alt * AU_R2D + ats.TrueRefract(alt, airp, STAR_TEMP) / 60.0;
+		if (star.ele < eleMin) continue;
+		horizon.push_back(star);
+		alts.push_back(alt);
+	}
+	// 大气质量: 真高度角
+	if ((n = horizon.size())) {
+		am.resize(n);
+		ats.AirmassBatch(n, &alts[0], &am[0]);
+		for (i = 0; i < n; ++i) horizon[i].airmass = am[i];
+	}
+}
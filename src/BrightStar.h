@@ -0,0 +1,62 @@
+/**
+ * @file BrightStar.h 亮星表: 全天相机天文标定的参考星
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 内置亮于约3等的恒星, J2000坐标, 不含自行
+ * - 可由文本文件替换: 每行"赤经 赤纬 星等", 角度, '#'起始为注释
+ */
+
+#ifndef BRIGHT_STAR_H_
+#define BRIGHT_STAR_H_
+
+#include <string>
+#include <vector>
+#include "ATimeSpace.h"
+
+#define STAR_TEMP	10.0	///< 计算大气折射的气温, 摄氏度
+
+struct BrightStar {
+	double ra;		///< 赤经, J2000, 角度
+	double dec;		///< 赤纬, J2000, 角度
+	double mag;		///< V星等
+};
+typedef std::vector<BrightStar> BrightStarVec;
+
+/**
+ * @brief 亮星的视地平坐标
+ */
+struct StarHorizon {
+	int idx;			///< 亮星表索引
+	double azi, ele;	///< 视地平坐标, 角度. 方位角北零点
+	double airmass;		///< 大气质量
+};
+typedef std::vector<StarHorizon> StarHorizonVec;
+
+/*!
+ * @brief 加载亮星表
+ * @param filePath  文件路径. 空: 使用内置亮星表
+ * @param stars     亮星, 按星等升序排列
+ * @return
+ * 加载结果. 文件不可读时使用内置亮星表并返回false
+ */
+extern bool LoadBrightStars(const std::string& filePath, BrightStarVec& stars);
+/*!
+ * @brief 测站气压, 毫巴. 标准大气, 标高8434米
+ * @param alt  海拔, 米
+ */
+extern double SitePressure(double alt);
+/*!
+ * @brief 计算亮星的视地平坐标
+ * @param ats      时空坐标转换. 已设置测站和时间
+ * @param stars    亮星表
+ * @param airp     测站气压, 毫巴
+ * @param eleMin   最低视高度角, 角度
+ * @param horizon  高于eleMin的亮星, 保持亮星表的次序
+ * @note
+ * 历元转换和恒星时对全部亮星只计算一次
+ */
+extern void BrightStarHorizon(AstroUtil::ATimeSpace& ats, const BrightStarVec& stars, double airp,
+	double eleMin, StarHorizonVec& horizon);
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file ByteRing.h 定义连续存储的字节环形缓冲区
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 容量为2的整数次幂, 以掩码计算位置
+ * - 数据以一或两段连续内存的形式访问(Spans), 可直接用作asio的缓冲区序列
+ * - 写入/读出使用memcpy整块复制; 查找使用memchr/memmem, 仅在跨越回绕点时比较拼接的边界数据
+ * - WriteSpan()/Commit()允许异步读操作直接写入空闲区
+ * - 本身不加锁, 由使用者同步
+ */
+
+#ifndef BYTE_RING_H_
+#define BYTE_RING_H_
+
+#include <string.h>
+#include <vector>
+
+class ByteRing {
+protected:
+	std::vector<char> buf_;	///< 存储区
+	size_t mask_;	///< 容量 - 1
+	size_t head_;	///< 首字节位置
+	size_t size_;	///< 数据长度
+
+public:
+	/**
+	 * @param capacity  容量, 向上取整为2的整数次幂
+	 */
+	ByteRing(size_t capacity = 0) {
+		SetCapacity(capacity);
+	}
+
+	/**
+	 * @brief 设置容量. 清空数据
+	 */
+	void SetCapacity(size_t capacity) {
+		size_t n(1);
+		while (n < capacity) n <<= 1;
+		buf_.assign(n, 0);
+		mask_ = n - 1;
+		head_ = size_ = 0;
+	}
+
+	size_t Capacity() const {
+		return mask_ + 1;
+	}
+
+	size_t Size() const {
+		return size_;
+	}
+
+	size_t Free() const {
+		return mask_ + 1 - size_;
+	}
+
+	bool Empty() const {
+		return !size_;
+	}
+
+	/**
+	 * @brief 清空数据. 不移动写入位置, 不影响正在写入WriteSpan()的异步操作
+	 */
+	void Clear() {
+		head_ = (head_ + size_) & mask_;
+		size_ = 0;
+	}
+
+	char operator[](size_t i) const {
+		return buf_[(head_ + i) & mask_];
+	}
+
+	/**
+	 * @brief 写入数据
+	 * @param data       数据
+	 * @param n          数据长度
+	 * @param overwrite  空间不足时是否覆盖最早的数据
+	 * @return
+	 * 写入长度
+	 */
+	size_t Push(const char* data, size_t n, bool overwrite = false) {
+		size_t cap(mask_ + 1);
+		if (n > Free()) {
+			if (!overwrite) n = Free();
+			else {
+				if (n > cap) {// 仅保留最后cap字节
+					data += n - cap;
+					n = cap;
+				}
+				Erase(n - Free());
+			}
+		}
+		size_t tail((head_ + size_) & mask_), n1(cap - tail);
+		if (n1 > n) n1 = n;
+		memcpy(&buf_[tail], data, n1);
+		memcpy(&buf_[0], data + n1, n - n1);
+		size_ += n;
+		return n;
+	}
+
+	/**
+	 * @brief 复制数据, 不删除
+	 * @param out   输出缓冲区
+	 * @param n     期望长度
+	 * @param from  起始偏移
+	 * @return
+	 * 实际复制长度
+	 */
+	size_t Peek(char* out, size_t n, size_t from = 0) const {
+		if (from >= size_) return 0;
+		if (n > size_ - from) n = size_ - from;
+		size_t pos((head_ + from) & mask_), n1(mask_ + 1 - pos);
+		if (n1 > n) n1 = n;
+		memcpy(out, &buf_[pos], n1);
+		memcpy(out + n1, &buf_[0], n - n1);
+		return n;
+	}
+
+	/**
+	 * @brief 删除最早的n字节
+	 */
+	void Erase(size_t n) {
+		if (n > size_) n = size_;
+		head_ = (head_ + n) & mask_;
+		size_ -= n;
+	}
+
+	/**
+	 * @brief 查看数据所在的两段连续内存
+	 * @return
+	 * 数据长度
+	 */
+	size_t Spans(const char*& p1, size_t& n1, const char*& p2, size_t& n2) const {
+		n1 = mask_ + 1 - head_;
+		if (n1 > size_) n1 = size_;
+		n2 = size_ - n1;
+		p1 = &buf_[head_];
+		p2 = &buf_[0];
+		return size_;
+	}
+
+	/**
+	 * @brief 查看写入位置之后的连续空闲区, 供异步读操作直接写入
+	 * @param n  空闲区长度
+	 * @return
+	 * 空闲区首地址
+	 */
+	char* WriteSpan(size_t& n) {
+		size_t tail((head_ + size_) & mask_);
+		n = mask_ + 1 - tail;
+		if (n > Free()) n = Free();
+		return &buf_[tail];
+	}
+
+	/**
+	 * @brief 确认已写入WriteSpan()的n字节
+	 */
+	void Commit(size_t n) {
+		size_ += n;
+	}
+
+	/**
+	 * @brief 查找字符串首次出现的位置
+	 * @param flag  字符串
+	 * @param len   字符串长度
+	 * @param from  起始偏移
+	 * @return
+	 * 相对首字节的偏移. 不存在时返回-1
+	 */
+	int Find(const char* flag, size_t len, size_t from = 0) const {
+		if (!flag || !len || from + len > size_) return -1;
+
+		const char *p1, *p2, *hit;
+		size_t n1, n2;
+		Spans(p1, n1, p2, n2);
+		if (from < n1) {// 第一段
+			if ((hit = find(p1 + from, n1 - from, flag, len))) return hit - p1;
+			if (n2 && len > 1) {// 跨越回绕点: 拼接两侧各len-1字节
+				size_t m1(n1 - from < len - 1 ? n1 - from : len - 1), m2(n2 < len - 1 ? n2 : len - 1);
+				std::vector<char> seam(m1 + m2);
+				memcpy(&seam[0], p1 + n1 - m1, m1);
+				memcpy(&seam[m1], p2, m2);
+				if ((hit = find(&seam[0], seam.size(), flag, len))) return n1 - m1 + (hit - &seam[0]);
+			}
+			from = n1;
+		}
+		if ((hit = find(p2 + from - n1, n2 - (from - n1), flag, len))) return n1 + (hit - p2);
+		return -1;
+	}
+
+protected:
+	static const char* find(const char* data, size_t n, const char* flag, size_t len) {
+		if (n < len) return NULL;
+		if (len == 1) return (const char*) memchr(data, flag[0], n);
+		return (const char*) memmem(data, n, flag, len);
+	}
+};
+
+#endif
@@ -1,5 +1,6 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind/bind.hpp>
 #include "CameraBase.h"
 #include "GLog.h"
 
@@ -7,6 +8,7 @@ using namespace boost;
 using namespace boost::posix_time;
 
 CameraBase::CameraBase() {
+	idTemp_ = 0;
 }
 
 CameraBase::~CameraBase() {
@@ -26,7 +28,8 @@ bool CameraBase::Connect() {
 		info_.pixels = info_.wSensor * info_.hSensor;
 		info_.Alloc();
 		thrdExpose_.reset(new boost::thread(boost::bind(&CameraBase::thread_expose, this)));
-		thrdTemp_.reset(new boost::thread(boost::bind(&CameraBase::thread_temperature, this)));
+		keep_.Reset();
+		idTemp_ = _gSched.Every(keep_, "camera temperature", 1000, boost::bind(&CameraBase::cycle_temperature, this));
 
 		return true;
 	}
@@ -37,7 +40,8 @@ void CameraBase::Disconnect() {
 	if (info_.connected) {
 		cooler_onoff(false, 0);
 		interrupt_thread(thrdExpose_);
-		interrupt_thread(thrdTemp_);
+		_gSched.Cancel(idTemp_);
+		keep_.Stop();
 		if (info_.state == CAMERA_EXPOSE) AbortExpose();
 		close_camera();
 		info_.Reset();
@@ -197,22 +201,17 @@ void CameraBase::thread_expose() {
 	}
 }
 
-void CameraBase::thread_temperature() {
-	boost::chrono::seconds toWait(1);
-
-	while (1) {
-		boost::this_thread::sleep_for(toWait);
-		if (info_.state == CAMERA_IDLE && !sensor_temperature(info_.coolGet)) {
-			if (++info_.errcnt > 3) {
-				info_.errcode = CAMEC_GET_TEMP;
-				info_.state = CAMERA_ERROR;
-			}
+void CameraBase::cycle_temperature() {
+	if (info_.state == CAMERA_IDLE && !sensor_temperature(info_.coolGet)) {
+		if (++info_.errcnt > 3) {
+			info_.errcode = CAMEC_GET_TEMP;
+			info_.state = CAMERA_ERROR;
 		}
-		else if (info_.state == CAMERA_ERROR && sensor_temperature(info_.coolGet)) {
-			if (info_.errcode == CAMEC_GET_TEMP) {
-				info_.state = CAMERA_IDLE;
-				info_.errcnt = CAMEC_SUCCESS;
-			}
+	}
+	else if (info_.state == CAMERA_ERROR && sensor_temperature(info_.coolGet)) {
+		if (info_.errcode == CAMEC_GET_TEMP) {
+			info_.state = CAMERA_IDLE;
+			info_.errcnt = CAMEC_SUCCESS;
 		}
 	}
 }
@@ -6,6 +6,7 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
 #include "BoostInclude.h"
+#include "Scheduler.h"
 #include "CameraDefine.h"
 
 using std::string;
@@ -119,7 +120,8 @@ protected:
 	CBF cbfExpose_;		///< 曝光进度回调函数
 	CameraInfo info_;	///< 相机配置及状态
 	ThrdPtr thrdExpose_;///< 线程: 监测曝光过程
-	ThrdPtr thrdTemp_;	///< 线程: 在空闲时监测芯片温度
+	BoostAsioKeep keep_;	///< 线程池句柄
+	int idTemp_;		///< 调度任务: 在空闲时监测芯片温度
 	boost::condition_variable cvExpBegin_;	///< 事件: 开始曝光
 	boost::condition_variable cvExpOver_;	///< 事件: 曝光结束
 
@@ -322,9 +324,9 @@ protected:
 	 */
 	void thread_expose();
 	/**
-	 * @brief 线程: 监测探测器温度
+	 * @brief 调度任务: 每秒监测探测器温度
 	 */
-	void thread_temperature();
+	void cycle_temperature();
 };
 typedef boost::shared_ptr<CameraBase> CameraPtr;
 
@@ -10,6 +10,8 @@
 #include "ADefine.h"
 #include "CloudCamera.h"
 #include "ProtoFocus.h"
+#include "Ephemeris.h"
+#include "DatedPath.h"
 
 #ifdef ENABLE_CAMERA
 #include "CloudCamera/CameraQHY.h"
@@ -22,8 +24,8 @@ using namespace AstroUtil;
 
 #define FOCUS_FRAME_MAX		3
 #define FOCUS_CONFIDENCE	0.1
-#define FWHM_EXPECT			3.0
 #define FWHM_EXPECT_ERROR	0.2
+#define FOCUS_POOR_WEIGHT	3.0		///< 像质差的帧: FWHM误差的放大倍数, 降低其在V曲线拟合中的权重
 
 #define FOCUS_OVER		0
 #define FOCUS_MANUAL	1
@@ -31,8 +33,12 @@ using namespace AstroUtil;
 
 CloudCamera::CloudCamera(const Parameter* param) {
     param_   = param;
-    fpLog_   = NULL;
+    cntFail_ = 0;
+    idCycle_ = 0;
+    periodCycle_ = 0;
 	focusMode_ = FOCUS_OVER;
+	darkExpose_  = false;
+	lightFrames_ = 0;
 	info_.state = WMC_FAIL_CONNECT;
 }
 
@@ -46,67 +52,60 @@ bool CloudCamera::Start() {
         ptime tmNow = second_clock::universal_time();
         ptime::date_type today = tmNow.date();
 
-        // 测量记录
-        path pathName(param_->sampleDir);
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write);
-        }
-		pathName /= param_->prefixName;
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write);
-        }
-        pathName /= (boost::format("Y%d") % today.year()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write);
-        }
-        pathName /= (boost::format("WMC_%d%02d%02d.log") % today.year() % today.month().as_number() % today.day()).str();
-        path pathLog(pathName);
-
-        // 原始图像
-        pathName = param_->dirRawImage;
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write);
-        }
-        pathName /= (boost::format("%s%d%02d%02d") % param_->prefixName % (today.year() - 2000) % today.month().as_number() % today.day()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write);
-        }
-        dirRawImg_ = pathName.string();
+        // 测量记录: <sampleDir>/<prefix>/Y<year>/WMC_<date>.log
+        DatedTreePtr treeLog = _gDated.Tree((path(param_->sampleDir) / param_->prefixName).string(), DATED_YEAR);
+        path pathLog(treeLog->File(today, "WMC_", ".log"));
+        // 原始图像: <dirRawImage>/<prefix><YYMMDD>
+        dirRawImg_ = _gDated.Tree(param_->dirRawImage, DATED_DAY | DATED_SHORT, param_->prefixName)->Dir(today);
+        if (pathLog.empty() || dirRawImg_.empty()) return false;
 
         // 云图=>数据处理
-        pathName = param_->sampleDir;
+        path pathName(param_->sampleDir);
         pathName /= "observed.list";
         pathNtfyProc_ = pathName.string();
         if (exists(path(pathLog))) copy_file(pathLog, pathName, copy_options::overwrite_existing);
         else remove(pathName);
         // 打开日志文件
-        fpLog_ = fopen(pathLog.c_str(), "a+");
+        logFile_.Open(pathLog.string(), "Camera");
     }
     catch(filesystem_error& ex) {
         _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
         return false;
     }
+    // 本底改正: 加载主暗场
+    bool importDark = param_->calibEnable && calib_.Load(param_) && !param_->calibDarkDir.empty();
+    if (param_->previewEnable) {
+#ifdef ENABLE_PREVIEW
+        preview_ = PreviewMaker::Create(param_);
+        if (!preview_->Start(dirRawImg_)) preview_.reset();
+#else
+        _gLog.Write(LOG_WARN, "[%s:%s], preview is not available: built without libjpeg", __FILE__, __FUNCTION__);
+#endif
+    }
 
-    thrdMain_.reset(new boost::thread(boost::bind(&CloudCamera::run, this)));
+    keep_.Reset();
+    // 导入外部暗场: 在线程池中读取文件, 不阻塞启动
+    if (importDark) keep_.Post(boost::bind(&CloudCamera::import_darks, this));
+    periodCycle_ = param_->sampleCycle * 1000;
+    idCycle_ = _gSched.Every(keep_, "cloud camera", periodCycle_, boost::bind(&CloudCamera::cycle, this));
     return true;
 }
 
 void CloudCamera::Stop() {
-    interrupt_thread(thrdMain_);
+    _gSched.Cancel(idCycle_);
+    keep_.Stop();
 	interrupt_thread(thrdReduce_);
     if (camPtr_.unique()) {
         camPtr_->Disconnect();
         camPtr_.reset();
     }
-    if (fpLog_) {
-        fclose(fpLog_);
-        fpLog_ = NULL;
-    }
+#ifdef ENABLE_PREVIEW
+	if (preview_) {// 相机断开后不再提交预览帧
+		preview_->Stop();
+		preview_.reset();
+	}
+#endif
+    logFile_.Close();
 }
 
 /**
@@ -126,14 +125,20 @@ void CloudCamera::DoFocus(UdpPtr udp, bool enable, bool manual) {
 		focusMode_ = FOCUS_OVER;
 		interrupt_thread(thrdReduce_); // 中断调焦
 		udpFocusPtr_.reset();
+
+		BoundedQueueStat stat = queImg_.Statistic(true);
+		_gLog.Write("Focus frame queue: enqueued = %llu, reduced = %llu, dropped = %llu, latency = %.1f/%.1f ms",
+			stat.enqueued, stat.dequeued, stat.dropped, stat.latencyMean, stat.latencyMax);
 	}
 	else if (!focusMode_) {// 启动调焦
 		if (!manual) {
-			focusAlgo_.Init(param_->fwhmPerfect, FWHM_EXPECT_ERROR);
+			focusAlgo_.Init(param_->fwhmPerfect, FWHM_EXPECT_ERROR, param_->focusStep, param_->focusFrameMax);
+			tmFocusMove_ = microsec_clock::universal_time();
 			udpFocusPtr_ = udp;
 		}
 		focusMode_ = manual ? FOCUS_MANUAL : FOCUS_AUTO;
-		queImg_.frames.clear();
+		queImg_.Clear();
+		queImg_.Statistic(true);
 		queFwhm_.clear();
 		thrdReduce_.reset(new boost::thread(boost::bind(&CloudCamera::thread_reduce, this)));
 	}
@@ -155,9 +160,31 @@ void CloudCamera::FocusMove(int step) {
 }
 
 void CloudCamera::expose_process(int state, double percent, double left) {
-	if (state == CAMERA_IMGRDY && !cloud2fits()) {
-		cloudadj(); // 评估图像中心区域亮度并调整曝光时间
-		++frmno_;
+	if (state == CAMERA_IMGRDY) {
+		const CameraInfo* nfcam = camPtr_->GetInfo();
+		bool calib = param_->calibEnable && nfcam->bitdepth > 8 && nfcam->bitdepth <= 16;
+
+		if (darkExpose_) {// 暗场: 仅用于合成主暗场
+			darkExpose_ = false;
+			if (calib) calib_.AddDark((const uint16_t*) nfcam->data.get(), nfcam->wSensor, nfcam->hSensor,
+				nfcam->expdur, nfcam->coolGet);
+		}
+		else {
+			// 原位改正后再提交云量引擎和存储
+			calibRslt_.Reset();
+			if (calib) calib_.Apply((uint16_t*) nfcam->data.get(), nfcam->wSensor, nfcam->hSensor,
+				nfcam->expdur, nfcam->coolGet, calibRslt_);
+			// 先提交云量引擎, 不等待存储FITS文件
+			if (engine_ && !focusMode_) engine_->Push(nfcam);
+#ifdef ENABLE_PREVIEW
+			if (preview_ && !focusMode_) preview_->Push(nfcam);
+#endif
+			if (!cloud2fits()) {
+				cloudadj(); // 评估图像中心区域亮度并调整曝光时间
+				++frmno_;
+			}
+			++lightFrames_;
+		}
 	}
 #ifdef NDEBUG
 	if (state != CAMERA_EXPOSE) _gLog.Write("camera state = %d", state);
@@ -199,6 +226,12 @@ int CloudCamera::cloud2fits() {
 	fits_write_key(fitsptr, TFLOAT, "GAIN", (void*) &nfcam->gainPreamp, "preamp gain/index", &status);
 	fits_write_key(fitsptr, TINT, "TEMPSET", (void*)&nfcam->coolSet, "cooler set point", &status);
 	fits_write_key(fitsptr, TINT, "TEMPACT", (void*)&nfcam->coolGet, "cooler actual point", &status);
+	if (!calibRslt_.master.empty()) {
+		int darksub = calibRslt_.dark ? 1 : 0;
+		fits_write_key(fitsptr, TLOGICAL, "DARKSUB", &darksub, "master dark subtracted", &status);
+		fits_write_key(fitsptr, TSTRING, "DARKFILE", (void*)calibRslt_.master.c_str(), "master dark", &status);
+		fits_write_key(fitsptr, TINT, "HOTPIX", &calibRslt_.hots, "hot pixels repaired", &status);
+	}
 
 	string termtype("CloudCamera");
 	fits_write_key(fitsptr, TSTRING, "TERMTYPE", (void*)termtype.c_str(), "terminal type", &status);
@@ -212,6 +245,14 @@ int CloudCamera::cloud2fits() {
 	fits_write_key(fitsptr, TDOUBLE, "SITELON",  (void*)&param_->siteLon,         "observation site longitude @ degrees", &status);
 	fits_write_key(fitsptr, TDOUBLE, "SITELAT",  (void*)&param_->siteLat,         "observation site latitude @ degrees", &status);
 	fits_write_key(fitsptr, TDOUBLE, "SITEALT",  (void*)&param_->siteAlt,         "observation site altitude @ meter", &status);
+
+	EphemPoint ephem;
+	if (_gEphem.Lookup(Ephemeris::MJD(nfcam->dateobs), ephem)) {
+		fits_write_key(fitsptr, TDOUBLE, "SUNALT",   (void*)&ephem.sunAlt,    "sun altitude @ degrees", &status);
+		fits_write_key(fitsptr, TDOUBLE, "MOONALT",  (void*)&ephem.moonAlt,   "moon altitude @ degrees", &status);
+		fits_write_key(fitsptr, TDOUBLE, "MOONAZ",   (void*)&ephem.moonAzi,   "moon azimuth @ degrees, south zero", &status);
+		fits_write_key(fitsptr, TDOUBLE, "MOONPHAS", (void*)&ephem.moonIllum, "illuminated fraction of moon", &status);
+	}
 	fits_close_file(fitsptr, &status);
 
 	if (status) {
@@ -221,19 +262,24 @@ int CloudCamera::cloud2fits() {
 	}
 	else {
 		info_.lastobs = to_iso_extended_string(nfcam->dateobs);
+		if (storage_) {
+			boost::system::error_code ec;
+			uintmax_t bytes = file_size(filePath, ec);
+			if (!ec) storage_->Account(filePath.string(), bytes);
+		}
 		if (!focusMode_) {// 写入通知文件
-			FILE* fp = fopen(pathNtfyProc_.c_str(), "a+");
-			fprintf (fp, "%s  %s\n", dirRawImg_.c_str(), fmtFileName.str().c_str());
-			fclose(fp);
+			if (!engine_) {
+				FILE* fp = fopen(pathNtfyProc_.c_str(), "a+");
+				fprintf (fp, "%s  %s\n", dirRawImg_.c_str(), fmtFileName.str().c_str());
+				fclose(fp);
+			}
 
-	        fprintf(fpLog_, "%s  %s\n", dirRawImg_.c_str(), fmtFileName.str().c_str());
-	        fflush(fpLog_);
+	        logFile_.Write("%s  %s\n", dirRawImg_.c_str(), fmtFileName.str().c_str());
 		}
 		else {// 启动图像处理 --> 调焦
 			xmFrmPtr frame = xmFrame::Create();
-			if (frame->Reset(filePath.string())) {
-				queImg_.Push(frame);
-				cvNewImg_.notify_one();
+			if (frame->Reset(filePath.string()) && queImg_.Push(frame)) {
+				_gLog.Write(LOG_WARN, "reduction is slower than exposure, older frame was dropped");
 			}
 		}
 	}
@@ -264,115 +310,208 @@ void CloudCamera::cloudadj() {
 	else if (expdur_ > param_->expdurMax) expdur_ = param_->expdurMax;
 }
 
-void CloudCamera::run() {
-	boost::chrono::seconds toWait(param_->sampleCycle);
-	const CameraInfo* nfCam = NULL;
-	int cnt(0), coolGet(100);
+void CloudCamera::import_darks() {
+	std::vector<path> files;
+
+	try {
+		path pathDir(param_->calibDarkDir);
+		if (!exists(pathDir)) return;
+		for (directory_iterator it(pathDir), end; it != end; ++it) {
+			string ext = it->path().extension().string();
+			if (is_regular_file(it->path()) && (ext == ".fit" || ext == ".fits")) files.push_back(it->path());
+		}
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (import_dark(files[i].string())) rename(files[i], files[i].string() + ".imported");
+		}
+	}
+	catch(filesystem_error& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+	}
+}
+
+bool CloudCamera::import_dark(const string& filePath) {
+	fitsfile *fitsptr;
+	int status(0), naxis(0), anynul(0);
+	long naxes[] = {0, 0};
+	double expdur(0.0), temp(0.0);
+	ArrayShortU data;
+
+	fits_open_file(&fitsptr, filePath.c_str(), READONLY, &status);
+	if (status) {
+		_gLog.Write(LOG_WARN, "[%s:%s], failed to open [%s]", __FILE__, __FUNCTION__, filePath.c_str());
+		return false;
+	}
+	fits_get_img_dim(fitsptr, &naxis, &status);
+	fits_get_img_size(fitsptr, 2, naxes, &status);
+	fits_read_key(fitsptr, TDOUBLE, "EXPTIME", &expdur, NULL, &status);
+	// 探测器温度: 本软件写入TEMPACT, 其它采集软件多为CCD-TEMP
+	if (!status && fits_read_key(fitsptr, TDOUBLE, "TEMPACT", &temp, NULL, &status) == KEY_NO_EXIST) {
+		status = 0;
+		fits_read_key(fitsptr, TDOUBLE, "CCD-TEMP", &temp, NULL, &status);
+	}
+	if (!status && naxis == 2) {
+		long pixels = naxes[0] * naxes[1];
+		data.reset(new unsigned short[pixels]);
+		fits_read_img(fitsptr, TUSHORT, 1, pixels, NULL, data.get(), &anynul, &status);
+	}
+	fits_close_file(fitsptr, &status);
+
+	if (status || naxis != 2) {
+		char txt[200] = "not a 2-D image";
+		if (status) fits_get_errstatus(status, txt);
+		_gLog.Write(LOG_WARN, "[%s:%s], %s, %s", __FILE__, __FUNCTION__, filePath.c_str(), txt);
+		return false;
+	}
+	calib_.AddDark(data.get(), int(naxes[0]), int(naxes[1]), expdur, int(floor(temp + 0.5)));
+	_gLog.Write("dark frame imported: %s, %.1f s, %.0f C", filePath.c_str(), expdur, temp);
+	return true;
+}
 
-	while (1) {
+void CloudCamera::cycle() {
 #ifdef ENABLE_CAMERA
-		if (!camPtr_.unique()) {// 连接相机
-			camPtr_ = boost::static_pointer_cast<CameraBase>(boost::shared_ptr<CameraQHY>(new CameraQHY));
-			if (camPtr_->Connect()) {
-				const CameraBase::CBSlot& slot = boost::bind(&CloudCamera::expose_process, this, _1, _2, _3);
-				camPtr_->RegisterExpose(slot);
-				camPtr_->CoolerOnoff(true, param_->coolerSet);
-				nfCam   = camPtr_->GetInfo();
-				coolGet = 100;
-				expdur_ = param_->expdurMin;
-				frmno_  = 1;
-				cnt = 0;
-				info_.state = WMC_SUCCESS;
-				_gLog.Write("cloud camera connected");
-			}
-			else {
-				info_.state = WMC_FAIL_CONNECT;
-				camPtr_.reset();
-				if (++cnt == 1) _gLog.Write(LOG_FAULT, "[%s:%s], failed to connect camera", __FILE__, __FUNCTION__);
-			}
+	if (!camPtr_.unique()) {// 连接相机
+		camPtr_ = boost::static_pointer_cast<CameraBase>(boost::shared_ptr<CameraQHY>(new CameraQHY));
+		if (camPtr_->Connect()) {
+			const CameraBase::CBSlot& slot = boost::bind(&CloudCamera::expose_process, this, _1, _2, _3);
+			camPtr_->RegisterExpose(slot);
+			camPtr_->CoolerOnoff(true, param_->coolerSet);
+			expdur_ = param_->expdurMin;
+			frmno_  = 1;
+			darkExpose_  = false;
+			lightFrames_ = 0;
+			cntFail_ = 0;
+			info_.state = WMC_SUCCESS;
+			_gLog.Write("cloud camera connected");
+		}
+		else {
+			info_.state = WMC_FAIL_CONNECT;
+			camPtr_.reset();
+			if (++cntFail_ == 1) _gLog.Write(LOG_FAULT, "[%s:%s], failed to connect camera", __FILE__, __FUNCTION__);
 		}
+	}
 #endif
-		if (camPtr_.unique()) {
-			if (nfCam->state == CAMERA_ERROR) {// 故障
-				_gLog.Write(LOG_FAULT, "[%s:%s:%d], errorcode = %d", __FILE__, __FUNCTION__, __LINE__, nfCam->errcode);
-				camPtr_->Disconnect();
-				camPtr_.reset();
-			}
-			else if (nfCam->state == CAMERA_IDLE) {// 新的曝光
-				// 条件1: 相机空闲
-				// 条件2: 制冷稳定
-				if (!camPtr_->Expose(expdur_)) {
-					_gLog.Write(LOG_WARN, "[%s:%s:%d], errorcode = %d", __FILE__, __FUNCTION__, __LINE__, nfCam->errcode);
-				}
-				else cnt = 0;
+	if (camPtr_.unique()) {
+		const CameraInfo* nfCam = camPtr_->GetInfo();
+		if (nfCam->state == CAMERA_ERROR) {// 故障
+			_gLog.Write(LOG_FAULT, "[%s:%s:%d], errorcode = %d", __FILE__, __FUNCTION__, __LINE__, nfCam->errcode);
+			camPtr_->Disconnect();
+			camPtr_.reset();
+		}
+		else if (nfCam->state == CAMERA_IDLE) {// 新的曝光
+			// 条件1: 相机空闲
+			// 条件2: 制冷稳定
+			// 有机械快门时, 按设定间隔以当前曝光时间插入暗场
+			darkExpose_ = param_->calibEnable && nfCam->hasShutter && !focusMode_
+				&& lightFrames_ >= param_->calibDarkEvery;
+			if (!camPtr_->Expose(expdur_, !darkExpose_)) {
+				darkExpose_ = false;
+				_gLog.Write(LOG_WARN, "[%s:%s:%d], errorcode = %d", __FILE__, __FUNCTION__, __LINE__, nfCam->errcode);
 			}
-			else if (nfCam->state == CAMERA_EXPOSE && ++cnt >= 2) {// 长时间无读出
-				_gLog.Write(LOG_WARN, "long time no readout");
-				info_.state = WMC_FAIL_READOUT;
-				camPtr_->AbortExpose();
+			else {
+				cntFail_ = 0;
+				if (darkExpose_) lightFrames_ = 0;
 			}
 		}
-		if (!focusMode_) boost::this_thread::sleep_for(toWait);
-		else boost::this_thread::sleep_for(boost::chrono::milliseconds(int(expdur_ * 1000)));
+		else if (nfCam->state == CAMERA_EXPOSE && ++cntFail_ >= 2) {// 长时间无读出
+			_gLog.Write(LOG_WARN, "long time no readout");
+			info_.state = WMC_FAIL_READOUT;
+			camPtr_->AbortExpose();
+		}
 	}
+
+
+	int period = focusMode_ ? expdur_ * 1000 : param_->sampleCycle * 1000;
+	if (period != periodCycle_ && _gSched.Reschedule(idCycle_, period)) periodCycle_ = period;
 }
 
 /**
  * @brief 线程: 处理图像, 统计半高全宽
  */
 void CloudCamera::thread_reduce() {
-	boost::mutex mtx;
-	MtxLck lck(mtx);
-	int step;
+	xmFrmPtr frame;
 
 	invSEx_.Prepare(param_);
 	while (focusMode_) {
-		if (queImg_.Empty()) cvNewImg_.wait(lck);
-
-		xmFrmPtr frame = queImg_.Pop();
+		queImg_.Wait(frame);
+		if (!frame) continue;
 		ptime now = second_clock::universal_time();
-		if ((now - from_iso_extended_string(frame->dateObs)).total_seconds() > 60) {
+		ptime tmObs = from_iso_extended_string(frame->dateObs);
+		if ((now - tmObs).total_seconds() > 60) {
 			_gLog.Write(LOG_WARN, "[%s] was too old, procerss might be blocked",
 				frame->fileName.c_str());
 		}
+		else if (focusMode_ == FOCUS_AUTO && tmObs < tmFocusMove_) {
+			// 曝光开始于调焦电机运动结束之前, 不代表新的焦点位置
+		}
 		else if (!invSEx_.DoIt(frame) && frame->fwhm > 1.0) {
-			queFwhm_.push_back(frame->fwhm);
-			if (queFwhm_.size() < FOCUS_FRAME_MAX) continue;
-			else if (queFwhm_.size() > FOCUS_FRAME_MAX) queFwhm_.pop_front();
-
-			// 统计
-			double sum(0.0), sq(0.0), mean, sigma;
-			for (int i = 0; i < FOCUS_FRAME_MAX; ++i) {
-				sum += queFwhm_[i];
-				sq  += queFwhm_[i] * queFwhm_[i];
-			}
-			mean = sum / FOCUS_FRAME_MAX;
-			sigma= (sq - mean * sum) / (FOCUS_FRAME_MAX - 1);
-			sigma= sigma > 0.0 ? sqrt(sigma) : 0.0;
-			_gLog.Write("%s : FWHM = %.1lf, sigma = %.2lf",
-				sigma <= FOCUS_CONFIDENCE ? "--->>> GOOD <<<---" : "!!! BAD !!!",
-				mean, sigma);
-			if (sigma <= FOCUS_CONFIDENCE
-				&& (mean - FWHM_EXPECT) > FWHM_EXPECT_ERROR
-				&& focusMode_ == FOCUS_AUTO) {
-				if (focusMode_ == FOCUS_AUTO) {// 自动调焦
-					if (!focusAlgo_.Push(mean, step)) {
-						ProtoFocusMove proto;
-						proto.step = step;
-						udpFocusPtr_->Write(&proto, sizeof(ProtoFocusMove));
-						_gLog.Write("AutoFocou[Move]: %d", step);
-					}
-					else {
-						ProtoFocusEnd proto;
-						udpFocusPtr_->Write(&proto, sizeof(ProtoFocusEnd));
-						focusMode_ = 0;
-						_gLog.Write("AutoFocou stopped. the last FWHM is %4.1f", mean);
-					}
-				}
-			}
+			if (focusMode_ == FOCUS_AUTO) focus_auto(frame);
+			else focus_manual(frame);
+		}
+	}
+}
+
+void CloudCamera::focus_auto(xmFrmPtr frame) {
+	// 单帧FWHM的误差: 参与统计星像的离散度 / sqrt(星像数量)
+	int n(0), step;
+	for (xmStarPtrVec::iterator it = frame->stars.begin(); it != frame->stars.end(); ++it) {
+		if ((*it)->inStat) ++n;
+	}
+	double sigma = n > 1 ? frame->fwhmErr / sqrt(double(n)) : frame->fwhmErr;
+	if (frame->flag) sigma *= FOCUS_POOR_WEIGHT;	// 像质差: 星像不足的网格过多
+
+	_gLog.Write("AutoFocus[%d]: FWHM = %.2lf, sigma = %.3lf%s",
+		focusAlgo_.FrameCount() + 1, frame->fwhm, sigma, frame->flag ? ", poor quality" : "");
+	if (!focusAlgo_.Push(frame->fwhm, sigma, step)) {
+		if (step) {
+			ProtoFocusMove proto;
+			proto.step = step;
+			udpFocusPtr_->Write(&proto, sizeof(ProtoFocusMove));
+			tmFocusMove_ = microsec_clock::universal_time();
+			_gLog.Write("AutoFocus[Move]: %d", step);
+		}
+	}
+	else {
+		int pos;
+		double fwhm, err;
+		bool fitted = focusAlgo_.GetResult(pos, fwhm, err);
+		bool target = focusAlgo_.EndReason() == FocusAutoAlgo::FOCUS_END_TARGET;
+		ProtoFocusEnd proto;
+		// 达到理想像质时报告实测FWHM; 到达帧数上限且拟合无效时为失败
+		proto.success = target || fitted ? 1 : 0;
+		proto.fwhm    = target ? uint16_t(frame->fwhm * 100) : (fitted ? uint16_t(fwhm * 100) : 0);
+		udpFocusPtr_->Write(&proto, sizeof(ProtoFocusEnd));
+		focusMode_ = FOCUS_OVER;
+		if (target) {
+			_gLog.Write("AutoFocus reached the expected FWHM after %d frames. the last FWHM is %4.1f",
+				focusAlgo_.FrameCount(), frame->fwhm);
+		}
+		else if (fitted) {
+			_gLog.Write("AutoFocus stopped after %d frames. the last FWHM is %4.1f, best focus = %d +/- %.0f, fitted FWHM = %4.2f",
+				focusAlgo_.FrameCount(), frame->fwhm, pos, err, fwhm);
 		}
 		else {
-			queFwhm_.pop_front();
+			_gLog.Write("AutoFocus stopped after %d frames. the last FWHM is %4.1f",
+				focusAlgo_.FrameCount(), frame->fwhm);
 		}
 	}
 }
+
+void CloudCamera::focus_manual(xmFrmPtr frame) {
+	if (frame->flag) return;	// 像质差的帧不参与均值统计
+	queFwhm_.push_back(frame->fwhm);
+	if (queFwhm_.size() < FOCUS_FRAME_MAX) return;
+	else if (queFwhm_.size() > FOCUS_FRAME_MAX) queFwhm_.pop_front();
+
+	// 统计
+	double sum(0.0), sq(0.0), mean, sigma;
+	for (int i = 0; i < FOCUS_FRAME_MAX; ++i) {
+		sum += queFwhm_[i];
+		sq  += queFwhm_[i] * queFwhm_[i];
+	}
+	mean = sum / FOCUS_FRAME_MAX;
+	sigma= (sq - mean * sum) / (FOCUS_FRAME_MAX - 1);
+	sigma= sigma > 0.0 ? sqrt(sigma) : 0.0;
+	_gLog.Write("%s : FWHM = %.1lf, sigma = %.2lf",
+		sigma <= FOCUS_CONFIDENCE ? "--->>> GOOD <<<---" : "!!! BAD !!!",
+		mean, sigma);
+}
@@ -15,6 +15,12 @@
 #include "InvokeSExtractor.h"
 #include "FocusAutoAlgo.h"
 #include "AsioUDP.h"
+#include "BoundedQueue.h"
+#include "CloudEngine.h"
+#include "FrameCalib.h"
+#include "PreviewMaker.h"
+#include "StorageManager.h"
+#include "AppendLog.h"
 
 enum {
 	WMC_SUCCESS,	///< 正确
@@ -82,6 +88,22 @@ public:
 	 * @param step  > 0: 顺时针; < 0: 逆时针
 	 */
 	void FocusMove(int step);
+	/**
+	 * @brief 设置进程内云量引擎
+	 * @note
+	 * 设置后读出的图像直接提交引擎, 不再通知外部处理软件
+	 */
+	void SetEngine(CloudEnginePtr engine) {
+		engine_ = engine;
+	}
+	/**
+	 * @brief 设置存储空间管理
+	 * @note
+	 * 写入的FITS文件字节数累计至存储空间管理, 用于估计可用空间
+	 */
+	void SetStorage(StoragePtr storage) {
+		storage_ = storage;
+	}
 
 private:
 	/* 功能 */
@@ -103,43 +125,42 @@ private:
 	 * @brief 依据图像中心统计结果, 修正曝光时间
 	 */
 	void cloudadj();
+	/**
+	 * @brief 导入外部暗场目录中的FITS暗场
+	 * @note
+	 * 导入后的文件增加扩展名.imported, 不再重复导入
+	 */
+	void import_darks();
+	/**
+	 * @brief 导入单个FITS暗场
+	 */
+	bool import_dark(const string& filePath);
 
 private:
 	/**
-	 * @brief 线程: 监测云量相机工作进度和状态
+	 * @brief 调度任务: 监测云量相机工作进度和状态
+	 * @note
+	 * 调焦时以曝光时间为周期
 	 */
-	void run();
+	void cycle();
 	/**
 	 * @brief 线程: 处理图像, 统计半高全宽
 	 */
 	void thread_reduce();
+	/**
+	 * @brief 自动调焦: 将单帧FWHM加入V曲线拟合, 并发送调焦步长或结束标志
+	 * @param frame  已完成处理的图像帧
+	 */
+	void focus_auto(xmFrmPtr frame);
+	/**
+	 * @brief 手动调焦: 统计连续多帧FWHM的均值和离散度
+	 * @param frame  已完成处理的图像帧
+	 */
+	void focus_manual(xmFrmPtr frame);
 
 // 数据类型
 private:
-	typedef struct xmFrameQueue {
-		boost::mutex mtx;
-		std::deque<xmFrmPtr> frames;
-
-	public:
-		void Push(xmFrmPtr frame) {
-			MtxLck lck(mtx);
-			frames.push_back(frame);
-		}
-
-		xmFrmPtr Pop() {
-			xmFrmPtr frame;
-			if (frames.size()) {
-				MtxLck lck(mtx);
-				frame = frames.front();
-				frames.pop_front();
-			}
-			return frame;
-		}
-
-		bool Empty() {
-			return frames.empty();
-		}
-	} xmFrmQue;
+	typedef BoundedQueue<xmFrmPtr> xmFrmQue;
 	typedef std::deque<double> dblQue;
 
 private:
@@ -148,24 +169,36 @@ private:
 	CameraPtr camPtr_;	///< 相机接口
 	int expdur_;		///< 云量相机曝光时间
 	int frmno_;			///< 帧序号
-    FILE* fpLog_;       ///< 日志文件
+    AppendLog logFile_; ///< 日志文件
 
     string dirRawImg_;      ///< 原始图像文件存储目录
 	string pathNtfyProc_;	///< 向处理软件告知图像文件
+	CloudEnginePtr engine_;	///< 进程内云量引擎
+	StoragePtr storage_;	///< 存储空间管理
+
+	/* 本底改正 */
+	FrameCalibrator calib_;	///< 主暗场与热像元修补
+	CalibResult calibRslt_;	///< 当前帧的改正结果
+	bool darkExpose_;		///< 当前曝光为暗场
+	int lightFrames_;		///< 上一帧暗场后的云图帧数
+	PreviewPtr preview_;	///< 预览与延时视频
 
-    ThrdPtr thrdMain_;  ///< 主线程
+    int cntFail_;       ///< 连接失败或无读出计数
+    BoostAsioKeep keep_;    ///< 线程池句柄
+    int idCycle_;           ///< 调度任务: 监测相机并启动曝光
+    int periodCycle_;       ///< 调度任务周期, 毫秒
 
 	/* 调焦 */
 	int focusMode_;	///< 调焦模式. 0- 停止; 1- 手动; 2- 自动
 	InvokeSExtractor invSEx_;	///< SExtractor接口
-	xmFrmQue queImg_;	///< 图像帧队列
+	xmFrmQue queImg_;	///< 图像帧队列. 有界, 处理线程总是处理最新的图像
 	dblQue   queFwhm_;	///< FWHM队列
 	ThrdPtr thrdReduce_;	///< 线程: 数据处理
-	boost::condition_variable cvNewImg_;	///< 有新的图像
 	// 自动调焦控制量
 	CBF cbfFocus_;	///< 回调函数: 调焦过程和结果
 	// 自动调焦接口
 	FocusAutoAlgo focusAlgo_;	///< 算法流程接口
+	ptime tmFocusMove_;		///< 最后一次调焦命令的时间. 此前开始曝光的图像不参与拟合
 	UdpPtr udpFocusPtr_;	///< 调焦网络通信接口
 };
 typedef CloudCamera::Pointer CloudCamPtr;
@@ -0,0 +1,325 @@
+/**
+ * @file CloudEngine.cpp 进程内云量引擎: 由相机帧缓冲区直接生成全天云量分布
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/filesystem.hpp>
+#include "ADefine.h"
+#include "CloudEngine.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+using namespace AstroUtil;
+
+CloudEngine::CloudEngine(const Parameter* param) {
+	param_  = param;
+	method_ = boost::iequals(param->engineMethod, "background") ? GRADE_BACKGROUND : GRADE_STARS;
+	projFail_ = false;
+	lensDirty_ = false;
+	refDensity_ = param->gradeDensity;
+	frames_  = 0;
+	msTotal_ = msMax_ = 0.0;
+}
+
+CloudEngine::~CloudEngine() {
+	Stop();
+}
+
+bool CloudEngine::Start() {
+	if (param_->gridAzStep <= 0.0 || param_->gridElStep <= 0.0 || param_->gridElMin >= 90.0) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], invalid zone grid", __FILE__, __FUNCTION__);
+		return false;
+	}
+	if (param_->astroEnable) {
+		calib_ = AstroCalibrator::Create(param_);
+		calib_->RegisterModel(boost::bind(&CloudEngine::lens_changed, this, _1));
+		if (!calib_->Start()) calib_.reset();
+	}
+	if (param_->photoEnable) photo_.Reset(param_);
+	queFrm_.Clear();
+	queFrm_.Statistic(true);
+	thrdProc_.reset(new boost::thread(boost::bind(&CloudEngine::thread_process, this)));
+	return true;
+}
+
+void CloudEngine::Stop() {
+	if (!thrdProc_.unique()) return;
+	interrupt_thread(thrdProc_);
+	if (calib_) {
+		calib_->Stop();
+		calib_.reset();
+	}
+
+	BoundedQueueStat stat = queFrm_.Statistic(true);
+	_gLog.Write("Cloud engine: frames = %d, dropped = %llu, latency = %.0f/%.0f ms",
+		frames_, stat.dropped, frames_ ? msTotal_ / frames_ : 0.0, msMax_);
+}
+
+void CloudEngine::RegisterResult(const CBSlot& slot) {
+	cbfResult_.connect(slot);
+}
+
+bool CloudEngine::Push(const CameraInfo* nfcam) {
+	if (nfcam->bitdepth <= 8 || nfcam->bitdepth > 16) return false;
+
+	CloudFrmPtr frame(new CloudFrame);
+	const uint16_t* data = (const uint16_t*) nfcam->data.get();
+	frame->width   = nfcam->wSensor;
+	frame->height  = nfcam->hSensor;
+	frame->dateobs = nfcam->dateobs;
+	frame->expdur  = nfcam->expdur;
+	frame->tmRead  = microsec_clock::universal_time();
+	frame->data.assign(data, data + nfcam->pixels);
+	if (queFrm_.Push(frame))
+		_gLog.Write(LOG_WARN, "cloud engine is slower than exposure, older frame was dropped");
+	return true;
+}
+
+void CloudEngine::thread_process() {
+	CloudFrmPtr frame;
+
+	while (true) {
+		queFrm_.Wait(frame);
+		if (frame) process(frame);
+		frame.reset();
+		boost::this_thread::interruption_point();
+	}
+}
+
+void CloudEngine::process(CloudFrmPtr frame) {
+	if ((lensDirty_.exchange(false) || !proj_.Match(frame->width, frame->height))
+		&& !load_projection(frame->width, frame->height)) return;
+
+	// 合并像元
+	const uint16_t* data = &frame->data[0];
+	int w = frame->width, wBin = proj_.WidthBin(), hBin = proj_.HeightBin(), x, y, i, j, k;
+	double norm = 1.0 / (CLOUD_BIN * CLOUD_BIN);
+	for (y = 0, k = 0; y < hBin; ++y) {
+		for (x = 0; x < wBin; ++x, ++k) {
+			const uint16_t* row = data + y * CLOUD_BIN * w + x * CLOUD_BIN;
+			uint32_t sum(0);
+			for (j = 0; j < CLOUD_BIN; ++j, row += w) {
+				for (i = 0; i < CLOUD_BIN; ++i) sum += row[i];
+			}
+			bin_[k] = float(sum * norm);
+		}
+	}
+
+	// 统计与分级
+	int n = proj_.Zones();
+	std::vector<double> cover(n, 1.0);
+	stat_zones();
+	if (method_ == GRADE_BACKGROUND) grade_background(frame->expdur, cover);
+	else grade_stars(cover);
+	if (param_->photoEnable) {
+		ptime mid = frame->dateobs + microseconds(int64_t(frame->expdur * 5E5));
+		photo_.Measure(mid, frame->expdur, proj_, &bin_[0], &bkg_[0], &noise_[0], phot_);
+	}
+
+	// 生成云量分布
+	InfoCloudage info;
+	info.Reset();
+	info.state   = WMCA_SUCCESS;
+	info.id      = param_->devID;
+	info.utc     = to_iso_extended_string(frame->dateobs);
+	info.siteLon = param_->siteLon;
+	info.siteLat = param_->siteLat;
+	info.siteAlt = param_->siteAlt;
+	info.azStep  = float(param_->gridAzStep);
+	info.elStep  = float(param_->gridElStep);
+	info.zones.reserve(n);
+	for (i = 0; i < n; ++i) {
+		const ProjZone& zone = proj_.Zone(i);
+		if (zone.area <= 0.0f) continue;	// 天区位于图像外
+		info.zones.push_back(std::make_tuple(zone.azi, zone.ele, int(cover[i] * CLOUD_LEVEL_MAX + 0.5)));
+		if (phot_.valid) info.phot.zones.push_back(phot_.zones[i]);
+	}
+	if (info.zones.empty()) info.state = WMCA_NO_DATA;	// 无有效天区
+	if (phot_.valid) {
+		info.phot.valid     = true;
+		info.phot.zeroPoint = phot_.zeroPoint;
+		info.phot.stars     = phot_.stars;
+		info.phot.detected  = phot_.detected;
+	}
+	cbfResult_(info);
+	if (calib_) submit_astrometry(frame, cover);
+
+	double ms = (microsec_clock::universal_time() - frame->tmRead).total_microseconds() * 1E-3;
+	msTotal_ += ms;
+	if (ms > msMax_) msMax_ = ms;
+	++frames_;
+}
+
+bool CloudEngine::load_projection(int width, int height) {
+	boost::filesystem::path pathProj(param_->sampleDir), pathModel(param_->sampleDir);
+	AllSkyLens lens;
+	pathProj  /= CLOUD_PROJ_FILE;
+	pathModel /= ASTRO_MODEL_FILE;
+	// 镜头模型: 标定结果优先于配置参数
+	lens.Reset(param_, width, height);
+	if (param_->astroEnable) AstroCalibrator::LoadModel(pathModel.string(), width, height, lens);
+	if (!proj_.Load(pathProj.string(), lens, param_, width, height, CLOUD_BIN)) {
+		if (!projFail_) _gLog.Write(LOG_FAULT, "[%s:%s], failed to load sky projection for %d x %d image",
+			__FILE__, __FUNCTION__, width, height);
+		projFail_ = true;
+		return false;
+	}
+
+	int n = proj_.Zones();
+	projFail_ = false;
+	bin_.resize(proj_.WidthBin() * proj_.HeightBin());
+	clip_.resize(n);
+	bkg_.resize(n);
+	noise_.resize(n);
+	_gLog.Write("Cloud engine: %d x %d image, %d zones, zenith = (%.1f, %.1f), scale = %.2f pixel/deg",
+		width, height, n, lens.x0, lens.y0, lens.scale);
+	return true;
+}
+
+void CloudEngine::stat_zones() {
+	int n = proj_.Zones(), i;
+
+	// 首次扫描: 全部像元; 二次扫描: 剔除星像后的背景和噪声
+	proj_.Moments(&bin_[0], NULL, moms_);
+	for (i = 0; i < n; ++i) clip_[i] = moms_[i].Mean() + CLOUD_CLIP_SIGMA * moms_[i].Sigma() + 1E-6;
+	proj_.Moments(&bin_[0], &clip_[0], moms_);
+	for (i = 0; i < n; ++i) {
+		bkg_[i]   = moms_[i].Mean();
+		noise_[i] = moms_[i].Sigma();
+	}
+}
+
+void CloudEngine::grade_stars(std::vector<double>& cover) {
+	int n = proj_.Zones(), i, k;
+	double v;
+	std::vector<int> counts;
+	std::vector<double> density(n, 0.0), valid;
+
+	// 星像: 高于背景gradeSigma倍噪声的局部极大值
+	for (i = 0; i < n; ++i) clip_[i] = bkg_[i] + param_->gradeSigma * (noise_[i] > 1.0 ? noise_[i] : 1.0);
+	proj_.CountPeaks(&bin_[0], &clip_[0], counts);
+	for (i = 0; i < n; ++i) {
+		const ProjZone& zone = proj_.Zone(i);
+		if (zone.area <= 0.0f) continue;
+		// 归算至天顶: 星数随极限星等按0.3 dex/星等变化
+		density[i] = counts[i] / zone.area * pow(10.0, 0.3 * SKY_EXTINCTION * (zone.airmass - 1.0));
+		valid.push_back(density[i]);
+	}
+	if (valid.empty()) return;
+
+	// 参考密度: 取夜间最佳值并缓慢衰减, 全天云时不被拉低
+	k = int(CLOUD_REF_QUANTILE * (valid.size() - 1));
+	std::nth_element(valid.begin(), valid.begin() + k, valid.end());
+	refDensity_ *= CLOUD_REF_DECAY;
+	if (valid[k] > refDensity_) refDensity_ = valid[k];
+	if (refDensity_ < 1E-6) return;
+	for (i = 0; i < n; ++i) {
+		v = 1.0 - density[i] / refDensity_;
+		cover[i] = v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v);
+	}
+}
+
+void CloudEngine::grade_background(double expdur, std::vector<double>& cover) {
+	int n = proj_.Zones(), i, k;
+	double x, model;
+	std::vector<double> excess(n, 0.0), valid;
+
+	if (expdur <= 0.0) expdur = 1.0;
+	for (i = 0; i < n; ++i) {
+		const ProjZone& zone = proj_.Zone(i);
+		if (zone.area <= 0.0f || bkg_[i] <= 0.0) continue;
+		// 晴夜背景随大气质量的变化: X * 10^(-0.4k(X-1))
+		x = zone.airmass;
+		model = x * pow(10.0, -0.4 * SKY_EXTINCTION * (x - 1.0));
+		excess[i] = log(bkg_[i] / expdur / model);
+		valid.push_back(excess[i]);
+	}
+	if (valid.empty() || param_->gradeContrast <= 0.0) return;
+
+	// 晴夜基准: 较暗天区的分位值
+	k = int(0.25 * (valid.size() - 1));
+	std::nth_element(valid.begin(), valid.begin() + k, valid.end());
+	for (i = 0; i < n; ++i) {
+		if (proj_.Zone(i).area <= 0.0f || bkg_[i] <= 0.0) continue;
+		x = (excess[i] - valid[k]) / param_->gradeContrast;
+		cover[i] = x < 0.0 ? 0.0 : (x > 1.0 ? 1.0 : x);
+	}
+}
+
+void CloudEngine::submit_astrometry(CloudFrmPtr frame, const std::vector<double>& cover) {
+	int n = proj_.Zones(), nsky(0), nclear(0), i;
+	for (i = 0; i < n; ++i) {
+		if (proj_.Zone(i).area <= 0.0f) continue;
+		++nsky;
+		if (cover[i] < CLOUD_ASTRO_COVER) ++nclear;
+	}
+	if (!nsky || nclear < CLOUD_ASTRO_CLEAR * nsky) return;
+
+	// 星像: 高于背景gradeSigma倍噪声的局部极大值, 3*3质心, 换算至原始图像坐标
+	int w = proj_.WidthBin(), h = proj_.HeightBin(), x, y, z, k;
+	const int16_t* index = proj_.Index();
+	const float* img = &bin_[0];
+	std::vector<double> thresh(n);
+	xmStarVec stars;
+	for (i = 0; i < n; ++i) thresh[i] = bkg_[i] + param_->gradeSigma * (noise_[i] > 1.0 ? noise_[i] : 1.0);
+	for (y = 1; y < h - 1; ++y) {
+		for (x = 1, k = y * w + 1; x < w - 1; ++x, ++k) {
+			if ((z = index[k]) < 0) continue;
+			const float* c = img + k;
+			float v = *c;
+			if (v <= thresh[z]) continue;
+			if (!(v >  c[-w - 1] && v >  c[-w] && v >  c[-w + 1] && v >  c[-1]
+			   && v >= c[1]      && v >= c[w - 1] && v >= c[w]   && v >= c[w + 1])) continue;
+
+			double sum(0.0), sx(0.0), sy(0.0), t;
+			for (int j = -1; j <= 1; ++j) {
+				for (i = -1; i <= 1; ++i) {
+					if ((t = c[j * w + i] - bkg_[z]) <= 0.0) continue;
+					sum += t;
+					sx  += t * i;
+					sy  += t * j;
+				}
+			}
+			xmStar star = xmStar();
+			star.x    = (x + sx / sum + 0.5) * CLOUD_BIN - 0.5;
+			star.y    = (y + sy / sum + 0.5) * CLOUD_BIN - 0.5;
+			star.flux = sum * CLOUD_BIN * CLOUD_BIN;
+			star.snr  = (v - bkg_[z]) / (noise_[z] > 1.0 ? noise_[z] : 1.0);
+			stars.push_back(star);
+		}
+	}
+	if (int(stars.size()) > CLOUD_ASTRO_STARS) {
+		std::nth_element(stars.begin(), stars.begin() + CLOUD_ASTRO_STARS, stars.end(), [](const xmStar& x1, const xmStar& x2) {
+			return x1.flux > x2.flux;
+		});
+		stars.resize(CLOUD_ASTRO_STARS);
+	}
+
+	xmFrmPtr frm = xmFrame::Create();
+	frm->width    = frame->width;
+	frm->height   = frame->height;
+	frm->dateObs  = to_iso_extended_string(frame->dateobs);
+	frm->expTime  = frame->expdur;
+	frm->astroFix = false;
+	frm->stars.reserve(stars.size());
+	for (xmStarVec::iterator it = stars.begin(); it != stars.end(); ++it) {
+		xmStarPtr star = xmStar::Create();
+		*star = *it;
+		star->mag     = -2.5 * log10(star->flux);
+		star->matched = 0;
+		frm->stars.push_back(star);
+	}
+	calib_->Push(frm);
+}
+
+void CloudEngine::lens_changed(const AllSkyLens& lens) {
+	lensDirty_ = true;
+}
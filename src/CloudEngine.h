@@ -0,0 +1,161 @@
+/**
+ * @file CloudEngine.h 进程内云量引擎: 由相机帧缓冲区直接生成全天云量分布
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 读出后复制图像数据并立即返回, 在独立线程中处理. 处理慢于曝光时丢弃较早的帧
+ * - 图像按CLOUD_BIN合并, 合并像元经投影表(SkyProjection)映射到天区网格.
+ *   投影表文件位于测量数据目录, 镜头标定、天区网格或图像尺寸变化时重新生成
+ * - 分级方法:
+ *   stars:      天区内星像密度相对晴夜参考密度的缺失比例. 参考密度随夜间最佳值更新
+ *   background: 天区背景亮度相对晴夜亮度-大气质量模型的增量
+ * - 结果与ReadCloudage解析的外部处理结果格式相同
+ * - 启用天文标定时, 晴夜帧提取星像后提交AstroCalibrator. 标定结果变化时重新生成投影表
+ * - 启用测光时, 每帧由ZonePhotometry测量天区消光, 随云量分布发布
+ */
+
+#ifndef CLOUD_ENGINE_H_
+#define CLOUD_ENGINE_H_
+
+#include <vector>
+#include <boost/signals2/signal.hpp>
+#include <boost/atomic.hpp>
+#include "BoostInclude.h"
+#include "BoundedQueue.h"
+#include "CameraBase.h"
+#include "SkyProjection.h"
+#include "AstroCalib.h"
+#include "ZonePhotometry.h"
+#include "ReadCloudage.h"
+
+#define CLOUD_BIN			2		///< 合并因子
+#define CLOUD_LEVEL_MAX		9		///< 云量等级上限: 全云. 与外部云量文件一致, 分为0~9级
+#define CLOUD_REF_DECAY		0.995	///< 参考星像密度的逐帧衰减系数
+#define CLOUD_REF_QUANTILE	0.8		///< 更新参考星像密度的天区分位数
+#define CLOUD_CLIP_SIGMA	3.0		///< 背景统计剔除星像的阈值, 噪声倍数
+#define CLOUD_PROJ_FILE		"SkyProjection.lut"	///< 投影表文件名
+#define CLOUD_ASTRO_COVER	0.3		///< 晴空天区的遮挡比例上限
+#define CLOUD_ASTRO_CLEAR	0.8		///< 提交天文标定的晴空天区比例下限
+#define CLOUD_ASTRO_STARS	300		///< 提交天文标定的最亮星像数量
+
+/**
+ * @brief 待处理的图像帧
+ */
+struct CloudFrame {
+	int width, height;	///< 图像尺寸
+	ptime dateobs;		///< 曝光开始时间
+	double expdur;		///< 曝光时间, 秒
+	ptime tmRead;		///< 提交时间: 读出完成
+	std::vector<uint16_t> data;	///< 图像数据
+};
+typedef boost::shared_ptr<CloudFrame> CloudFrmPtr;
+
+class CloudEngine {
+public:
+	typedef boost::shared_ptr<CloudEngine> Pointer;
+	/*!
+	 * @brief 声明回调函数及插槽: 云量分布
+	 */
+	typedef boost::signals2::signal<void (const InfoCloudage&)> CBF;
+	typedef CBF::slot_type CBSlot;
+
+	enum {
+		GRADE_STARS,		///< 星像计数
+		GRADE_BACKGROUND	///< 背景梯度
+	};
+
+public:
+	CloudEngine(const Parameter* param);
+	~CloudEngine();
+	static Pointer Create(const Parameter* param) {
+		return Pointer(new CloudEngine(param));
+	}
+
+public:
+	/**
+	 * @brief 启动处理线程
+	 */
+	bool Start();
+	/**
+	 * @brief 停止处理线程
+	 */
+	void Stop();
+	/**
+	 * @brief 注册回调函数: 云量分布
+	 * @note
+	 * 在引擎线程中回调
+	 */
+	void RegisterResult(const CBSlot& slot);
+	/**
+	 * @brief 提交读出的图像
+	 * @param nfcam  相机状态及图像数据
+	 * @return
+	 * false: 数字位宽不被支持
+	 */
+	bool Push(const CameraInfo* nfcam);
+
+protected:
+	/**
+	 * @brief 线程: 处理图像帧
+	 */
+	void thread_process();
+	/**
+	 * @brief 由单帧图像生成云量分布
+	 */
+	void process(CloudFrmPtr frame);
+	/**
+	 * @brief 加载适用于当前图像尺寸的投影表
+	 */
+	bool load_projection(int width, int height);
+	/**
+	 * @brief 统计各天区的背景和噪声
+	 */
+	void stat_zones();
+	/**
+	 * @brief 按星像密度分级, 输出遮挡比例
+	 */
+	void grade_stars(std::vector<double>& cover);
+	/**
+	 * @brief 按背景梯度分级, 输出遮挡比例
+	 */
+	void grade_background(double expdur, std::vector<double>& cover);
+	/**
+	 * @brief 晴夜帧: 提取星像并提交天文标定
+	 */
+	void submit_astrometry(CloudFrmPtr frame, const std::vector<double>& cover);
+	/**
+	 * @brief 回调: 镜头模型变化
+	 */
+	void lens_changed(const AllSkyLens& lens);
+
+protected:
+	const Parameter* param_;	///< 配置参数
+	int method_;			///< 分级方法
+	CBF cbfResult_;			///< 回调函数: 云量分布
+	BoundedQueue<CloudFrmPtr> queFrm_;	///< 图像帧队列. 有界, 总是处理最新的图像
+	ThrdPtr thrdProc_;		///< 线程: 处理图像帧
+
+	/* 天区网格 */
+	SkyProjection proj_;	///< 投影表
+	bool projFail_;			///< 投影表加载失败. 避免重复记录日志
+	AstroCalibPtr calib_;	///< 天文标定
+	boost::atomic<bool> lensDirty_;	///< 镜头模型已变化, 待重新加载投影表
+	ZonePhotometry photo_;	///< 测光透明度
+	CloudPhot phot_;		///< 测光结果: 与投影表的天区一一对应
+
+	/* 计算缓冲区 */
+	std::vector<float> bin_;		///< 合并图像
+	ZoneMomentVec moms_;			///< 天区统计量
+	std::vector<double> clip_;		///< 天区阈值
+	std::vector<double> bkg_;		///< 天区背景
+	std::vector<double> noise_;		///< 天区噪声
+	double refDensity_;		///< 晴夜参考星像密度, 颗/平方度, 归算至天顶
+
+	/* 统计 */
+	int frames_;			///< 已处理帧数
+	double msTotal_;		///< 自读出至生成结果的累计耗时, 毫秒
+	double msMax_;			///< 自读出至生成结果的最大耗时, 毫秒
+};
+typedef CloudEngine::Pointer CloudEnginePtr;
+
+#endif
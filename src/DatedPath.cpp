@@ -0,0 +1,129 @@
+/**
+ * @file DatedPath.cpp 按日期组织的输出目录: 缓存当日目录并生成文件名
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "DatedPath.h"
+#include "GLog.h"
+
+using namespace boost::filesystem;
+using namespace boost::posix_time;
+
+/*
+ * 创建目录. 新建的目录移除组和其他用户的写权限
+ */
+static bool make_dir(const path& pathName, boost::system::error_code& ec) {
+	if (create_directory(pathName, ec)) permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write, ec);
+	return !ec;
+}
+
+/*
+ * 创建根目录及缺失的上级目录. 新建的根目录移除组和其他用户的写权限
+ */
+static bool make_root(const path& pathName, boost::system::error_code& ec) {
+	if (create_directories(pathName, ec)) permissions(pathName, perms::remove_perms | perms::group_write | perms::others_write, ec);
+	return !ec;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+DatedTree::DatedTree(const string& root, int levels, const string& prefix) {
+	root_   = root;
+	levels_ = levels;
+	prefix_ = prefix;
+	last_   = 0;
+}
+
+string DatedTree::Dir(const date& day) {
+	MtxLck lck(mtx_);
+	const DayCache* cache = lookup(day);
+	return cache ? cache->dir : string();
+}
+
+string DatedTree::File(const date& day, const char* prefix, const char* suffix) {
+	MtxLck lck(mtx_);
+	const DayCache* cache = lookup(day);
+	if (!cache) return string();
+	return cache->dir + char(path::preferred_separator) + prefix + cache->stamp + suffix;
+}
+
+string DatedTree::File(const ptime& tm, const char* prefix, const char* sep, const char* suffix) {
+	ptime::time_duration_type tdt = tm.time_of_day();
+	char hms[40];
+	snprintf(hms, sizeof(hms), "%02d%02d%02d", int(tdt.hours()), int(tdt.minutes()), int(tdt.seconds()));
+
+	MtxLck lck(mtx_);
+	const DayCache* cache = lookup(tm.date());
+	if (!cache) return string();
+	return cache->dir + char(path::preferred_separator) + prefix + cache->stamp + sep + hms + suffix;
+}
+
+const DatedTree::DayCache* DatedTree::lookup(const date& day) {
+	if (cache_[last_].day == day) return &cache_[last_];
+	if (cache_[1 - last_].day == day) return &cache_[1 - last_];
+
+	int year = day.year(), month = day.month().as_number(), dd = day.day();
+	char name[20];
+	boost::system::error_code ec;
+	path pathName(root_);
+
+	// 逐级创建目录
+	bool ok = make_root(pathName, ec);
+	if (ok && (levels_ & DATED_YEAR)) {
+		snprintf(name, sizeof(name), "Y%d", year);
+		pathName /= name;
+		ok = make_dir(pathName, ec);
+	}
+	if (ok && (levels_ & DATED_DAY)) {
+		if (levels_ & DATED_SHORT) snprintf(name, sizeof(name), "%02d%02d%02d", year % 100, month, dd);
+		else snprintf(name, sizeof(name), "%d%02d%02d", year, month, dd);
+		pathName /= prefix_ + name;
+		ok = make_dir(pathName, ec);
+	}
+	if (!ok) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to create [%s], %s", __FILE__, __FUNCTION__,
+			pathName.c_str(), ec.message().c_str());
+		return NULL;
+	}
+
+	// 替换较早创建的缓存项
+	last_ = 1 - last_;
+	DayCache& cache = cache_[last_];
+	snprintf(name, sizeof(name), "%d%02d%02d", year, month, dd);
+	cache.day   = day;
+	cache.dir   = pathName.string();
+	cache.stamp = name;
+	return &cache;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+DatedPath::DatedPath() {
+}
+
+DatedPath::~DatedPath() {
+}
+
+DatedTreePtr DatedPath::Tree(const string& root, int levels, const string& prefix) {
+	char key[20];
+	snprintf(key, sizeof(key), "%d:", levels);
+
+	MtxLck lck(mtx_);
+	DatedTreePtr& tree = trees_[key + prefix + ":" + root];
+	if (!tree) tree.reset(new DatedTree(root, levels, prefix));
+	return tree;
+}
+
+void DatedPath::Prepare() {
+	std::vector<DatedTreePtr> trees;
+	{
+		MtxLck lck(mtx_);
+		for (std::map<string, DatedTreePtr>::iterator it = trees_.begin(); it != trees_.end(); ++it)
+			trees.push_back(it->second);
+	}
+
+	boost::gregorian::date tomorrow = second_clock::universal_time().date() + boost::gregorian::days(1);
+	for (size_t i = 0; i < trees.size(); ++i) trees[i]->Dir(tomorrow);
+}
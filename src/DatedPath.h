@@ -0,0 +1,116 @@
+/**
+ * @file DatedPath.h 按日期组织的输出目录: 缓存当日目录并生成文件名
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 目录树: <root>[/Y<year>][/<prefix><YYYYMMDD或YYMMDD>]
+ * - 每个目录树缓存两个日期的目录. 首次访问某日时逐级创建并设置权限, 根目录的上级目录缺失时一并创建,
+ *   其后同日内生成路径不再访问文件系统
+ * - DatedPath::Prepare在UTC日界前预先创建次日目录, 日界后的首次写入无需创建目录
+ * - 生成的路径以值返回, 可在多线程中使用
+ */
+
+#ifndef DATED_PATH_H_
+#define DATED_PATH_H_
+
+#include <map>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "BoostInclude.h"
+
+using std::string;
+
+#define DATED_AHEAD		600		///< 在UTC日界前预先创建次日目录, 秒
+
+/**
+ * @brief 目录层级
+ */
+enum {
+	DATED_YEAR  = 0x01,	///< 年目录: Y<year>
+	DATED_DAY   = 0x02,	///< 日目录: <prefix><YYYYMMDD>
+	DATED_SHORT = 0x04	///< 日目录使用两位年份: <prefix><YYMMDD>
+};
+
+class DatedTree {
+public:
+	typedef boost::shared_ptr<DatedTree> Pointer;
+	typedef boost::gregorian::date date;
+	typedef boost::posix_time::ptime ptime;
+
+public:
+	/**
+	 * @param root    根目录
+	 * @param levels  目录层级, DATED_*的组合
+	 * @param prefix  日目录名前缀
+	 */
+	DatedTree(const string& root, int levels, const string& prefix);
+
+protected:
+	/* 数据类型 */
+	struct DayCache {
+		date day;		///< 日期
+		string dir;		///< 日期目录
+		string stamp;	///< 日期戳: YYYYMMDD
+	};
+
+protected:
+	/* 成员变量 */
+	boost::mutex mtx_;	///< 互斥锁
+	string root_;		///< 根目录
+	int levels_;		///< 目录层级
+	string prefix_;		///< 日目录名前缀
+	DayCache cache_[2];	///< 最近使用的两个日期
+	int last_;			///< 最近创建的缓存项
+
+public:
+	/* 接口 */
+	/*!
+	 * @brief 日期目录. 该日首次访问时创建
+	 * @return
+	 * 创建失败时返回空字符串
+	 */
+	string Dir(const date& day);
+	/*!
+	 * @brief 按日命名的文件: <日期目录>/<prefix><YYYYMMDD><suffix>
+	 */
+	string File(const date& day, const char* prefix, const char* suffix);
+	/*!
+	 * @brief 按时刻命名的文件: <日期目录>/<prefix><YYYYMMDD><sep><hhmmss><suffix>
+	 */
+	string File(const ptime& tm, const char* prefix, const char* sep, const char* suffix);
+
+protected:
+	/*!
+	 * @brief 查找或创建日期目录
+	 * @return
+	 * 缓存项. 创建失败时返回NULL
+	 */
+	const DayCache* lookup(const date& day);
+};
+typedef DatedTree::Pointer DatedTreePtr;
+
+class DatedPath {
+public:
+	DatedPath();
+	virtual ~DatedPath();
+
+protected:
+	/* 成员变量 */
+	boost::mutex mtx_;	///< 互斥锁
+	std::map<string, DatedTreePtr> trees_;	///< 已登记的目录树
+
+public:
+	/* 接口 */
+	/*!
+	 * @brief 登记目录树. 相同的根目录与层级共享同一实例
+	 */
+	DatedTreePtr Tree(const string& root, int levels, const string& prefix = "");
+	/*!
+	 * @brief 调度任务: 为已登记的目录树创建次日目录
+	 */
+	void Prepare();
+};
+
+extern DatedPath _gDated;
+
+#endif
@@ -15,7 +15,6 @@
 #include <boost/bind/bind.hpp>
 #include <boost/bind/placeholders.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
@@ -23,7 +22,7 @@
 #include "GLog.h"
 #include "ADefine.h"
 #include "EnvMonitor.h"
-#include "ATimeSpace.h"
+#include "Ephemeris.h"
 #include "AstroDeviceDef.h"
 #include "ProtocolPDXP.h"
 #include "ProtoFocus.h"
@@ -34,7 +33,10 @@ using namespace boost::placeholders;
 using namespace AstroUtil;
 
 EnvMonitor::EnvMonitor(const Parameter* param) {
-	param_ = param;
+	param_   = param;
+	pnoPDXP_ = 0;
+	dusk_ = dawn_ = 0.0;
+	idTwilight_ = idPDXP_ = idDated_ = 0;
 }
 
 EnvMonitor::~EnvMonitor() {
@@ -61,17 +63,42 @@ bool EnvMonitor::Start() {
 		return false;
 	}
 
+	// 测量记录的持久化策略
+	for (std::vector<Parameter::LogSync>::const_iterator it = param_->logSyncs.begin(); it != param_->logSyncs.end(); ++it)
+		AppendLog::SetPolicy(it->stream, it->mode, it->period);
+
 	odt_ = TypeObservationDuration::ODT_MIN;
-	thrdTwilight_.reset(new boost::thread(boost::bind(&EnvMonitor::monitor_twilight, this)));
-	if (param_->minDiskFree > 0) thrdDisk_.reset(new boost::thread(boost::bind(&EnvMonitor::thread_diskfree, this)));
+	keep_.Post(boost::bind(&EnvMonitor::plan_twilight, this));
+	// 日期目录: 日界前预先创建次日目录
+	treeWea_ = _gDated.Tree((path(param_->sampleDir) / "WeaFile").string(), DATED_YEAR | DATED_DAY, "WEA");
+	idDated_ = _gSched.Every(keep_, "dated paths", 86400 * 1000, boost::bind(&DatedPath::Prepare, &_gDated),
+		(86400 - DATED_AHEAD) * 1000);
+	// 存储空间管理
+	storage_ = StorageManager::Create(param_);
+	storage_->Start();
 	// 启动网络上传流程
-	if (param_->enablePDXP) thrdPDXP_.reset(new boost::thread(boost::bind(&EnvMonitor::thread_pdxp, this)));
+	if (param_->enablePDXP) {
+		int cycle = param_->sampleCycle <= 10 ? 10 : param_->sampleCycle;
+		udpPDXP_ = UdpSession::Create();
+		udpPDXP_->Open();
+		idPDXP_ = _gSched.Every(keep_, "pdxp", cycle * 1000, boost::bind(&EnvMonitor::cycle_pdxp, this));
+	}
 
 	weaStatPtr_ = WeatherStation::Create(param_->portWeaStation.c_str(), param_->portRain.c_str(), param_->sampleDir.c_str());
 	weaStatPtr_->Start(param_->sampleCycle);
 
 	readCloudagePtr_ = ReadCloudage::Create();
 	readCloudagePtr_->Start(param_);
+	if (param_->engineEnable) {// 进程内云量引擎: 结果交由ReadCloudage标注和发布
+		cloudEngine_ = CloudEngine::Create(param_);
+		const CloudEngine::CBSlot& slot = boost::bind(&ReadCloudage::Submit, readCloudagePtr_.get(), _1);
+		cloudEngine_->RegisterResult(slot);
+		if (!cloudEngine_->Start()) cloudEngine_.reset();
+	}
+
+	// 扩展传感器
+	sampleLog_.Start(param_->sampleDir);
+	sensors_ = SensorRegistry::CreateAll(param_->sensors, param_);
 
 	// 网络服务
 	udpCmd_ = UdpSession::Create();
@@ -87,128 +114,101 @@ bool EnvMonitor::Start() {
 void EnvMonitor::Stop() {
 	udpCmd_.reset();
 
-	interrupt_thread(thrdDisk_);
-	interrupt_thread(thrdTwilight_);
-	interrupt_thread(thrdPDXP_);
+	{// 停止调度任务
+		_gSched.Cancel(idTwilight_);
+		_gSched.Cancel(idPDXP_);
+		_gSched.Cancel(idDated_);
+		keep_.Stop();
+		udpPDXP_.reset();
+	}
 
 	if (camCloudPtr_.unique()) {
 		camCloudPtr_->Stop();
 		camCloudPtr_.reset();
 	}
 
-	sqmPtr_.reset();
+	sqmMgr_.reset();
+	if (cloudEngine_) {
+		cloudEngine_->Stop();
+		cloudEngine_.reset();
+	}
 	readCloudagePtr_.reset();
 	weaStatPtr_.reset();
+	for (SensorVec::iterator it = sensors_.begin(); it != sensors_.end(); ++it) (*it)->Stop();
+	sensors_.clear();
+	sampleLog_.Stop();
+	if (storage_) {
+		storage_->Stop();
+		storage_.reset();
+	}
 }
 
-/*========================== 线程 ==========================*/
-void EnvMonitor::monitor_twilight() {
-	double sunrise, sunset;// 小时, 本地时
-
-	while (1) {
-		{// 计算晨昏蒙影
-			ptime utc = second_clock::universal_time();
-			ptime::date_type today = utc.date();
-			ATimeSpace ats;
-			ats.SetSite(param_->siteLon, param_->siteLat, param_->siteAlt, -timezone/3600);
-			ats.SetUTC(today.year(), today.month().as_number(), today.day(), utc.time_of_day().total_seconds() / AU_DAYSEC);
-			if (ats.TimeOfSunAlt(sunrise, sunset, param_->sunEleMax)) {
-				sunrise = 24;
-				sunset  = 0;
-			}
-			char risestr[20], setstr[20];
-			ats.HourDbl2Str(sunrise, risestr);
-			ats.HourDbl2Str(sunset,  setstr);
-			_gLog.Write("Observation Duration: From = %s,  To = %s", setstr, risestr);
+/*========================== 调度任务 ==========================*/
+void EnvMonitor::plan_twilight() {
+	double now = Ephemeris::MJD(microsec_clock::universal_time());
+	{// 更新星历表, 由太阳高度角表计算夜间时段
+		if (!_gEphem.Covers(now, now + 2.0))
+			_gEphem.Build(param_->siteLon, param_->siteLat, param_->siteAlt, floor(now));
+		if (!_gEphem.Night(now, param_->sunEleMax, dusk_, dawn_)) {// 极昼或极夜: 持续观测, 次日重新计算
+			dusk_ = now;
+			dawn_ = now + 1.0;
 		}
-		{// 等待至昏影时
-			odt_ = TypeObservationDuration::ODT_DAYTIME;
-			double hours = second_clock::local_time().time_of_day().total_seconds() / 3600.0;
-			if (hours > sunrise && hours < sunset) {
-				int seconds = int((sunset - hours) * 3600 + 1.5);
-				boost::this_thread::sleep_for(boost::chrono::seconds(seconds));
-			}
-			odt_ = TypeObservationDuration::ODT_NIGHT;
-		}
-		{// 1: 启动观测流程
-			camCloudPtr_ = CloudCamera::Create(param_);
-			camCloudPtr_->Start();
-
-			sqmPtr_ = SQM::Create(param_->addrSQM.c_str(), param_->sampleDir.c_str());
-			sqmPtr_->Start(param_->sampleCycle);
-		}
-		{// 观测至晨光始
-			double hours = second_clock::local_time().time_of_day().total_seconds() / 3600.0;
-			if ((hours = sunrise - hours) < 0) hours += 24;
-			int seconds = int(hours * 3600 + 1.5);
-			boost::this_thread::sleep_for(boost::chrono::seconds(seconds));
+		_gLog.Write("Observation Duration: From = %s,  To = %s",
+			to_simple_string(Ephemeris::UTC(dusk_)).c_str(), to_simple_string(Ephemeris::UTC(dawn_)).c_str());
+	}
+	{// 等待至昏影时
+		odt_ = TypeObservationDuration::ODT_DAYTIME;
+		if (now < dusk_) {
+			int64_t ms = int64_t((dusk_ - now) * 86400.0 + 1.5) * 1000;
+			idTwilight_ = _gSched.Once(keep_, "twilight", ms, boost::bind(&EnvMonitor::night_begin, this));
 		}
-		{// 停止观测流程
-			_gLog.Write("Cloud Camera stopped for entering into day time");
-			_gLog.Write("SQM stopped for entering into day time");
+		else night_begin();
+	}
+}
 
-			camCloudPtr_.reset();
-			sqmPtr_.reset();
+void EnvMonitor::night_begin() {
+	odt_ = TypeObservationDuration::ODT_NIGHT;
+	{// 1: 启动观测流程
+		camCloudPtr_ = CloudCamera::Create(param_);
+		camCloudPtr_->SetEngine(cloudEngine_);
+		camCloudPtr_->SetStorage(storage_);
+		camCloudPtr_->Start();
+
+		SQMUnitVec units(1);
+		units[0].name = "sqm";
+		units[0].ip   = param_->addrSQM;
+		for (size_t i = 0; i < param_->sqmUnits.size(); ++i) {
+			SQMUnit unit;
+			unit.name = param_->sqmUnits[i].name;
+			unit.ip   = param_->sqmUnits[i].addr;
+			unit.port = param_->sqmUnits[i].port;
+			if (unit.name.empty()) unit.name = "sqm-" + unit.ip;
+			units.push_back(unit);
 		}
+		sqmMgr_ = SQMManager::Create(param_->sampleDir.c_str());
+		sqmMgr_->Start(param_->sampleCycle, units);
+		if (param_->sqmDiscover) sqmMgr_->Discover();
+	}
+	{// 观测至晨光始
+		double days = dawn_ - Ephemeris::MJD(microsec_clock::universal_time());
+		int64_t ms = int64_t((days > 0.0 ? days : 0.0) * 86400.0 + 1.5) * 1000;
+		idTwilight_ = _gSched.Once(keep_, "twilight", ms, boost::bind(&EnvMonitor::night_end, this));
 	}
 }
 
-void EnvMonitor::thread_diskfree() {
-	while (1) {
-		ptime tmNow = second_clock::local_time();
-		ptime tmNoon(tmNow.date(), hours(12));
-		int toWait = (tmNoon - tmNow).total_seconds();
-		if (toWait <= 0) toWait += 86400;
-		boost::this_thread::sleep_for(boost::chrono::seconds(toWait));
-
-		try {// 检查磁盘可用空间
-			path pathDir(param_->dirRawImage);
-			space_info si = space(pathDir);
-			if ((si.available >> 30) > param_->minDiskFree) continue;
-			_gLog.Write(LOG_WARN, "free disk capacity [%d] GB is less than threshold...starts erasing the oldest data",
-				si.available >> 30);
-
-			// 查找待删除目录
-			typedef std::vector<string> stringvec;
-			stringvec dirList;
-			string subName;
-			for (directory_iterator it = directory_iterator(pathDir); it != directory_iterator(); ++it) {
-				if (is_directory(it->path())) {
-					subName = it->path().filename().string();
-					if (subName.find(param_->prefixName) == 0) dirList.push_back(it->path().string());
-				}
-			}
-			std::stable_sort(dirList.begin(), dirList.end(), [](const string& ls, const string& rs) {
-				return ls < rs;
-			});
-
-			// 删除历史数据
-			for (stringvec::iterator it = dirList.begin(); it != dirList.end(); ++it) {
-				remove_all(path(*it));
+void EnvMonitor::night_end() {
+	_gLog.Write("Cloud Camera stopped for entering into day time");
+	_gLog.Write("SQM stopped for entering into day time");
 
-				si = space(pathDir);
-				if ((si.available >> 30) > param_->minDiskFree) break;
-			}
-			_gLog.Write("disk erasing complete, free capacity is %d GB", si.available >> 30);
-		}
-		catch(filesystem_error& ex) {
-			_gLog.Write(LOG_FAULT, "[%s : %s], %s", __FILE__, __FUNCTION__, ex.what());
-		}
-	}
+	camCloudPtr_.reset();
+	sqmMgr_.reset();
+	plan_twilight();
 }
 
-void EnvMonitor::thread_pdxp() {
-	boost::chrono::seconds toWait(param_->sampleCycle <= 10 ? 10 : param_->sampleCycle);
-	uint32_t pno(0);
-	UdpPtr udp = UdpSession::Create();
-	udp->Open();
-
-	while (1) {
-		boost::this_thread::sleep_for(toWait);
-		upload_pdxp(udp,  pno,  param_->addrPDXP.c_str(),  param_->portPDXP);
-        // save_json();   ///< 保存事后气象数据
-		++pno;
-	}
+void EnvMonitor::cycle_pdxp() {
+	upload_pdxp(udpPDXP_,  pnoPDXP_,  param_->addrPDXP.c_str(),  param_->portPDXP);
+    // save_json();   ///< 保存事后气象数据
+	++pnoPDXP_;
 }
 
 void EnvMonitor::save_json() {
@@ -274,9 +274,10 @@ void EnvMonitor::save_json() {
     ptSQM.add("State", 1);
     ptSQM.add("SQMUTC", Mtime);
     ptSQM.add("MPSAS", -99.9);
-    if(sqmPtr_.unique()) {
-        if (sqmPtr_->IsConnected()) {
-            const InfoSQM* nfSQM = sqmPtr_->GetInfo();
+    SQMPtr sqm = sqmMgr_ ? sqmMgr_->Primary() : SQMPtr();
+    if (sqm) {
+        if (sqm->IsConnected()) {
+            const InfoSQM* nfSQM = sqm->GetInfo();
             if (nfSQM->state != SQM_NO_DATA) {
                 // 填写sqm 到 wea文件
                 string sqmUtc = nfSQM->utc;
@@ -376,6 +377,7 @@ void EnvMonitor::upload_pdxp(UdpPtr udp, uint32_t pno, const char* ip, int port)
 	const InfoCloudage* nfCloudage = readCloudagePtr_->GetInfo();
 	int zone_count = nfCloudage->zones.size();
 	int pack_count = (zone_count + zone_max - 1) / zone_max;
+	if (qxzsy.cloud_state == 0 && zone_count <= 0) qxzsy.cloud_state = 1; // 无有效天区
 	if (qxzsy.cloud_state == 0) {// 填充云量分布基本信息
 		UTC2DateTimeBJ(nfCloudage->utc.c_str(), qxzsy.cloud_date, qxzsy.cloud_time);
 		qxzsy.azi_step   = int32_t(nfCloudage->azStep * 10);
@@ -405,14 +407,15 @@ void EnvMonitor::upload_pdxp(UdpPtr udp, uint32_t pno, const char* ip, int port)
 	}
 
 	// 填充夜天光
-	if (!sqmPtr_.unique()) {// 未工作
+	SQMPtr sqm = sqmMgr_ ? sqmMgr_->Primary() : SQMPtr();
+	if (!sqm) {// 未工作
 		qxzsy.sqm_state = 0x02;
     }
-	else if (!sqmPtr_->IsConnected()) {// 连接失败
+	else if (!sqm->IsConnected()) {// 连接失败
 		qxzsy.sqm_state = 0x01;
     }
 	else {
-		const InfoSQM* nfSQM = sqmPtr_->GetInfo();
+		const InfoSQM* nfSQM = sqm->GetInfo();
 		if (nfSQM->state == SQM_NO_DATA) {
             qxzsy.sqm_state = 0x03; // 无读出
         }
@@ -442,7 +445,7 @@ void EnvMonitor::upload_pdxp(UdpPtr udp, uint32_t pno, const char* ip, int port)
 		for (int i = 0; i < zone_count; ++i) {
 			if (std::get<2>(caSet[i]) >= 7) ++zone_greater_7;
 		}
-		qxzsy.cloud_percent = uint16_t(zone_greater_7 * 1000 / zone_count);
+		qxzsy.cloud_percent = zone_count > 0 ? uint16_t(zone_greater_7 * 1000 / zone_count) : UINT16_MAX;
 
 		// 填充分天区云量
 		for (int pack_no = 1; pack_no <= pack_count; ++pack_no) {
@@ -520,43 +523,17 @@ void EnvMonitor::focus_respond(const int rslt, const int value) {
 	}
 }
 
-const char* EnvMonitor::log_filepath(const InfoCloudage* info_) {
+string EnvMonitor::log_filepath(const InfoCloudage* info_) {
     try {
         // 文件路径
         // <root>
-        //       CloudAge
+        //       WeaFile
         //               Y<year>
-        //                      CA<year><month><day>
-        //                                          CA<year><month><day>T<hour><minute><second>.json
+        //                      WEA<year><month><day>
+        //                                          <year><month><day><hour><minute><second>_5606.wea
         //
         ptime utc = from_iso_extended_string(info_->utc);
-        ptime::date_type day = utc.date();
-        ptime::time_duration_type tdt = utc.time_of_day();
-        static path pathName;
-        pathName = param_->sampleDir;
-        pathName /= "WeaFile";
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("Y%d") % day.year()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("WEA%d%02d%02d") % day.year() % day.month().as_number() % day.day()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("%d%02d%02d%02d%02d%02d_5606.wea")
-                     % day.year() % day.month().as_number() % day.day()
-                     % tdt.hours() % tdt.minutes() % tdt.seconds()).str();
-
-        return pathName.c_str();
-    }
-    catch(filesystem_error& ex) {
-        _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+        return treeWea_->File(utc, "", "", "_5606.wea");
     }
     catch(...) {
         _gLog.Write(LOG_FAULT, "[%s:%s], wrong time style[%s]", __FILE__, __FUNCTION__, info_->utc.c_str());
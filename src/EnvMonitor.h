@@ -8,6 +8,10 @@
 #include "ReadCloudage.h"
 #include "AsioUDP.h"
 #include "CloudCamera.h"
+#include "Scheduler.h"
+#include "SensorDriver.h"
+#include "StorageManager.h"
+#include "DatedPath.h"
 
 class EnvMonitor {
 public:
@@ -28,17 +32,21 @@ public:
 
 protected:
 	/**
-	 * @brief 监测/计算每日的晨昏时, 启动/停止服务
+	 * @brief 由星历表计算夜间时段, 并安排观测流程的启动时间
 	 */
-	void monitor_twilight();
+	void plan_twilight();
 	/**
-	 * @brief 线程: 监视磁盘空间并清理历史数据
+	 * @brief 调度任务: 昏影时启动观测流程, 并安排晨光始时的停止任务
 	 */
-	void thread_diskfree();
+	void night_begin();
 	/**
-	 * @brief 线程: 定时上传PDXP格式数据
+	 * @brief 调度任务: 晨光始时停止观测流程, 并重新计算晨昏时
 	 */
-	void thread_pdxp();
+	void night_end();
+	/**
+	 * @brief 调度任务: 定时上传PDXP格式数据
+	 */
+	void cycle_pdxp();
 	/**
 	 * @brief 上传PDXP接口数据
 	 * @param udp  UDP接口
@@ -70,25 +78,35 @@ protected:
      * @brief 获取日志文件路径
      * @return 日志文件路径
      */
-    const char* log_filepath(const InfoCloudage* info_);
+    string log_filepath(const InfoCloudage* info_);
 
 protected:
 	const Parameter* param_; ///< 配置参数
 	int odt_;	///< 观测时段类型
 
 	// 设备接口
-	SQMPtr sqmPtr_;			///< SQM接口
+	SQMMgrPtr sqmMgr_;		///< SQM接口: 主设备及其它设备
 	WeaStatPtr weaStatPtr_;	///< 气象站接口
 	ReadCloudagePtr readCloudagePtr_;	///< 读取云量分布接口
 	CloudCamPtr camCloudPtr_;	///< 云量相机接口
+	CloudEnginePtr cloudEngine_;	///< 进程内云量引擎
+	StoragePtr storage_;	///< 存储空间管理: 索引与历史数据清理
+	SensorVec sensors_;		///< 扩展传感器: 由配置文件<Sensors>实例化
+	SampleLog sampleLog_;	///< 样本总线日志
 	// 网络接口
 	UdpPtr udpCastPtr_;		///< 组播接口
 	UdpPtr udpCmd_;			///< 命令接口
 
-	/* 线程 */
-	ThrdPtr thrdTwilight_;	///< 线程: 计算晨昏时作为设备启动/停止时间
-	ThrdPtr thrdDisk_;		///< 线程: 监视磁盘空间并清理历史数据
-	ThrdPtr thrdPDXP_;		///< 线程: PDXP上传
+	/* 调度任务 */
+	BoostAsioKeep keep_;	///< 线程池句柄
+	double dusk_;			///< 昏影终, 修正儒略日
+	double dawn_;			///< 晨光始, 修正儒略日
+	int idTwilight_;		///< 调度任务: 启动/停止观测流程
+	int idPDXP_;			///< 调度任务: PDXP上传
+	int idDated_;			///< 调度任务: 预先创建次日目录
+	DatedTreePtr treeWea_;	///< 气象数据文件目录: WeaFile/Y<year>/WEA<date>
+	UdpPtr udpPDXP_;		///< PDXP上传接口
+	uint32_t pnoPDXP_;		///< PDXP帧序号
 };
 
 #endif
@@ -0,0 +1,156 @@
+/**
+ * @file Ephemeris.cpp 日月星历表服务
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ADefine.h"
+#include "AMath.h"
+#include "ATimeSpace.h"
+#include "Ephemeris.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace AstroUtil;
+
+bool Ephemeris::Build(double lgt, double lat, double alt, double mjdStart, int days, int stepMin) {
+	if (days <= 0 || stepMin <= 0) return false;
+
+	boost::shared_ptr<Table> tab(new Table);
+	int n = days * 1440 / stepMin + 1, i, j;
+	std::vector<double> x(n), y(n * EPH_COLUMNS), c(n);
+	double ra, dec, ra1, dec1, r, azi, h, lst;
+	ATimeSpace ats;
+	AMath math;
+
+	tab->mjd0 = mjdStart;
+	tab->step = stepMin / 1440.0;
+	tab->n    = n;
+	ats.SetSite(lgt, lat, alt, 0);
+	for (i = 0; i < n; ++i) {
+		x[i] = i * tab->step;	// 相对首节点, 避免样条系数损失精度
+		ats.SetMJD(mjdStart + x[i]);
+		lst = ats.LocalSiderealTime();
+		// 太阳
+		ats.SunPosition(ra, dec);
+		ats.Eq2Horizon(lst - ra, dec, azi, h);
+		y[EPH_SUN_ALT * n + i] = h * AU_R2D;
+		y[EPH_SUN_AZI * n + i] = azi * AU_R2D;
+		// 月面照亮比例: 由地心日月角距近似, k = (1 - cos(角距)) / 2
+		ats.MoonPosition(r, ra1, dec1);
+		y[EPH_MOON_ILLUM * n + i] = (1.0 - cos(ats.SphereAngle(ra, dec, ra1, dec1))) * 0.5;
+		// 月亮
+		ats.MoonTopo(r, ra, dec);
+		ats.Eq2Horizon(lst - ra, dec, azi, h);
+		y[EPH_MOON_ALT * n + i] = h * AU_R2D;
+		y[EPH_MOON_AZI * n + i] = azi * AU_R2D;
+	}
+	// 方位角展开为连续值, 查询时再调制到[0, 360)
+	for (j = EPH_SUN_AZI; j <= EPH_MOON_AZI; j += EPH_MOON_AZI - EPH_SUN_AZI) {
+		double* az = &y[j * n];
+		for (i = 1; i < n; ++i) {
+			while (az[i] - az[i - 1] >  180.0) az[i] -= 360.0;
+			while (az[i] - az[i - 1] < -180.0) az[i] += 360.0;
+		}
+	}
+
+	tab->y.resize(n * EPH_COLUMNS);
+	tab->c.resize(n * EPH_COLUMNS);
+	for (j = 0; j < EPH_COLUMNS; ++j) {
+		math.spline(n, &x[0], &y[j * n], AU_MAX, AU_MAX, &c[0]);
+		for (i = 0; i < n; ++i) {
+			tab->y[j * n + i] = float(y[j * n + i]);
+			tab->c[j * n + i] = float(c[i]);
+		}
+	}
+
+	MtxLck lck(mtx_);
+	table_ = tab;
+	return true;
+}
+
+bool Ephemeris::Covers(double mjd1, double mjd2) {
+	TablePtr tab = table();
+	return tab && mjd1 >= tab->mjd0 && mjd2 <= tab->mjd0 + (tab->n - 1) * tab->step;
+}
+
+double Ephemeris::Value(int column, double mjd) {
+	TablePtr tab = table();
+	if (!tab || column < 0 || column >= EPH_COLUMNS) return NAN;
+	double x = interp(*tab, column, mjd);
+	if (column == EPH_SUN_AZI || column == EPH_MOON_AZI) x = cycmod(x, 360.0);
+	return x;
+}
+
+bool Ephemeris::Lookup(double mjd, EphemPoint& pt) {
+	TablePtr tab = table();
+	if (!tab) return false;
+	pt.sunAlt    = interp(*tab, EPH_SUN_ALT, mjd);
+	pt.sunAzi    = cycmod(interp(*tab, EPH_SUN_AZI, mjd), 360.0);
+	pt.moonAlt   = interp(*tab, EPH_MOON_ALT, mjd);
+	pt.moonAzi   = cycmod(interp(*tab, EPH_MOON_AZI, mjd), 360.0);
+	pt.moonIllum = interp(*tab, EPH_MOON_ILLUM, mjd);
+	return !isnan(pt.sunAlt);
+}
+
+double Ephemeris::NextSunCrossing(double mjd, double alt, bool rising) {
+	TablePtr tab = table();
+	if (!tab) return NAN;
+
+	double y0, y1, t0, t1, t;
+	int k = int(floor((mjd - tab->mjd0) / tab->step));
+	if (k < 0) k = 0;
+	const float* y = &tab->y[EPH_SUN_ALT * tab->n];
+	for (y0 = interp(*tab, EPH_SUN_ALT, t0 = mjd); k < tab->n - 1; ++k, y0 = y1, t0 = t1) {
+		t1 = tab->mjd0 + (k + 1) * tab->step;
+		y1 = y[k + 1];
+		if (t1 <= t0) continue;
+		if (rising ? !(y0 < alt && y1 >= alt) : !(y0 >= alt && y1 < alt)) continue;
+		// 在内插函数上二分求根
+		for (int i = 0; i < 30; ++i) {
+			t = (t0 + t1) * 0.5;
+			if ((interp(*tab, EPH_SUN_ALT, t) < alt) == rising) t0 = t;
+			else t1 = t;
+		}
+		return (t0 + t1) * 0.5;
+	}
+	return NAN;
+}
+
+bool Ephemeris::Night(double mjd, double alt, double& dusk, double& dawn) {
+	double h = Value(EPH_SUN_ALT, mjd);
+	if (isnan(h)) return false;
+	dusk = h < alt ? mjd : NextSunCrossing(mjd, alt, false);
+	dawn = isnan(dusk) ? NAN : NextSunCrossing(dusk, alt, true);
+	return !isnan(dawn);
+}
+
+double Ephemeris::MJD(const ptime& utc) {
+	return utc.date().modjulian_day() + utc.time_of_day().total_microseconds() * 1E-6 / 86400.0;
+}
+
+ptime Ephemeris::UTC(double mjd) {
+	double day = floor(mjd);
+	return ptime(ptime::date_type(1858, 11, 17) + boost::gregorian::days(long(day)),
+		microseconds(int64_t((mjd - day) * 86400.0 * 1E6 + 0.5)));
+}
+
+Ephemeris::TablePtr Ephemeris::table() {
+	MtxLck lck(mtx_);
+	return table_;
+}
+
+double Ephemeris::interp(const Table& tab, int col, double mjd) {
+	double x = (mjd - tab.mjd0) / tab.step, a, b;
+	if (x < 0.0 || x > tab.n - 1) return NAN;
+	int k = int(x);
+	if (k >= tab.n - 1) k = tab.n - 2;
+	const float* y = &tab.y[col * tab.n];
+	const float* c = &tab.c[col * tab.n];
+	b = x - k;
+	a = 1.0 - b;
+	// 与AMath::splint相同的三次样条公式, 区间由步长直接定位
+	return a * y[k] + b * y[k + 1] + ((a * a - 1) * a * c[k] + (b * b - 1) * b * c[k + 1]) * tab.step * tab.step / 6;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file Ephemeris.h 日月星历表服务
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 按固定步长预先计算未来若干天的太阳/月亮高度角、方位角和月面照亮比例,
+ *   以三次样条(AMath::spline)的节点值和二阶导数存储
+ * - 查询按步长直接定位区间后内插, O(1), 不再重复计算星历级数
+ * - 晨昏时由太阳高度角表求根, 可提前规划任意日期的观测时段
+ * - 重建的表整体替换旧表. 查询者持有表的引用计数, 不阻塞重建
+ */
+
+#ifndef EPHEMERIS_H_
+#define EPHEMERIS_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include "BoostInclude.h"
+
+#define EPHEM_STEP_MIN		5	///< 缺省步长, 分钟
+#define EPHEM_DAYS			3	///< 缺省天数
+
+/**
+ * @brief 星历表的列
+ */
+enum {
+	EPH_SUN_ALT,	///< 太阳高度角, 角度
+	EPH_SUN_AZI,	///< 太阳方位角, 角度, 南零点
+	EPH_MOON_ALT,	///< 月亮高度角, 角度. 站心
+	EPH_MOON_AZI,	///< 月亮方位角, 角度, 南零点
+	EPH_MOON_ILLUM,	///< 月面照亮比例, [0, 1]
+	EPH_COLUMNS
+};
+
+/**
+ * @brief 单个时刻的日月位置
+ */
+struct EphemPoint {
+	double sunAlt;		///< 太阳高度角, 角度
+	double sunAzi;		///< 太阳方位角, 角度
+	double moonAlt;		///< 月亮高度角, 角度
+	double moonAzi;		///< 月亮方位角, 角度
+	double moonIllum;	///< 月面照亮比例
+};
+
+class Ephemeris {
+protected:
+	/* 星历表 */
+	struct Table {
+		double mjd0;	///< 首节点的修正儒略日
+		double step;	///< 步长, 天
+		int n;			///< 节点数量
+		std::vector<float> y;	///< 节点值, 按列存储: y[col * n + i]
+		std::vector<float> c;	///< 样条二阶导数, 与y对应
+	};
+	typedef boost::shared_ptr<const Table> TablePtr;
+
+protected:
+	boost::mutex mtx_;	///< 互斥锁: 星历表
+	TablePtr table_;	///< 星历表
+
+public:
+	/*!
+	 * @brief 计算并替换星历表
+	 * @param lgt       测站地理经度, 角度. 东经为正
+	 * @param lat       测站地理纬度, 角度. 北纬为正
+	 * @param alt       测站海拔, 米
+	 * @param mjdStart  首节点的修正儒略日
+	 * @param days      天数
+	 * @param stepMin   步长, 分钟
+	 * @return
+	 * 计算结果
+	 */
+	bool Build(double lgt, double lat, double alt, double mjdStart, int days = EPHEM_DAYS, int stepMin = EPHEM_STEP_MIN);
+	/*!
+	 * @brief 检查星历表是否覆盖[mjd1, mjd2]
+	 */
+	bool Covers(double mjd1, double mjd2);
+	/*!
+	 * @brief 查询单列
+	 * @param column  列
+	 * @param mjd     修正儒略日
+	 * @return
+	 * 内插值. 超出星历表范围时为NAN
+	 */
+	double Value(int column, double mjd);
+	/*!
+	 * @brief 查询全部列
+	 * @return
+	 * false: 超出星历表范围
+	 */
+	bool Lookup(double mjd, EphemPoint& pt);
+	/*!
+	 * @brief 查找mjd之后太阳高度角穿越alt的时刻
+	 * @param mjd     起始时刻, 修正儒略日
+	 * @param alt     太阳高度角, 角度
+	 * @param rising  true: 升起; false: 降落
+	 * @return
+	 * 修正儒略日. 星历表范围内不穿越时为NAN
+	 */
+	double NextSunCrossing(double mjd, double alt, bool rising);
+	/*!
+	 * @brief 查找mjd时或其后的首个夜间时段: 太阳高度角低于alt
+	 * @param dusk  时段起始, 修正儒略日. mjd已位于夜间时等于mjd
+	 * @param dawn  时段结束, 修正儒略日
+	 * @return
+	 * false: 星历表范围内没有完整的夜间时段(极昼/极夜或表未覆盖)
+	 */
+	bool Night(double mjd, double alt, double& dusk, double& dawn);
+	/*!
+	 * @brief UTC时间转换为修正儒略日
+	 */
+	static double MJD(const boost::posix_time::ptime& utc);
+	/*!
+	 * @brief 修正儒略日转换为UTC时间
+	 */
+	static boost::posix_time::ptime UTC(double mjd);
+
+protected:
+	TablePtr table();
+	/*!
+	 * @brief 在星历表的第k个区间内内插
+	 */
+	static double interp(const Table& tab, int col, double mjd);
+};
+
+extern Ephemeris _gEphem;
+
+#endif
@@ -0,0 +1,270 @@
+/**
+ * @file FocusAutoAlgo.cpp 定义云量相机自动调焦算法
+ * @version 0.2
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "FocusAutoAlgo.h"
+
+using namespace AstroUtil;
+
+FocusAutoAlgo::FocusAutoAlgo() {
+	Init(3.0, 0.2);
+}
+
+void FocusAutoAlgo::Init(double fwhm, double err, int stepInit, int frameMax) {
+	expFwhm_    = fwhm;
+	expFwhmErr_ = err;
+	stepInit_   = stepInit > 0 ? stepInit : 500;
+	stepMax_    = stepInit_ * 10;
+	posTol_     = stepInit_ / 5 > 20 ? stepInit_ / 5 : 20;
+	frameMax_   = frameMax >= 5 ? frameMax : 5;
+	state_      = FOCUS_SEARCH;
+	end_        = FOCUS_END_NONE;
+	posNow_     = 0;
+	stepSearch_ = stepInit_;
+	fitValid_   = false;
+	posBest_    = 0.0;
+	posBestErr_ = __DBL_MAX__;
+	fwhmBest_   = __DBL_MAX__;
+	samples_.clear();
+}
+
+bool FocusAutoAlgo::Push(double fwhm, double sigma, int &step) {
+	step = 0;
+	if (state_ == FOCUS_DONE) return true;
+	// 误差下限: 避免单帧权重过大
+	if (sigma < 0.01 * fwhm) sigma = 0.01 * fwhm;
+
+	FocusSample sample;
+	sample.pos   = posNow_;
+	sample.fwhm  = fwhm;
+	sample.sigma = sigma;
+	samples_.push_back(sample);
+
+	if (state_ == FOCUS_FINAL || fwhm <= (expFwhm_ + expFwhmErr_)) {// 验证帧或已达到理想像质
+		fitValid_ = fit();
+		if (fwhm <= (expFwhm_ + expFwhmErr_)) end_ = FOCUS_END_TARGET;
+		state_ = FOCUS_DONE;
+		return true;
+	}
+
+	int target;
+	if ((fitValid_ = fit()) && posBestErr_ <= posTol_) {// 最佳焦点已收敛
+		target = int(floor(posBest_ + 0.5));
+		state_ = FOCUS_FINAL;
+		end_   = FOCUS_END_FITTED;
+	}
+	else if ((int) samples_.size() >= frameMax_) {// 到达帧数上限: 移至拟合或采样中的最佳位置
+		if (fitValid_) target = int(floor(posBest_ + 0.5));
+		else {
+			FocusSampleVec::iterator it = std::min_element(samples_.begin(), samples_.end(),
+				[](const FocusSample& x1, const FocusSample& x2) {
+					return x1.fwhm < x2.fwhm;
+			});
+			target = it->pos;
+		}
+		state_ = FOCUS_FINAL;
+		end_   = FOCUS_END_BUDGET;
+	}
+	else {
+		int posMin(posNow_), posMax(posNow_);
+		for (FocusSampleVec::iterator it = samples_.begin(); it != samples_.end(); ++it) {
+			if (it->pos < posMin) posMin = it->pos;
+			if (it->pos > posMax) posMax = it->pos;
+		}
+		if (fitValid_ && posBest_ >= posMin && posBest_ <= posMax) {
+			state_ = FOCUS_REFINE;
+			target = choose_probe();
+		}
+		else {
+			state_ = FOCUS_SEARCH;
+			target = choose_search();
+		}
+	}
+
+	step = move_to(target);
+	if (state_ == FOCUS_FINAL && step == 0) {// 已位于最佳焦点
+		state_ = FOCUS_DONE;
+		return true;
+	}
+	return false;
+}
+
+bool FocusAutoAlgo::GetResult(int &pos, double &fwhm, double &err) {
+	if (fitValid_) {
+		pos  = int(floor(posBest_ + 0.5));
+		fwhm = fwhmBest_;
+		err  = posBestErr_;
+	}
+	else if (samples_.size()) {
+		FocusSampleVec::iterator it = std::min_element(samples_.begin(), samples_.end(),
+			[](const FocusSample& x1, const FocusSample& x2) {
+				return x1.fwhm < x2.fwhm;
+		});
+		pos  = it->pos;
+		fwhm = it->fwhm;
+		err  = __DBL_MAX__;
+	}
+	return fitValid_;
+}
+
+bool FocusAutoAlgo::fit() {
+	int n = (int) samples_.size();
+	if (n < 3) return false;
+	// 至少3个不同的焦点位置
+	std::vector<int> pos;
+	for (int i = 0; i < n; ++i) pos.push_back(samples_[i].pos);
+	std::sort(pos.begin(), pos.end());
+	if (std::unique(pos.begin(), pos.end()) - pos.begin() < 3) return false;
+
+	// 加权: 各行乘以1/sigma(FWHM^2), sigma(FWHM^2) = 2 * FWHM * sigma(FWHM)
+	std::vector<double> x(3 * n), y(n);
+	double scale = 1.0 / stepInit_;
+	double u, w, t, chi2(0.0);
+	double normal[9];
+	int i, j, k;
+
+	for (i = 0; i < n; ++i) {
+		u = samples_[i].pos * scale;
+		w = 0.5 / (samples_[i].fwhm * samples_[i].sigma);
+		x[i]         = w;
+		x[n + i]     = w * u;
+		x[2 * n + i] = w * u * u;
+		y[i]         = w * samples_[i].fwhm * samples_[i].fwhm;
+	}
+	if (!math_.LSFitLinear(n, 3, x.data(), y.data(), coef_)) return false;
+
+	// 系数协方差 = 法方程矩阵的逆, 并以约化卡方修正
+	for (j = 0; j < 3; ++j) {
+		for (k = 0; k < 3; ++k) {
+			for (i = 0, t = 0.0; i < n; ++i) t += x[j * n + i] * x[k * n + i];
+			normal[j * 3 + k] = t;
+		}
+	}
+	if (!math_.MatrixInvert(3, normal)) return false;
+	memcpy(cov_, normal, sizeof(cov_));
+	for (i = 0; i < n; ++i) {
+		t = y[i] - (coef_[0] * x[i] + coef_[1] * x[n + i] + coef_[2] * x[2 * n + i]);
+		chi2 += t * t;
+	}
+	if (n > 3 && (chi2 /= (n - 3)) > 1.0) {
+		for (i = 0; i < 9; ++i) cov_[i] *= chi2;
+	}
+
+	// V曲线开口向上, 且最小值为正
+	if (coef_[2] <= 0.0) return false;
+	t = coef_[0] - coef_[1] * coef_[1] * 0.25 / coef_[2];
+	if (t <= 0.0) return false;
+	fwhmBest_   = sqrt(t);
+	posBest_    = -0.5 * coef_[1] / coef_[2] * stepInit_;
+	posBestErr_ = error_best(cov_) * stepInit_;
+	return true;
+}
+
+double FocusAutoAlgo::error_best(const double *cov) {
+	// u0 = -c1 / (2 * c2)
+	double g[3] = {0.0, -0.5 / coef_[2], 0.5 * coef_[1] / (coef_[2] * coef_[2])};
+	double var(0.0);
+	for (int j = 0; j < 3; ++j) {
+		for (int k = 0; k < 3; ++k) var += g[j] * cov[j * 3 + k] * g[k];
+	}
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+int FocusAutoAlgo::choose_probe() {
+	const int N = 8;
+	const double factor[] = {-2.0, -1.5, -1.0, -0.5, 0.5, 1.0, 1.5, 2.0};
+	int n = (int) samples_.size();
+	double scale = 1.0 / stepInit_;
+	double u0 = posBest_ * scale;
+	double uNow = posNow_ * scale;
+	double uMax = double(stepMax_) * scale;
+	double h = fwhmBest_ / sqrt(coef_[2]);	// 双曲线渐近线与顶点的交叉宽度: FWHM = sqrt(2) * FWHM(min)
+	double normal[9], trial[9], xv[3];
+	double u, w, f, t, err, errMin(__DBL_MAX__), uBest(u0);
+	std::vector<double> ratio;
+	int i, j, k;
+
+	// 采样误差的相对值, 取中值用于预测新采样的误差
+	for (i = 0; i < n; ++i) ratio.push_back(samples_[i].sigma / samples_[i].fwhm);
+	std::nth_element(ratio.begin(), ratio.begin() + n / 2, ratio.end());
+	double rsig = ratio[n / 2];
+
+	// 现有采样的法方程矩阵
+	memset(normal, 0, sizeof(normal));
+	for (i = 0; i < n; ++i) {
+		u = samples_[i].pos * scale;
+		w = 0.5 / (samples_[i].fwhm * samples_[i].sigma);
+		xv[0] = w;
+		xv[1] = w * u;
+		xv[2] = w * u * u;
+		for (j = 0; j < 3; ++j) {
+			for (k = 0; k < 3; ++k) normal[j * 3 + k] += xv[j] * xv[k];
+		}
+	}
+
+	// 评估候选位置加入后的最佳焦点误差
+	for (i = 0; i < N; ++i) {
+		u = u0 + factor[i] * h;
+		if (fabs(u - uNow) > uMax) continue;
+		if ((t = coef_[0] + coef_[1] * u + coef_[2] * u * u) <= 0.0) continue;
+		f = sqrt(t);
+		w = 0.5 / (f * f * rsig);
+		xv[0] = w;
+		xv[1] = w * u;
+		xv[2] = w * u * u;
+		for (j = 0; j < 3; ++j) {
+			for (k = 0; k < 3; ++k) trial[j * 3 + k] = normal[j * 3 + k] + xv[j] * xv[k];
+		}
+		if (math_.MatrixInvert(3, trial) && (err = error_best(trial)) < errMin) {
+			errMin = err;
+			uBest  = u;
+		}
+	}
+
+	return int(floor(uBest * stepInit_ + 0.5));
+}
+
+int FocusAutoAlgo::choose_search() {
+	int n = (int) samples_.size();
+	if (n == 1) return posNow_ + stepSearch_;
+
+	if (fitValid_) {// 已有V曲线, 但最佳焦点在采样范围之外: 向最佳焦点移动
+		return int(floor(posBest_ + 0.5));
+	}
+
+	// 无有效拟合: 自FWHM最小的采样沿外侧继续搜索
+	int posMin(samples_[0].pos), posMax(samples_[0].pos), posFine(samples_[0].pos);
+	double fwhmMin(samples_[0].fwhm);
+	for (int i = 1; i < n; ++i) {
+		if (samples_[i].pos < posMin) posMin = samples_[i].pos;
+		if (samples_[i].pos > posMax) posMax = samples_[i].pos;
+		if (samples_[i].fwhm < fwhmMin) {
+			fwhmMin = samples_[i].fwhm;
+			posFine = samples_[i].pos;
+		}
+	}
+	if (posFine == posMax) {
+		if ((stepSearch_ *= 2) > stepMax_) stepSearch_ = stepMax_;
+		return posMax + stepSearch_;
+	}
+	if (posFine == posMin) {
+		if ((stepSearch_ *= 2) > stepMax_) stepSearch_ = stepMax_;
+		return posMin - stepSearch_;
+	}
+	// 已跨越最佳焦点但拟合无效(噪声过大): 在最佳采样两侧交替加密
+	if ((stepSearch_ /= 2) < posTol_) stepSearch_ = posTol_;
+	return posFine + (n % 2 ? stepSearch_ : -stepSearch_);
+}
+
+int FocusAutoAlgo::move_to(int target) {
+	int step = target - posNow_;
+	if (step > stepMax_) step = stepMax_;
+	else if (step < -stepMax_) step = -stepMax_;
+	posNow_ += step;
+	return step;
+}
@@ -10,57 +10,150 @@
  *
  * @copyright Copyright (c) 2023
  *
+ * @version 0.2
+ * @date 2026-10-18
+ * @note
+ * - 以V曲线(双曲线)模型拟合全部采样, 替代依据最后两帧外推步长的方法
+ * - 模型: FWHM^2 = c0 + c1 * p + c2 * p^2, 加权最小二乘拟合
+ * - 依据拟合协方差选择下一个采样位置, 使最佳焦点的期望误差最小
+ * - 调焦帧数有上限, 到达上限后移至最佳焦点并结束
  */
 
 #ifndef FOCUS_AUTO_ALGO_H_
 #define FOCUS_AUTO_ALGO_H_
 
-#include <math.h>
+#include <vector>
+#include "AMath.h"
 
-struct FocusAutoAlgo {
-	double expFwhm;	///< 期望FWHM
-	double expFwhmErr;	///< 期望FWHM的误差
-	double fwhmLast;	///< 最后一次的FWHM
-	int    stepLast;	///< 最后一次调节步长
+/**
+ * @brief 调焦采样
+ */
+struct FocusSample {
+	int    pos;		///< 焦点位置, 相对调焦起点的步数
+	double fwhm;	///< 半高全宽
+	double sigma;	///< 半高全宽的误差
+};
+typedef std::vector<FocusSample> FocusSampleVec;
+
+class FocusAutoAlgo {
+public:
+	FocusAutoAlgo();
+
+public:
+	/* 调焦结束原因 */
+	enum {
+		FOCUS_END_NONE,		///< 未结束
+		FOCUS_END_TARGET,	///< 已达到理想像质
+		FOCUS_END_FITTED,	///< 最佳焦点已收敛
+		FOCUS_END_BUDGET	///< 到达帧数上限
+	};
+
+protected:
+	/* 调焦流程状态 */
+	enum {
+		FOCUS_SEARCH,	///< 搜索: 采样不足或尚未跨越最佳焦点
+		FOCUS_REFINE,	///< 精化: 已跨越最佳焦点, 减小最佳焦点误差
+		FOCUS_FINAL,	///< 已命令移至最佳焦点, 等待验证帧
+		FOCUS_DONE		///< 结束
+	};
+
+	AstroUtil::AMath math_;	///< 最小二乘拟合与矩阵运算
+	double expFwhm_;	///< 期望FWHM
+	double expFwhmErr_;	///< 期望FWHM的误差
+	int stepInit_;		///< 初始搜索步长
+	int stepMax_;		///< 单次调焦步长上限
+	int posTol_;		///< 最佳焦点的误差阈值, 步数
+	int frameMax_;		///< 调焦帧数上限
+	int state_;			///< 调焦流程状态
+	int end_;			///< 结束原因. 进入FOCUS_FINAL时确定, 验证帧达到理想像质时改为FOCUS_END_TARGET
+	int posNow_;		///< 当前焦点位置, 相对调焦起点
+	int stepSearch_;	///< 搜索步长
+	FocusSampleVec samples_;	///< 全部采样
+
+	/* 拟合结果 */
+	bool fitValid_;		///< 拟合结果有效, 且V曲线开口向上
+	double coef_[3];	///< 拟合系数. 位置以stepInit_为单位
+	double cov_[9];		///< 拟合系数协方差
+	double posBest_;	///< 最佳焦点
+	double posBestErr_;	///< 最佳焦点误差, 步数
+	double fwhmBest_;	///< 最佳焦点处的FWHM
 
 public:
 	/**
 	 * @brief 初始化调焦过程
-	 * @param fwhm  期望FWHM
-	 * @param err   期望FWHM的误差
+	 * @param fwhm      期望FWHM
+	 * @param err       期望FWHM的误差
+	 * @param stepInit  初始搜索步长
+	 * @param frameMax  调焦帧数上限
 	 */
-	void Init(double fwhm, double err) {
-		expFwhm    = fwhm;
-		expFwhmErr = err;
-		fwhmLast   = __DBL_MAX__;
-	}
-
+	void Init(double fwhm, double err, int stepInit = 500, int frameMax = 15);
 	/**
-	 * @brief 设置当前FWHM
+	 * @brief 设置当前焦点位置的FWHM
 	 * @param fwhm  半高全宽
+	 * @param sigma 半高全宽的误差
 	 * @param step  调焦步长
 	 * @return
-	 * true- 结束调焦, 已达到理想像质
+	 * true- 结束调焦, 已达到理想像质或已移至最佳焦点
 	 * false- 继续调焦, step中包含调焦步长
 	 */
-	bool Push(double fwhm, int &step) {
-		if (fwhm <= (expFwhm + expFwhmErr)) return true;
-
-		if (fwhmLast == __DBL_MAX__) {
-			step = 500;
-		}
-		else {
-			step = int((expFwhm - fwhm) * stepLast * 80 / (fwhm - fwhmLast)) / 100;
-			if      (abs(step) > 5000) step = step > 5000 ? 5000 : -5000;
-			else if (abs(step) > 2000) step = step > 2000 ? 2000 : -2000;
-			else if (abs(step) > 500)  step = step > 500 ? 500 : -500;
-			else if (abs(step) > 100)  step = step > 0 ? 100 : -100;
-		}
-		stepLast = step;
-		fwhmLast = fwhm;
-
-		return abs(step) < 100;
+	bool Push(double fwhm, double sigma, int &step);
+	/**
+	 * @brief 查看调焦结果
+	 * @param pos   最佳焦点, 相对调焦起点
+	 * @param fwhm  最佳焦点处的FWHM
+	 * @param err   最佳焦点的误差, 步数. 该值越小置信度越高
+	 * @return
+	 * 拟合结果有效性
+	 */
+	bool GetResult(int &pos, double &fwhm, double &err);
+	/**
+	 * @brief 查看调焦结束原因
+	 * @return
+	 * FOCUS_END_*
+	 */
+	int EndReason() {
+		return state_ == FOCUS_DONE ? end_ : FOCUS_END_NONE;
 	}
+	/**
+	 * @brief 查看已使用的调焦帧数
+	 */
+	int FrameCount() {
+		return (int) samples_.size();
+	}
+
+protected:
+	/**
+	 * @brief 加权最小二乘拟合V曲线, 并计算最佳焦点及其误差
+	 * @return
+	 * 拟合结果有效性
+	 */
+	bool fit();
+	/**
+	 * @brief 最佳焦点误差: 由系数协方差传递
+	 * @param cov  系数协方差
+	 * @return
+	 * 最佳焦点误差, 以stepInit_为单位
+	 */
+	double error_best(const double *cov);
+	/**
+	 * @brief 在V曲线两翼选择使最佳焦点期望误差最小的采样位置
+	 * @return
+	 * 下一个采样位置
+	 */
+	int choose_probe();
+	/**
+	 * @brief 沿FWHM减小方向搜索
+	 * @return
+	 * 下一个采样位置
+	 */
+	int choose_search();
+	/**
+	 * @brief 计算由当前位置移至目标位置的步长, 并更新当前位置
+	 * @param target  目标位置
+	 * @return
+	 * 调焦步长
+	 */
+	int move_to(int target);
 };
 
 #endif
@@ -0,0 +1,328 @@
+/**
+ * @file FrameCalib.cpp 云图本底改正: 主暗场与热像元修补
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <boost/format.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "FrameCalib.h"
+#include "Ephemeris.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::interprocess;
+
+#define CALIB_FRAMES_MAX	15		///< 合成主暗场的帧数上限
+#define CALIB_HOT_WARN		0.01	///< 热像元比例超过该值时记录日志
+
+/* 暗场偏置和热像元索引在文件中的偏移量 */
+static size_t offset_offset() {
+	return sizeof(CalibHeader);
+}
+
+static size_t hots_offset(size_t pixels) {
+	return (offset_offset() + pixels * sizeof(int16_t) + 7) & ~size_t(7);
+}
+
+/*
+ * 饱和减法: data = data - offset, 限定于[0, 65535]
+ * 无符号数异或0x8000后等同于减去32768的有符号数, 有符号饱和减法后再异或还原
+ */
+static void subtract_offset(uint16_t* data, const int16_t* offset, size_t n) {
+	size_t i(0);
+#if defined(__SSE2__)
+	const __m128i bias = _mm_set1_epi16(int16_t(0x8000));
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (data + i)), bias);
+		v = _mm_subs_epi16(v, _mm_loadu_si128((const __m128i*) (offset + i)));
+		_mm_storeu_si128((__m128i*) (data + i), _mm_xor_si128(v, bias));
+	}
+#elif defined(__ARM_NEON)
+	const uint16x8_t bias = vdupq_n_u16(0x8000);
+	for (; i + 8 <= n; i += 8) {
+		int16x8_t v = vreinterpretq_s16_u16(veorq_u16(vld1q_u16(data + i), bias));
+		v = vqsubq_s16(v, vld1q_s16(offset + i));
+		vst1q_u16(data + i, veorq_u16(vreinterpretq_u16_s16(v), bias));
+	}
+#endif
+	for (; i < n; ++i) {
+		int v = int(data[i]) - offset[i];
+		data[i] = uint16_t(v < 0 ? 0 : (v > 65535 ? 65535 : v));
+	}
+}
+
+/*
+ * 热像元修补: 上下左右像元的中值. 相邻热像元不超过一个时不受影响
+ */
+static void repair_hots(uint16_t* data, int width, int height, const int32_t* hots, int n) {
+	uint16_t v[4];
+	int x, y, m;
+
+	for (int i = 0; i < n; ++i) {
+		int k = hots[i];
+		x = k % width;
+		y = k / width;
+		m = 0;
+		if (x > 0)          v[m++] = data[k - 1];
+		if (x < width - 1)  v[m++] = data[k + 1];
+		if (y > 0)          v[m++] = data[k - width];
+		if (y < height - 1) v[m++] = data[k + width];
+		std::sort(v, v + m);
+		if      (m == 4) data[k] = uint16_t((v[1] + v[2] + 1) / 2);
+		else if (m == 3) data[k] = v[1];
+		else if (m == 2) data[k] = uint16_t((v[0] + v[1] + 1) / 2);
+		else if (m == 1) data[k] = v[0];
+	}
+}
+
+FrameCalibrator::FrameCalibrator() {
+	frames_   = 5;
+	tempStep_ = 5;
+	hotSigma_ = 8.0;
+}
+
+FrameCalibrator::~FrameCalibrator() {
+	keep_.Stop();
+}
+
+bool FrameCalibrator::Load(const Parameter* param) {
+	MtxLck lck(mtx_);
+	boost::filesystem::path pathDir(param->sampleDir);
+
+	frames_   = std::min(std::max(param->calibDarkFrames, 1), CALIB_FRAMES_MAX);
+	tempStep_ = std::max(param->calibTempStep, 1);
+	hotSigma_ = param->calibHotSigma;
+	masters_.clear();
+	darks_.clear();
+
+	pathDir /= CALIB_DIR;
+	dir_ = pathDir.string();
+	try {
+		if (!boost::filesystem::exists(pathDir)) boost::filesystem::create_directories(pathDir);
+		for (boost::filesystem::directory_iterator it(pathDir), end; it != end; ++it) {
+			if (it->path().extension() != ".cal") continue;
+			MasterPtr master = map(it->path().string());
+			if (!master) {
+				_gLog.Write(LOG_WARN, "[%s:%s], invalid master dark [%s]", __FILE__, __FUNCTION__, it->path().c_str());
+				continue;
+			}
+			masters_[BinKey(master->header->temp, master->header->expms)] = master;
+		}
+	}
+	catch(boost::filesystem::filesystem_error& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		return false;
+	}
+	_gLog.Write("frame calibration: %d master darks loaded from [%s]", int(masters_.size()), dir_.c_str());
+	return true;
+}
+
+bool FrameCalibrator::AddDark(const uint16_t* data, int width, int height, double expdur, int temp) {
+	if (width <= 0 || height <= 0 || expdur <= 0.0 || dir_.empty()) return false;
+
+	BinKey key = bin_key(expdur, temp);
+	size_t pixels = size_t(width) * height;
+	ArrayShortU frame(new unsigned short[pixels]);
+	DarkVec darks;
+
+	memcpy(frame.get(), data, pixels * sizeof(uint16_t));
+	{// 取出满帧数的暗场, 合成时不持有互斥锁
+		MtxLck lck(mtx_);
+		DarkStack& stack = darks_[key];
+		// 同档暗场的尺寸须一致: 窗口或合并因子变化后重新累计
+		if (stack.width != width || stack.height != height) {
+			stack.width  = width;
+			stack.height = height;
+			stack.frames.clear();
+		}
+		stack.frames.push_back(frame);
+		if (int(stack.frames.size()) < frames_) return false;
+		darks.swap(stack.frames);
+		darks_.erase(key);
+	}
+	keep_.Post(boost::bind(&FrameCalibrator::build, this, key, darks, width, height));
+	return true;
+}
+
+bool FrameCalibrator::Apply(uint16_t* data, int width, int height, double expdur, int temp, CalibResult& rslt) {
+	MtxLck lck(mtx_);
+	bool exact;
+	MasterPtr master = find(bin_key(expdur, temp), width, height, exact);
+
+	rslt.Reset();
+	if (!master) return false;
+	if (exact) subtract_offset(data, master->offset, size_t(width) * height);
+	repair_hots(data, width, height, master->hots, master->header->hots);
+	rslt.dark   = exact;
+	rslt.hots   = master->header->hots;
+	rslt.master = master->name;
+	return true;
+}
+
+int FrameCalibrator::Masters() {
+	MtxLck lck(mtx_);
+	return int(masters_.size());
+}
+
+FrameCalibrator::BinKey FrameCalibrator::bin_key(double expdur, int temp) const {
+	int expms = int(expdur * 1000.0 + 0.5);
+	int tbin  = int(floor(double(temp) / tempStep_ + 0.5)) * tempStep_;
+	return BinKey(tbin, expms);
+}
+
+std::string FrameCalibrator::file_name(const BinKey& key) const {
+	return (boost::format("Dark_%dms_%+dC.cal") % key.second % key.first).str();
+}
+
+FrameCalibrator::MasterPtr FrameCalibrator::map(const std::string& filePath) {
+	try {
+		uintmax_t size = boost::filesystem::file_size(filePath);
+		if (size < sizeof(CalibHeader)) return MasterPtr();
+
+		MasterPtr master(new Master);
+		file_mapping file(filePath.c_str(), read_only);
+		master->region.reset(new mapped_region(file, read_only));
+		const char* base = (const char*) master->region->get_address();
+		const CalibHeader* header = (const CalibHeader*) base;
+		if (memcmp(header->magic, CALIB_MAGIC, sizeof(header->magic))
+				|| header->width <= 0 || header->height <= 0 || header->hots < 0)
+			return MasterPtr();
+		size_t pixels = size_t(header->width) * header->height;
+		if (size != hots_offset(pixels) + size_t(header->hots) * sizeof(int32_t)) return MasterPtr();
+
+		master->name   = boost::filesystem::path(filePath).filename().string();
+		master->header = header;
+		master->offset = (const int16_t*) (base + offset_offset());
+		master->hots   = (const int32_t*) (base + hots_offset(pixels));
+		return master;
+	}
+	catch(std::exception& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		return MasterPtr();
+	}
+}
+
+bool FrameCalibrator::build(const BinKey& key, const DarkVec& darks, int width, int height) {
+	int n = darks.size(), i, mid = n / 2;
+	size_t pixels = size_t(width) * height, k;
+	std::vector<uint16_t> combined(pixels);
+	std::vector<int16_t> offset(pixels);
+	std::vector<int32_t> hots;
+	std::vector<uint32_t> hist(65536, 0);
+	uint16_t v[CALIB_FRAMES_MAX];
+
+	// 逐像元中值: 剔除宇宙线
+	for (k = 0; k < pixels; ++k) {
+		for (i = 0; i < n; ++i) v[i] = darks[i][k];
+		std::nth_element(v, v + mid, v + n);
+		++hist[combined[k] = v[mid]];
+	}
+
+	// 基底与噪声: 中值及其与低侧15.87%分位数之差, 不受热像元影响
+	int pedestal(-1), low(-1);
+	uint64_t sum(0), qLow = uint64_t(pixels * 0.1587), qMid = pixels / 2;
+	for (i = 0; i < 65536 && pedestal < 0; ++i) {
+		sum += hist[i];
+		if (low < 0 && sum > qLow) low = i;
+		if (sum > qMid) pedestal = i;
+	}
+	double noise = std::max(double(pedestal - low), 1.0);
+	int thresh = int(hotSigma_ * noise + 0.5);
+
+	for (k = 0; k < pixels; ++k) {
+		int d = int(combined[k]) - pedestal;
+		offset[k] = int16_t(d < -32768 ? -32768 : (d > 32767 ? 32767 : d));
+		if (d > thresh) hots.push_back(int32_t(k));
+	}
+	if (hots.size() > pixels * CALIB_HOT_WARN) {
+		_gLog.Write(LOG_WARN, "[%s:%s], %d hot pixels at %d ms, %+d C", __FILE__, __FUNCTION__,
+			int(hots.size()), key.second, key.first);
+	}
+
+	CalibHeader header;
+	memset(&header, 0, sizeof(CalibHeader));
+	memcpy(header.magic, CALIB_MAGIC, sizeof(header.magic));
+	header.width    = width;
+	header.height   = height;
+	header.expms    = key.second;
+	header.temp     = key.first;
+	header.frames   = n;
+	header.pedestal = pedestal;
+	header.hots     = int32_t(hots.size());
+	header.noise    = noise;
+	header.mjd      = Ephemeris::MJD(microsec_clock::universal_time());
+
+	// 写入临时文件后替换. 已映射的旧文件在解除映射前保持有效
+	boost::filesystem::path filePath(dir_);
+	filePath /= file_name(key);
+	std::string pathTmp = filePath.string() + ".tmp";
+	FILE* fp = fopen(pathTmp.c_str(), "wb");
+	if (!fp) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to create [%s]", __FILE__, __FUNCTION__, pathTmp.c_str());
+		return false;
+	}
+	static const char pad[8] = {0};
+	size_t npad = hots_offset(pixels) - offset_offset() - pixels * sizeof(int16_t);
+	bool ok = fwrite(&header, sizeof(CalibHeader), 1, fp) == 1
+		&& fwrite(&offset[0], sizeof(int16_t), pixels, fp) == pixels
+		&& (!npad || fwrite(pad, 1, npad, fp) == npad)
+		&& (hots.empty() || fwrite(&hots[0], sizeof(int32_t), hots.size(), fp) == hots.size());
+	ok = (fclose(fp) == 0) && ok;
+	if (ok) {
+		boost::system::error_code ec;
+		boost::filesystem::rename(pathTmp, filePath, ec);
+		ok = !ec;
+	}
+	if (!ok) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to write [%s]", __FILE__, __FUNCTION__, filePath.c_str());
+		boost::system::error_code ec;
+		boost::filesystem::remove(pathTmp, ec);
+		return false;
+	}
+
+	MasterPtr master = map(filePath.string());
+	if (!master) return false;
+	{
+		MtxLck lck(mtx_);
+		masters_[key] = master;
+	}
+	_gLog.Write("master dark [%s]: %d frames, pedestal = %d, noise = %.1f, hot pixels = %d",
+		master->name.c_str(), n, pedestal, noise, header.hots);
+	return true;
+}
+
+FrameCalibrator::MasterPtr FrameCalibrator::find(const BinKey& key, int width, int height, bool& exact) {
+	MasterPtr best;
+	double dmin(0.0), d;
+
+	exact = false;
+	if (key.second <= 0) return best;
+	for (MasterMap::iterator it = masters_.lower_bound(BinKey(key.first, 0));
+			it != masters_.end() && it->first.first == key.first; ++it) {
+		const CalibHeader* header = it->second->header;
+		if (header->width != width || header->height != height) continue;
+		if (it->first.second == key.second) {
+			exact = true;
+			return it->second;
+		}
+		d = fabs(log(double(it->first.second) / key.second));
+		if (!best || d < dmin) {
+			best = it->second;
+			dmin = d;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file FrameCalib.h 云图本底改正: 主暗场与热像元修补
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 暗场按(曝光时间, 探测器温度)分档累计, 每档满设定帧数后逐像元取中值生成主暗场
+ * - 主暗场存储为暗场偏置: 主暗场 - 基底, 基底为主暗场的中值. 改正后的图像保留基底,
+ *   曝光时间调整与背景统计不受影响
+ * - 热像元: 暗场偏置高于设定倍数噪声的像元, 以上下左右像元的中值替换
+ * - 主暗场文件: 文件头 + 暗场偏置(int16_t * 像元数) + 热像元索引(int32_t * 热像元数).
+ *   存储于测量数据目录下的Calibration目录, 启动时以内存映射方式加载
+ * - 曝光时间无对应主暗场时, 使用同温度档中曝光时间最接近的主暗场修补热像元, 不扣除暗场
+ * - 减暗场为16位饱和运算, 以SSE2/NEON向量指令原位处理
+ * - 主暗场在线程池中合成, 不持有互斥锁; 合成结束后替换. 合成期间改正使用已有主暗场
+ */
+
+#ifndef FRAME_CALIB_H_
+#define FRAME_CALIB_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "BoostInclude.h"
+#include "BoostAsioKeep.h"
+#include "Parameter.h"
+
+#define CALIB_MAGIC			"WMDARK01"		///< 文件标志及版本
+#define CALIB_DIR			"Calibration"	///< 主暗场目录名
+
+/**
+ * @brief 主暗场文件头
+ */
+struct CalibHeader {
+	char magic[8];		///< 文件标志
+	int32_t width;		///< 图像宽度
+	int32_t height;		///< 图像高度
+	int32_t expms;		///< 曝光时间, 毫秒
+	int32_t temp;		///< 温度档, 摄氏度
+	int32_t frames;		///< 合成帧数
+	int32_t pedestal;	///< 基底
+	int32_t hots;		///< 热像元数量
+	int32_t reserved;	///< 保留, 0
+	double noise;		///< 主暗场噪声
+	double mjd;			///< 生成时间, 修正儒略日
+};
+
+/**
+ * @brief 单帧改正结果
+ */
+struct CalibResult {
+	bool dark;			///< 已扣除暗场
+	int hots;			///< 修补的热像元数量
+	std::string master;	///< 使用的主暗场文件名. 空: 未改正
+
+public:
+	CalibResult() {
+		Reset();
+	}
+	void Reset() {
+		dark = false;
+		hots = 0;
+		master.clear();
+	}
+};
+
+class FrameCalibrator {
+public:
+	FrameCalibrator();
+	~FrameCalibrator();
+
+public:
+	/*!
+	 * @brief 加载已生成的主暗场
+	 * @param param  配置参数: 测量数据目录与分档
+	 * @return
+	 * 主暗场目录可用时返回true
+	 */
+	bool Load(const Parameter* param);
+	/*!
+	 * @brief 加入暗场
+	 * @param data    图像数据
+	 * @param width   图像宽度
+	 * @param height  图像高度
+	 * @param expdur  曝光时间, 秒
+	 * @param temp    探测器温度, 摄氏度
+	 * @return
+	 * 该档已满设定帧数, 开始合成主暗场
+	 */
+	bool AddDark(const uint16_t* data, int width, int height, double expdur, int temp);
+	/*!
+	 * @brief 原位改正图像
+	 * @param data    图像数据
+	 * @param width   图像宽度
+	 * @param height  图像高度
+	 * @param expdur  曝光时间, 秒
+	 * @param temp    探测器温度, 摄氏度
+	 * @param rslt    改正结果
+	 * @return
+	 * 找到可用主暗场时返回true
+	 */
+	bool Apply(uint16_t* data, int width, int height, double expdur, int temp, CalibResult& rslt);
+	/*!
+	 * @brief 主暗场数量
+	 */
+	int Masters();
+
+protected:
+	/**
+	 * @brief 内存映射的主暗场
+	 */
+	struct Master {
+		std::string name;	///< 文件名
+		boost::shared_ptr<boost::interprocess::mapped_region> region;	///< 文件映射
+		const CalibHeader* header;	///< 文件头
+		const int16_t* offset;		///< 暗场偏置
+		const int32_t* hots;		///< 热像元索引, 升序
+	};
+	typedef boost::shared_ptr<Master> MasterPtr;
+	typedef std::pair<int, int> BinKey;	///< 分档: 温度档, 曝光时间(毫秒)
+	typedef std::map<BinKey, MasterPtr> MasterMap;
+	typedef std::vector<ArrayShortU> DarkVec;
+	/**
+	 * @brief 同档待合成的暗场
+	 */
+	struct DarkStack {
+		int width, height;	///< 图像尺寸
+		DarkVec frames;		///< 暗场
+
+	public:
+		DarkStack() {
+			width = height = 0;
+		}
+	};
+	typedef std::map<BinKey, DarkStack> DarkMap;
+
+protected:
+	/*!
+	 * @brief 计算分档
+	 */
+	BinKey bin_key(double expdur, int temp) const;
+	/*!
+	 * @brief 主暗场文件名
+	 */
+	std::string file_name(const BinKey& key) const;
+	/*!
+	 * @brief 映射主暗场文件并校验文件头
+	 */
+	MasterPtr map(const std::string& filePath);
+	/*!
+	 * @brief 合成主暗场并写入文件. 在线程池中执行, 仅在替换主暗场时持有互斥锁
+	 */
+	bool build(const BinKey& key, const DarkVec& darks, int width, int height);
+	/*!
+	 * @brief 查找主暗场: 同档, 或同温度档中曝光时间最接近的
+	 * @param exact  找到同档主暗场
+	 */
+	MasterPtr find(const BinKey& key, int width, int height, bool& exact);
+
+protected:
+	boost::mutex mtx_;	///< 互斥锁: 主暗场与待合成暗场
+	std::string dir_;	///< 主暗场目录
+	int frames_;		///< 合成主暗场的暗场帧数
+	int tempStep_;		///< 温度档间隔, 摄氏度
+	double hotSigma_;	///< 热像元阈值, 噪声倍数
+	MasterMap masters_;	///< 主暗场
+	DarkMap darks_;		///< 待合成暗场
+	BoostAsioKeep keep_;	///< 线程池句柄: 合成主暗场
+};
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * @file FrameCodec.cpp 串口协议帧编解码
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include "FrameCodec.h"
+
+/*
+ * CRC16/MODBUS查找表: 反射多项式0xA001
+ * v[k][i]为字节i之后再移入k个零字节的余数, 用于每次处理8字节
+ */
+static const struct CRCTable {
+	uint16_t v[8][256];
+
+	CRCTable() {
+		int i, j, k;
+		for (i = 0; i < 256; ++i) {
+			uint16_t crc = i;
+			for (j = 0; j < 8; ++j) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+			v[0][i] = crc;
+		}
+		for (k = 1; k < 8; ++k) {
+			for (i = 0; i < 256; ++i) v[k][i] = (v[k - 1][i] >> 8) ^ v[0][v[k - 1][i] & 0xFF];
+		}
+	}
+} crcTable;
+
+uint16_t CRC16Modbus(const uint8_t* data, size_t len, uint16_t crc) {
+	const uint16_t (*t)[256] = crcTable.v;
+
+	for (; len >= 8; len -= 8, data += 8) {
+		crc ^= data[0] | (data[1] << 8);
+		crc = t[7][crc & 0xFF] ^ t[6][crc >> 8]
+			^ t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]]
+			^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+	}
+	while (len--) crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+	return crc;
+}
+
+/////////////////////////////////////////////////////////////////////
+int FrameParser::Parse() {
+	size_t i(0), len;
+	int rslt;
+
+	frmLen_ = 0;
+	if (!decoder_) return FRAME_SKIP;
+	while (i < buf_.size()) {
+		rslt = decoder_->Check(&buf_[i], buf_.size() - i, len);
+		if (rslt == FRAME_SKIP) ++i;
+		else if (rslt == FRAME_BAD) {// 丢弃该帧头, 继续查找
+			bad_ = true;
+			++badFrames_;
+			++i;
+		}
+		else {// 丢弃帧头之前的数据
+			buf_.erase(buf_.begin(), buf_.begin() + i);
+			if (rslt == FRAME_OK) frmLen_ = len;
+			return rslt;
+		}
+	}
+	buf_.clear();
+	return FRAME_SKIP;
+}
+
+void FrameParser::Consume() {
+	buf_.erase(buf_.begin(), buf_.begin() + frmLen_);
+	frmLen_ = 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file FrameCodec.h 串口协议帧编解码
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - CRC16/MODBUS: 逐8字节查表(slice-by-8)
+ * - FrameBuilder: 组装请求帧, 自动附加校验码
+ * - FrameDecoder: 可替换的帧识别接口, 由具体协议实现
+ * - FrameParser: 在接收缓冲区中用FrameDecoder查找有效帧, 丢弃帧间噪声和校验错误的帧头
+ */
+
+#ifndef FRAME_CODEC_H_
+#define FRAME_CODEC_H_
+
+#include <stdint.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+/*!
+ * @brief 计算CRC16/MODBUS校验码
+ * @param data  待校验数据
+ * @param len   数据长度, 字节
+ * @param crc   初值. 可用于分段计算
+ * @return
+ * 校验码. 低字节在前发送
+ */
+extern uint16_t CRC16Modbus(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief 组装请求帧
+ */
+class FrameBuilder {
+protected:
+	std::vector<uint8_t> data_;	///< 帧数据
+
+public:
+	FrameBuilder& U8(uint8_t x) {
+		data_.push_back(x);
+		return *this;
+	}
+	/*!
+	 * @brief 高字节在前附加16位数值
+	 */
+	FrameBuilder& U16(uint16_t x) {
+		data_.push_back(x >> 8);
+		data_.push_back(x & 0xFF);
+		return *this;
+	}
+	FrameBuilder& Bytes(const uint8_t* x, size_t n) {
+		data_.insert(data_.end(), x, x + n);
+		return *this;
+	}
+	/*!
+	 * @brief 附加CRC16/MODBUS校验码, 低字节在前
+	 */
+	FrameBuilder& CRC16() {
+		uint16_t crc = CRC16Modbus(data_.empty() ? NULL : &data_[0], data_.size());
+		data_.push_back(crc & 0xFF);
+		data_.push_back(crc >> 8);
+		return *this;
+	}
+	const std::vector<uint8_t>& Data() const {
+		return data_;
+	}
+};
+
+/**
+ * @brief 帧识别结果
+ */
+enum {
+	FRAME_SKIP = -2,	///< 非帧头
+	FRAME_BAD,			///< 帧头有效, 校验错误
+	FRAME_MORE,			///< 帧头有效, 数据不完整
+	FRAME_OK			///< 有效帧
+};
+
+/**
+ * @brief 帧识别接口
+ */
+class FrameDecoder {
+public:
+	virtual ~FrameDecoder() {}
+	/*!
+	 * @brief 检查数据起始处是否为有效帧
+	 * @param data    数据
+	 * @param len     数据长度, 字节
+	 * @param frmLen  FRAME_OK或FRAME_BAD时, 帧长度
+	 * @return
+	 * 识别结果
+	 */
+	virtual int Check(const uint8_t* data, size_t len, size_t& frmLen) = 0;
+};
+typedef boost::shared_ptr<FrameDecoder> FrameDecoderPtr;
+
+/**
+ * @brief 在接收缓冲区中查找有效帧
+ */
+class FrameParser {
+protected:
+	std::vector<uint8_t> buf_;	///< 接收缓冲区
+	FrameDecoderPtr decoder_;	///< 帧识别接口
+	size_t frmLen_;		///< 已找到的有效帧长度
+	bool bad_;			///< 自上次Clear()后遇到过校验错误的帧
+	unsigned long long badFrames_;	///< 校验错误的帧数量
+
+public:
+	FrameParser() {
+		frmLen_    = 0;
+		bad_       = false;
+		badFrames_ = 0;
+	}
+
+	void SetDecoder(FrameDecoderPtr decoder) {
+		decoder_ = decoder;
+	}
+	void Append(const char* data, size_t len) {
+		buf_.insert(buf_.end(), data, data + len);
+	}
+	void Clear() {
+		buf_.clear();
+		frmLen_ = 0;
+		bad_    = false;
+	}
+	size_t Size() const {
+		return buf_.size();
+	}
+	bool HasBadFrame() const {
+		return bad_;
+	}
+	unsigned long long BadFrames() const {
+		return badFrames_;
+	}
+	/*!
+	 * @brief 查找有效帧. 帧头之前的数据被丢弃
+	 * @return
+	 * FRAME_OK: 有效帧位于Frame(); FRAME_MORE: 帧不完整; FRAME_SKIP: 无可识别的帧头
+	 */
+	int Parse();
+	/*!
+	 * @brief Parse()返回FRAME_OK后查看有效帧
+	 */
+	const uint8_t* Frame() const {
+		return &buf_[0];
+	}
+	size_t FrameLength() const {
+		return frmLen_;
+	}
+	/*!
+	 * @brief 从缓冲区中移除已处理的有效帧
+	 */
+	void Consume();
+};
+
+#endif
@@ -5,8 +5,11 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <math.h>
+#include <boost/thread/thread.hpp>
 #include "InvokeSExtractor.h"
 #include "GLog.h"
+#include "AsioPool.h"
+#include "AMath.h"
 #include "xmImageDef.h"
 
 #define TEMP_DIR	"/tmp"
@@ -16,6 +19,20 @@
 #define TEMP_NNW	"/tmp/default.nnw"
 
 using namespace boost::filesystem;
+using namespace AstroUtil;
+
+/**
+ * @brief 计算中值和离散度
+ * @param vals  样本. 计算过程改变样本顺序
+ * @param med   中值
+ * @param sig   离散度: 1.4826 * MAD, 与正态分布的标准差一致
+ */
+static void median_mad(std::vector<double>& vals, double& med, double& sig) {
+	int n = (int) vals.size();
+	med = k_select(vals.data(), n, n / 2);
+	for (int i = 0; i < n; ++i) vals[i] = fabs(vals[i] - med);
+	sig = 1.4826 * k_select(vals.data(), n, n / 2);
+}
 
 InvokeSExtractor::InvokeSExtractor()
 	: param_(NULL)
@@ -67,11 +84,10 @@ int InvokeSExtractor::DoIt(xmFrmPtr frame) {
 				_gLog.Write(LOG_WARN, "%s, no enough stars found", frame->fileName.c_str());
 				rslt = 4;
 			}
-			else if (!stat_quality()) {
-                _gLog.Write(LOG_WARN, "%s, bad image quality", frame->fileName.c_str());
-				rslt = 5;
-			}
 			else {
+				// 像质差: 标记后继续统计, 由使用者决定取舍
+				frame->flag = stat_quality() ? 0 : 1;
+				if (frame->flag) _gLog.Write(LOG_WARN, "%s, bad image quality", frame->fileName.c_str());
 				// if (!(frame->bTrailing = stat_incline())) {// 是否大部分星像拖尾? == false
 				// 	stat_fwhm();
 				// }
@@ -88,6 +104,11 @@ int InvokeSExtractor::DoIt(xmFrmPtr frame) {
 				else {
 					_gLog.Write("%s, star count = %6u", frame->fileName.c_str(), frame->stars.size());
 				}
+				if (frame->fieldFit) {
+					_gLog.Write("%s, field fwhm = %4.1f, tilt = (%5.2f, %5.2f), curvature = %5.2f",
+						frame->fileName.c_str(), frame->fwhmField,
+						frame->tiltX, frame->tiltY, frame->curvature);
+				}
 			}
 			free_star_link(headLink_);
 		}
@@ -351,8 +372,174 @@ int InvokeSExtractor::resolve_catalog(const char* pathCat) {
 	return starCount_;
 }
 
+void InvokeSExtractor::stat_zones() {
+	int cols = (frame_->width  + ZONE_SIZE - 1) / ZONE_SIZE;
+	int rows = (frame_->height + ZONE_SIZE - 1) / ZONE_SIZE;
+	int n = cols * rows;
+	int i, col, row, x1, y1;
+	double x0(frame_->width * 0.5 + 0.5);
+	double y0(frame_->height * 0.5 + 0.5);
+	double r = 0.5 * (frame_->width < frame_->height ? frame_->width : frame_->height);
+	double dx, dy;
+
+	frame_->zoneCols = cols;
+	frame_->zoneRows = rows;
+	frame_->zones.resize(n);
+	zoneStars_.resize(n);
+	for (row = 0, i = 0; row < rows; ++row) {
+		y1 = (row + 1) * ZONE_SIZE;
+		if (y1 > frame_->height) y1 = frame_->height;
+		for (col = 0; col < cols; ++col, ++i) {
+			xmZone& zone = frame_->zones[i];
+			x1 = (col + 1) * ZONE_SIZE;
+			if (x1 > frame_->width) x1 = frame_->width;
+			zone.col = col;
+			zone.row = row;
+			zone.xc  = 0.5 * (col * ZONE_SIZE + x1) + 0.5;
+			zone.yc  = 0.5 * (row * ZONE_SIZE + y1) + 0.5;
+			dx = zone.xc - x0;
+			dy = zone.yc - y0;
+			zone.inSky = dx * dx + dy * dy <= r * r;
+			zoneStars_[i].clear();
+		}
+	}
+
+	// 分组: 单次遍历星像链表
+	xmStarPtr star;
+	xmStarLink* now = headLink_->next;
+	while (now != headLink_) {
+		star = now->star;
+		col = int((star->x - 0.5) / ZONE_SIZE);
+		row = int((star->y - 0.5) / ZONE_SIZE);
+		if (col < 0) col = 0;
+		else if (col >= cols) col = cols - 1;
+		if (row < 0) row = 0;
+		else if (row >= rows) row = rows - 1;
+		zoneStars_[row * cols + col].push_back(star);
+		now = now->next;
+	}
+
+	// 并行统计: 各任务处理互不重叠的网格. 线程池执行其余任务, 本线程执行第一个
+	int ntask = _gPool.IsRunning() ? _gPool.ThreadCount() + 1 : 1;
+	if (ntask > n) ntask = n;
+	if (ntask <= 1) stat_zone_range(0, 1);
+	else {
+		boost::mutex mtx;
+		boost::condition_variable cvDone;
+		int left = ntask - 1;
+		for (i = 1; i < ntask; ++i) {
+			_gPool.GetIOService().post([this, i, ntask, &mtx, &cvDone, &left]() {
+				stat_zone_range(i, ntask);
+				MtxLck lck(mtx);
+				if (--left == 0) cvDone.notify_one();
+			});
+		}
+		stat_zone_range(0, ntask);
+		// 任务引用本函数的局部变量: 等待期间不响应线程中断
+		boost::this_thread::disable_interruption di;
+		MtxLck lck(mtx);
+		while (left) cvDone.wait(lck);
+	}
+
+	// 全视场FWHM中值
+	std::vector<double> vals;
+	for (i = 0; i < n; ++i) {
+		if (frame_->zones[i].inSky && frame_->zones[i].good) vals.push_back(frame_->zones[i].fwhm);
+	}
+	if (vals.size()) frame_->fwhmField = k_select(vals.data(), (int) vals.size(), (int) vals.size() / 2);
+	fit_field();
+}
+
+void InvokeSExtractor::stat_zone_range(int first, int stride) {
+	int n = (int) frame_->zones.size();
+	std::vector<double> fwhm, elong;
+
+	for (int i = first; i < n; i += stride) {
+		xmZone& zone = frame_->zones[i];
+		xmStarPtrVec& stars = zoneStars_[i];
+		zone.count = (int) stars.size();
+		zone.good  = zone.count >= STAR_PER_ZONE;
+		zone.fwhm  = zone.fwhmErr  = 0.0;
+		zone.elong = zone.elongErr = 0.0;
+		if (!zone.good) continue;
+
+		fwhm.clear();
+		elong.clear();
+		for (xmStarPtrVec::iterator it = stars.begin(); it != stars.end(); ++it) {
+			fwhm.push_back((*it)->fwhm);
+			elong.push_back((*it)->elong);
+		}
+		median_mad(fwhm,  zone.fwhm,  zone.fwhmErr);
+		median_mad(elong, zone.elong, zone.elongErr);
+	}
+}
+
+void InvokeSExtractor::fit_field() {
+	const int nbase = 4;
+	std::vector<double> u, v, f;
+	double x0(frame_->width * 0.5 + 0.5);
+	double y0(frame_->height * 0.5 + 0.5);
+	double r = 0.5 * (frame_->width < frame_->height ? frame_->width : frame_->height);
+
+	for (xmZoneVec::iterator it = frame_->zones.begin(); it != frame_->zones.end(); ++it) {
+		if (it->inSky && it->good) {
+			u.push_back((it->xc - x0) / r);
+			v.push_back((it->yc - y0) / r);
+			f.push_back(it->fwhm);
+		}
+	}
+
+	int m = (int) f.size();
+	if (m < 2 * nbase) return;
+	std::vector<double> x(nbase * m);
+	double c[nbase];
+	for (int i = 0; i < m; ++i) {
+		x[i]         = 1.0;
+		x[m + i]     = u[i];
+		x[2 * m + i] = v[i];
+		x[3 * m + i] = u[i] * u[i] + v[i] * v[i];
+	}
+	AMath math;
+	if ((frame_->fieldFit = math.LSFitLinear(m, nbase, x.data(), f.data(), c))) {
+		frame_->tiltX     = c[1];
+		frame_->tiltY     = c[2];
+		frame_->curvature = c[3];
+	}
+}
+
+void InvokeSExtractor::save_zones() {
+	path pathName(frame_->filePath);
+	pathName.replace_extension("zone");
+	FILE* fp = fopen(pathName.c_str(), "w");
+	if (!fp) return;
+
+	fprintf (fp, "# ZONE %d %d %d\n", frame_->zoneCols, frame_->zoneRows, ZONE_SIZE);
+	if (frame_->fieldFit) {
+		fprintf (fp, "# FIELD %5.2f %6.3f %6.3f %6.3f\n",
+			frame_->fwhmField, frame_->tiltX, frame_->tiltY, frame_->curvature);
+	}
+	fprintf (fp, "# col row      xc      yc count  fwhm  sigma elong  sigma sky\n");
+	for (xmZoneVec::iterator it = frame_->zones.begin(); it != frame_->zones.end(); ++it) {
+		fprintf (fp, "%5d %3d %7.1f %7.1f %5d %5.2f %6.3f %5.2f %6.3f %3d\n",
+			it->col, it->row, it->xc, it->yc, it->count,
+			it->fwhm, it->fwhmErr, it->elong, it->elongErr, it->inSky ? 1 : 0);
+	}
+	fclose(fp);
+}
+
 bool InvokeSExtractor::stat_quality() {
-	return true;
+	int sky(0), bad(0);
+	stat_zones();
+#ifdef NDEBUG
+	save_zones();
+#endif
+	for (xmZoneVec::iterator it = frame_->zones.begin(); it != frame_->zones.end(); ++it) {
+		if (it->inSky) {
+			++sky;
+			if (!it->good) ++bad;
+		}
+	}
+	return sky > 0 && bad <= param_->focusBadZone * sky;
 }
 
 bool InvokeSExtractor::stat_incline() {
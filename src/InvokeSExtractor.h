@@ -42,6 +42,8 @@ private:
 	double elong_;		///< 延展率均值
 	double elongErr_;	///< 延展率误差
 
+	std::vector<xmStarPtrVec> zoneStars_;	///< 按网格分组的星像
+
 // 接口
 public:
 	/**
@@ -64,7 +66,7 @@ public:
 	 * 2 : 不能启动进程
 	 * 3 : SEx调用/执行错误
 	 * 4 : 星像数量不足, 无法完成定标等流程
-	 * 5 : 图像质量差
+	 * @note 像质差的图像仍完成统计, 以xmFrame::flag标记
 	 */
 	int DoIt(xmFrmPtr frame);
 
@@ -110,11 +112,31 @@ private:
 	 * 星像数量
 	 */
 	int resolve_catalog(const char* pathCat);
+	/**
+	 * @brief 按ZONE_SIZE划分网格, 在线程池中并行统计各网格的星像轮廓, 生成FWHM分布图
+	 */
+	void stat_zones();
+	/**
+	 * @brief 统计网格first, first+stride, ...的星像轮廓
+	 * @param first   第一个网格索引
+	 * @param stride  网格索引间隔
+	 */
+	void stat_zone_range(int first, int stride);
+	/**
+	 * @brief 拟合FWHM分布图中的倾斜与场曲
+	 * @note 模型: FWHM = c0 + c1 * u + c2 * v + c3 * (u^2 + v^2), (u, v)为归一化至半视场的坐标
+	 */
+	void fit_field();
+	/**
+	 * @brief 将FWHM分布图写入与图像同名的.zone文件
+	 */
+	void save_zones();
 	/**
 	 * @brief 统计评估图像质量
 	 * @return 图像质量是否符合条件
 	 * @note 质量标准:
-	 * - 图像纵/横各4等分, 共16个区域, 每个区域至少包含3颗星
+	 * - 成像圆内的网格中, 星像数量少于STAR_PER_ZONE的网格比例不超过Parameter::focusBadZone
+	 * - 评估前完成分区统计和视场拟合. 调试模式下输出分区文件
 	 */
 	bool stat_quality();
 	/**
@@ -0,0 +1,215 @@
+/**
+ * @file ModbusMaster.cpp 基于SerialComm的MODBUS RTU主站
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/asio/placeholders.hpp>
+#include "ModbusMaster.h"
+
+#define MODBUS_FUNC_READ_HOLDING	0x03
+#define MODBUS_FUNC_EXCEPTION		0x80
+#define MODBUS_REG_MAX				125		// 单次读取的最大寄存器数量
+
+using namespace boost::placeholders;
+namespace bchrono = boost::asio::chrono;
+
+int ModbusRtuDecoder::Check(const uint8_t* data, size_t len, size_t& frmLen) {
+	if (data[0] != slave) return FRAME_SKIP;
+	if (len < 2) return FRAME_MORE;
+	if (data[1] == func) frmLen = rspLen;
+	else if (data[1] == (func | MODBUS_FUNC_EXCEPTION)) frmLen = 5;
+	else return FRAME_SKIP;
+	if (len < 3) return FRAME_MORE;
+	if (data[1] == func && data[2] != rspLen - 5) return FRAME_SKIP;	// 字节数与请求不符
+	if (len < frmLen) return FRAME_MORE;
+
+	uint16_t crc = CRC16Modbus(data, frmLen - 2);
+	return data[frmLen - 2] == (crc & 0xFF) && data[frmLen - 1] == (crc >> 8) ? FRAME_OK : FRAME_BAD;
+}
+
+/////////////////////////////////////////////////////////////////////
+ModbusMaster::ModbusMaster()
+	: tmrGap_(keep_.GetIOService()), tmrTimeout_(keep_.GetIOService()) {
+	t35_     = 4010;
+	timeout_ = MODBUS_TIMEOUT;
+	retry_   = MODBUS_RETRY;
+	busy_    = false;
+	decoder_.reset(new ModbusRtuDecoder);
+	parser_.SetDecoder(decoder_);
+}
+
+ModbusMaster::~ModbusMaster() {
+	Close();
+}
+
+bool ModbusMaster::Open(const char* portname, const int baud_rate) {
+	if (IsOpen()) return true;
+
+	port_ = SerialComm::Create();
+	if (!port_->Open(portname, baud_rate)) {
+		port_.reset();
+		return false;
+	}
+	// t3.5: 3.5个字符时间, 每个字符11位. 波特率高于19200时固定为1.75毫秒
+	t35_ = baud_rate > 19200 ? 1750 : 38500000 / baud_rate;
+	queTrans_.clear();
+	active_.reset();
+	parser_.Clear();
+	busy_ = false;
+	keep_.Reset();
+
+	const SerialComm::CBSlot& slot = boost::bind(&ModbusMaster::handle_serial, this, _1, _2, _3);
+	port_->SetReadLength(0);
+	port_->RegisterRead(slot);
+	return true;
+}
+
+void ModbusMaster::Close() {
+	if (port_) {
+		boost::system::error_code ec;
+		keep_.Stop();
+		tmrGap_.cancel(ec);
+		tmrTimeout_.cancel(ec);
+		port_->Close();
+		port_.reset();
+		queTrans_.clear();
+		active_.reset();
+		busy_ = false;
+	}
+}
+
+bool ModbusMaster::IsOpen() {
+	return port_ && port_->IsOpen();
+}
+
+void ModbusMaster::SetTimeout(int ms, int retries) {
+	timeout_ = ms > 0 ? ms : MODBUS_TIMEOUT;
+	retry_   = retries >= 0 ? retries : 0;
+}
+
+bool ModbusMaster::ReadHolding(uint8_t slave, uint16_t addr, uint16_t count, const CBRegister& cb, int priority) {
+	if (!IsOpen() || !count || count > MODBUS_REG_MAX) return false;
+
+	TransPtr trans(new Transaction);
+	trans->request = FrameBuilder().U8(slave).U8(MODBUS_FUNC_READ_HOLDING).U16(addr).U16(count).CRC16().Data();
+	trans->slave   = slave;
+	trans->func    = MODBUS_FUNC_READ_HOLDING;
+	trans->rspLen  = 5 + 2 * count;
+	trans->retries = retry_;
+	trans->priority = priority;
+	trans->cb      = cb;
+	keep_.Post(boost::bind(&ModbusMaster::enqueue, this, trans));
+	return true;
+}
+
+ModbusStat ModbusMaster::Statistic() {
+	MtxLck lck(mtxStat_);
+	return stat_;
+}
+
+/////////////////////////////////////////////////////////////////////
+void ModbusMaster::enqueue(TransPtr trans) {
+	std::deque<TransPtr>::iterator it = queTrans_.end();
+	while (it != queTrans_.begin() && (*(it - 1))->priority < trans->priority) --it;
+	queTrans_.insert(it, trans);
+	if (!busy_) start_next();
+}
+
+void ModbusMaster::start_next() {
+	if (queTrans_.empty()) {
+		busy_ = false;
+		return;
+	}
+	busy_ = true;
+	active_ = queTrans_.front();
+	queTrans_.pop_front();
+	decoder_->slave  = active_->slave;
+	decoder_->func   = active_->func;
+	decoder_->rspLen = active_->rspLen;
+	parser_.Clear();
+	{
+		MtxLck lck(mtxStat_);
+		++stat_.requests;
+	}
+	send();
+}
+
+void ModbusMaster::send() {
+	port_->Write((const char*) &active_->request[0], active_->request.size());
+	tmrTimeout_.expires_after(bchrono::milliseconds(timeout_));
+	tmrTimeout_.async_wait(keep_.Wrap(boost::bind(&ModbusMaster::on_timeout, this, boost::asio::placeholders::error)));
+}
+
+void ModbusMaster::finish(int ec) {
+	TransPtr trans = active_;
+	RegVec regs;
+	boost::system::error_code ec1;
+
+	tmrTimeout_.cancel(ec1);
+	if (ec == MODBUS_SUCCESS) {
+		const uint8_t* frame = parser_.Frame();
+		for (int i = 0, n = int(trans->rspLen - 5) / 2; i < n; ++i) regs.push_back((frame[3 + 2 * i] << 8) | frame[4 + 2 * i]);
+	}
+	else if (ec == MODBUS_EXCEPTION) regs.push_back(parser_.Frame()[2]); // 异常码
+	{
+		MtxLck lck(mtxStat_);
+		if (ec == MODBUS_SUCCESS) ++stat_.responses;
+		else if (ec == MODBUS_EXCEPTION) ++stat_.exceptions;
+		if (parser_.HasBadFrame()) ++stat_.crcErrors;
+	}
+	parser_.Clear();
+	active_.reset();
+	// 静默t3.5后开始下一事务
+	tmrGap_.expires_after(bchrono::microseconds(t35_));
+	tmrGap_.async_wait(keep_.Wrap(boost::bind(&ModbusMaster::on_gap, this, boost::asio::placeholders::error)));
+
+	if (trans->cb) trans->cb(ec, regs);
+}
+
+void ModbusMaster::retry(int ec) {
+	MtxLck lck(mtxStat_);
+	if (ec == MODBUS_TIMEOUT_ERR) ++stat_.timeouts;
+	if (active_->retries-- > 0) {
+		++stat_.retries;
+		if (parser_.HasBadFrame()) ++stat_.crcErrors;
+		lck.unlock();
+		parser_.Clear();
+		send();
+	}
+	else {
+		lck.unlock();
+		finish(ec);
+	}
+}
+
+void ModbusMaster::handle_serial(SerialComm* comm, int ec, size_t bytes) {
+	if (!ec) keep_.Post(boost::bind(&ModbusMaster::on_receive, this));
+}
+
+void ModbusMaster::on_receive() {
+	char buff[64];
+	int n;
+
+	while ((n = port_->Read(buff, sizeof(buff))) > 0) parser_.Append(buff, n);
+	if (!active_) parser_.Clear(); // 无事务时收到的数据
+	else if (parser_.Parse() == FRAME_OK) finish(parser_.Frame()[1] == active_->func ? MODBUS_SUCCESS : MODBUS_EXCEPTION);
+	else {// 等待后续数据或帧间隔
+		tmrGap_.expires_after(bchrono::microseconds(t35_));
+		tmrGap_.async_wait(keep_.Wrap(boost::bind(&ModbusMaster::on_gap, this, boost::asio::placeholders::error)));
+	}
+}
+
+void ModbusMaster::on_gap(const boost::system::error_code& ec) {
+	if (ec || tmrGap_.expiry() > SteadyTimer::clock_type::now()) return; // 定时器已被重置
+
+	if (!active_) start_next();
+	else if (parser_.HasBadFrame()) retry(MODBUS_CRC_ERR); // 帧结束
+}
+
+void ModbusMaster::on_timeout(const boost::system::error_code& ec) {
+	if (ec || !active_ || tmrTimeout_.expiry() > SteadyTimer::clock_type::now()) return;
+	retry(MODBUS_TIMEOUT_ERR);
+}
@@ -0,0 +1,199 @@
+/**
+ * @file ModbusMaster.h 基于SerialComm的MODBUS RTU主站
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 同一串口可挂接多个从站, 事务按优先级排队, 同一优先级按提交顺序, 逐个发送. 前一事务结束并静默t3.5后
+ *   立即发送下一事务
+ * - 帧界定: 按期望长度即时完成; 接收间隔超过t3.5时视为帧结束, 丢弃无法识别的数据
+ * - 反馈帧由FrameParser和ModbusRtuDecoder识别: 检查从站地址、功能码和CRC16, 支持异常反馈
+ * - 每个事务独立超时和重试
+ * - 回调函数在主站的strand中执行
+ */
+
+#ifndef MODBUS_MASTER_H_
+#define MODBUS_MASTER_H_
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include "SerialComm.h"
+#include "FrameCodec.h"
+
+#define MODBUS_TIMEOUT		500		///< 默认反馈超时, 毫秒
+#define MODBUS_RETRY		2		///< 默认重试次数
+
+/**
+ * @brief 事务结果
+ */
+enum {
+	MODBUS_SUCCESS,		///< 正确
+	MODBUS_TIMEOUT_ERR,	///< 反馈超时
+	MODBUS_CRC_ERR,		///< 反馈帧校验错误
+	MODBUS_EXCEPTION	///< 从站异常反馈
+};
+
+/**
+ * @brief 主站统计量
+ */
+struct ModbusStat {
+	unsigned long long requests;	///< 事务数量
+	unsigned long long responses;	///< 正确反馈数量
+	unsigned long long retries;		///< 重发次数
+	unsigned long long timeouts;	///< 超时次数
+	unsigned long long crcErrors;	///< 收到校验错误帧的请求次数
+	unsigned long long exceptions;	///< 异常反馈次数
+
+public:
+	ModbusStat() {
+		requests = responses = retries = timeouts = crcErrors = exceptions = 0;
+	}
+};
+
+/**
+ * @brief 识别当前事务的反馈帧: 正常反馈或异常反馈
+ */
+class ModbusRtuDecoder : public FrameDecoder {
+public:
+	uint8_t slave;	///< 从站地址
+	uint8_t func;	///< 功能码
+	size_t rspLen;	///< 正常反馈帧长度
+
+public:
+	ModbusRtuDecoder() {
+		slave  = func = 0;
+		rspLen = 0;
+	}
+	int Check(const uint8_t* data, size_t len, size_t& frmLen);
+};
+
+class ModbusMaster {
+public:
+	ModbusMaster();
+	virtual ~ModbusMaster();
+
+public:
+	/* 数据类型 */
+	typedef boost::shared_ptr<ModbusMaster> Pointer;
+	typedef std::vector<uint16_t> RegVec;
+	/*!
+	 * @brief 读寄存器回调函数
+	 * @param _1  事务结果
+	 * @param _2  寄存器数值
+	 */
+	typedef boost::function<void (int ec, const RegVec& regs)> CBRegister;
+
+protected:
+	/* 事务 */
+	struct Transaction {
+		uint8_t slave;		///< 从站地址
+		uint8_t func;		///< 功能码
+		std::vector<uint8_t> request;	///< 请求帧
+		size_t rspLen;		///< 正常反馈帧长度
+		int retries;		///< 剩余重试次数
+		int priority;		///< 优先级. 数值大者先发送
+		CBRegister cb;		///< 回调函数
+	};
+	typedef boost::shared_ptr<Transaction> TransPtr;
+
+protected:
+	/* 成员变量 */
+	BoostAsioKeep keep_;	///< 线程池句柄
+	SerialPtr port_;		///< 串口
+	SteadyTimer tmrGap_;	///< 定时器: t3.5帧间隔
+	SteadyTimer tmrTimeout_;	///< 定时器: 反馈超时
+	int t35_;			///< t3.5, 微秒
+	int timeout_;		///< 反馈超时, 毫秒
+	int retry_;			///< 重试次数
+	std::deque<TransPtr> queTrans_;	///< 待发送事务
+	TransPtr active_;	///< 正在执行的事务
+	bool busy_;			///< 正在执行事务或等待帧间隔
+	boost::shared_ptr<ModbusRtuDecoder> decoder_;	///< 反馈帧识别
+	FrameParser parser_;	///< 接收缓冲区及帧查找
+	ModbusStat stat_;	///< 统计量
+	boost::mutex mtxStat_;	///< 互斥锁: 统计量
+
+public:
+	/* 接口 */
+	static Pointer Create() {
+		return Pointer(new ModbusMaster);
+	}
+	/*!
+	 * @brief 打开串口
+	 * @param portname  串口名称
+	 * @param baud_rate 波特率
+	 * @return
+	 * 串口打开结果
+	 */
+	bool Open(const char* portname, const int baud_rate = 9600);
+	/*!
+	 * @brief 关闭串口. 未完成的事务被丢弃, 不调用其回调函数
+	 */
+	void Close();
+	bool IsOpen();
+	/*!
+	 * @brief 设置反馈超时和重试次数
+	 * @param ms       超时, 毫秒
+	 * @param retries  重试次数
+	 */
+	void SetTimeout(int ms, int retries);
+	/*!
+	 * @brief 读保持寄存器(功能码0x03)
+	 * @param slave  从站地址
+	 * @param addr   起始寄存器地址
+	 * @param count  寄存器数量
+	 * @param cb     回调函数
+	 * @param priority  优先级. 数值大者先发送, 不抢占正在执行的事务
+	 * @return
+	 * 事务是否已提交
+	 */
+	bool ReadHolding(uint8_t slave, uint16_t addr, uint16_t count, const CBRegister& cb, int priority = 0);
+	/*!
+	 * @brief 查看统计量
+	 */
+	ModbusStat Statistic();
+
+protected:
+	/*!
+	 * @brief 将事务加入队列: 排在优先级不低于它的事务之后
+	 */
+	void enqueue(TransPtr trans);
+	/*!
+	 * @brief 开始下一事务
+	 */
+	void start_next();
+	/*!
+	 * @brief 发送当前事务的请求帧
+	 */
+	void send();
+	/*!
+	 * @brief 结束当前事务, 执行回调函数, 并等待帧间隔
+	 * @param ec  事务结果
+	 */
+	void finish(int ec);
+	/*!
+	 * @brief 重发或以故障结束当前事务
+	 * @param ec  事务结果
+	 */
+	void retry(int ec);
+	/*!
+	 * @brief 串口回调函数: 收到数据
+	 */
+	void handle_serial(SerialComm* comm, int ec, size_t bytes);
+	/*!
+	 * @brief 读出串口数据并解析
+	 */
+	void on_receive();
+	/*!
+	 * @brief 定时器: t3.5帧间隔
+	 */
+	void on_gap(const boost::system::error_code& ec);
+	/*!
+	 * @brief 定时器: 反馈超时
+	 */
+	void on_timeout(const boost::system::error_code& ec);
+};
+typedef ModbusMaster::Pointer ModbusPtr;
+
+#endif
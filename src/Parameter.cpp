@@ -33,6 +33,9 @@ Parameter::Parameter() {
 	portPDU = 3002;		///< PDU端口
 	portDevice = 5;		///< 设备电源在PDU上的端口
 
+	/* 线程池 */
+	poolThreads = 4;	///< asio线程池的线程数量
+
 	/* 采样周期 */
 	sampleCycle = 30;	///< 采样周期
 	sampleDir = "/history";	///< 测量数据存储目录
@@ -45,6 +48,7 @@ Parameter::Parameter() {
 	/* SQM */
 	sqmEnable = true;
 	addrSQM = "192.168.1.6";		///< SQM地址
+	sqmDiscover = false;
 
 	/* 云量相机 */
 	fileCloudAge= "updateFile_new.txt";
@@ -56,7 +60,52 @@ Parameter::Parameter() {
 	saturation  = 60000;	///< 饱和值
 	coolerSet   = -10;	///< 制冷温度
 	minDiskFree = 100;	///< 可用空间小于100GB时删除历史数据
+	targetDiskFree = 120;
+	retainRaw = retainProduct = retainLog = 0;
+	cleanRate   = 50;
+	archiveEnable = false;
+	archiveAfter  = 3;
+	retainArchive = 0;
+	archiveRate   = 20;
 	fwhmPerfect = 3.0;	///< 期望FWHM值
+	focusStep   = 500;	///< 自动调焦初始搜索步长
+	focusFrameMax = 15;	///< 自动调焦帧数上限
+	focusBadZone  = 0.5;	///< 像质评估: 星像不足的网格比例上限
+
+	/* 全天镜头 */
+	lensX0 = lensY0 = 0.0;	///< 图像中心
+	lensScale    = 0.0;	///< 地平圈内切于图像
+	lensRotation = 0.0;
+	lensFlip     = false;
+	lensK2 = lensK3 = 0.0;
+
+	/* 云量引擎 */
+	engineEnable = false;
+	engineMethod = "stars";
+	gridAzStep   = 30.0;
+	gridElStep   = 10.0;
+	gridElMin    = 20.0;
+	gradeSigma   = 5.0;
+	gradeDensity = 1.0;
+	gradeContrast= 0.5;
+
+	/* 天文标定 */
+	astroEnable  = false;
+	photoEnable  = false;
+
+	/* 本底改正 */
+	calibEnable     = false;
+	calibDarkEvery  = 120;
+	calibDarkFrames = 5;
+	calibTempStep   = 5;
+	calibHotSigma   = 8.0;
+
+	/* 预览 */
+	previewEnable  = false;
+	previewBin     = 4;
+	previewQuality = 80;
+	previewBudget  = 500;
+	previewLapse   = true;
 }
 
 Parameter::~Parameter() {
@@ -97,11 +146,24 @@ bool Parameter::Load(const char* filePath) {
 				portPDU    = it->second.get("IP.<xmlattr>.Port",    3002);
 				portDevice = it->second.get("DevicePower.<xmlattr>.Port", 5);
 			}
+			else if (iequals(it->first, "Executor")) {
+				poolThreads = it->second.get("<xmlattr>.Threads", 4);
+				if (poolThreads < 1) poolThreads = 1;
+			}
 			else if (iequals(it->first, "Sample")) {
 				sampleCycle = it->second.get("<xmlattr>.Cycle", 30);
 				sampleDir   = it->second.get("<xmlattr>.Dir", "/history");
 				if (sampleCycle < 20) sampleCycle = 20;
 				else if (sampleCycle > 60) sampleCycle = 60;
+				logSyncs.clear();
+				for (ptree::const_iterator child = it->second.begin(); child != it->second.end(); ++child) {
+					if (!iequals(child->first, "Log")) continue;
+					LogSync sync;
+					sync.stream = child->second.get("<xmlattr>.Stream", "");
+					sync.mode   = child->second.get("<xmlattr>.Sync",   "datasync");
+					sync.period = child->second.get("<xmlattr>.Period", 60);
+					if (!sync.stream.empty()) logSyncs.push_back(sync);
+				}
 			}
 			else if (iequals(it->first, "WeatherStation")) {
 				portWeaStation = it->second.get("<xmlattr>.Port", "/dev/ttyUSB0");
@@ -111,6 +173,16 @@ bool Parameter::Load(const char* filePath) {
 			else if (iequals(it->first, "SQM")) {
 				sqmEnable = it->second.get("<xmlattr>.Enable", false);
 				addrSQM = it->second.get("<xmlattr>.Address", "192.168.100.6");
+				sqmDiscover = it->second.get("<xmlattr>.Discover", false);
+				sqmUnits.clear();
+				for (ptree::const_iterator child = it->second.begin(); child != it->second.end(); ++child) {
+					if (!iequals(child->first, "Unit")) continue;
+					SQMAddr unit;
+					unit.name = child->second.get("<xmlattr>.Name", "");
+					unit.addr = child->second.get("<xmlattr>.Address", "");
+					unit.port = child->second.get("<xmlattr>.Port", 10001);
+					if (!unit.addr.empty()) sqmUnits.push_back(unit);
+				}
 			}
 			else if (iequals(it->first, "CloudCamera")) {
 				fileCloudAge = it->second.get("CloudAge.<xmlattr>.FileName", "");
@@ -122,7 +194,52 @@ bool Parameter::Load(const char* filePath) {
 				saturation   = it->second.get("Camera.<xmlattr>.Saturation", 60000);
 				coolerSet    = it->second.get("Camera.<xmlattr>.Cooler",     -10);
 				minDiskFree  = it->second.get("FreeDisk.<xmlattr>.Min",      100);
+				targetDiskFree = it->second.get("FreeDisk.<xmlattr>.Target", 120);
+				retainRaw     = it->second.get("Retention.<xmlattr>.Raw",      0);
+				retainProduct = it->second.get("Retention.<xmlattr>.Products", 0);
+				retainLog     = it->second.get("Retention.<xmlattr>.Logs",     0);
+				cleanRate     = it->second.get("Retention.<xmlattr>.Rate",     50);
+				archiveEnable = it->second.get("Archive.<xmlattr>.Enable",     false);
+				archiveAfter  = it->second.get("Archive.<xmlattr>.After",      3);
+				archiveDir    = it->second.get("Archive.<xmlattr>.Dir",        "");
+				retainArchive = it->second.get("Archive.<xmlattr>.Retain",     0);
+				archiveRate   = it->second.get("Archive.<xmlattr>.Rate",       20);
 				fwhmPerfect  = it->second.get("Focus.<xmlattr>.FWHM",        3.0);
+				focusStep    = it->second.get("Focus.<xmlattr>.Step",        500);
+				focusFrameMax= it->second.get("Focus.<xmlattr>.FrameMax",    15);
+				focusBadZone = it->second.get("Focus.<xmlattr>.BadZone",     0.5);
+				lensX0       = it->second.get("Lens.<xmlattr>.CenterX",      0.0);
+				lensY0       = it->second.get("Lens.<xmlattr>.CenterY",      0.0);
+				lensScale    = it->second.get("Lens.<xmlattr>.Scale",        0.0);
+				lensRotation = it->second.get("Lens.<xmlattr>.Rotation",     0.0);
+				lensFlip     = it->second.get("Lens.<xmlattr>.Flip",         false);
+				lensK2       = it->second.get("Lens.<xmlattr>.K2",           0.0);
+				lensK3       = it->second.get("Lens.<xmlattr>.K3",           0.0);
+				engineEnable = it->second.get("Engine.<xmlattr>.Enable",     false);
+				engineMethod = it->second.get("Engine.<xmlattr>.Method",     "stars");
+				gridAzStep   = it->second.get("Grid.<xmlattr>.AzStep",       30.0);
+				gridElStep   = it->second.get("Grid.<xmlattr>.ElStep",       10.0);
+				gridElMin    = it->second.get("Grid.<xmlattr>.ElMin",        20.0);
+				gradeSigma   = it->second.get("Grade.<xmlattr>.Sigma",       5.0);
+				gradeDensity = it->second.get("Grade.<xmlattr>.StarDensity", 1.0);
+				gradeContrast= it->second.get("Grade.<xmlattr>.Contrast",    0.5);
+				astroEnable  = it->second.get("Astrometry.<xmlattr>.Enable",  false);
+				astroCatalog = it->second.get("Astrometry.<xmlattr>.Catalog", "");
+				photoEnable  = it->second.get("Photometry.<xmlattr>.Enable",  false);
+				calibEnable     = it->second.get("Calibration.<xmlattr>.Enable",     false);
+				calibDarkEvery  = it->second.get("Calibration.<xmlattr>.DarkEvery",  120);
+				calibDarkFrames = it->second.get("Calibration.<xmlattr>.DarkFrames", 5);
+				calibTempStep   = it->second.get("Calibration.<xmlattr>.TempStep",   5);
+				calibHotSigma   = it->second.get("Calibration.<xmlattr>.HotSigma",   8.0);
+				calibDarkDir    = it->second.get("Calibration.<xmlattr>.DarkDir",    "");
+				previewEnable  = it->second.get("Preview.<xmlattr>.Enable",    false);
+				previewBin     = it->second.get("Preview.<xmlattr>.Bin",       4);
+				previewQuality = it->second.get("Preview.<xmlattr>.Quality",   80);
+				previewBudget  = it->second.get("Preview.<xmlattr>.Budget",    500);
+				previewLapse   = it->second.get("Preview.<xmlattr>.TimeLapse", true);
+			}
+			else if (iequals(it->first, "Sensors")) {
+				sensors = it->second;
 			}
 		}
 
@@ -167,17 +284,34 @@ bool Parameter::Save(const char* filePath) {
 		ptPDU.add("IP.<xmlattr>.Port",          portPDU);
 		ptPDU.add("DevicePower.<xmlattr>.Port", portDevice);
 
+		pt.add("Executor.<xmlattr>.Threads", poolThreads);
+
 		ptree& ptMea = pt.add("Sample", "");
 		ptMea.add("<xmlattr>.Cycle", sampleCycle);
 		ptMea.add("<xmlattr>.Dir",   sampleDir);
+		for (std::vector<LogSync>::const_iterator sync = logSyncs.begin(); sync != logSyncs.end(); ++sync) {
+			ptree& ptLog = ptMea.add("Log", "");
+			ptLog.add("<xmlattr>.Stream", sync->stream);
+			ptLog.add("<xmlattr>.Sync",   sync->mode);
+			ptLog.add("<xmlattr>.Period", sync->period);
+		}
+		ptMea.add("<xmlcomment>", "Sync : group = buffered, written and synced every period; datasync = written per line, synced every period; dsync = synced per line");
 
 		ptree& ptWeaSta = pt.add("WeatherStation", "");
 		ptWeaSta.add("<xmlattr>.Port", portWeaStation);
 		ptWeaSta.add("Rain.<xmlattr>.Enable", rainEnable);
 		ptWeaSta.add("Rain.<xmlattr>.Port", portRain);
 
-		pt.add("SQM.<xmlattr>.Enable", sqmEnable);
-		pt.add("SQM.<xmlattr>.Address", addrSQM);
+		ptree& ptSQM = pt.add("SQM", "");
+		ptSQM.add("<xmlattr>.Enable", sqmEnable);
+		ptSQM.add("<xmlattr>.Address", addrSQM);
+		ptSQM.add("<xmlattr>.Discover", sqmDiscover);
+		for (std::vector<SQMAddr>::const_iterator unit = sqmUnits.begin(); unit != sqmUnits.end(); ++unit) {
+			ptree& ptUnit = ptSQM.add("Unit", "");
+			ptUnit.add("<xmlattr>.Name",    unit->name);
+			ptUnit.add("<xmlattr>.Address", unit->addr);
+			ptUnit.add("<xmlattr>.Port",    unit->port);
+		}
 
 		ptree& ptCloud = pt.add("CloudCamera", "");
 		ptCloud.add("CloudAge.<xmlattr>.FileName", fileCloudAge);
@@ -189,7 +323,58 @@ bool Parameter::Save(const char* filePath) {
 		ptCloud.add("Camera.<xmlattr>.Saturation", saturation);
 		ptCloud.add("Camera.<xmlattr>.Cooler",     coolerSet);
 		ptCloud.add("FreeDisk.<xmlattr>.Min",      minDiskFree);
+		ptCloud.add("FreeDisk.<xmlattr>.Target",   targetDiskFree);
+		ptCloud.add("Retention.<xmlattr>.Raw",      retainRaw);
+		ptCloud.add("Retention.<xmlattr>.Products", retainProduct);
+		ptCloud.add("Retention.<xmlattr>.Logs",     retainLog);
+		ptCloud.add("Retention.<xmlattr>.Rate",     cleanRate);
+		ptCloud.add("Retention.<xmlcomment>", "Raw/Products/Logs : days to keep, 0 = limited by free disk only");
+		ptCloud.add("Retention.<xmlcomment>", "Rate : erasing rate limit in MB/s");
+		ptCloud.add("Archive.<xmlattr>.Enable",    archiveEnable);
+		ptCloud.add("Archive.<xmlattr>.After",     archiveAfter);
+		ptCloud.add("Archive.<xmlattr>.Dir",       archiveDir);
+		ptCloud.add("Archive.<xmlattr>.Retain",    retainArchive);
+		ptCloud.add("Archive.<xmlattr>.Rate",      archiveRate);
+		ptCloud.add("Archive.<xmlcomment>", "After : pack night directories older than these days into compressed FITS");
+		ptCloud.add("Archive.<xmlcomment>", "Dir : archive volume, empty = raw image directory. Rate : reading rate limit in MB/s");
 		ptCloud.add("Focus.<xmlattr>.FWHM",        fwhmPerfect);
+		ptCloud.add("Focus.<xmlattr>.Step",        focusStep);
+		ptCloud.add("Focus.<xmlattr>.FrameMax",    focusFrameMax);
+		ptCloud.add("Focus.<xmlattr>.BadZone",     focusBadZone);
+		ptCloud.add("Focus.<xmlcomment>", "BadZone : frames with more in-sky zones short of stars than this fraction are flagged as poor quality");
+		ptCloud.add("Lens.<xmlattr>.CenterX",      lensX0);
+		ptCloud.add("Lens.<xmlattr>.CenterY",      lensY0);
+		ptCloud.add("Lens.<xmlattr>.Scale",        lensScale);
+		ptCloud.add("Lens.<xmlattr>.Rotation",     lensRotation);
+		ptCloud.add("Lens.<xmlattr>.Flip",         lensFlip);
+		ptCloud.add("Lens.<xmlattr>.K2",           lensK2);
+		ptCloud.add("Lens.<xmlattr>.K3",           lensK3);
+		ptCloud.add("Engine.<xmlattr>.Enable",     engineEnable);
+		ptCloud.add("Engine.<xmlattr>.Method",     engineMethod);
+		ptCloud.add("Engine.<xmlcomment>", "Method stars : star density");
+		ptCloud.add("Engine.<xmlcomment>", "Method background : background gradient");
+		ptCloud.add("Grid.<xmlattr>.AzStep",       gridAzStep);
+		ptCloud.add("Grid.<xmlattr>.ElStep",       gridElStep);
+		ptCloud.add("Grid.<xmlattr>.ElMin",        gridElMin);
+		ptCloud.add("Grade.<xmlattr>.Sigma",       gradeSigma);
+		ptCloud.add("Grade.<xmlattr>.StarDensity", gradeDensity);
+		ptCloud.add("Grade.<xmlattr>.Contrast",    gradeContrast);
+		ptCloud.add("Astrometry.<xmlattr>.Enable",  astroEnable);
+		ptCloud.add("Astrometry.<xmlattr>.Catalog", astroCatalog);
+		ptCloud.add("Photometry.<xmlattr>.Enable",  photoEnable);
+		ptCloud.add("Calibration.<xmlattr>.Enable",     calibEnable);
+		ptCloud.add("Calibration.<xmlattr>.DarkEvery",  calibDarkEvery);
+		ptCloud.add("Calibration.<xmlattr>.DarkFrames", calibDarkFrames);
+		ptCloud.add("Calibration.<xmlattr>.TempStep",   calibTempStep);
+		ptCloud.add("Calibration.<xmlattr>.HotSigma",   calibHotSigma);
+		ptCloud.add("Calibration.<xmlattr>.DarkDir",    calibDarkDir);
+		ptCloud.add("Preview.<xmlattr>.Enable",    previewEnable);
+		ptCloud.add("Preview.<xmlattr>.Bin",       previewBin);
+		ptCloud.add("Preview.<xmlattr>.Quality",   previewQuality);
+		ptCloud.add("Preview.<xmlattr>.Budget",    previewBudget);
+		ptCloud.add("Preview.<xmlattr>.TimeLapse", previewLapse);
+
+		if (!sensors.empty()) pt.add_child("Sensors", sensors);
 
 		xml_writer_settings<std::string> settings(' ', 4);
 		write_xml(filePath, pt, std::locale(), settings);
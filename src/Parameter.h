@@ -3,6 +3,8 @@
 #define _SRC_PARAMETER_H_
 
 #include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
 
 using std::string;
 
@@ -42,9 +44,18 @@ public:
 	int portPDU;		///< PDU端口
 	int portDevice;		///< 设备电源在PDU上的端口
 
+	/* 线程池 */
+	int poolThreads;	///< asio线程池的线程数量
+
 	/* 采样周期 */
 	int sampleCycle;	///< 采样周期, 秒. >= 10
 	string sampleDir;	///< 测量数据存储目录
+	struct LogSync {
+		string stream;	///< 数据流: Weather, SQM, Sensors, Camera
+		string mode;	///< 持久化策略: group, datasync, dsync
+		int period;		///< 同步周期, 秒
+	};
+	std::vector<LogSync> logSyncs;	///< 测量记录的持久化策略. 未配置的数据流: datasync, 60秒
 
 	/* 气象站 */
 	string portWeaStation;	///< 气象站串口名称
@@ -53,7 +64,14 @@ public:
 
 	/* SQM */
 	bool sqmEnable;		///< 启用SQM
-	string addrSQM;		///< SQM地址
+	string addrSQM;		///< SQM地址. 主设备
+	bool sqmDiscover;	///< 查找网段内的其它SQM
+	struct SQMAddr {
+		string name;	///< 名称
+		string addr;	///< IP地址
+		int port;		///< TCP端口
+	};
+	std::vector<SQMAddr> sqmUnits;	///< 其它SQM
 
 	/* 云量相机 */
 	string fileCloudAge;///< 云量分布交换文件
@@ -64,8 +82,63 @@ public:
 	int expdurMax;		///< 最大曝光时间, 秒
 	int saturation;		///< 饱和值
 	int coolerSet;		///< 制冷温度
-	int minDiskFree;	///< 最小可用磁盘空间, GB
+	int minDiskFree;	///< 最小可用磁盘空间, GB. 低于该值时删除历史数据
+	int targetDiskFree;	///< 删除历史数据直至可用空间恢复至该值, GB
+	int retainRaw;		///< 原始图像保留天数. <= 0: 仅受可用空间约束
+	int retainProduct;	///< 产品保留天数. <= 0: 仅受可用空间约束
+	int retainLog;		///< 日志保留天数. <= 0: 仅受可用空间约束
+	int cleanRate;		///< 删除速率上限, MB/秒. <= 0: 不限制
+	bool archiveEnable;	///< 启用分级存储: 将历史夜间目录打包为压缩归档
+	int archiveAfter;	///< 打包超过该天数的夜间目录
+	string archiveDir;	///< 归档目录. 空: 原始图像根目录
+	int retainArchive;	///< 归档保留天数. <= 0: 仅受可用空间约束
+	int archiveRate;	///< 打包读取速率上限, MB/秒. <= 0: 不限制
 	double fwhmPerfect;	///< 期望FWHM值
+	int focusStep;		///< 自动调焦初始搜索步长
+	int focusFrameMax;	///< 自动调焦帧数上限
+	double focusBadZone;	///< 像质评估: 成像圆内星像不足的网格比例上限. 超出时标记为像质差
+
+	/* 全天镜头 */
+	double lensX0;		///< 天顶像元X坐标. <= 0: 图像中心
+	double lensY0;		///< 天顶像元Y坐标. <= 0: 图像中心
+	double lensScale;	///< 等距投影比例, 像元/度. <= 0: 地平圈内切于图像
+	double lensRotation;///< 图像向上方向(行号减小)的方位角, 角度, 北零点
+	bool lensFlip;		///< 方位角沿图像逆时针增加. 仰视成像时东西镜像
+	double lensK2;		///< 径向畸变系数: r = scale * z * (1 + k2 * u + k3 * u^2), u = z / 90
+	double lensK3;		///< 径向畸变系数
+
+	/* 云量引擎 */
+	bool engineEnable;	///< 启用进程内云量引擎. 禁用时读取外部处理结果文件
+	string engineMethod;///< 分级方法. stars: 星像计数; background: 背景梯度
+	double gridAzStep;	///< 天区方位步长, 角度
+	double gridElStep;	///< 天区高度步长, 角度
+	double gridElMin;	///< 天区最低高度角, 角度
+	double gradeSigma;	///< 星像检测阈值, 背景噪声倍数
+	double gradeDensity;///< 晴夜星像密度初值, 颗/平方度, 归算至天顶
+	double gradeContrast;	///< 全云时背景亮度相对晴夜的自然对数差
+
+	/* 天文标定 */
+	bool astroEnable;	///< 由晴夜星像自动标定镜头模型
+	string astroCatalog;///< 亮星表文件. 空: 使用内置亮星表
+	bool photoEnable;	///< 由星表星流量测量天区消光, 使用同一星表
+
+	/* 本底改正 */
+	bool calibEnable;	///< 启用暗场扣除和热像元修补
+	int calibDarkEvery;	///< 每拍摄若干帧云图插入一帧暗场. 需要机械快门
+	int calibDarkFrames;///< 合成主暗场的暗场帧数
+	int calibTempStep;	///< 主暗场的温度档间隔, 摄氏度
+	double calibHotSigma;	///< 热像元阈值, 暗场噪声倍数
+	string calibDarkDir;///< 外部暗场目录: 启动时导入其中的FITS暗场. 空: 不导入
+
+	/* 预览 */
+	bool previewEnable;	///< 生成JPEG预览
+	int previewBin;		///< 预览合并因子: 2或4
+	int previewQuality;	///< JPEG质量, 1-100
+	int previewBudget;	///< 单帧CPU预算, 毫秒. <= 0: 不限制
+	bool previewLapse;	///< 生成夜间延时视频
+
+	/* 扩展传感器 */
+	boost::property_tree::ptree sensors;	///< <Sensors>节点, 由SensorRegistry实例化
 };
 
 #endif
@@ -0,0 +1,281 @@
+/**
+ * @file PreviewMaker.cpp 云图预览与夜间延时视频
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#ifdef ENABLE_PREVIEW
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <jpeglib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "PreviewMaker.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+
+/*
+ * 水平相邻像元对累加: acc[j] += row[2j] + row[2j+1]
+ */
+static void add_pairs(const uint16_t* row, uint32_t* acc, int n) {
+	int j(0);
+#if defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi32(0xFFFF);
+	for (; j + 4 <= n; j += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (row + 2 * j));
+		__m128i s = _mm_add_epi32(_mm_and_si128(v, mask), _mm_srli_epi32(v, 16));
+		_mm_storeu_si128((__m128i*) (acc + j), _mm_add_epi32(_mm_loadu_si128((const __m128i*) (acc + j)), s));
+	}
+#elif defined(__ARM_NEON)
+	for (; j + 4 <= n; j += 4) vst1q_u32(acc + j, vpadalq_u16(vld1q_u32(acc + j), vld1q_u16(row + 2 * j)));
+#endif
+	for (; j < n; ++j) acc[j] += uint32_t(row[2 * j]) + row[2 * j + 1];
+}
+
+/* libjpeg错误处理: 返回编码调用处, 避免默认处理退出进程 */
+struct JpegError {
+	struct jpeg_error_mgr mgr;
+	jmp_buf jmp;
+};
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+	char txt[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message)(cinfo, txt);
+	_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, txt);
+	longjmp(((JpegError*) cinfo->err)->jmp, 1);
+}
+
+PreviewMaker::PreviewMaker(const Parameter* param) {
+	param_   = param;
+	fpLapse_ = NULL;
+	bin_     = param->previewBin <= 2 ? 2 : 4;
+	credit_  = 0.0;
+	frames_  = skipped_ = 0;
+	msTotal_ = 0.0;
+	hasLevel_ = false;
+	black_ = white_ = 0.0;
+}
+
+PreviewMaker::~PreviewMaker() {
+	Stop();
+}
+
+bool PreviewMaker::Start(const std::string& dirNight) {
+	boost::filesystem::path pathPreview(param_->sampleDir);
+	pathPreview /= PREVIEW_FILE;
+	pathPreview_ = pathPreview.string();
+
+	if (param_->previewLapse) {
+		boost::filesystem::path pathLapse(dirNight);
+		pathLapse /= pathLapse.filename().string() + ".mjpeg";
+		pathLapse_ = pathLapse.string();
+		if (!(fpLapse_ = fopen(pathLapse_.c_str(), "ab"))) {
+			_gLog.Write(LOG_FAULT, "[%s:%s], failed to open [%s]", __FILE__, __FUNCTION__, pathLapse_.c_str());
+			return false;
+		}
+	}
+
+	credit_  = 0.0;
+	frames_  = skipped_ = 0;
+	msTotal_ = 0.0;
+	hasLevel_ = false;
+	queFrm_.Clear();
+	queFrm_.Statistic(true);
+	thrdPreview_.reset(new boost::thread(boost::bind(&PreviewMaker::thread_preview, this)));
+	return true;
+}
+
+void PreviewMaker::Stop() {
+	if (thrdPreview_.unique()) {
+		interrupt_thread(thrdPreview_);
+		BoundedQueueStat stat = queFrm_.Statistic(true);
+		_gLog.Write("Preview: frames = %d, skipped = %d, dropped = %llu, cost = %.0f ms",
+			frames_, skipped_, stat.dropped, frames_ ? msTotal_ / frames_ : 0.0);
+	}
+	if (fpLapse_) {
+		fclose(fpLapse_);
+		fpLapse_ = NULL;
+	}
+}
+
+bool PreviewMaker::Push(const CameraInfo* nfcam) {
+	if (nfcam->bitdepth <= 8 || nfcam->bitdepth > 16) return false;
+
+	PrvFrmPtr frame(new PreviewFrame);
+	frame->width   = nfcam->wSensor / bin_;
+	frame->height  = nfcam->hSensor / bin_;
+	frame->dateobs = nfcam->dateobs;
+	frame->expdur  = nfcam->expdur;
+	frame->data.resize(size_t(frame->width) * frame->height);
+	if (frame->data.empty()) return false;
+	Bin((const uint16_t*) nfcam->data.get(), nfcam->wSensor, nfcam->hSensor, bin_, &frame->data[0]);
+	queFrm_.Push(frame);
+	return true;
+}
+
+void PreviewMaker::Bin(const uint16_t* src, int width, int height, int bin, uint16_t* dst) {
+	int wOut = width / bin, hOut = height / bin, npair = wOut * bin / 2, x, y, r;
+	int half = bin * bin / 2, shift = bin == 2 ? 2 : 4;
+	std::vector<uint32_t> acc(npair);
+
+	for (y = 0; y < hOut; ++y, dst += wOut) {
+		std::fill(acc.begin(), acc.end(), 0);
+		for (r = 0; r < bin; ++r) add_pairs(src + size_t(y * bin + r) * width, &acc[0], npair);
+		if (bin == 2) {
+			for (x = 0; x < wOut; ++x) dst[x] = uint16_t((acc[x] + half) >> shift);
+		}
+		else {
+			for (x = 0; x < wOut; ++x) dst[x] = uint16_t((acc[2 * x] + acc[2 * x + 1] + half) >> shift);
+		}
+	}
+}
+
+void PreviewMaker::thread_preview() {
+	PrvFrmPtr frame;
+	double budget = param_->previewBudget;
+
+	while (true) {
+		queFrm_.Wait(frame);
+		boost::this_thread::interruption_point();
+		if (!frame) continue;
+		// 预算余额不超过单帧预算: 空闲期不积累
+		if (budget > 0.0) {
+			credit_ = std::min(credit_ + budget, budget);
+			if (credit_ < 0.0) {
+				++skipped_;
+				frame.reset();
+				continue;
+			}
+		}
+
+		ptime tm0 = microsec_clock::universal_time();
+		if (process(frame)) ++frames_;
+		double ms = (microsec_clock::universal_time() - tm0).total_microseconds() * 1E-3;
+		msTotal_ += ms;
+		credit_  -= ms;
+		frame.reset();
+	}
+}
+
+bool PreviewMaker::process(PrvFrmPtr frame) {
+	char comment[100];
+
+	stretch(frame.get());
+	snprintf(comment, sizeof(comment), "DATE-OBS=%s EXPTIME=%.3f",
+		to_iso_extended_string(frame->dateobs).c_str(), frame->expdur);
+	if (!encode(frame->width, frame->height, comment)) return false;
+
+	// 最新预览: 写入临时文件后替换
+	std::string pathTmp = pathPreview_ + ".tmp";
+	FILE* fp = fopen(pathTmp.c_str(), "wb");
+	bool ok = fp && fwrite(&jpeg_[0], 1, jpeg_.size(), fp) == jpeg_.size();
+	if (fp) ok = (fclose(fp) == 0) && ok;
+	if (ok) {
+		boost::system::error_code ec;
+		boost::filesystem::rename(pathTmp, pathPreview_, ec);
+		ok = !ec;
+	}
+	if (!ok) _gLog.Write(LOG_WARN, "[%s:%s], failed to write [%s]", __FILE__, __FUNCTION__, pathPreview_.c_str());
+
+	// 延时视频: 追加完整的JPEG帧
+	if (fpLapse_) {
+		if (fwrite(&jpeg_[0], 1, jpeg_.size(), fpLapse_) != jpeg_.size() || fflush(fpLapse_)) {
+			_gLog.Write(LOG_FAULT, "[%s:%s], failed to append [%s]", __FILE__, __FUNCTION__, pathLapse_.c_str());
+			fclose(fpLapse_);
+			fpLapse_ = NULL;
+		}
+	}
+	return ok;
+}
+
+void PreviewMaker::stretch(const PreviewFrame* frame) {
+	size_t n = frame->data.size(), k;
+	const uint16_t* data = &frame->data[0];
+	int lo(-1), hi(-1), i;
+
+	// 黑白电平: 直方图分位数
+	hist_.assign(65536, 0);
+	for (k = 0; k < n; ++k) ++hist_[data[k]];
+	uint64_t sum(0), qLo = uint64_t(n * PREVIEW_BLACK), qHi = uint64_t(n * PREVIEW_WHITE);
+	for (i = 0; i < 65536 && hi < 0; ++i) {
+		sum += hist_[i];
+		if (lo < 0 && sum > qLo) lo = i;
+		if (sum > qHi) hi = i;
+	}
+	if (hi < 0) hi = 65535;
+	if (!hasLevel_) {
+		black_ = lo;
+		white_ = hi;
+		hasLevel_ = true;
+	}
+	else {
+		black_ += PREVIEW_SMOOTH * (lo - black_);
+		white_ += PREVIEW_SMOOTH * (hi - white_);
+	}
+	lo = int(black_ + 0.5);
+	hi = std::max(int(white_ + 0.5), lo + 1);
+
+	// asinh拉伸查找表
+	double soft = PREVIEW_SOFT * (hi - lo);
+	double norm = 255.0 / asinh((hi - lo) / soft);
+	lut_.resize(hi - lo + 1);
+	for (i = lo; i <= hi; ++i) lut_[i - lo] = uint8_t(asinh((i - lo) / soft) * norm + 0.5);
+
+	gray_.resize(n);
+	const uint8_t* lut = &lut_[0];
+	for (k = 0; k < n; ++k) {
+		int v = data[k];
+		gray_[k] = v <= lo ? 0 : (v >= hi ? 255 : lut[v - lo]);
+	}
+}
+
+/*
+ * 压缩为JPEG. setjmp位于本函数: 输出缓冲区由调用者持有, 出错返回后仍然有效
+ */
+static bool jpeg_compress(j_compress_ptr cinfo, const uint8_t* gray, int width, int height, int quality,
+		const std::string& comment, unsigned char** buff, unsigned long* size) {
+	if (setjmp(((JpegError*) cinfo->err)->jmp)) return false;
+
+	jpeg_create_compress(cinfo);
+	jpeg_mem_dest(cinfo, buff, size);
+	cinfo->image_width  = width;
+	cinfo->image_height = height;
+	cinfo->input_components = 1;
+	cinfo->in_color_space   = JCS_GRAYSCALE;
+	jpeg_set_defaults(cinfo);
+	jpeg_set_quality(cinfo, quality, TRUE);
+	jpeg_start_compress(cinfo, TRUE);
+	jpeg_write_marker(cinfo, JPEG_COM, (const JOCTET*) comment.c_str(), comment.size());
+	while (cinfo->next_scanline < cinfo->image_height) {
+		JSAMPROW row = (JSAMPROW) gray + size_t(cinfo->next_scanline) * width;
+		jpeg_write_scanlines(cinfo, &row, 1);
+	}
+	jpeg_finish_compress(cinfo);
+	return true;
+}
+
+bool PreviewMaker::encode(int width, int height, const std::string& comment) {
+	struct jpeg_compress_struct cinfo;
+	JpegError jerr;
+	unsigned char* buff = NULL;
+	unsigned long size = 0;
+
+	cinfo.err = jpeg_std_error(&jerr.mgr);
+	jerr.mgr.error_exit = jpeg_error_exit;
+	bool rslt = jpeg_compress(&cinfo, &gray_[0], width, height, param_->previewQuality, comment, &buff, &size);
+	if (rslt) jpeg_.assign(buff, buff + size);
+	jpeg_destroy_compress(&cinfo);
+	free(buff);
+	return rslt;
+}
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @file PreviewMaker.h 云图预览与夜间延时视频
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 读出后直接由相机帧缓冲区合并像元(2x2或4x4, SSE2/NEON), 仅复制合并后的图像
+ * - 独立线程拉伸与编码: 按直方图分位数确定黑白电平, asinh拉伸为8位灰度, 编码为JPEG.
+ *   黑白电平逐帧平滑, 减少延时视频闪烁
+ * - 最新预览写入测量数据目录下的Preview.jpg; 各帧JPEG依次追加至当晚原始图像目录下的
+ *   MJPEG文件, 可由ffmpeg -f mjpeg读取. 只追加不改写, 异常退出不损坏已写入的帧
+ * - CPU预算: 每帧积累预算时间, 处理耗时从中扣除, 余额为负时跳过该帧.
+ *   处理慢于曝光时丢弃较早的帧
+ * - 依赖libjpeg: 构建时找到libjpeg才定义ENABLE_PREVIEW并编译本模块
+ */
+
+#ifndef PREVIEW_MAKER_H_
+#define PREVIEW_MAKER_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "BoostInclude.h"
+#include "BoundedQueue.h"
+#include "CameraBase.h"
+#include "Parameter.h"
+
+#define PREVIEW_FILE		"Preview.jpg"	///< 最新预览文件名
+#define PREVIEW_BLACK		0.005	///< 黑电平: 直方图分位数
+#define PREVIEW_WHITE		0.999	///< 白电平: 直方图分位数
+#define PREVIEW_SOFT		0.05	///< asinh拉伸的线性区宽度, 相对黑白电平差
+#define PREVIEW_SMOOTH		0.5		///< 黑白电平的逐帧平滑系数: 新值权重
+
+/**
+ * @brief 合并后的预览帧
+ */
+struct PreviewFrame {
+	int width, height;	///< 合并图像尺寸
+	ptime dateobs;		///< 曝光开始时间
+	double expdur;		///< 曝光时间, 秒
+	std::vector<uint16_t> data;	///< 合并图像: 像元均值
+};
+typedef boost::shared_ptr<PreviewFrame> PrvFrmPtr;
+
+class PreviewMaker {
+public:
+	typedef boost::shared_ptr<PreviewMaker> Pointer;
+
+public:
+	PreviewMaker(const Parameter* param);
+	~PreviewMaker();
+	static Pointer Create(const Parameter* param) {
+		return Pointer(new PreviewMaker(param));
+	}
+
+public:
+	/**
+	 * @brief 打开当晚的延时视频并启动处理线程
+	 * @param dirNight  当晚原始图像目录
+	 */
+	bool Start(const std::string& dirNight);
+	/**
+	 * @brief 停止处理线程并关闭延时视频
+	 */
+	void Stop();
+	/**
+	 * @brief 合并像元后提交预览帧
+	 * @return
+	 * 图像位宽不适用时返回false
+	 */
+	bool Push(const CameraInfo* nfcam);
+	/**
+	 * @brief 合并像元: 像元均值
+	 * @param src     原始图像
+	 * @param width   原始图像宽度
+	 * @param height  原始图像高度
+	 * @param bin     合并因子: 2或4
+	 * @param dst     合并图像. 尺寸: (width / bin) * (height / bin)
+	 */
+	static void Bin(const uint16_t* src, int width, int height, int bin, uint16_t* dst);
+
+protected:
+	/**
+	 * @brief 线程: 在CPU预算内处理预览帧
+	 */
+	void thread_preview();
+	/**
+	 * @brief 拉伸并编码单帧, 写入预览和延时视频
+	 */
+	bool process(PrvFrmPtr frame);
+	/**
+	 * @brief 按直方图分位数和asinh函数拉伸为8位灰度
+	 */
+	void stretch(const PreviewFrame* frame);
+	/**
+	 * @brief 将灰度图像编码为JPEG
+	 * @param comment  写入JPEG注释段的文本
+	 */
+	bool encode(int width, int height, const std::string& comment);
+
+protected:
+	const Parameter* param_;	///< 配置参数
+	BoundedQueue<PrvFrmPtr> queFrm_;	///< 待处理帧. 有界, 总是处理最新的帧
+	ThrdPtr thrdPreview_;		///< 线程: 拉伸与编码
+	std::string pathPreview_;	///< 最新预览文件路径
+	std::string pathLapse_;		///< 延时视频文件路径
+	FILE* fpLapse_;				///< 延时视频文件
+	int bin_;			///< 合并因子
+
+	/* CPU预算 */
+	double credit_;		///< 预算余额, 毫秒
+	int frames_;		///< 已处理帧数
+	int skipped_;		///< 超出预算跳过的帧数
+	double msTotal_;	///< 累计处理耗时, 毫秒
+
+	/* 拉伸与编码. 重复使用 */
+	bool hasLevel_;		///< 已有黑白电平
+	double black_, white_;	///< 平滑后的黑白电平
+	std::vector<uint32_t> hist_;	///< 直方图
+	std::vector<uint8_t> lut_;		///< 拉伸查找表: 黑电平至白电平
+	std::vector<uint8_t> gray_;		///< 8位灰度图像
+	std::vector<uint8_t> jpeg_;		///< JPEG编码结果
+};
+typedef PreviewMaker::Pointer PreviewPtr;
+
+#endif
@@ -7,9 +7,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/format.hpp>
 #include "ReadCloudage.h"
 #include "GLog.h"
+#include "SampleBus.h"
 
 using namespace boost;
 using namespace boost::filesystem;
@@ -18,45 +18,80 @@ using namespace boost::posix_time;
 typedef std::vector<string> strvec;
 
 ReadCloudage::ReadCloudage() {
+    oldTime_ = 0;
+    ellapsed_ = 0;
+    update_ = false;
+    idScan_ = 0;
 }
 
 ReadCloudage::~ReadCloudage() {
-    interrupt_thread(thrdMain_);
+    _gSched.Cancel(idScan_);
+    keep_.Stop();
 }
 
 void ReadCloudage::Start(const Parameter* param) {
-    param_ = param;
-    thrdMain_.reset(new boost::thread(boost::bind(&ReadCloudage::run, this)));
+    path pathFile(param->sampleDir);
+    pathFile /= param->fileCloudAge;
+    param_    = param;
+    pathFile_ = pathFile.string();
+    treeLog_  = _gDated.Tree((path(param->sampleDir) / "CloudAge").string(), DATED_YEAR | DATED_DAY, "CA");
+
+    if (param->engineEnable) {
+        info_.state = WMCA_NO_DATA;
+        idScan_ = _gSched.Every(keep_, "cloudage watch", 1000, boost::bind(&ReadCloudage::watch, this));
+    }
+    else idScan_ = _gSched.Every(keep_, "cloudage scan", 1000, boost::bind(&ReadCloudage::scan, this));
 }
 
-void ReadCloudage::run() {
-    boost::chrono::seconds period(1);
-    path pathFile(param_->sampleDir);
-    pathFile /= param_->fileCloudAge;
-    std::time_t lastTime(0), oldTime(0);
-    int ellapsed(0);
-    bool update(false);
+void ReadCloudage::Submit(const InfoCloudage& info) {
+    keep_.Post(boost::bind(&ReadCloudage::accept, this, info));
+}
 
-    while (1) {
-        boost::this_thread::sleep_for(period);
+void ReadCloudage::scan() {
+    try {
+        path pathFile(pathFile_);
+        std::time_t lastTime;
 
         if (!exists(pathFile)) {// 无文件
             info_.state = WMCA_NO_DATA;
         }
-        else if ((lastTime = last_write_time(pathFile)) != oldTime) {// 初次读文件或文件已更新
-            oldTime = lastTime;
-            update = true;
+        else if ((lastTime = last_write_time(pathFile)) != oldTime_) {// 初次读文件或文件已更新
+            oldTime_ = lastTime;
+            update_ = true;
         }
-        else if (update) {// 解析文件
-            update = false;
-            ellapsed = 0;
+        else if (update_) {// 解析文件
+            update_ = false;
+            ellapsed_ = 0;
             info_.state = WMCA_SUCCESS;
-            if (resolve_file(pathFile.c_str())) save_log();
+            if (resolve_file(pathFile_.c_str())) {
+                annotate();
+                save_log();
+            }
         }
-        else if (++ellapsed > 300 && info_.state != WMCA_TOO_OLD) {// 5分钟文件未更新
+        else if (++ellapsed_ > 300 && info_.state != WMCA_TOO_OLD) {// 5分钟文件未更新
             info_.state = WMCA_TOO_OLD;
         }
     }
+    catch(filesystem_error& ex) {
+        _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+    }
+}
+
+void ReadCloudage::watch() {
+    if (++ellapsed_ > 300 && info_.state != WMCA_TOO_OLD) {// 5分钟无结果
+        info_.state = WMCA_TOO_OLD;
+    }
+}
+
+void ReadCloudage::accept(const InfoCloudage& info) {
+    ellapsed_ = 0;
+    info_ = info;
+    if (info_.zones.empty()) {// 无有效天区
+        info_.state = WMCA_NO_DATA;
+        return;
+    }
+    annotate();
+    save_log();
 }
 
 bool ReadCloudage::resolve_file(const char* filePath) {
@@ -101,11 +136,32 @@ bool ReadCloudage::resolve_file(const char* filePath) {
 	std::stable_sort(info_.zones.begin(), info_.zones.end(), [](const CloudAge& x1, const CloudAge& x2) {
 		return (get<1>(x1) > get<1>(x2) || (get<1>(x1) == get<1>(x2) && get<0>(x1) <= get<0>(x2)));
 	});
+    if (info_.zones.empty()) info_.state = WMCA_NO_DATA;
 
     return (info_.state == 0 && info_.azStep < __FLT_MAX__ && info_.elStep < __FLT_MAX__);
 }
 
-const char* ReadCloudage::log_filepath() {
+void ReadCloudage::annotate() {
+    try {
+        ptime utc = from_iso_extended_string(info_.utc);
+        bool hasSite = info_.siteLon < __DBL_MAX__ && info_.siteLat < __DBL_MAX__ && info_.siteAlt < __DBL_MAX__;
+        double mpsas = SKY_INVALID;
+        Sample sample;
+        // SQM测量值与云量分布相差10分钟内时用于校准
+        if (_gSamples.Latest("sqm", "mpsas", sample) && sample.state == SAMPLE_OK
+                && (utc - sample.utc).abs() <= minutes(10))
+            mpsas = sample.value;
+        annotator_.Annotate(hasSite ? info_.siteLon : param_->siteLon,
+            hasSite ? info_.siteLat : param_->siteLat,
+            hasSite ? info_.siteAlt : param_->siteAlt,
+            utc, info_.zones, mpsas, info_.sky);
+    }
+    catch(...) {
+        _gLog.Write(LOG_FAULT, "[%s:%s], wrong time style[%s]", __FILE__, __FUNCTION__, info_.utc.c_str());
+    }
+}
+
+string ReadCloudage::log_filepath() {
     try {
         // 文件路径
         // <root>
@@ -115,33 +171,7 @@ const char* ReadCloudage::log_filepath() {
         //                                          CA<year><month><day>T<hour><minute><second>.json
         //
         ptime utc = from_iso_extended_string(info_.utc);
-        ptime::date_type day = utc.date();
-        ptime::time_duration_type tdt = utc.time_of_day();
-        static path pathName;
-        pathName = param_->sampleDir;
-        pathName /= "CloudAge";
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("Y%d") % day.year()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("CA%d%02d%02d") % day.year() % day.month().as_number() % day.day()).str();
-        if (!exists(pathName)) {
-            create_directory(pathName);
-            permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-        }
-        pathName /= (boost::format("CA%d%02d%02dT%02d%02d%02d.json")
-            % day.year() % day.month().as_number() % day.day()
-            % tdt.hours() % tdt.minutes() % tdt.seconds()).str();
-
-        return pathName.c_str();
-    }
-    catch(filesystem_error& ex) {
-        _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+        return treeLog_->File(utc, "CA", "T", ".json");
     }
     catch(...) {
         _gLog.Write(LOG_FAULT, "[%s:%s], wrong time style[%s]", __FILE__, __FUNCTION__, info_.utc.c_str());
@@ -166,6 +196,21 @@ void ReadCloudage::save_log() {
         }
         pt.add("Step.Azimuth",    info_.azStep);
         pt.add("Step.Elevation",  info_.elStep);
+        CloudSky& sky = info_.sky;
+        if (sky.valid) {
+            pt.add("Sky.SunAltitude",  sky.sunAlt);
+            pt.add("Sky.MoonAltitude", sky.moonAlt);
+            pt.add("Sky.MoonAzimuth",  sky.moonAzi);
+            pt.add("Sky.MoonIllumination", sky.moonIllum);
+            pt.add("Sky.ZenithMag",    sky.zenithMag);
+            pt.add("Sky.Calibrated",   sky.calibrated);
+        }
+        CloudPhot& phot = info_.phot;
+        if (phot.valid) {
+            pt.add("Photometry.ZeroPoint", phot.zeroPoint);
+            pt.add("Photometry.Stars",     phot.stars);
+            pt.add("Photometry.Detected",  phot.detected);
+        }
         CloudAgeSet& zones = info_.zones;
         int n = (int) zones.size();
         for (int i = 0; i < n; ++i) {
@@ -173,6 +218,25 @@ void ReadCloudage::save_log() {
             ptZone.add("azi",   std::get<0>(zones[i]));
             ptZone.add("ele",   std::get<1>(zones[i]));
             ptZone.add("level", std::get<2>(zones[i]));
+            if (sky.valid) {
+                ptZone.add("airmass", sky.zones[i].airmass);
+                ptZone.add("moon",    sky.zones[i].moonDist);
+                ptZone.add("sky",     sky.zones[i].skyMag);
+            }
+            if (phot.valid) {
+                ptZone.add("stars",      phot.zones[i].stars);
+                ptZone.add("extinction", phot.zones[i].extinction);
+            }
+        }
+        // 样本总线中的全部通道: 与云量分布同时刻的传感器读数
+        SampleVec samples = _gSamples.Snapshot();
+        for (SampleVec::iterator it = samples.begin(); it != samples.end(); ++it) {
+            boost::property_tree::ptree& ptSample = pt.add("Sensors", "");
+            ptSample.add("name",  it->Key());
+            ptSample.add("state", it->state);
+            ptSample.add("utc",   to_iso_extended_string(it->utc));
+            ptSample.add("value", it->value);
+            ptSample.add("unit",  it->unit);
         }
         boost::property_tree::write_json(pathName, pt);
     }
@@ -13,10 +13,10 @@
 #include <tuple>
 #include <vector>
 #include "BoostInclude.h"
+#include "Scheduler.h"
 #include "Parameter.h"
-
-typedef std::tuple<float, float, int> CloudAge;
-typedef std::vector<CloudAge> CloudAgeSet;
+#include "ZoneAnnotator.h"
+#include "DatedPath.h"
 
 enum {
 	WMCA_SUCCESS,	///< 正确
@@ -34,6 +34,8 @@ struct InfoCloudage {
     float azStep;      ///< 方位步长
     float elStep;      ///< 高度步长
     CloudAgeSet zones; ///< 全天云量分布
+    CloudSky sky;      ///< 天区标注: 与zones一一对应. 每幅云量分布计算一次
+    CloudPhot phot;    ///< 测光透明度: 与zones一一对应. 仅云量引擎生成
 
 public:
     InfoCloudage() = default;
@@ -41,6 +43,8 @@ public:
         siteLon = siteLat = siteAlt = __DBL_MAX__;
         azStep = elStep = __FLT_MAX__;
         zones.clear();
+        sky.Reset();
+        phot.Reset();
     }
 };
 
@@ -64,26 +68,46 @@ public:
     const InfoCloudage* GetInfo() {
         return &info_;
     }
+    /**
+     * @brief 提交进程内云量引擎生成的云量分布
+     * @note
+     * - 与交换文件的解析结果同样标注并写入日志
+     * - 启用云量引擎时不再扫描交换文件
+     */
+    void Submit(const InfoCloudage& info);
 
 protected:
     /**
-     * @brief 线程: 扫描数据处理结果, 生成全天云量分布
+     * @brief 调度任务: 每秒扫描数据处理结果, 生成全天云量分布
+     */
+    void scan();
+    /**
+     * @brief 调度任务: 每秒检查云量引擎的结果是否过期
      */
-    void run();
+    void watch();
+    /**
+     * @brief 接收云量引擎的结果
+     */
+    void accept(const InfoCloudage& info);
     /**
      * @brief 从数据处理结果文件中读取/解析云量分布
      * @param filePath 交换文件路径
      * @return 文件读取/解析结果
      */
     bool resolve_file(const char* filePath);
+    /**
+     * @brief 标注云量分布: 大气质量、月距和天光背景亮度
+     * @note
+     * - 天顶亮度以主SQM的最新测量值校准
+     */
+    void annotate();
     /**
      * @brief 获取日志文件路径
      * @return 日志文件路径
      * @note
-     * - 创建文件目录
-     * - 获取文件路径
+     * 日期目录由DatedPath创建并缓存
      */
-    const char* log_filepath();
+    string log_filepath();
     /**
      * @brief 将单帧图像处理结果以JSON格式写入日志文件
      */
@@ -92,7 +116,14 @@ protected:
 private:
 	const Parameter* param_; ///< 配置参数
     InfoCloudage info_;     ///< 云量分布信息
-    ThrdPtr thrdMain_;      ///< 线程指针
+    string pathFile_;       ///< 交换文件路径
+    DatedTreePtr treeLog_;  ///< 日志目录: CloudAge/Y<year>/CA<date>
+    std::time_t oldTime_;   ///< 交换文件的最后修改时间
+    int ellapsed_;          ///< 交换文件未更新的时长, 秒
+    bool update_;           ///< 交换文件已更新, 待解析
+    BoostAsioKeep keep_;    ///< 线程池句柄
+    int idScan_;            ///< 调度任务: 扫描交换文件
+    ZoneAnnotator annotator_;   ///< 天区标注
 };
 
 typedef ReadCloudage::Pointer ReadCloudagePtr;
@@ -1,4 +1,6 @@
 
+#include <string.h>
+#include <stdlib.h>
 #include <boost/system/system_error.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
@@ -6,216 +8,295 @@
 #include <boost/bind/bind.hpp>
 #include <boost/bind/placeholders.hpp>
 #include <boost/asio/placeholders.hpp>
-#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
 #include "SQM.h"
+#include "SampleBus.h"
 #include "GLog.h"
 
 using namespace boost::system;
 using namespace boost::filesystem;
 using namespace boost::asio;
 using namespace boost::posix_time;
+using namespace boost::placeholders;
 
-SQMUnitVec SQM::units_;
-boost::condition_variable SQM::cvFound_;
-
-SQM::SQM(const char* ip, const char* dirName)
-    : portDev_(10001) {
+SQM::SQM(const SQMUnit& unit, const char* dirName) {
     if (dirName) dirRoot_ = dirName;
-    ipDev_ = ip;
-    cntRsp_= 0;
-    fpLog_ = NULL;
+    unit_ = unit;
+    if (unit_.name.empty()) unit_.name = "sqm";
+    treeLog_ = _gDated.Tree((path(dirRoot_) / "SQM").string(), DATED_YEAR);
+    oldDay_ = 0;
+    cycle_  = 0;
+    inflight_ = 0;
+    backoff_  = 1;
+    wait_     = 0;
+    connecting_ = connected_ = false;
+    idCycle_  = 0;
+    info_.state = SQM_FAIL_CONNECT;
+    info_.mpsas = info_.temperature = 0.0;
 }
 
 SQM::~SQM() {
-    interrupt_thread(thrdCycle_);
+    _gSched.Cancel(idCycle_);
+    keep_.Stop();
     tcpClient_.reset();
-    if (fpLog_) {
-        fclose(fpLog_);
-        fpLog_ = NULL;
-    }
-    _gLog.Write("SQM: stopped");
-}
-
-void SQM::handle_found(const boost::system::error_code& ec, const int bytes) {
-    if (!ec && bytes >= 30) cvFound_.notify_one();
-}
-
-int SQM::Find() {
-    try {
-        boost::chrono::seconds toWait(1);
-        units_.clear();
-        // 建立UDP套接口
-        BoostAsioKeep keep;
-        ip::udp::socket sock(keep.GetIOService());
-        sock.open(ip::udp::v4());
-        sock.set_option(socket_base::broadcast(true));
-        // 构建并发送信息
-        ip::udp::endpoint broadcast(ip::address::from_string("255.255.255.255"), 30718);
-        unsigned char query[] = {0, 0, 0, 0xF6};
-        sock.send_to(buffer(query), broadcast);
-        // 监测反馈信息
-        boost::mutex mtx;
-        MtxLck lck(mtx);
-        unsigned char rcvd[100];
-        char mac[20];
-        ip::udp::endpoint remote;
-
-        while (1) {
-            sock.async_receive_from(buffer(rcvd), remote,
-                bind(&SQM::handle_found, placeholders::error, placeholders::bytes_transferred));
-            if (cvFound_.wait_for(lck, toWait) == boost::cv_status::timeout) break;
-
-            if (rcvd[0] == 0 && rcvd[1] == 0 && rcvd[2] == 0 && rcvd[3] == 0xF7) {
-                SQMUnit unit;
-                int n(0);
-                for (int i = 24; i <= 29; ++i) n += sprintf(mac + n, "%02X:", rcvd[i]);
-                mac[n - 1] = 0;
-                unit.ip = remote.address().to_string();
-                unit.mac= mac;
-                units_.push_back(unit);
-                _gLog.Write("SQM: found [%s,  %s]", unit.ip.c_str(), unit.mac.c_str());
-            }
-        }
-        // 释放套接口
-        sock.close();
-        // 返回找到的设备数量
-        return units_.size();
-    }
-    catch(system_error& ex) {
-		_gLog.Write(LOG_WARN, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
-    }
-
-    return 0;
-}
-
-bool SQM::GetAddress(int index, string& ip, string& mac) {
-    if (index >= 0 && index < units_.size()) {
-        ip = units_[index].ip;
-        mac= units_[index].mac;
-        return true;
-    }
-    return false;
+    logFile_.Close();
+    _gLog.Write("SQM<%s>: stopped", unit_.name.c_str());
 }
 
 bool SQM::Start(int cycle) {
-    thrdCycle_.reset(new boost::thread(boost::bind(&SQM::run, this, cycle)));
+    cycle_ = cycle;
+    idCycle_ = _gSched.Every(keep_, unit_.name.c_str(), cycle * 1000, boost::bind(&SQM::cycle, this));
 
     return true;
 }
 
 bool SQM::IsConnected() {
-    return (tcpClient_.unique() && tcpClient_->IsOpen());
-}
-
-void SQM::run(int cycle) {
-    boost::chrono::seconds toWait(cycle);
-    char query[] = "rx";
-    int cntQry(0);
-
-    info_.state = 0;
-    while (1) {
-        if (!tcpClient_.unique()) {// 尝试连接
-            tcpClient_ = TcpClient::Create();
-            const TcpClient::CBSlot& slot = boost::bind(&SQM::handle_receive, this, boost::placeholders::_1, boost::placeholders::_2);
-            tcpClient_->RegisterRead(slot);
-            if (!tcpClient_->Connect(ipDev_.c_str(), portDev_)) {
-                tcpClient_.reset();
-                info_.state = SQM_FAIL_CONNECT;
-                _gLog.Write(LOG_FAULT, "[%s:%d], failed to connect SQM[%s:%u]",
-                    __FILE__, __LINE__, ipDev_.c_str(), portDev_);
-            }
-            else {
-                info_.state = SQM_SUCCESS;
-                info_.utc   = to_iso_extended_string(second_clock::universal_time());
-                info_.mpsas = 0.0;
-                oldDay_     = 0;
-                cntQry = cntRsp_ = 0;
-
-                _gLog.Write("SQM: starts working...");
-            }
+    return connected_;
+}
+
+void SQM::cycle() {
+    if (connecting_) return;
+    if (!tcpClient_) {// 尝试连接
+        if (wait_ > 0) {
+            --wait_;
+            return;
         }
-        if (tcpClient_.unique()) {
-            if ((cntQry - cntRsp_) > 5) {
-                info_.state = SQM_NO_DATA;
-                _gLog.Write(LOG_WARN, "SQM: long time no data response");
-            }
-
-            if (info_.state != SQM_SUCCESS) {
-                tcpClient_->Close();
-                tcpClient_.reset();
-            }
-            else {// 发送查询指令
-                ++cntQry;
-                tcpClient_->Write(query, sizeof(query));
-            }
+        tcpClient_ = TcpClient::Create();
+        const TcpClient::CBSlot& slotConn = boost::bind(&SQM::handle_connect, this, _1, _2);
+        const TcpClient::CBSlot& slotRead = boost::bind(&SQM::handle_receive, this, _1, _2);
+        const TcpClient::MsgSlot& slotMsg = boost::bind(&SQM::handle_message, this, _1, _2, _3);
+        tcpClient_->RegisterConnect(slotConn);
+        tcpClient_->RegisterRead(slotRead);
+        tcpClient_->RegisterMessage(slotMsg);
+        tcpClient_->SetDelimFrame("\n", 1, SQM_LINE_SIZE);
+        connecting_ = true;
+        if (!tcpClient_->Connect(unit_.ip.c_str(), unit_.port)) {
+            _gLog.Write(LOG_FAULT, "[%s:%d], failed to connect SQM<%s>[%s:%u]",
+                __FILE__, __LINE__, unit_.name.c_str(), unit_.ip.c_str(), unit_.port);
+            disconnect(SQM_FAIL_CONNECT);
         }
-        boost::this_thread::sleep_for(toWait);
     }
+    else if (inflight_ >= SQM_MAX_INFLIGHT) {
+        _gLog.Write(LOG_WARN, "SQM<%s>: long time no data response", unit_.name.c_str());
+        disconnect(SQM_NO_DATA);
+    }
+    else {// 发送查询指令, 不等待前次反馈
+        ++inflight_;
+        tcpClient_->Write("rx", 2);
+    }
+}
+
+void SQM::disconnect(int state) {
+    info_.state = state;
+    connecting_ = connected_ = false;
+    inflight_   = 0;
+    tcpClient_.reset();
+    // 指数退避
+    wait_ = backoff_;
+    if ((backoff_ *= 2) > SQM_MAX_BACKOFF) backoff_ = SQM_MAX_BACKOFF;
+}
+
+void SQM::handle_connect(TcpClient* client, const boost::system::error_code ec) {
+    keep_.Post(boost::bind(&SQM::on_connect, this, client, ec.value()));
 }
 
 void SQM::handle_receive(TcpClient* client, const boost::system::error_code ec) {
-    static char buff[64];
-    static char mpsas[8];
-    if (!ec && client->Read(buff, 57) == 57 && buff[0] == 'r') {
-        ptime tmNow = second_clock::universal_time();
-        memcpy(mpsas, buff + 2, 6);
-        buff[57] = 0;
-        mpsas[6] = 0;
-        info_.utc   = to_iso_extended_string(tmNow);
-        info_.mpsas = float(atof(mpsas));
-
-        ++cntRsp_;
+    if (ec) keep_.Post(boost::bind(&SQM::on_closed, this, client));
+}
+
+void SQM::handle_message(TcpClient* client, const char* data, size_t len) {
+    if (len < 8 || len >= SQM_LINE_SIZE || data[0] != 'r') return;
+
+    char line[SQM_LINE_SIZE];
+    const char* ptr;
+    float mpsas, temperature(0.0);
+    memcpy(line, data, len);
+    line[len] = 0;
+    mpsas = float(atof(line + 2));
+    if ((ptr = strrchr(line, ',')) != NULL) temperature = float(atof(ptr + 1));
 #ifdef NDEBUG
-        _gLog.Write("SQM: %s => %6.2f", buff, info_.mpsas);
+    _gLog.Write("SQM<%s>: %s => %6.2f", unit_.name.c_str(), line, mpsas);
 #endif
+    keep_.Post(boost::bind(&SQM::on_reading, this, client, mpsas, temperature));
+}
 
-        // 写入文件
-        ptime::date_type today = tmNow.date();
-        if (open_file(today.year(), today.month().as_number(), today.day())) {
-            fprintf(fpLog_, "%s  %6.2f\n", info_.utc.c_str(), info_.mpsas);
-            fflush(fpLog_);
-        }
+void SQM::on_connect(TcpClient* client, int ec) {
+    if (client != tcpClient_.get()) return; // 已断开
+    connecting_ = false;
+    if (ec) {
+        _gLog.Write(LOG_FAULT, "[%s:%d], failed to connect SQM<%s>[%s:%u], retry after %d cycles",
+            __FILE__, __LINE__, unit_.name.c_str(), unit_.ip.c_str(), unit_.port, backoff_);
+        disconnect(SQM_FAIL_CONNECT);
     }
     else {
-        info_.state = SQM_CLOSED;
-        _gLog.Write(LOG_WARN, "SQM: remote closed");
+        info_.state = SQM_SUCCESS;
+        connected_  = true;
+        _gLog.Write("SQM<%s>: connected to [%s:%u]", unit_.name.c_str(), unit_.ip.c_str(), unit_.port);
+        ++inflight_;
+        tcpClient_->Write("rx", 2);
+    }
+}
+
+void SQM::on_closed(TcpClient* client) {
+    if (client != tcpClient_.get()) return; // 已断开
+    _gLog.Write(LOG_WARN, "SQM<%s>: remote closed", unit_.name.c_str());
+    disconnect(SQM_CLOSED);
+}
+
+void SQM::on_reading(TcpClient* client, float mpsas, float temperature) {
+    if (client != tcpClient_.get()) return; // 已断开
+
+    ptime tmNow = second_clock::universal_time();
+    info_.state = SQM_SUCCESS;
+    info_.utc   = to_iso_extended_string(tmNow);
+    info_.mpsas = mpsas;
+    info_.temperature = temperature;
+    if (inflight_ > 0) --inflight_;
+    backoff_ = 1;
+
+    {// 发布到样本总线
+        SampleVec samples(2);
+        samples[0].channel = "mpsas";
+        samples[0].unit    = "mag/arcsec2";
+        samples[0].value   = info_.mpsas;
+        samples[1].channel = "temperature";
+        samples[1].unit    = "C";
+        samples[1].value   = info_.temperature;
+        for (int i = 0; i < 2; ++i) {
+            samples[i].sensor = unit_.name;
+            samples[i].state  = SAMPLE_OK;
+            samples[i].utc    = tmNow;
+        }
+        _gSamples.Publish(samples);
+    }
+
+    // 写入文件
+    ptime::date_type today = tmNow.date();
+    if (open_file(today.year(), today.month().as_number(), today.day())) {
+        logFile_.Write("%s  %6.2f\n", info_.utc.c_str(), info_.mpsas);
     }
 }
 
 bool SQM::open_file(int year, int month, int day) {
     if (oldDay_ != day) {
-        if (fpLog_) {
-            fclose(fpLog_);
-            fpLog_ = NULL;
-        }
+        logFile_.Close();
 
-        try {
-            // 创建目录
-            path pathName(dirRoot_);
-            pathName /= (boost::format("SQM").str());
-            if (!exists(pathName)) {
-                create_directory(pathName);
-                permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-            }
-            pathName /= (boost::format("Y%d") % year).str();
-            if (!exists(pathName)) {
-                create_directory(pathName);
-                permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-            }
-            // 打开文件
-            boost::format fmtFile("SQM_%d%02d%02d.log");
-            pathName /= (fmtFile % year % month % day).str();
-            _gLog.Write("SQM File = %s", pathName.c_str());
-            fpLog_ = fopen(pathName.c_str(), "a+");
-
-            // 保存日期
-            oldDay_ = day;
-        }
-        catch(filesystem_error& ex) {
-            _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
-            return false;
-        }
+        // 打开文件
+        string prefix = boost::to_upper_copy(unit_.name) + "_";
+        string pathName = treeLog_->File(boost::gregorian::date(year, month, day), prefix.c_str(), ".log");
+        if (pathName.empty()) return false;
+        _gLog.Write("SQM<%s> File = %s", unit_.name.c_str(), pathName.c_str());
+        logFile_.Open(pathName, "SQM");
+
+        // 保存日期
+        oldDay_ = day;
+    }
+
+    return logFile_.IsOpen();
+}
+
+/////////////////////////////////////////////////////////////////////
+SQMManager::SQMManager(const char* dirName)
+    : sock_(keep_.GetIOService()), tmrFind_(keep_.GetIOService()) {
+    if (dirName) dirRoot_ = dirName;
+    cycle_ = 0;
+}
+
+SQMManager::~SQMManager() {
+    Stop();
+}
+
+bool SQMManager::Start(int cycle, const SQMUnitVec& units) {
+    cycle_ = cycle;
+    keep_.Reset();
+    for (SQMUnitVec::const_iterator it = units.begin(); it != units.end(); ++it) add_unit(*it);
+    return true;
+}
+
+void SQMManager::Stop() {
+    boost::system::error_code ec;
+    SQMVec units;
+
+    keep_.Stop();
+    tmrFind_.cancel(ec);
+    sock_.close(ec);
+    {
+        MtxLck lck(mtxUnits_);
+        units.swap(units_);
+    }
+}
+
+void SQMManager::Discover(int waitMs) {
+    keep_.Post(boost::bind(&SQMManager::find, this, waitMs));
+}
+
+SQMPtr SQMManager::Primary() {
+    MtxLck lck(mtxUnits_);
+    return units_.empty() ? SQMPtr() : units_[0];
+}
+
+SQMVec SQMManager::Units() {
+    MtxLck lck(mtxUnits_);
+    return units_;
+}
+
+void SQMManager::add_unit(const SQMUnit& unit) {
+    MtxLck lck(mtxUnits_);
+    for (SQMVec::iterator it = units_.begin(); it != units_.end(); ++it) {
+        if ((*it)->GetUnit().ip == unit.ip) return;
+    }
+    SQMPtr sqm = SQM::Create(unit, dirRoot_.c_str());
+    sqm->Start(cycle_);
+    units_.push_back(sqm);
+}
+
+void SQMManager::find(int waitMs) {
+    if (sock_.is_open()) return; // 正在查找
+
+    boost::system::error_code ec;
+    unsigned char query[] = {0, 0, 0, 0xF6};
+    sock_.open(ip::udp::v4(), ec);
+    if (!ec) sock_.set_option(socket_base::broadcast(true), ec);
+    if (!ec) sock_.send_to(buffer(query), ip::udp::endpoint(ip::address_v4::broadcast(), 30718), 0, ec);
+    if (ec) {
+        _gLog.Write(LOG_WARN, "[%s:%s], %s", __FILE__, __FUNCTION__, ec.message().c_str());
+        sock_.close(ec);
+        return;
     }
 
-    return fpLog_ != NULL;
+    start_receive();
+    tmrFind_.expires_after(boost::asio::chrono::milliseconds(waitMs));
+    tmrFind_.async_wait(keep_.Wrap(boost::bind(&SQMManager::on_find_end, this, placeholders::error)));
+}
+
+void SQMManager::start_receive() {
+    sock_.async_receive_from(buffer(rcvd_), remote_,
+        keep_.Wrap(boost::bind(&SQMManager::on_found, this, placeholders::error, placeholders::bytes_transferred)));
+}
+
+void SQMManager::on_found(const boost::system::error_code& ec, size_t bytes) {
+    if (ec) return; // 查找结束
+
+    if (bytes >= 30 && rcvd_[0] == 0 && rcvd_[1] == 0 && rcvd_[2] == 0 && rcvd_[3] == 0xF7) {
+        SQMUnit unit;
+        char mac[20], name[20];
+        int n(0);
+        for (int i = 24; i <= 29; ++i) n += sprintf(mac + n, "%02X:", rcvd_[i]);
+        mac[n - 1] = 0;
+        sprintf(name, "sqm-%02x%02x%02x", rcvd_[27], rcvd_[28], rcvd_[29]);
+        unit.name = name;
+        unit.ip   = remote_.address().to_string();
+        unit.mac  = mac;
+        _gLog.Write("SQM: found [%s,  %s]", unit.ip.c_str(), unit.mac.c_str());
+        add_unit(unit);
+    }
+    start_receive();
+}
+
+void SQMManager::on_find_end(const boost::system::error_code& ec) {
+    if (ec) return;
+
+    boost::system::error_code ec1;
+    sock_.close(ec1);
+    _gLog.Write("SQM: discovery finished, %d units in service", int(Units().size()));
 }
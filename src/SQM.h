@@ -20,6 +20,11 @@
  *      亮度     传感器频率     传感器周期1   传感器周期2    温度
  *   r, 06.70m,0000022921Hz,0000000020c,0000000.000s, 039.4C
  *   r,±xx.xxm,xxxxxxxxxxHz,xxxxxxxxxxx,xxxxxxx.xxxs,±xxx.xC
+ *
+ * @version 1.0
+ * @date 2026-10-18
+ * - SQMManager: 异步查找, 同时访问多台SQM
+ * - 保持TCP连接, 查询流水线, 断线后指数退避重连
  */
 
 #ifndef _SRC_SQM_H_
@@ -27,11 +32,20 @@
 
 #include <string>
 #include <vector>
+#include <boost/asio/ip/udp.hpp>
 #include "BoostInclude.h"
 #include "AsioTCP.h"
+#include "Scheduler.h"
+#include "DatedPath.h"
+#include "AppendLog.h"
 
 using std::string;
 
+#define SQM_PORT            10001   ///< TCP端口
+#define SQM_MAX_INFLIGHT    3       ///< 最大未反馈查询数量
+#define SQM_MAX_BACKOFF     32      ///< 最大重新连接等待周期数
+#define SQM_LINE_SIZE       128     ///< 反馈行最大长度
+
 enum {
     SQM_SUCCESS,
     SQM_FAIL_CONNECT,
@@ -46,72 +60,64 @@ struct InfoSQM {
     int state;      ///< 工作状态. 0: 正确; 1: SQM断网; 2: 无数据反馈
     string utc;     ///< 数据采集时间, CCYY-MM-DDThh:mm:ss
     float mpsas;    ///< 天光背景亮度, 星等@平方角秒
+    float temperature;  ///< 传感器温度, 摄氏度
 
 public:
     InfoSQM() = default;
 };
 
 /**
- * @brief SQM单元查找结果
+ * @brief SQM单元
  */
 struct SQMUnit {
-    string ip;  ///< IP地址
-    string mac; ///< MAC地址
+    string name;    ///< 名称. 用作日志文件前缀和样本总线的传感器名称
+    string ip;      ///< IP地址
+    string mac;     ///< MAC地址
+    uint16_t port;  ///< TCP端口
+
+public:
+    SQMUnit() {
+        port = SQM_PORT;
+    }
 };
 typedef std::vector<SQMUnit> SQMUnitVec;
 
+/**
+ * @brief 单台SQM: 保持TCP连接, 周期查询
+ * @note
+ * - 查询流水线: 不等待前次反馈即发送本周期的rx, 未反馈的查询超过SQM_MAX_INFLIGHT时断开连接
+ * - 断开或连接失败后按指数退避重新连接: 1, 2, 4, ... SQM_MAX_BACKOFF个周期
+ * - 反馈由TcpClient按换行分帧, 不依赖固定长度
+ */
 class SQM {
 public:
     typedef boost::shared_ptr<SQM> Pointer;
 
 public:
-    SQM(const char* ip, const char* dirName = NULL);
+    SQM(const SQMUnit& unit, const char* dirName = NULL);
     ~SQM();
-    static Pointer Create(const char* ip, const char* dirName = NULL) {
-        return Pointer(new SQM(ip, dirName));
+    static Pointer Create(const SQMUnit& unit, const char* dirName = NULL) {
+        return Pointer(new SQM(unit, dirName));
     }
 
 protected:
     string  dirRoot_;   ///< 样本数据文件根目录
-    string  ipDev_;    ///< 设备IP地址
-    const uint16_t portDev_;    ///< 设备端口
-    InfoSQM info_;  ///< SQM信息
-    FILE* fpLog_;   ///< 日志文件
-    int cntRsp_;    ///< 有效采样计数
-    int oldDay_;    ///< UTC日期
+    DatedTreePtr treeLog_;  ///< 日志目录: SQM/Y<year>
+    SQMUnit unit_;      ///< 设备
+    InfoSQM info_;      ///< SQM信息
+    AppendLog logFile_; ///< 日志文件
+    int oldDay_;        ///< UTC日期
 
-    TcpCPtr tcpClient_; ///< TCP连接
-    ThrdPtr thrdCycle_; ///< 线程指针
+    int cycle_;         ///< 采样周期, 秒
+    int inflight_;      ///< 已发送未反馈的查询数量
+    int backoff_;       ///< 重新连接的等待周期数
+    int wait_;          ///< 距离重新连接的剩余周期数
+    bool connecting_;   ///< 正在连接
+    bool connected_;    ///< 连接有效
 
-/////////////////////////////////////////////////////////////////////
-// 静态接口: 查找同一网段的可用NTP
-public:
-    static SQMUnitVec units_;  ///< 在网段内查找到的设备地址
-    static boost::condition_variable cvFound_; ///< UDP查询指令反馈结果
-
-public:
-    /**
-     * @brief 查找网段内可能存在的设备
-     * @return 找到的设备数量
-     */
-    static int Find();
-    /**
-     * @brief 查看设备的网络地址
-     * @param index  设备索引, 1-count
-     * @param ip     IP地址
-     * @param mac    MAC地址
-     * @return 操作结果的有效性
-     */
-    static bool GetAddress(int index, string& ip, string& mac);
-
-protected:
-	/**
-	 * @brief 回调函数: 处理UDP端口上广播收到的信息
-	 * @param ec     故障字. 0: 无故障
-	 * @param bytes  接收信息的长度, 字节
-	 */
-	static void handle_found(const boost::system::error_code& ec, const int bytes);
-/////////////////////////////////////////////////////////////////////
+    TcpCPtr tcpClient_; ///< TCP连接
+    BoostAsioKeep keep_;    ///< 线程池句柄
+    int idCycle_;           ///< 调度任务: 采样周期
 
 public:
     /**
@@ -132,19 +138,44 @@ public:
     const InfoSQM* GetInfo() {
         return &info_;
     }
+    const SQMUnit& GetUnit() {
+        return unit_;
+    }
 
 protected:
     /**
-     * @brief 线程: 定时读取天光背景
-     * @param cycle 采用周期, 秒
+     * @brief 调度任务: 按需连接, 并发送查询指令
+     */
+    void cycle();
+    /**
+     * @brief 断开连接, 并安排重新连接
+     * @param state  工作状态
      */
-    void run(int cycyle);
+    void disconnect(int state);
     /**
-     * @brief 回调函数: 处理收到的SQM信息
-     * @param client  网络连接
-     * @param ec      故障码
+     * @brief 回调函数: 连接结果. 投递到本实例的strand
+     */
+    void handle_connect(TcpClient* client, const boost::system::error_code ec);
+    /**
+     * @brief 回调函数: 接收结果. 连接断开时投递到本实例的strand
      */
     void handle_receive(TcpClient* client, const boost::system::error_code ec);
+    /**
+     * @brief 回调函数: 收到一行反馈. 在TcpClient的strand中解析, 结果投递到本实例的strand
+     */
+    void handle_message(TcpClient* client, const char* data, size_t len);
+    /**
+     * @brief 处理连接结果
+     */
+    void on_connect(TcpClient* client, int ec);
+    /**
+     * @brief 处理连接断开
+     */
+    void on_closed(TcpClient* client);
+    /**
+     * @brief 处理测量结果: 记录、发布并写入文件
+     */
+    void on_reading(TcpClient* client, float mpsas, float temperature);
     /**
      * @brief  打开日志文件
      * @param  year  UTC年
@@ -155,5 +186,84 @@ protected:
     bool open_file(int year, int month, int day);
 };
 typedef SQM::Pointer SQMPtr;
+typedef std::vector<SQMPtr> SQMVec;
+
+/**
+ * @brief 多台SQM管理: 异步查找网段内的设备, 并为每台设备创建SQM实例
+ * @note
+ * - 查找: 广播查询后在等待时间内接收全部反馈, 不阻塞线程
+ * - 首台设备为主设备, 供PDXP和事后数据文件使用
+ */
+class SQMManager {
+public:
+    typedef boost::shared_ptr<SQMManager> Pointer;
+
+public:
+    SQMManager(const char* dirName = NULL);
+    ~SQMManager();
+    static Pointer Create(const char* dirName = NULL) {
+        return Pointer(new SQMManager(dirName));
+    }
+
+protected:
+    string dirRoot_;    ///< 样本数据文件根目录
+    int cycle_;         ///< 采样周期, 秒
+    boost::mutex mtxUnits_;     ///< 互斥锁: 设备
+    SQMVec units_;      ///< 设备
+    BoostAsioKeep keep_;        ///< 线程池句柄
+    boost::asio::ip::udp::socket sock_;     ///< 查找: 广播套接口
+    boost::asio::ip::udp::endpoint remote_; ///< 查找: 反馈地址
+    unsigned char rcvd_[100];   ///< 查找: 反馈信息
+    SteadyTimer tmrFind_;       ///< 查找: 等待时间
+
+public:
+    /**
+     * @brief 启动全部设备的查询流程
+     * @param cycle  采样周期, 秒
+     * @param units  配置的设备. 首台为主设备
+     * @return 启动结果
+     */
+    bool Start(int cycle, const SQMUnitVec& units);
+    /**
+     * @brief 停止全部设备
+     */
+    void Stop();
+    /**
+     * @brief 查找网段内的设备. 新设备被加入并启动
+     * @param waitMs  等待反馈的时间, 毫秒
+     */
+    void Discover(int waitMs = 1000);
+    /**
+     * @brief 主设备
+     */
+    SQMPtr Primary();
+    /**
+     * @brief 全部设备
+     */
+    SQMVec Units();
+
+protected:
+    /**
+     * @brief 加入并启动设备. 相同IP地址的设备只加入一次
+     */
+    void add_unit(const SQMUnit& unit);
+    /**
+     * @brief 查找: 发送广播查询
+     */
+    void find(int waitMs);
+    /**
+     * @brief 查找: 接收下一条反馈
+     */
+    void start_receive();
+    /**
+     * @brief 查找: 处理反馈
+     */
+    void on_found(const boost::system::error_code& ec, size_t bytes);
+    /**
+     * @brief 查找: 等待结束
+     */
+    void on_find_end(const boost::system::error_code& ec);
+};
+typedef SQMManager::Pointer SQMMgrPtr;
 
 #endif
@@ -0,0 +1,112 @@
+/**
+ * @file SampleBus.cpp 环境传感器样本总线
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include "SampleBus.h"
+#include "GLog.h"
+
+using namespace boost::placeholders;
+using namespace boost::posix_time;
+using namespace boost::filesystem;
+
+SampleBus::SampleBus() {
+	idNext_ = 1;
+}
+
+SampleBus::~SampleBus() {
+}
+
+void SampleBus::Publish(const SampleVec& samples) {
+	std::vector<CBSample> subs;
+	{
+		MtxLck lck(mtx_);
+		for (SampleVec::const_iterator it = samples.begin(); it != samples.end(); ++it)
+			latest_[it->Key()] = *it;
+		for (std::map<int, CBSample>::iterator it = subs_.begin(); it != subs_.end(); ++it)
+			subs.push_back(it->second);
+	}
+	for (size_t i = 0; i < subs.size(); ++i) subs[i](samples);
+}
+
+SampleVec SampleBus::Snapshot() {
+	SampleVec samples;
+	MtxLck lck(mtx_);
+	for (std::map<string, Sample>::iterator it = latest_.begin(); it != latest_.end(); ++it)
+		samples.push_back(it->second);
+	return samples;
+}
+
+bool SampleBus::Latest(const string& sensor, const string& channel, Sample& sample) {
+	MtxLck lck(mtx_);
+	std::map<string, Sample>::iterator it = latest_.find(sensor + "." + channel);
+	if (it == latest_.end()) return false;
+	sample = it->second;
+	return true;
+}
+
+int SampleBus::Subscribe(const CBSample& cb) {
+	MtxLck lck(mtx_);
+	subs_[idNext_] = cb;
+	return idNext_++;
+}
+
+void SampleBus::Unsubscribe(int& id) {
+	MtxLck lck(mtx_);
+	subs_.erase(id);
+	id = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+SampleLog::SampleLog() {
+	oldDay_ = 0;
+	idSub_  = 0;
+}
+
+SampleLog::~SampleLog() {
+	Stop();
+}
+
+void SampleLog::Start(const string& dirRoot) {
+	dirRoot_ = dirRoot;
+	treeLog_ = _gDated.Tree((path(dirRoot_) / "Sensors").string(), DATED_YEAR);
+	keep_.Reset();
+	idSub_ = _gSamples.Subscribe(keep_.Wrap(boost::bind(&SampleLog::write, this, _1)));
+}
+
+void SampleLog::Stop() {
+	if (idSub_) _gSamples.Unsubscribe(idSub_);
+	keep_.Stop();
+	logFile_.Close();
+}
+
+void SampleLog::write(const SampleVec& samples) {
+	for (SampleVec::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+		ptime::date_type day = it->utc.date();
+		if (!open_file(day.year(), day.month().as_number(), day.day())) return;
+		logFile_.Write("%s %s %.6g %s %d\n", to_iso_extended_string(it->utc).c_str(), it->Key().c_str(),
+			it->value, it->unit.empty() ? "-" : it->unit.c_str(), it->state);
+	}
+}
+
+bool SampleLog::open_file(int year, int month, int day) {
+	if (oldDay_ != day) {
+		logFile_.Close();
+
+		// 打开文件
+		string pathName = treeLog_->File(boost::gregorian::date(year, month, day), "Sensors_", ".log");
+		if (pathName.empty()) return false;
+		_gLog.Write("Sensor File = %s", pathName.c_str());
+		logFile_.Open(pathName, "Sensors");
+
+		// 保存日期
+		oldDay_ = day;
+	}
+
+	return logFile_.IsOpen();
+}
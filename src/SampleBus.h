@@ -0,0 +1,154 @@
+/**
+ * @file SampleBus.h 环境传感器样本总线
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 传感器驱动以"传感器.通道"为键发布样本, 总线保存各通道的最新样本
+ * - 订阅者在发布者的线程中被调用, 需要时由订阅者自行投递到其strand
+ * - SampleLog: 订阅总线, 将全部样本按UTC日期写入文本文件
+ */
+
+#ifndef SAMPLE_BUS_H_
+#define SAMPLE_BUS_H_
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include "BoostInclude.h"
+#include "BoostAsioKeep.h"
+#include "DatedPath.h"
+#include "AppendLog.h"
+
+using std::string;
+
+/**
+ * @brief 样本状态
+ */
+enum {
+	SAMPLE_OK,		///< 正确
+	SAMPLE_NO_DATA,	///< 设备无反馈或数据无效
+	SAMPLE_STALE	///< 数据过期
+};
+
+/**
+ * @brief 传感器样本
+ */
+struct Sample {
+	string sensor;	///< 传感器名称
+	string channel;	///< 通道名称
+	string unit;	///< 单位
+	double value;	///< 数值
+	int state;		///< 状态
+	boost::posix_time::ptime utc;	///< 采样时间
+
+public:
+	Sample() {
+		value = 0.0;
+		state = SAMPLE_NO_DATA;
+	}
+	/*!
+	 * @brief 总线中的键: 传感器.通道
+	 */
+	string Key() const {
+		return sensor + "." + channel;
+	}
+};
+typedef std::vector<Sample> SampleVec;
+
+class SampleBus {
+public:
+	SampleBus();
+	virtual ~SampleBus();
+
+public:
+	/* 数据类型 */
+	/*!
+	 * @brief 订阅回调函数
+	 * @param _1  同一次发布的样本
+	 */
+	typedef boost::function<void (const SampleVec&)> CBSample;
+
+protected:
+	/* 成员变量 */
+	boost::mutex mtx_;	///< 互斥锁
+	std::map<string, Sample> latest_;	///< 各通道的最新样本
+	std::map<int, CBSample> subs_;		///< 订阅者
+	int idNext_;		///< 下一个订阅编号
+
+public:
+	/* 接口 */
+	/*!
+	 * @brief 发布样本, 并通知订阅者
+	 */
+	void Publish(const SampleVec& samples);
+	/*!
+	 * @brief 查看全部通道的最新样本, 按键排序
+	 */
+	SampleVec Snapshot();
+	/*!
+	 * @brief 查看单个通道的最新样本
+	 * @return
+	 * 通道是否存在
+	 */
+	bool Latest(const string& sensor, const string& channel, Sample& sample);
+	/*!
+	 * @brief 订阅样本
+	 * @return
+	 * 订阅编号
+	 */
+	int Subscribe(const CBSample& cb);
+	/*!
+	 * @brief 取消订阅
+	 * @param id  订阅编号. 取消后置为0
+	 */
+	void Unsubscribe(int& id);
+};
+
+extern SampleBus _gSamples;
+
+/**
+ * @brief 将样本总线的全部样本按日写入文件
+ * @note
+ * 文件路径: <root>/Sensors/Y<year>/Sensors_<year><month><day>.log
+ * 每行一个样本: UTC 键 数值 单位 状态
+ */
+class SampleLog {
+public:
+	SampleLog();
+	virtual ~SampleLog();
+
+protected:
+	string dirRoot_;	///< 根目录
+	DatedTreePtr treeLog_;	///< 日志目录: Sensors/Y<year>
+	AppendLog logFile_;	///< 日志文件
+	int oldDay_;		///< UTC日期
+	int idSub_;			///< 订阅编号
+	BoostAsioKeep keep_;	///< 线程池句柄: 写文件不阻塞发布者
+
+public:
+	/*!
+	 * @brief 开始记录
+	 * @param dirRoot  根目录
+	 */
+	void Start(const string& dirRoot);
+	/*!
+	 * @brief 停止记录
+	 */
+	void Stop();
+
+protected:
+	/*!
+	 * @brief 写入样本
+	 */
+	void write(const SampleVec& samples);
+	/*!
+	 * @brief 打开日志文件
+	 * @return 文件创建或打开结果
+	 */
+	bool open_file(int year, int month, int day);
+};
+
+#endif
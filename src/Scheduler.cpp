@@ -0,0 +1,324 @@
+/**
+ * @file Scheduler.cpp 基于分层时间轮的定时任务调度器
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "Scheduler.h"
+#include "GLog.h"
+
+#define SCHED_REPORT_CYCLE		3600000		// 统计报告周期, 毫秒
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+namespace bchrono = boost::asio::chrono;
+
+Scheduler::Scheduler() {
+	for (int i = 0; i < WHEEL_LEVELS; ++i) count_[i] = 0;
+	tickNow_ = tickTarget_ = 0;
+	armed_    = -1;
+	idNext_   = 1;
+	idReport_ = 0;
+	wakeups_  = 0;
+}
+
+Scheduler::~Scheduler() {
+	Stop();
+}
+
+void Scheduler::Start() {
+	{
+		MtxLck lck(mtx_);
+		if (keep_) return;
+		keep_.reset(new BoostAsioKeep);
+		tmr_.reset(new SteadyTimer(keep_->GetIOService()));
+		base_    = Clock::now();
+		tickNow_ = tickTarget_ = 0;
+		armed_   = -1;
+	}
+	idReport_ = Every(*keep_, "scheduler report", SCHED_REPORT_CYCLE, boost::bind(&Scheduler::Report, this));
+}
+
+void Scheduler::Stop() {
+	MtxLck lck(mtx_);
+	if (!keep_) return;
+
+	boost::system::error_code ec;
+	for (std::map<int, ItemPtr>::iterator it = items_.begin(); it != items_.end(); ++it) unlink(it->second);
+	items_.clear();
+	idReport_ = 0;
+	lck.unlock();
+	keep_->Stop();
+	tmr_->cancel(ec);
+	lck.lock();
+	tmr_.reset();
+	keep_.reset();
+	armed_ = -1;
+}
+
+int Scheduler::Every(BoostAsioKeep& keep, const char* name, int periodMs, const Task& task, int offsetMs) {
+	ItemPtr item(new Item);
+	if (periodMs < WHEEL_TICK) periodMs = WHEEL_TICK;
+	item->name     = name;
+	item->periodMs = periodMs;
+	item->offsetMs = offsetMs;
+	item->period   = periodMs / WHEEL_TICK;
+	item->deadline = first_deadline(periodMs, offsetMs);
+	item->task     = task;
+	return add(keep, item);
+}
+
+int Scheduler::Once(BoostAsioKeep& keep, const char* name, int64_t delayMs, const Task& task) {
+	ItemPtr item(new Item);
+	if (delayMs < 0) delayMs = 0;
+	item->name     = name;
+	item->periodMs = 0;
+	item->offsetMs = 0;
+	item->period   = 0;
+	item->deadline = tick_of(Clock::now() + bchrono::milliseconds(delayMs));
+	item->task     = task;
+	return add(keep, item);
+}
+
+bool Scheduler::Reschedule(int id, int periodMs) {
+	MtxLck lck(mtx_);
+	std::map<int, ItemPtr>::iterator it = items_.find(id);
+	if (it == items_.end() || !it->second->period) return false;
+
+	ItemPtr item = it->second;
+	if (periodMs < WHEEL_TICK) periodMs = WHEEL_TICK;
+	if (periodMs != item->periodMs) {
+		unlink(item);
+		item->periodMs = periodMs;
+		item->period   = periodMs / WHEEL_TICK;
+		item->deadline = first_deadline(periodMs, item->offsetMs);
+		link(item);
+		arm();
+	}
+	return true;
+}
+
+void Scheduler::Cancel(int& id) {
+	MtxLck lck(mtx_);
+	std::map<int, ItemPtr>::iterator it = items_.find(id);
+	if (it != items_.end()) {
+		unlink(it->second);
+		items_.erase(it);
+		arm();
+	}
+	id = 0;
+}
+
+SchedStatVec Scheduler::Statistic() {
+	MtxLck lck(mtx_);
+	SchedStatVec stats;
+	for (std::map<int, ItemPtr>::iterator it = items_.begin(); it != items_.end(); ++it) {
+		ItemPtr item = it->second;
+		SchedStat stat;
+		stat.name       = item->name;
+		stat.period     = item->periodMs;
+		stat.runs       = item->runs;
+		stat.misses     = item->misses;
+		stat.jitterMean = item->jitterMean;
+		stat.jitterMax  = item->jitterMax;
+		stats.push_back(stat);
+	}
+	return stats;
+}
+
+void Scheduler::Report() {
+	SchedStatVec stats = Statistic();
+	unsigned long long wakeups;
+	{
+		MtxLck lck(mtx_);
+		wakeups = wakeups_;
+	}
+	_gLog.Write("scheduler: tasks = %d, wakeups = %llu", (int) stats.size(), wakeups);
+	for (SchedStatVec::iterator it = stats.begin(); it != stats.end(); ++it) {
+		_gLog.Write("scheduler: [%s] period = %d ms, runs = %llu, misses = %llu, jitter = %.1f/%.1f ms",
+			it->name.c_str(), it->period, it->runs, it->misses, it->jitterMean, it->jitterMax);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////
+int64_t Scheduler::tick_of(const TimePoint& tp) {
+	int64_t ms = bchrono::duration_cast<bchrono::milliseconds>(tp - base_).count();
+	return (ms + WHEEL_TICK - 1) / WHEEL_TICK;
+}
+
+int64_t Scheduler::first_deadline(int periodMs, int offsetMs) {
+	ptime utc = microsec_clock::universal_time();
+	int64_t ms = (utc - ptime(boost::gregorian::date(1970, 1, 1))).total_milliseconds() - offsetMs;
+	int64_t phase = ms % periodMs;
+	if (phase < 0) phase += periodMs;
+	return tick_of(Clock::now() + bchrono::milliseconds(phase ? periodMs - phase : periodMs));
+}
+
+int Scheduler::add(BoostAsioKeep& keep, ItemPtr item) {
+	item->running    = 0;
+	item->runSeq     = 0;
+	item->linked     = false;
+	item->runs       = 0;
+	item->misses     = 0;
+	item->jitterMean = 0.0;
+	item->jitterMax  = 0.0;
+	item->runner     = keep.Wrap(boost::bind(&Scheduler::run_task, this, _1, _2, _3));
+
+	MtxLck lck(mtx_);
+	if (!keep_) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], scheduler is not running, task [%s] is rejected",
+			__FILE__, __FUNCTION__, item->name.c_str());
+		return 0;
+	}
+	item->id = idNext_++;
+	items_[item->id] = item;
+	link(item);
+	arm();
+	return item->id;
+}
+
+void Scheduler::link(ItemPtr item) {
+	int64_t d = item->deadline > tickNow_ ? item->deadline : tickNow_ + 1;
+	int64_t delta = d - tickNow_;
+	int level = 0;
+
+	while (level < WHEEL_LEVELS - 1 && delta >= (int64_t(1) << (WHEEL_BITS * (level + 1)))) ++level;
+	if (delta >= (int64_t(1) << (WHEEL_BITS * WHEEL_LEVELS))) {// 超出时间轮范围: 放入最高层, 到期时重新放入
+		d = tickNow_ + (int64_t(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	}
+	item->level  = level;
+	item->slot   = int((d >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	ItemList& slot = wheel_[level][item->slot];
+	item->pos    = slot.insert(slot.end(), item);
+	item->linked = true;
+	++count_[level];
+}
+
+void Scheduler::unlink(ItemPtr item) {
+	if (item->linked) {
+		wheel_[item->level][item->slot].erase(item->pos);
+		item->linked = false;
+		--count_[item->level];
+	}
+}
+
+void Scheduler::cascade(int level) {
+	ItemList items;
+	items.swap(wheel_[level][(tickNow_ >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+	count_[level] -= (int) items.size();
+	for (ItemList::iterator it = items.begin(); it != items.end(); ++it) {
+		(*it)->linked = false;
+		link(*it);
+	}
+}
+
+void Scheduler::advance(int64_t target) {
+	tickTarget_ = target;
+	while (tickNow_ < target) {
+		// 跳过空闲刻度: 直至最低非空层的下一个级联点
+		int level = 0;
+		while (level < WHEEL_LEVELS && !count_[level]) ++level;
+		if (level == WHEEL_LEVELS) {
+			tickNow_ = target;
+			break;
+		}
+		int64_t span = int64_t(1) << (WHEEL_BITS * level);
+		int64_t next = (tickNow_ / span + 1) * span;
+		tickNow_ = (next < target ? next : target) - 1;
+
+		++tickNow_;
+		if (!(tickNow_ & WHEEL_MASK)) {// 级联
+			for (level = 1; level < WHEEL_LEVELS; ++level) {
+				cascade(level);
+				if ((tickNow_ >> (WHEEL_BITS * level)) & WHEEL_MASK) break;
+			}
+		}
+
+		ItemList items;
+		items.swap(wheel_[0][tickNow_ & WHEEL_MASK]);
+		count_[0] -= (int) items.size();
+		for (ItemList::iterator it = items.begin(); it != items.end(); ++it) {
+			(*it)->linked = false;
+			if ((*it)->deadline > tickNow_) link(*it); // 超出范围的任务
+			else fire(*it);
+		}
+	}
+}
+
+void Scheduler::fire(ItemPtr item) {
+	if (item->running) ++item->misses; // 前次执行尚未结束
+	else {
+		if (!++item->runSeq) ++item->runSeq;	// 轮次0表示空闲
+		item->running = item->runSeq;
+		RunGuardPtr guard(new RunGuard(item, item->runSeq));
+		keep_->GetIOService().post(boost::bind(item->runner, item, item->deadline, guard));
+	}
+
+	if (!item->period) items_.erase(item->id);
+	else {// 绝对截止时间: 跳过已错过的周期
+		item->deadline += item->period;
+		while (item->deadline <= tickTarget_) {
+			item->deadline += item->period;
+			++item->misses;
+		}
+		link(item);
+	}
+}
+
+void Scheduler::arm() {
+	int64_t next(-1), d;
+	int level, idx, i;
+
+	for (level = 0; level < WHEEL_LEVELS; ++level) {
+		if (!count_[level]) continue;
+		idx = int((tickNow_ >> (WHEEL_BITS * level)) & WHEEL_MASK);
+		for (i = 1; i <= WHEEL_SLOTS; ++i) {
+			ItemList& slot = wheel_[level][(idx + i) & WHEEL_MASK];
+			if (slot.empty()) continue;
+			for (ItemList::iterator it = slot.begin(); it != slot.end(); ++it) {
+				d = (*it)->deadline > tickNow_ ? (*it)->deadline : tickNow_ + 1;
+				if (next < 0 || d < next) next = d;
+			}
+			break;
+		}
+	}
+
+	if (next != armed_ && tmr_) {
+		armed_ = next;
+		if (next < 0) {
+			boost::system::error_code ec;
+			tmr_->cancel(ec);
+		}
+		else {
+			tmr_->expires_at(base_ + bchrono::milliseconds(next * WHEEL_TICK));
+			tmr_->async_wait(keep_->Wrap(boost::bind(&Scheduler::on_timer, this, boost::asio::placeholders::error)));
+		}
+	}
+}
+
+void Scheduler::on_timer(const boost::system::error_code& ec) {
+	if (ec) return;
+
+	MtxLck lck(mtx_);
+	++wakeups_;
+	armed_ = -1;
+	advance(tick_of(Clock::now() - bchrono::milliseconds(WHEEL_TICK - 1)));
+	arm();
+}
+
+void Scheduler::run_task(ItemPtr item, int64_t deadline, RunGuardPtr guard) {
+	double jitter = bchrono::duration<double, std::milli>(
+		Clock::now() - (base_ + bchrono::milliseconds(deadline * WHEEL_TICK))).count();
+	{
+		MtxLck lck(mtx_);
+		++item->runs;
+		item->jitterMean += (jitter - item->jitterMean) / item->runs;
+		if (jitter > item->jitterMax) item->jitterMax = jitter;
+	}
+
+	item->task();	// 执行结束或异常退出后, 回调函数销毁时由guard清除执行标志
+}
@@ -0,0 +1,227 @@
+/**
+ * @file Scheduler.h 基于分层时间轮的定时任务调度器
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 时间轮: 4层, 每层64个槽位, 刻度10毫秒, 覆盖约46小时
+ * - 无空转: 仅在最近的截止时间唤醒, 空闲时不产生刻度中断
+ * - 周期任务的截止时间为绝对时间, 且对齐到UTC时间的周期整数倍. 相同周期的任务同时触发,
+ *   执行延迟不累积
+ * - 任务在注册者的strand中执行, 注册者Stop()后不再执行
+ * - 统计每个任务的执行次数、截止时间错过次数和启动抖动
+ * - 截止时间错过: 前次执行尚未结束, 或唤醒延迟超过一个周期. 错过的执行被跳过, 不补偿
+ * - 执行标志由随回调函数销毁的守卫清除: 注册者的strand停止或重置后, 被丢弃的执行同样结束
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "BoostAsioKeep.h"
+
+using std::string;
+
+#define WHEEL_TICK		10		///< 时间刻度, 毫秒
+#define WHEEL_BITS		6		///< 每层槽位数量的二进制位数
+#define WHEEL_SLOTS		(1 << WHEEL_BITS)
+#define WHEEL_MASK		(WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS	4		///< 层数
+
+/**
+ * @brief 任务统计量
+ */
+struct SchedStat {
+	string name;	///< 任务名称
+	int period;		///< 周期, 毫秒. 0: 单次任务
+	unsigned long long runs;	///< 执行次数
+	unsigned long long misses;	///< 截止时间错过次数
+	double jitterMean;	///< 平均启动抖动, 毫秒
+	double jitterMax;	///< 最大启动抖动, 毫秒
+};
+typedef std::vector<SchedStat> SchedStatVec;
+
+class Scheduler {
+public:
+	Scheduler();
+	virtual ~Scheduler();
+
+public:
+	/* 数据类型 */
+	typedef boost::function<void ()> Task;
+	typedef SteadyTimer::clock_type Clock;
+	typedef Clock::time_point TimePoint;
+
+protected:
+	struct Item;
+	struct RunGuard;
+	typedef boost::shared_ptr<Item> ItemPtr;
+	typedef boost::shared_ptr<RunGuard> RunGuardPtr;
+	typedef std::list<ItemPtr> ItemList;
+	typedef boost::function<void (ItemPtr, int64_t, RunGuardPtr)> Runner;
+
+	/* 任务 */
+	struct Item {
+		int id;				///< 任务编号
+		string name;		///< 任务名称
+		int periodMs;		///< 周期, 毫秒. 0: 单次任务
+		int offsetMs;		///< 相对UTC周期整数倍的相位, 毫秒
+		int64_t period;		///< 周期, 刻度
+		int64_t deadline;	///< 截止时间, 刻度
+		boost::atomic<unsigned> running;	///< 正在执行的轮次. 0: 空闲
+		unsigned runSeq;	///< 最近一次触发的轮次
+		Task task;			///< 任务函数
+		Runner runner;		///< 在注册者strand中执行任务
+		/* 在时间轮中的位置 */
+		bool linked;
+		int level, slot;
+		ItemList::iterator pos;
+		/* 统计量 */
+		unsigned long long runs;
+		unsigned long long misses;
+		double jitterMean;
+		double jitterMax;
+	};
+
+	/* 执行守卫: 投递的回调函数执行完毕或被丢弃后销毁, 清除该轮次的执行标志 */
+	struct RunGuard {
+		ItemPtr item;	///< 任务
+		unsigned seq;	///< 轮次
+
+	public:
+		RunGuard(ItemPtr _item, unsigned _seq) : item(_item), seq(_seq) {}
+		~RunGuard() {
+			unsigned expected = seq;
+			item->running.compare_exchange_strong(expected, 0u);
+		}
+	};
+
+protected:
+	/* 成员变量 */
+	boost::mutex mtx_;	///< 互斥锁: 时间轮和任务
+	ItemList wheel_[WHEEL_LEVELS][WHEEL_SLOTS];	///< 时间轮
+	int count_[WHEEL_LEVELS];	///< 各层任务数量
+	std::map<int, ItemPtr> items_;	///< 全部任务
+	TimePoint base_;	///< 刻度零点
+	int64_t tickNow_;	///< 已处理的刻度
+	int64_t tickTarget_;	///< 本次推进的目标刻度
+	int64_t armed_;		///< 定时器的唤醒刻度. -1: 未启动
+	int idNext_;		///< 下一个任务编号
+	int idReport_;		///< 统计报告任务编号
+	unsigned long long wakeups_;	///< 唤醒次数
+	boost::scoped_ptr<BoostAsioKeep> keep_;	///< 线程池句柄
+	boost::scoped_ptr<SteadyTimer> tmr_;	///< 唤醒定时器
+
+public:
+	/* 接口 */
+	/**
+	 * @brief 启动调度器. 需在线程池启动后调用
+	 */
+	void Start();
+	/**
+	 * @brief 停止调度器, 并取消全部任务
+	 */
+	void Stop();
+	/**
+	 * @brief 注册周期任务
+	 * @param keep      注册者的线程池句柄. 任务在其strand中执行
+	 * @param name      任务名称
+	 * @param periodMs  周期, 毫秒
+	 * @param task      任务函数
+	 * @param offsetMs  相位: 截止时间 = UTC周期整数倍 + offsetMs
+	 * @return
+	 * 任务编号. 注册者销毁前应调用Cancel()
+	 */
+	int Every(BoostAsioKeep& keep, const char* name, int periodMs, const Task& task, int offsetMs = 0);
+	/**
+	 * @brief 注册单次任务
+	 * @param keep     注册者的线程池句柄
+	 * @param name     任务名称
+	 * @param delayMs  延迟, 毫秒
+	 * @param task     任务函数
+	 * @return
+	 * 任务编号
+	 */
+	int Once(BoostAsioKeep& keep, const char* name, int64_t delayMs, const Task& task);
+	/**
+	 * @brief 修改周期任务的周期. 保留统计量
+	 * @param id        任务编号
+	 * @param periodMs  周期, 毫秒
+	 * @return
+	 * 任务是否存在
+	 */
+	bool Reschedule(int id, int periodMs);
+	/**
+	 * @brief 取消任务. 已开始执行的任务不受影响
+	 * @param id  任务编号. 取消后置为0
+	 */
+	void Cancel(int& id);
+	/**
+	 * @brief 查看全部任务的统计量
+	 */
+	SchedStatVec Statistic();
+	/**
+	 * @brief 在日志中记录全部任务的统计量
+	 */
+	void Report();
+
+protected:
+	/**
+	 * @brief 计算时间对应的刻度, 向上取整
+	 */
+	int64_t tick_of(const TimePoint& tp);
+	/**
+	 * @brief 计算周期任务的首个截止时间: 对齐到UTC时间的周期整数倍
+	 */
+	int64_t first_deadline(int periodMs, int offsetMs);
+	/**
+	 * @brief 注册任务
+	 */
+	int add(BoostAsioKeep& keep, ItemPtr item);
+	/**
+	 * @brief 将任务放入时间轮
+	 */
+	void link(ItemPtr item);
+	/**
+	 * @brief 将任务移出时间轮
+	 */
+	void unlink(ItemPtr item);
+	/**
+	 * @brief 将上层槽位中的任务重新放入时间轮
+	 * @param level  层
+	 */
+	void cascade(int level);
+	/**
+	 * @brief 推进时间轮至目标刻度, 并触发到期任务
+	 */
+	void advance(int64_t target);
+	/**
+	 * @brief 触发任务
+	 */
+	void fire(ItemPtr item);
+	/**
+	 * @brief 依据最近的截止时间设置唤醒定时器
+	 */
+	void arm();
+	/**
+	 * @brief 定时器: 唤醒
+	 */
+	void on_timer(const boost::system::error_code& ec);
+	/**
+	 * @brief 在注册者strand中执行任务
+	 * @param item      任务
+	 * @param deadline  本次截止时间, 刻度
+	 * @param guard     执行守卫. 随回调函数销毁, 不论回调函数是否执行
+	 */
+	void run_task(ItemPtr item, int64_t deadline, RunGuardPtr guard);
+};
+
+extern Scheduler _gSched;
+
+#endif
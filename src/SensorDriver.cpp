@@ -0,0 +1,149 @@
+/**
+ * @file SensorDriver.cpp 环境传感器驱动接口及注册表
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/format.hpp>
+#include "SensorDriver.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::algorithm;
+using boost::property_tree::ptree;
+
+SensorDriver::SensorDriver() {
+	period_ = 0;
+}
+
+SensorDriver::~SensorDriver() {
+}
+
+bool SensorDriver::Start(const Config& cfg, const Parameter* param) {
+	name_   = cfg.get("<xmlattr>.Name", "");
+	period_ = int(cfg.get("<xmlattr>.Period", double(param->sampleCycle)) * 1000);
+	if (name_.empty() || period_ <= 0) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], sensor<%s> requires Name and a positive Period",
+			__FILE__, __FUNCTION__, type_.c_str());
+		return false;
+	}
+
+	channels_.clear();
+	for (ptree::const_iterator it = cfg.begin(); it != cfg.end(); ++it) {
+		if (!iequals(it->first, "Channel")) continue;
+		Channel ch;
+		ch.name   = it->second.get("<xmlattr>.Name", "");
+		ch.unit   = it->second.get("<xmlattr>.Unit", "");
+		ch.key    = it->second.get("<xmlattr>.Key",  "");
+		ch.index  = it->second.get("<xmlattr>.Index",  int(channels_.size()));
+		ch.scale  = it->second.get("<xmlattr>.Scale",  1.0);
+		ch.offset = it->second.get("<xmlattr>.Offset", 0.0);
+		ch.sign   = it->second.get("<xmlattr>.Signed", false);
+		if (ch.name.empty()) ch.name = ch.key.empty() ? (boost::format("ch%d") % ch.index).str() : ch.key;
+		channels_.push_back(ch);
+	}
+	if (channels_.empty()) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], sensor<%s> has no Channel", __FILE__, __FUNCTION__, name_.c_str());
+		return false;
+	}
+
+	keep_.Reset();
+	if (!start(cfg, param)) {
+		keep_.Stop();
+		return false;
+	}
+	_gLog.Write("Sensor<%s:%s>: %d channels, period = %d ms", type_.c_str(), name_.c_str(),
+		int(channels_.size()), period_);
+	return true;
+}
+
+void SensorDriver::Stop() {
+	keep_.Stop();
+	stop();
+}
+
+Sample SensorDriver::make_sample(const Channel& ch, double raw, const ptime& utc) {
+	Sample sample;
+	sample.sensor  = name_;
+	sample.channel = ch.name;
+	sample.unit    = ch.unit;
+	sample.utc     = utc;
+	if (!isnan(raw)) {
+		if (ch.sign && raw >= 32768.0 && raw < 65536.0) raw -= 65536.0;
+		sample.value = raw * ch.scale + ch.offset;
+		sample.state = SAMPLE_OK;
+	}
+	return sample;
+}
+
+void SensorDriver::publish(const std::vector<double>& raw) {
+	ptime utc = microsec_clock::universal_time();
+	SampleVec samples;
+	for (ChannelVec::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+		double x = it->index >= 0 && it->index < int(raw.size()) ? raw[it->index] : NAN;
+		samples.push_back(make_sample(*it, x, utc));
+	}
+	_gSamples.Publish(samples);
+}
+
+void SensorDriver::publish(const std::map<string, double>& raw) {
+	ptime utc = microsec_clock::universal_time();
+	SampleVec samples;
+	for (ChannelVec::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+		std::map<string, double>::const_iterator x = raw.find(it->key);
+		samples.push_back(make_sample(*it, x == raw.end() ? NAN : x->second, utc));
+	}
+	_gSamples.Publish(samples);
+}
+
+void SensorDriver::publish_state(int state) {
+	ptime utc = microsec_clock::universal_time();
+	SampleVec samples;
+	for (ChannelVec::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+		Sample sample = make_sample(*it, NAN, utc);
+		sample.state = state;
+		samples.push_back(sample);
+	}
+	_gSamples.Publish(samples);
+}
+
+/////////////////////////////////////////////////////////////////////
+std::map<string, SensorRegistry::Factory>& SensorRegistry::table() {
+	static std::map<string, Factory> drivers;
+	return drivers;
+}
+
+bool SensorRegistry::Register(const string& type, const Factory& factory) {
+	return table().insert(std::make_pair(to_lower_copy(type), factory)).second;
+}
+
+SensorPtr SensorRegistry::Create(const SensorDriver::Config& cfg, const Parameter* param) {
+	string type = to_lower_copy(cfg.get("<xmlattr>.Type", string()));
+	string name = cfg.get("<xmlattr>.Name", "");
+	if (!cfg.get("<xmlattr>.Enable", true)) return SensorPtr();
+
+	std::map<string, Factory>::iterator it = table().find(type);
+	if (it == table().end()) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], sensor<%s> has unknown type<%s>",
+			__FILE__, __FUNCTION__, name.c_str(), type.c_str());
+		return SensorPtr();
+	}
+
+	SensorPtr sensor(it->second());
+	sensor->type_ = type;
+	if (!sensor->Start(cfg, param)) sensor.reset();
+	return sensor;
+}
+
+SensorVec SensorRegistry::CreateAll(const SensorDriver::Config& sensors, const Parameter* param) {
+	SensorVec drivers;
+	for (ptree::const_iterator it = sensors.begin(); it != sensors.end(); ++it) {
+		if (!iequals(it->first, "Sensor")) continue;
+		SensorPtr sensor = Create(it->second, param);
+		if (sensor) drivers.push_back(sensor);
+	}
+	return drivers;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file SensorDriver.h 环境传感器驱动接口及注册表
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 驱动由配置文件<Sensors>下的<Sensor Type="..." Name="...">节点实例化, 新增传感器只需修改配置
+ * - 驱动类型通过REGISTER_SENSOR_DRIVER在注册表中登记. 内置类型:
+ *   modbus:  MODBUS RTU寄存器映射, 经串口总线SerialBus采样
+ *   tcpline: TCP行协议, 周期发送查询字符串并解析反馈行, 例如SQM
+ *   file:    监视文本文件, 解析"键 = 值"形式的行, 例如云量交换文件
+ * - 通道由<Channel>节点定义, 原始数值经 value = raw * Scale + Offset 换算后发布到样本总线
+ * - 采样由调度器驱动, 不创建线程
+ *
+ * 配置示例:
+ * <Sensors>
+ *     <Sensor Type="modbus" Name="dew" Port="/dev/ttyUSB1" Baud="9600" Slave="3" Address="0" Count="2" Period="30">
+ *         <Channel Name="temperature" Index="0" Scale="0.1" Unit="C" Signed="true"/>
+ *         <Channel Name="dewpoint"    Index="1" Scale="0.1" Unit="C"/>
+ *     </Sensor>
+ *     <Sensor Type="tcpline" Name="sqm2" Host="192.168.1.7" Port="10001" Query="rx" Period="30">
+ *         <Channel Name="mpsas" Index="1" Unit="mag/arcsec2"/>
+ *     </Sensor>
+ * </Sensors>
+ */
+
+#ifndef SENSOR_DRIVER_H_
+#define SENSOR_DRIVER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include "SampleBus.h"
+#include "Parameter.h"
+
+using std::string;
+
+class SensorDriver {
+	friend class SensorRegistry;
+
+public:
+	SensorDriver();
+	virtual ~SensorDriver();
+
+public:
+	/* 数据类型 */
+	typedef boost::shared_ptr<SensorDriver> Pointer;
+	typedef boost::property_tree::ptree Config;
+
+protected:
+	/* 通道 */
+	struct Channel {
+		string name;	///< 通道名称
+		string unit;	///< 单位
+		string key;		///< 键. 用于按名称取值的驱动
+		int index;		///< 原始数值索引
+		double scale;	///< 换算系数
+		double offset;	///< 换算偏置
+		bool sign;		///< 原始数值为有符号16位整数
+	};
+	typedef std::vector<Channel> ChannelVec;
+
+protected:
+	/* 成员变量 */
+	string type_;	///< 驱动类型
+	string name_;	///< 传感器名称
+	int period_;	///< 采样周期, 毫秒
+	ChannelVec channels_;	///< 通道
+	BoostAsioKeep keep_;	///< 线程池句柄
+
+public:
+	/* 接口 */
+	const string& Type() const {
+		return type_;
+	}
+	const string& Name() const {
+		return name_;
+	}
+	/*!
+	 * @brief 按配置启动采样
+	 * @param cfg    <Sensor>节点
+	 * @param param  全局参数
+	 * @return
+	 * 启动结果
+	 */
+	bool Start(const Config& cfg, const Parameter* param);
+	/*!
+	 * @brief 停止采样. 派生类的析构函数应调用
+	 */
+	void Stop();
+
+protected:
+	/*!
+	 * @brief 由驱动实现: 读取专有配置并开始采样
+	 */
+	virtual bool start(const Config& cfg, const Parameter* param) = 0;
+	/*!
+	 * @brief 由驱动实现: 停止采样, 释放设备. 可重复调用
+	 */
+	virtual void stop() = 0;
+	/*!
+	 * @brief 按通道定义换算原始数值, 并发布到样本总线
+	 * @param raw  原始数值. 索引越界的通道标记为无数据
+	 */
+	void publish(const std::vector<double>& raw);
+	/*!
+	 * @brief 按键取值换算, 并发布到样本总线
+	 * @param raw  键-原始数值
+	 */
+	void publish(const std::map<string, double>& raw);
+	/*!
+	 * @brief 发布全部通道的故障状态
+	 * @param state  样本状态
+	 */
+	void publish_state(int state);
+	/*!
+	 * @brief 换算单个通道
+	 */
+	Sample make_sample(const Channel& ch, double raw, const boost::posix_time::ptime& utc);
+};
+typedef SensorDriver::Pointer SensorPtr;
+typedef std::vector<SensorPtr> SensorVec;
+
+/**
+ * @brief 传感器驱动注册表
+ */
+class SensorRegistry {
+public:
+	/* 数据类型 */
+	typedef boost::function<SensorDriver* ()> Factory;
+
+	template <class Driver>
+	static SensorDriver* Make() {
+		return new Driver;
+	}
+
+public:
+	/*!
+	 * @brief 登记驱动类型
+	 * @param type     类型名称, 不区分大小写
+	 * @param factory  构造函数
+	 * @return
+	 * false: 类型已存在
+	 */
+	static bool Register(const string& type, const Factory& factory);
+	/*!
+	 * @brief 按<Sensor>节点创建并启动驱动
+	 * @return
+	 * 驱动实例. 未启用、类型未知或启动失败时为空
+	 */
+	static SensorPtr Create(const SensorDriver::Config& cfg, const Parameter* param);
+	/*!
+	 * @brief 按<Sensors>节点创建并启动全部驱动
+	 */
+	static SensorVec CreateAll(const SensorDriver::Config& sensors, const Parameter* param);
+
+protected:
+	/*!
+	 * @brief 注册表. 函数内静态变量, 避免静态初始化顺序问题
+	 */
+	static std::map<string, Factory>& table();
+};
+
+/*!
+ * @brief 在驱动的实现文件中登记驱动类型
+ */
+#define REGISTER_SENSOR_DRIVER(type, cls) \
+	static const bool registered_##cls = SensorRegistry::Register(type, &SensorRegistry::Make<cls>)
+
+#endif
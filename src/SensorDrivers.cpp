@@ -0,0 +1,276 @@
+/**
+ * @file SensorDrivers.cpp 内置传感器驱动: modbus, tcpline, file
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <ctime>
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/filesystem.hpp>
+#include "SensorDriver.h"
+#include "SerialBus.h"
+#include "Scheduler.h"
+#include "AsioTCP.h"
+#include "GLog.h"
+
+using namespace boost::placeholders;
+using namespace boost::filesystem;
+using namespace boost::algorithm;
+
+/*!
+ * @brief 解析数值. 允许数值后附带单位, 例如"06.70m"
+ * @return
+ * 数值. 无法解析时为NAN
+ */
+static double parse_value(const string& token) {
+	const char* str = token.c_str();
+	char* end;
+	double x = strtod(str, &end);
+	return end == str ? NAN : x;
+}
+
+/////////////////////////////////////////////////////////////////////
+/*--------------------- modbus: MODBUS RTU寄存器映射 ---------------------*/
+/*
+ * 属性: Port, Baud(9600), Slave(1), Address(0), Count(通道最大索引+1), Priority(0),
+ *       Timeout(毫秒), Retry
+ * 通道: Index为寄存器相对Address的偏移
+ */
+class ModbusSensor : public SensorDriver {
+protected:
+	int idDev_;		///< 总线设备编号
+
+public:
+	ModbusSensor() {
+		idDev_ = 0;
+	}
+	virtual ~ModbusSensor() {
+		Stop();
+	}
+
+protected:
+	bool start(const Config& cfg, const Parameter* param) {
+		string port = cfg.get("<xmlattr>.Port", "");
+		int baud    = cfg.get("<xmlattr>.Baud", 9600);
+		if (port.empty() || !_gBus.AddPort(port, baud, cfg.get("<xmlattr>.Timeout", MODBUS_TIMEOUT),
+				cfg.get("<xmlattr>.Retry", MODBUS_RETRY)))
+			return false;
+
+		int count(0);
+		for (ChannelVec::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+			if (it->index >= count) count = it->index + 1;
+		}
+		BusDevice dev;
+		dev.name     = name_;
+		dev.port     = port;
+		dev.slave    = cfg.get("<xmlattr>.Slave",   1);
+		dev.addr     = cfg.get("<xmlattr>.Address", 0);
+		dev.count    = cfg.get("<xmlattr>.Count",   count);
+		dev.period   = period_;
+		dev.priority = cfg.get("<xmlattr>.Priority", 0);
+		idDev_ = _gBus.AddDevice(dev, keep_.Wrap(boost::bind(&ModbusSensor::on_reading, this, _1)));
+		return idDev_ != 0;
+	}
+
+	void stop() {
+		if (idDev_) _gBus.RemoveDevice(idDev_);
+	}
+
+	void on_reading(const BusReading& reading) {
+		if (reading.ec) publish_state(SAMPLE_NO_DATA);
+		else publish(std::vector<double>(reading.regs.begin(), reading.regs.end()));
+	}
+};
+REGISTER_SENSOR_DRIVER("modbus", ModbusSensor);
+
+/////////////////////////////////////////////////////////////////////
+/*--------------------- tcpline: TCP行协议 ---------------------*/
+/*
+ * 属性: Host, Port, Query(查询字符串), Separator(字段分隔符, 缺省",;"), MaxMissed(3)
+ * 反馈以换行结束. 通道: Index为字段序号
+ * 连续MaxMissed个周期无反馈时断开连接, 并在下一周期重新连接
+ */
+class LineSensor : public SensorDriver {
+protected:
+	string host_;		///< 设备地址
+	uint16_t port_;		///< 设备端口
+	string query_;		///< 查询字符串
+	string sep_;		///< 字段分隔符
+	int maxMissed_;		///< 最大连续无反馈周期数
+	int missed_;		///< 连续无反馈周期数
+	int idPoll_;		///< 调度任务: 采样
+	TcpCPtr tcp_;		///< 网络连接
+
+public:
+	LineSensor() {
+		port_      = 0;
+		maxMissed_ = 3;
+		missed_    = 0;
+		idPoll_    = 0;
+	}
+	virtual ~LineSensor() {
+		Stop();
+	}
+
+protected:
+	bool start(const Config& cfg, const Parameter* param) {
+		host_      = cfg.get("<xmlattr>.Host", "");
+		port_      = cfg.get("<xmlattr>.Port", 0);
+		query_     = cfg.get("<xmlattr>.Query", "");
+		sep_       = cfg.get("<xmlattr>.Separator", ",;");
+		maxMissed_ = cfg.get("<xmlattr>.MaxMissed", 3);
+		if (host_.empty() || !port_) return false;
+
+		idPoll_ = _gSched.Every(keep_, name_.c_str(), period_, boost::bind(&LineSensor::poll, this));
+		return true;
+	}
+
+	void stop() {
+		_gSched.Cancel(idPoll_);
+		tcp_.reset();
+	}
+
+	void poll() {
+		if (tcp_ && missed_ >= maxMissed_) {
+			_gLog.Write(LOG_WARN, "Sensor<%s>: no response from %s:%u, reconnect", name_.c_str(), host_.c_str(), port_);
+			publish_state(SAMPLE_NO_DATA);
+			tcp_.reset();
+		}
+		if (!tcp_) {// 异步连接, 下一周期开始查询
+			tcp_ = TcpClient::Create();
+			const TcpClient::CBSlot& slot = boost::bind(&LineSensor::handle_read, this, _1, _2);
+			const TcpClient::MsgSlot& slotMsg = boost::bind(&LineSensor::handle_line, this, _1, _2, _3);
+			tcp_->RegisterRead(slot);
+			tcp_->RegisterMessage(slotMsg);
+			tcp_->SetDelimFrame("\n", 1);
+			missed_ = 0;
+			if (!tcp_->Connect(host_.c_str(), port_)) {
+				tcp_.reset();
+				publish_state(SAMPLE_NO_DATA);
+			}
+		}
+		else if (tcp_->IsOpen()) {
+			if (!query_.empty()) tcp_->Write(query_.c_str(), query_.size());
+			++missed_;
+		}
+		else ++missed_;
+	}
+
+	void handle_read(TcpClient* client, const boost::system::error_code& ec) {
+		if (ec) keep_.Post(boost::bind(&LineSensor::closed, this, client));
+	}
+
+	/*
+	 * 在TcpClient的strand中解析并发布, 仅将应答标志投递到本实例的strand
+	 */
+	void handle_line(TcpClient* client, const char* data, size_t len) {
+		std::vector<string> tokens;
+		std::vector<double> raw;
+		string line(data, len);
+		trim(line);
+		if (line.empty()) return;
+		split(tokens, line, is_any_of(sep_));
+		for (size_t i = 0; i < tokens.size(); ++i) raw.push_back(parse_value(trim_copy(tokens[i])));
+		publish(raw);
+		keep_.Post(boost::bind(&LineSensor::answered, this, client));
+	}
+
+	void answered(TcpClient* client) {
+		if (client == tcp_.get()) missed_ = 0;
+	}
+
+	void closed(TcpClient* client) {
+		if (client != tcp_.get()) return; // 已重新连接
+		_gLog.Write(LOG_WARN, "Sensor<%s>: remote closed", name_.c_str());
+		publish_state(SAMPLE_NO_DATA);
+		tcp_.reset();
+	}
+};
+REGISTER_SENSOR_DRIVER("tcpline", LineSensor);
+
+/////////////////////////////////////////////////////////////////////
+/*--------------------- file: 文本文件 ---------------------*/
+/*
+ * 属性: Path(相对路径时位于采样目录下), MaxAge(秒, 300)
+ * 行格式: 键 = 值 或 键 值; #开头为注释. 通道: Key为键
+ * 文件更新且写入结束(修改时间早于1秒前)时解析; 超过MaxAge未更新时发布过期状态
+ */
+class FileSensor : public SensorDriver {
+protected:
+	string path_;		///< 文件路径
+	int maxAge_;		///< 最大未更新时长, 秒
+	std::time_t oldTime_;	///< 已解析文件的修改时间
+	int state_;			///< 最近发布的状态
+	int idPoll_;		///< 调度任务: 采样
+
+public:
+	FileSensor() {
+		maxAge_  = 300;
+		oldTime_ = 0;
+		state_   = -1;
+		idPoll_  = 0;
+	}
+	virtual ~FileSensor() {
+		Stop();
+	}
+
+protected:
+	bool start(const Config& cfg, const Parameter* param) {
+		path pathFile(cfg.get("<xmlattr>.Path", ""));
+		if (pathFile.empty()) return false;
+		if (pathFile.is_relative()) pathFile = path(param->sampleDir) / pathFile;
+		path_   = pathFile.string();
+		maxAge_ = cfg.get("<xmlattr>.MaxAge", 300);
+
+		idPoll_ = _gSched.Every(keep_, name_.c_str(), period_, boost::bind(&FileSensor::poll, this));
+		return true;
+	}
+
+	void stop() {
+		_gSched.Cancel(idPoll_);
+	}
+
+	void set_state(int state) {
+		if (state_ != state) publish_state(state_ = state);
+	}
+
+	void poll() {
+		try {
+			std::time_t now = std::time(NULL), mtime;
+			if (!exists(path_)) set_state(SAMPLE_NO_DATA);
+			else if ((mtime = last_write_time(path_)) != oldTime_) {
+				if (now - mtime >= 1) {// 写入已结束
+					oldTime_ = mtime;
+					resolve();
+				}
+			}
+			else if (now - mtime > maxAge_) set_state(SAMPLE_STALE);
+		}
+		catch(filesystem_error& ex) {
+			_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		}
+	}
+
+	void resolve() {
+		std::map<string, double> raw;
+		std::ifstream ifs(path_.c_str());
+		string line, key;
+		size_t pos;
+
+		while (std::getline(ifs, line)) {
+			trim(line);
+			if (line.empty() || line[0] == '#') continue;
+			if ((pos = line.find_first_of("= \t")) == string::npos) continue;
+			key = trim_copy(line.substr(0, pos));
+			raw[key] = parse_value(trim_left_copy_if(line.substr(pos), is_any_of("= \t")));
+		}
+		publish(raw);
+		state_ = SAMPLE_OK;
+	}
+};
+REGISTER_SENSOR_DRIVER("file", FileSensor);
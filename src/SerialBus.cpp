@@ -0,0 +1,188 @@
+/**
+ * @file SerialBus.cpp 串口总线管理: 多个RS-485串口, 每个串口挂接多个MODBUS从站设备
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <boost/bind/bind.hpp>
+#include <boost/bind/placeholders.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "SerialBus.h"
+#include "Scheduler.h"
+#include "GLog.h"
+
+using namespace boost::placeholders;
+using namespace boost::posix_time;
+namespace bchrono = boost::asio::chrono;
+
+SerialBus::SerialBus() {
+	idNext_ = 1;
+}
+
+SerialBus::~SerialBus() {
+	Stop();
+}
+
+bool SerialBus::AddPort(const string& name, int baud, int timeout, int retries) {
+	MtxLck lck(mtx_);
+	std::map<string, PortPtr>::iterator it = ports_.find(name);
+	if (it != ports_.end()) {
+		if (it->second->baud == baud) return true;
+		_gLog.Write(LOG_FAULT, "[%s:%s], port<%s> is already used with baud rate %d",
+			__FILE__, __FUNCTION__, name.c_str(), it->second->baud);
+		return false;
+	}
+
+	if (!keep_) keep_.reset(new BoostAsioKeep);
+	PortPtr port(new Port);
+	port->name     = name;
+	port->baud     = baud;
+	port->timeout  = timeout;
+	port->retries  = retries;
+	port->master   = ModbusMaster::Create();
+	port->failures = 0;
+	port->tmOpen   = SteadyTimer::clock_type::now() - bchrono::milliseconds(BUS_REOPEN_MS);
+	ports_[name] = port;
+	return true;
+}
+
+int SerialBus::AddDevice(const BusDevice& desc, const CBReading& cb) {
+	MtxLck lck(mtx_);
+	std::map<string, PortPtr>::iterator it = ports_.find(desc.port);
+	if (it == ports_.end() || !desc.count || desc.period <= 0) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], invalid device<%s> on port<%s>",
+			__FILE__, __FUNCTION__, desc.name.c_str(), desc.port.c_str());
+		return 0;
+	}
+
+	DevPtr dev(new Device);
+	dev->id      = idNext_++;
+	dev->desc    = desc;
+	dev->port    = it->second;
+	dev->cb      = cb;
+	dev->pending = false;
+	dev->seq     = 0;
+	dev->skips   = 0;
+	dev->idPoll  = _gSched.Every(*keep_, desc.name.c_str(), desc.period, boost::bind(&SerialBus::poll, this, dev->id));
+	devices_[dev->id] = dev;
+	return dev->id;
+}
+
+void SerialBus::RemoveDevice(int& id) {
+	MtxLck lck(mtx_);
+	std::map<int, DevPtr>::iterator it = devices_.find(id);
+	if (it != devices_.end()) {
+		_gSched.Cancel(it->second->idPoll);
+		devices_.erase(it);
+	}
+	id = 0;
+}
+
+bool SerialBus::Statistic(const string& name, ModbusStat& stat) {
+	MtxLck lck(mtx_);
+	std::map<string, PortPtr>::iterator it = ports_.find(name);
+	if (it == ports_.end()) return false;
+	stat = it->second->master->Statistic();
+	return true;
+}
+
+void SerialBus::Stop() {
+	std::map<string, PortPtr> ports;
+	{
+		MtxLck lck(mtx_);
+		for (std::map<int, DevPtr>::iterator it = devices_.begin(); it != devices_.end(); ++it)
+			_gSched.Cancel(it->second->idPoll);
+		devices_.clear();
+		ports.swap(ports_);
+	}
+	if (keep_) keep_->Stop();
+	for (std::map<string, PortPtr>::iterator it = ports.begin(); it != ports.end(); ++it)
+		it->second->master->Close();
+	if (keep_) keep_->Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+bool SerialBus::open_port(PortPtr port) {
+	if (port->master->IsOpen()) return true;
+
+	SteadyTimer::time_point now = SteadyTimer::clock_type::now();
+	if (now - port->tmOpen < bchrono::milliseconds(BUS_REOPEN_MS)) return false;
+	port->tmOpen = now;
+	if (!port->master->Open(port->name.c_str(), port->baud)) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to open port<%s>", __FILE__, __FUNCTION__, port->name.c_str());
+		return false;
+	}
+	port->master->SetTimeout(port->timeout, port->retries);
+	port->failures = 0;
+	_gLog.Write("Serial Bus: port<%s> opened, baud rate = %d", port->name.c_str(), port->baud);
+	return true;
+}
+
+void SerialBus::close_port(PortPtr port) {
+	ModbusStat stat = port->master->Statistic();
+	_gLog.Write(LOG_WARN, "Serial Bus: port<%s> no response, requests = %llu, timeouts = %llu, crc errors = %llu",
+		port->name.c_str(), stat.requests, stat.timeouts, stat.crcErrors);
+	// 主站丢弃未完成的事务, 不再回调
+	port->master->Close();
+	MtxLck lck(mtx_);
+	for (std::map<int, DevPtr>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
+		if (it->second->port == port) it->second->pending = false;
+	}
+}
+
+void SerialBus::poll(int id) {
+	DevPtr dev;
+	{
+		MtxLck lck(mtx_);
+		std::map<int, DevPtr>::iterator it = devices_.find(id);
+		if (it == devices_.end()) return;
+		dev = it->second;
+	}
+	if (dev->pending) {
+		++dev->skips;
+		return;
+	}
+	if (!open_port(dev->port)) {
+		publish(dev, BUS_PORT_ERR, ModbusMaster::RegVec());
+		return;
+	}
+
+	const BusDevice& desc = dev->desc;
+	dev->pending = true;
+	if (!dev->port->master->ReadHolding(desc.slave, desc.addr, desc.count,
+			keep_->Wrap(boost::bind(&SerialBus::on_reading, this, dev, ++dev->seq, _1, _2)), desc.priority)) {
+		dev->pending = false;
+		publish(dev, BUS_PORT_ERR, ModbusMaster::RegVec());
+	}
+}
+
+void SerialBus::on_reading(DevPtr dev, unsigned seq, int ec, const ModbusMaster::RegVec& regs) {
+	if (!dev->pending || seq != dev->seq) return; // 串口已被关闭
+	dev->pending = false;
+
+	PortPtr port = dev->port;
+	if (ec == MODBUS_SUCCESS || ec == MODBUS_EXCEPTION) port->failures = 0;
+	else if (++port->failures >= BUS_FAIL_CLOSE) close_port(port);
+	publish(dev, ec, regs);
+}
+
+void SerialBus::publish(DevPtr dev, int ec, const ModbusMaster::RegVec& regs) {
+	{// 已注销的设备
+		MtxLck lck(mtx_);
+		if (!devices_.count(dev->id)) return;
+	}
+
+	const BusDevice& desc = dev->desc;
+	BusReading reading;
+	reading.name = desc.name;
+	reading.ec   = ec;
+	reading.utc  = microsec_clock::universal_time();
+	if (ec == MODBUS_SUCCESS) {
+		reading.regs = regs;
+		for (size_t i = 0; i < regs.size(); ++i) {
+			double x = desc.sign ? (double) (int16_t) regs[i] : (double) regs[i];
+			reading.values.push_back(i < desc.scale.size() ? x * desc.scale[i] : x);
+		}
+	}
+	if (dev->cb) dev->cb(reading);
+}
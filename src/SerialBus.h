@@ -0,0 +1,185 @@
+/**
+ * @file SerialBus.h 串口总线管理: 多个RS-485串口, 每个串口挂接多个MODBUS从站设备
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 总线管理器持有全部串口(ModbusMaster). 不同串口的事务并行执行, 同一串口的事务按优先级排队
+ * - 设备描述: 串口、从站地址、寄存器区间、换算系数、采样周期和优先级
+ * - 各设备的采样由调度器驱动. 周期相同的设备同时提交查询, 由主站按优先级依次发送
+ * - 前次查询尚未结束时跳过本次采样
+ * - 串口按需打开; 连续失败达到阈值时关闭, 并在下次采样时重新打开
+ * - 换算后的读数通过回调函数发布. 回调函数在总线的strand中执行
+ */
+
+#ifndef SERIAL_BUS_H_
+#define SERIAL_BUS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "ModbusMaster.h"
+
+using std::string;
+
+#define BUS_FAIL_CLOSE		6		///< 串口连续失败次数达到该值时关闭串口
+#define BUS_REOPEN_MS		5000	///< 重新打开串口的最小间隔, 毫秒
+
+/**
+ * @brief 读数结果. 除MODBUS事务结果外的附加值
+ */
+enum {
+	BUS_PORT_ERR = -1	///< 串口未打开
+};
+
+/**
+ * @brief 设备描述
+ */
+struct BusDevice {
+	string name;		///< 设备名称
+	string port;		///< 串口名称
+	uint8_t slave;		///< 从站地址
+	uint16_t addr;		///< 起始寄存器地址
+	uint16_t count;		///< 寄存器数量
+	std::vector<double> scale;	///< 各寄存器的换算系数. 缺省为1
+	bool sign;			///< 寄存器数值为有符号16位整数
+	int period;			///< 采样周期, 毫秒
+	int priority;		///< 优先级. 数值大者先发送
+
+public:
+	BusDevice() {
+		slave  = 0;
+		addr   = count = 0;
+		sign   = false;
+		period = 1000;
+		priority = 0;
+	}
+};
+
+/**
+ * @brief 设备读数
+ */
+struct BusReading {
+	string name;	///< 设备名称
+	int ec;			///< 结果. MODBUS_SUCCESS: 正确
+	boost::posix_time::ptime utc;	///< 采样时间
+	ModbusMaster::RegVec regs;		///< 寄存器原始数值
+	std::vector<double> values;		///< 换算后的数值
+};
+
+class SerialBus {
+public:
+	SerialBus();
+	virtual ~SerialBus();
+
+public:
+	/* 数据类型 */
+	/*!
+	 * @brief 读数回调函数
+	 * @param _1  读数
+	 */
+	typedef boost::function<void (const BusReading&)> CBReading;
+
+protected:
+	/* 串口 */
+	struct Port {
+		string name;	///< 串口名称
+		int baud;		///< 波特率
+		int timeout;	///< 反馈超时, 毫秒
+		int retries;	///< 重试次数
+		ModbusPtr master;	///< MODBUS主站
+		int failures;	///< 连续失败次数
+		SteadyTimer::time_point tmOpen;	///< 最近一次打开串口的时间
+	};
+	typedef boost::shared_ptr<Port> PortPtr;
+
+	/* 设备 */
+	struct Device {
+		int id;				///< 设备编号
+		BusDevice desc;		///< 设备描述
+		PortPtr port;		///< 所在串口
+		CBReading cb;		///< 回调函数
+		int idPoll;			///< 调度任务: 采样
+		bool pending;		///< 查询尚未结束
+		unsigned seq;		///< 查询序号
+		unsigned long long skips;	///< 跳过的采样次数
+	};
+	typedef boost::shared_ptr<Device> DevPtr;
+
+protected:
+	/* 成员变量 */
+	boost::scoped_ptr<BoostAsioKeep> keep_;	///< 线程池句柄. 首次登记串口时创建: _gBus为全局对象, 此时线程池已启动
+	boost::mutex mtx_;		///< 互斥锁: 串口和设备
+	std::map<string, PortPtr> ports_;	///< 串口
+	std::map<int, DevPtr> devices_;		///< 设备
+	int idNext_;	///< 下一个设备编号
+
+public:
+	/* 接口 */
+	/*!
+	 * @brief 登记串口. 串口在首次采样时打开
+	 * @param name     串口名称
+	 * @param baud     波特率
+	 * @param timeout  反馈超时, 毫秒
+	 * @param retries  重试次数
+	 * @return
+	 * false: 串口已以不同波特率登记
+	 */
+	bool AddPort(const string& name, int baud = 9600, int timeout = MODBUS_TIMEOUT, int retries = MODBUS_RETRY);
+	/*!
+	 * @brief 登记设备, 并开始周期采样
+	 * @param desc  设备描述. 所在串口须已登记
+	 * @param cb    回调函数
+	 * @return
+	 * 设备编号. 0: 失败
+	 */
+	int AddDevice(const BusDevice& desc, const CBReading& cb);
+	/*!
+	 * @brief 注销设备. 注销后不再采样, 正在执行的回调函数不受影响
+	 * @param id  设备编号. 注销后置为0
+	 */
+	void RemoveDevice(int& id);
+	/*!
+	 * @brief 查看串口统计量
+	 * @return
+	 * 串口是否已登记
+	 */
+	bool Statistic(const string& name, ModbusStat& stat);
+	/*!
+	 * @brief 注销全部设备, 关闭全部串口
+	 */
+	void Stop();
+
+protected:
+	/*!
+	 * @brief 按需打开串口
+	 * @return
+	 * 串口是否已打开
+	 */
+	bool open_port(PortPtr port);
+	/*!
+	 * @brief 关闭串口, 并结束其上全部设备的查询
+	 */
+	void close_port(PortPtr port);
+	/*!
+	 * @brief 调度任务: 采样
+	 */
+	void poll(int id);
+	/*!
+	 * @brief 查询结果
+	 * @param dev   设备
+	 * @param seq   查询序号
+	 * @param ec    事务结果
+	 * @param regs  寄存器数值
+	 */
+	void on_reading(DevPtr dev, unsigned seq, int ec, const ModbusMaster::RegVec& regs);
+	/*!
+	 * @brief 换算并发布读数
+	 */
+	void publish(DevPtr dev, int ec, const ModbusMaster::RegVec& regs);
+};
+
+extern SerialBus _gBus;
+
+#endif
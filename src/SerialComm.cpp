@@ -4,6 +4,7 @@
  * @date 2017-10-10
  */
 #include <boost/bind/bind.hpp>
+#include <boost/array.hpp>
 #include <boost/asio/placeholders.hpp>
 #include "SerialComm.h"
 
@@ -16,9 +17,11 @@ using boost::system::error_code;
 SerialComm::SerialComm()
 	: port_(keep_.GetIOService()) {
 	bufrcv_.reset(new char[SERIAL_BUFF_SIZE]);
-	crcrcv_.set_capacity(SERIAL_BUFF_SIZE * 10);
-	crcsnd_.set_capacity(SERIAL_BUFF_SIZE * 10);
-	msglen_ = 0;
+	rcv_.SetCapacity(SERIAL_BUFF_SIZE * 16);
+	snd_.SetCapacity(SERIAL_BUFF_SIZE * 16);
+	rdptr_   = NULL;
+	writing_ = false;
+	msglen_  = 0;
 }
 
 SerialComm::~SerialComm() {
@@ -30,6 +33,10 @@ bool SerialComm::Open(const char* portname, const int baud_rate) {
 	error_code ec;
 	port_.open(portname, ec);
 	if (!ec) {
+		keep_.Reset();
+		rcv_.Clear();
+		snd_.Clear();
+		writing_ = false;
 		port_.set_option(serial_port::baud_rate(baud_rate));
 		port_.set_option(serial_port::stop_bits(serial_port::stop_bits::one));
 		port_.set_option(serial_port::parity(serial_port::parity::none));
@@ -43,6 +50,7 @@ bool SerialComm::Open(const char* portname, const int baud_rate) {
 void SerialComm::Close() {
 	if (port_.is_open()) {
 		error_code ec;
+		keep_.Stop();
 		port_.close(ec);
 	}
 }
@@ -56,25 +64,16 @@ bool SerialComm::IsOpen() {
 }
 
 int SerialComm::Lookup(const char* flag, const size_t len, const size_t from) {
-	if (!flag || len <= 0 || from < 0) return -1;
-
 	MtxLck lck(mtxrcv_);
-	size_t n(crcrcv_.size() - len), pos, i(0), j;
-	for (pos = from, i = -1; i != len && pos <= n; ++pos) {
-		for (i = 0, j = pos; i < len && flag[i] == crcrcv_[j]; ++i, ++j);
-	}
-	return (i == len) ? (pos - 1) : -1;
+	return rcv_.Find(flag, len, from);
 }
 
 int SerialComm::Write(const char* buff, const size_t len) {
 	if (!buff || len <= 0 || !port_.is_open()) return 0;
 
 	MtxLck lck(mtxsnd_);
-	size_t n0(crcsnd_.size()), n(crcsnd_.capacity() - n0), i;
-
-	if (n > len) n = len;
-	for (i = 0; i < n; ++i) crcsnd_.push_back(buff[i]);
-	if (!n0 && port_.is_open()) start_write();
+	size_t n = snd_.Push(buff, len);
+	if (!writing_) start_write();
 	return n;
 }
 
@@ -82,14 +81,8 @@ int SerialComm::Read(char* buff, const size_t len, const size_t from, bool erase
 	if (!buff || len == 0) return 0;
 
 	MtxLck lck(mtxrcv_);
-	size_t end(from + len);
-	size_t to_read = crcrcv_.size() > end ? len : crcrcv_.size() - from;
-
-	if (to_read) {
-		size_t i, j;
-		for (i = 0, j = from; i < to_read; ++i, ++j) buff[i] = crcrcv_[j];
-		if (erase) crcrcv_.erase_begin(end);
-	}
+	size_t to_read = rcv_.Peek(buff, len, from);
+	if (to_read && erase) rcv_.Erase(from + to_read);
 	return to_read;
 }
 
@@ -106,35 +99,54 @@ void SerialComm::RegisterWrite(const CBSlot& slot) {
 }
 
 void SerialComm::handle_read(const error_code& ec, size_t n) {
-	if (!ec) {
+	size_t size;
+	{
 		MtxLck lock(mtxrcv_);
-		for(size_t i = 0; i < n; ++i) crcrcv_.push_back(bufrcv_[i]);
+		if (!ec) {
+			if (rdptr_ == bufrcv_.get()) rcv_.Push(rdptr_, n, true);
+			else rcv_.Commit(n);
+		}
+		size = rcv_.Size();
 	}
-	if (msglen_ == 0 || crcrcv_.size() >= msglen_)
-		cbrcv_(this, ec.value(), crcrcv_.size());
+	if (msglen_ == 0 || size >= msglen_)
+		cbrcv_(this, ec.value(), size);
 	if (!ec) start_read();
 }
 
 void SerialComm::handle_write(const error_code& ec, size_t n) {
-	if (!ec) {
+	{
 		MtxLck lock(mtxsnd_);
-		crcsnd_.erase_begin(n);
+		if (!ec) {
+			snd_.Erase(n);
+			start_write();
+		}
+		else writing_ = false;
 	}
 	cbsnd_(this, ec.value(), n);
-	if (!ec) start_write();
 }
 
 void SerialComm::start_read() {
-	port_.async_read_some(buffer(bufrcv_.get(), SERIAL_BUFF_SIZE),
-			boost::bind(&SerialComm::handle_read, this,
-					placeholders::error, placeholders::bytes_transferred));
+	size_t n;
+	{// 优先直接写入接收缓冲区的空闲区
+		MtxLck lock(mtxrcv_);
+		rdptr_ = rcv_.WriteSpan(n);
+		if (!n) {
+			rdptr_ = bufrcv_.get();
+			n = SERIAL_BUFF_SIZE;
+		}
+	}
+	port_.async_read_some(buffer(rdptr_, n),
+			keep_.Wrap(boost::bind(&SerialComm::handle_read, this,
+					placeholders::error, placeholders::bytes_transferred)));
 }
 
 void SerialComm::start_write() {
-	int n(crcsnd_.size());
-	if (n) {
-		port_.async_write_some(boost::asio::buffer(crcsnd_.linearize(), n),
-				boost::bind(&SerialComm::handle_write, this,
-						placeholders::error, placeholders::bytes_transferred));
+	const char *p1, *p2;
+	size_t n1, n2;
+	if ((writing_ = snd_.Spans(p1, n1, p2, n2) > 0)) {
+		boost::array<const_buffer, 2> bufs = {{ buffer(p1, n1), buffer(p2, n2) }};
+		port_.async_write_some(bufs,
+				keep_.Wrap(boost::bind(&SerialComm::handle_write, this,
+						placeholders::error, placeholders::bytes_transferred)));
 	}
 }
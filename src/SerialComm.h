@@ -23,6 +23,7 @@
 #include <boost/system/error_code.hpp>
 #include "BoostInclude.h"
 #include "BoostAsioKeep.h"
+#include "ByteRing.h"
 
 using std::string;
 
@@ -46,15 +47,17 @@ public:
 
 protected:
 	/* 成员变量 */
-	BoostAsioKeep keep_;	//< 提供io_service对象
+	BoostAsioKeep keep_;	//< 线程池句柄: 串行化回调函数, 并在实例销毁前丢弃未执行的回调函数
 	boost::asio::serial_port port_;	//< 串口
 	CBF  cbrcv_;	//< receive回调函数
 	CBF  cbsnd_;	//< send回调函数
 	size_t  msglen_;	//< 读取信息长度
 
-	ArrayChar bufrcv_;		//< 单条接收缓冲区
-	ArrayCharCrc crcrcv_;	//< 循环接收缓冲区
-	ArrayCharCrc crcsnd_;	//< 循环发送缓冲区
+	ArrayChar bufrcv_;		//< 单条接收缓冲区: 循环接收缓冲区已满时使用
+	char* rdptr_;			//< 正在执行的异步读操作的写入位置
+	ByteRing rcv_;			//< 循环接收缓冲区. 异步读操作直接写入其空闲区
+	ByteRing snd_;			//< 循环发送缓冲区. 以两段连续内存直接发送
+	bool writing_;			//< 正在执行异步写操作
 	boost::mutex mtxrcv_;	//< 接收互斥锁
 	boost::mutex mtxsnd_;	//< 发送互斥锁
 
@@ -144,6 +147,8 @@ protected:
 	void start_read();
 	/*!
 	 * @brief 尝试发送缓冲区数据
+	 * @note
+	 * 调用者持有发送互斥锁
 	 */
 	void start_write();
 };
@@ -0,0 +1,267 @@
+/**
+ * @file SkyProjection.cpp 全天图像投影表: 合并像元到天区的索引
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <boost/thread/thread.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include "ADefine.h"
+#include "ATimeSpace.h"
+#include "Parameter.h"
+#include "SkyProjection.h"
+#include "GLog.h"
+#include "AsioPool.h"
+
+using namespace boost::interprocess;
+using namespace AstroUtil;
+
+#define PROJ_BAND_ROWS	64	///< 单个线程处理的最少行数
+
+/* 天区表和索引在文件中的偏移量 */
+static size_t zones_offset() {
+	return sizeof(ProjHeader);
+}
+
+static size_t index_offset(int zones) {
+	return (zones_offset() + zones * sizeof(ProjZone) + 7) & ~size_t(7);
+}
+
+SkyProjection::SkyProjection() {
+	header_ = NULL;
+	zones_  = NULL;
+	index_  = NULL;
+}
+
+SkyProjection::~SkyProjection() {
+}
+
+bool SkyProjection::Load(const std::string& filePath, const AllSkyLens& lens, const Parameter* param, int width, int height, int bin) {
+	if (bin < 1 || param->gridAzStep <= 0.0 || param->gridElStep <= 0.0 || param->gridElMin >= 90.0) return false;
+
+	ProjHeader header;
+	memset(&header, 0, sizeof(ProjHeader));
+	lens_ = lens;
+	memcpy(header.magic, PROJ_MAGIC, sizeof(header.magic));
+	header.width    = width;
+	header.height   = height;
+	header.bin      = bin;
+	header.wBin     = width / bin;
+	header.hBin     = height / bin;
+	header.zones    = int(360.0 / param->gridAzStep + 0.5) * int(ceil((90.0 - param->gridElMin) / param->gridElStep - 1E-6));
+	header.flip     = lens_.flip ? 1 : 0;
+	header.x0       = lens_.x0;
+	header.y0       = lens_.y0;
+	header.scale    = lens_.scale;
+	header.rotation = lens_.rotation;
+	header.k2       = lens_.k2;
+	header.k3       = lens_.k3;
+	header.azStep   = param->gridAzStep;
+	header.elStep   = param->gridElStep;
+	header.elMin    = param->gridElMin;
+	if (header.zones > PROJ_ZONE_MAX) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], too many zones[%d]", __FILE__, __FUNCTION__, header.zones);
+		return false;
+	}
+
+	if (map(filePath, header)) return true;
+	_gLog.Write("building sky projection table [%s]", filePath.c_str());
+	return build(filePath, header) && map(filePath, header);
+}
+
+bool SkyProjection::map(const std::string& filePath, const ProjHeader& header) {
+	region_.reset();
+	header_ = NULL;
+	zones_  = NULL;
+	index_  = NULL;
+
+	try {
+		if (!boost::filesystem::exists(filePath)) return false;
+		size_t size = index_offset(header.zones) + size_t(header.wBin) * header.hBin * sizeof(int16_t);
+		if (boost::filesystem::file_size(filePath) != size) return false;
+
+		file_mapping file(filePath.c_str(), read_only);
+		region_.reset(new mapped_region(file, read_only));
+		const char* base = (const char*) region_->get_address();
+		if (memcmp(base, &header, sizeof(ProjHeader))) {
+			region_.reset();
+			return false;
+		}
+		header_ = (const ProjHeader*) base;
+		zones_  = (const ProjZone*) (base + zones_offset());
+		index_  = (const int16_t*) (base + index_offset(header.zones));
+		return true;
+	}
+	catch(std::exception& ex) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
+		region_.reset();
+		return false;
+	}
+}
+
+bool SkyProjection::build(const std::string& filePath, const ProjHeader& header) {
+	int nAz = int(360.0 / header.azStep + 0.5);
+	int nEl = header.zones / nAz;
+	int n = header.zones, wBin = header.wBin, hBin = header.hBin;
+	int i, a, b, x, y, k;
+	double azi, ele, el1, el2;
+	std::vector<ProjZone> zones(n);
+	std::vector<int16_t> index(size_t(wBin) * hBin, -1);
+
+	// 天区: 高度角降序, 同一高度带内方位角升序
+	{
+		ATimeSpace ats;
+		std::vector<double> alt(n), am(n);
+		for (b = 0, i = 0; b < nEl; ++b) {
+			el2 = 90.0 - b * header.elStep;
+			el1 = el2 - header.elStep;
+			if (el1 < header.elMin) el1 = header.elMin;
+			for (a = 0; a < nAz; ++a, ++i) {
+				zones[i].azi  = float((a + 0.5) * header.azStep);
+				zones[i].ele  = float((el1 + el2) * 0.5);
+				zones[i].area = 0.0f;
+				alt[i] = zones[i].ele * AU_D2R;
+			}
+		}
+		ats.AirmassBatch(n, &alt[0], &am[0]);
+		for (i = 0; i < n; ++i) zones[i].airmass = float(am[i]);
+	}
+
+	// 索引: 合并像元中心投影到天区
+	AllSkyLens lens(lens_);
+	std::vector<double> area(n, 0.0);
+	lens.x0    = (lens_.x0 + 0.5) / header.bin - 0.5;
+	lens.y0    = (lens_.y0 + 0.5) / header.bin - 0.5;
+	lens.scale = lens_.scale / header.bin;
+	for (y = 0, k = 0; y < hBin; ++y) {
+		for (x = 0; x < wBin; ++x, ++k) {
+			lens.Pixel2Horizon(x, y, azi, ele);
+			if (ele < header.elMin || ele > 90.0) continue;
+			b = int((90.0 - ele) / header.elStep);
+			if (b >= nEl) b = nEl - 1;
+			a = int(azi / header.azStep) % nAz;
+			index[k] = int16_t(i = b * nAz + a);
+			area[i] += lens.PixelArea(ele);
+		}
+	}
+	for (i = 0; i < n; ++i) zones[i].area = float(area[i]);
+
+	// 写入临时文件后替换, 避免其它进程映射到不完整的文件
+	std::string pathTmp = filePath + ".tmp";
+	FILE* fp = fopen(pathTmp.c_str(), "wb");
+	if (!fp) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to create [%s]", __FILE__, __FUNCTION__, pathTmp.c_str());
+		return false;
+	}
+	static const char pad[8] = {0};
+	size_t npad = index_offset(n) - zones_offset() - n * sizeof(ProjZone);
+	bool ok = fwrite(&header, sizeof(ProjHeader), 1, fp) == 1
+		&& fwrite(&zones[0], sizeof(ProjZone), n, fp) == size_t(n)
+		&& (!npad || fwrite(pad, 1, npad, fp) == npad)
+		&& fwrite(&index[0], sizeof(int16_t), index.size(), fp) == index.size();
+	ok = (fclose(fp) == 0) && ok;
+	if (ok) {
+		boost::system::error_code ec;
+		boost::filesystem::rename(pathTmp, filePath, ec);
+		ok = !ec;
+	}
+	if (!ok) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to write [%s]", __FILE__, __FUNCTION__, filePath.c_str());
+		boost::system::error_code ec;
+		boost::filesystem::remove(pathTmp, ec);
+	}
+	return ok;
+}
+
+int SkyProjection::band_threads() const {
+	int nthrd = _gPool.IsRunning() ? _gPool.ThreadCount() + 1 : 1;
+	int nmax  = header_->hBin / PROJ_BAND_ROWS;
+	if (nthrd > nmax) nthrd = nmax;
+	return nthrd < 1 ? 1 : nthrd;
+}
+
+template <class Func>
+void SkyProjection::parallel(int nthrd, const Func& band) const {
+	int h = header_->hBin;
+	if (nthrd == 1) band(0, h, 0);
+	else {// 线程池执行其余行带, 本线程执行第一个
+		boost::mutex mtx;
+		boost::condition_variable cvDone;
+		int left = nthrd - 1;
+		for (int i = 1; i < nthrd; ++i) {
+			_gPool.GetIOService().post([&band, &mtx, &cvDone, &left, h, i, nthrd]() {
+				band(h * i / nthrd, h * (i + 1) / nthrd, i);
+				MtxLck lck(mtx);
+				if (--left == 0) cvDone.notify_one();
+			});
+		}
+		band(0, h / nthrd, 0);
+		// 任务引用本函数的局部变量: 等待期间不响应线程中断
+		boost::this_thread::disable_interruption di;
+		MtxLck lck(mtx);
+		while (left) cvDone.wait(lck);
+	}
+}
+
+void SkyProjection::Moments(const float* img, const double* clip, ZoneMomentVec& moms) const {
+	int n = Zones(), i;
+	moms.assign(n, ZoneMoment());
+	if (!n) return;
+
+	int nthrd = band_threads(), w = header_->wBin;
+	std::vector<ZoneMomentVec> part(nthrd, ZoneMomentVec(n));
+	parallel(nthrd, [&](int y0, int y1, int t) {
+		ZoneMoment* acc = &part[t][0];
+		const int16_t* idx = index_ + size_t(y0) * w;
+		const float* pix = img + size_t(y0) * w;
+		for (size_t k = 0, m = size_t(y1 - y0) * w; k < m; ++k) {
+			int z = idx[k];
+			if (z < 0) continue;
+			double v = pix[k];
+			if (clip && v >= clip[z]) continue;
+			ZoneMoment& mo = acc[z];
+			++mo.count;
+			mo.sum += v;
+			mo.sq  += v * v;
+		}
+	});
+	for (int t = 0; t < nthrd; ++t) {
+		for (i = 0; i < n; ++i) {
+			moms[i].count += part[t][i].count;
+			moms[i].sum   += part[t][i].sum;
+			moms[i].sq    += part[t][i].sq;
+		}
+	}
+}
+
+void SkyProjection::CountPeaks(const float* img, const double* thresh, std::vector<int>& counts) const {
+	int n = Zones(), i;
+	counts.assign(n, 0);
+	if (!n) return;
+
+	int nthrd = band_threads(), w = header_->wBin, h = header_->hBin;
+	std::vector<std::vector<int> > part(nthrd, std::vector<int>(n, 0));
+	parallel(nthrd, [&](int y0, int y1, int t) {
+		int* acc = &part[t][0];
+		if (y0 < 1) y0 = 1;
+		if (y1 > h - 1) y1 = h - 1;
+		for (int y = y0; y < y1; ++y) {
+			const int16_t* idx = index_ + size_t(y) * w;
+			const float* c = img + size_t(y) * w;
+			for (int x = 1; x < w - 1; ++x) {
+				int z = idx[x];
+				if (z < 0) continue;
+				float v = c[x];
+				if (v <= thresh[z]) continue;
+				if (v >  c[x - w - 1] && v >  c[x - w] && v >  c[x - w + 1] && v >  c[x - 1]
+				 && v >= c[x + 1]     && v >= c[x + w - 1] && v >= c[x + w] && v >= c[x + w + 1]) ++acc[z];
+			}
+		}
+	});
+	for (int t = 0; t < nthrd; ++t) {
+		for (i = 0; i < n; ++i) counts[i] += part[t][i];
+	}
+}
@@ -0,0 +1,176 @@
+/**
+ * @file SkyProjection.h 全天图像投影表: 合并像元到天区的索引
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 镜头标定或天区网格变化时生成一次, 存储为二进制文件, 启动时以内存映射方式加载
+ * - 文件头记录图像尺寸、合并因子、镜头模型和天区网格, 与当前配置或标定结果不一致时重新生成
+ * - 文件结构: 文件头 + 天区表(ProjZone * 天区数) + 索引(int16_t * 合并像元数).
+ *   索引为-1的像元不属于任何天区
+ * - 天区统计为按行带并行的单次线性扫描: 各线程累加至独立的缓冲区后合并
+ * - 行带由进程级线程池AsioPool执行, 调用线程执行第一个行带并等待其余行带结束
+ */
+
+#ifndef SKY_PROJECTION_H_
+#define SKY_PROJECTION_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <math.h>
+#include <boost/scoped_ptr.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "AllSkyLens.h"
+
+#define PROJ_MAGIC		"WMPROJ02"	///< 文件标志及版本
+#define PROJ_ZONE_MAX	32767		///< 天区数量上限: int16_t索引
+
+/**
+ * @brief 投影表文件头
+ * @note
+ * 全部成员参与一致性比较, 不得存在填充字节
+ */
+struct ProjHeader {
+	char magic[8];		///< 文件标志
+	int32_t width;		///< 图像宽度
+	int32_t height;		///< 图像高度
+	int32_t bin;		///< 合并因子
+	int32_t wBin;		///< 合并图像宽度
+	int32_t hBin;		///< 合并图像高度
+	int32_t zones;		///< 天区数量
+	int32_t flip;		///< 镜头: 方位角沿图像逆时针增加
+	int32_t reserved;	///< 保留, 0
+	double x0, y0;		///< 镜头: 天顶像元坐标
+	double scale;		///< 镜头: 投影比例, 像元/度
+	double rotation;	///< 镜头: 图像向上方向的方位角
+	double k2, k3;		///< 镜头: 径向畸变系数
+	double azStep;		///< 天区方位步长, 角度
+	double elStep;		///< 天区高度步长, 角度
+	double elMin;		///< 天区最低高度角, 角度
+};
+
+/**
+ * @brief 天区表的单条记录
+ */
+struct ProjZone {
+	float azi;		///< 中心方位角, 角度, 北零点
+	float ele;		///< 中心高度角, 角度
+	float airmass;	///< 中心大气质量
+	float area;		///< 在图像内的立体角, 平方度. 0: 天区位于图像外
+};
+
+/**
+ * @brief 单个天区的一阶和二阶矩
+ */
+struct ZoneMoment {
+	int count;		///< 像元数
+	double sum;		///< 累加值
+	double sq;		///< 平方累加值
+
+public:
+	ZoneMoment() {
+		count = 0;
+		sum = sq = 0.0;
+	}
+	double Mean() const {
+		return count ? sum / count : 0.0;
+	}
+	double Sigma() const {
+		if (count < 2) return 0.0;
+		double var = (sq - sum * sum / count) / (count - 1);
+		return var > 0.0 ? sqrt(var) : 0.0;
+	}
+};
+typedef std::vector<ZoneMoment> ZoneMomentVec;
+
+class SkyProjection {
+protected:
+	boost::scoped_ptr<boost::interprocess::mapped_region> region_;	///< 投影表文件映射
+	const ProjHeader* header_;	///< 文件头
+	const ProjZone* zones_;		///< 天区表
+	const int16_t* index_;		///< 合并像元的天区索引
+	AllSkyLens lens_;			///< 镜头模型: 原始图像
+
+public:
+	SkyProjection();
+	~SkyProjection();
+
+public:
+	/*!
+	 * @brief 加载投影表. 文件不存在或与当前配置不一致时重新生成
+	 * @param filePath  投影表文件路径
+	 * @param lens      镜头模型: 原始图像
+	 * @param param     配置参数: 天区网格
+	 * @param width     图像宽度
+	 * @param height    图像高度
+	 * @param bin       合并因子
+	 * @return
+	 * 加载结果
+	 */
+	bool Load(const std::string& filePath, const AllSkyLens& lens, const Parameter* param, int width, int height, int bin);
+	/*!
+	 * @brief 检查投影表是否适用于尺寸为width*height的图像
+	 */
+	bool Match(int width, int height) const {
+		return header_ && header_->width == width && header_->height == height;
+	}
+	int Zones() const {
+		return header_ ? header_->zones : 0;
+	}
+	int Bin() const {
+		return header_ ? header_->bin : 0;
+	}
+	int WidthBin() const {
+		return header_ ? header_->wBin : 0;
+	}
+	int HeightBin() const {
+		return header_ ? header_->hBin : 0;
+	}
+	const ProjZone& Zone(int i) const {
+		return zones_[i];
+	}
+	const int16_t* Index() const {
+		return index_;
+	}
+	const AllSkyLens& Lens() const {
+		return lens_;
+	}
+	/*!
+	 * @brief 按天区累加合并图像的一阶和二阶矩
+	 * @param img    合并图像
+	 * @param clip   各天区的上限, 不小于上限的像元不参与累加. NULL: 不限制
+	 * @param moms   统计结果. 长度: 天区数
+	 */
+	void Moments(const float* img, const double* clip, ZoneMomentVec& moms) const;
+	/*!
+	 * @brief 按天区统计高于阈值的局部极大值数量
+	 * @param img     合并图像
+	 * @param thresh  各天区的阈值
+	 * @param counts  统计结果. 长度: 天区数
+	 * @note
+	 * 相等的相邻像元只计一次. 图像边缘像元不参与统计
+	 */
+	void CountPeaks(const float* img, const double* thresh, std::vector<int>& counts) const;
+
+protected:
+	/*!
+	 * @brief 生成投影表文件
+	 */
+	bool build(const std::string& filePath, const ProjHeader& header);
+	/*!
+	 * @brief 映射投影表文件并校验文件头
+	 */
+	bool map(const std::string& filePath, const ProjHeader& header);
+	/*!
+	 * @brief 行带并行的线程数量: 线程池线程数+1(调用线程), 不超过行带数
+	 */
+	int band_threads() const;
+	/*!
+	 * @brief 并行执行: 图像按行带划分给nthrd个线程
+	 * @param band  处理函数: (首行, 尾行+1, 线程序号)
+	 */
+	template <class Func>
+	void parallel(int nthrd, const Func& band) const;
+};
+
+#endif
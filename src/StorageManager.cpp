@@ -0,0 +1,644 @@
+/**
+ * @file StorageManager.cpp 存储空间管理: 按索引增量维护和清理历史数据
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <fitsio.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#include "StorageManager.h"
+#include "GLog.h"
+
+using namespace boost::filesystem;
+using namespace boost::posix_time;
+
+#ifdef __linux__
+#define IOPRIO_WHO_PROCESS	1
+#define IOPRIO_CLASS_IDLE	3
+#define IOPRIO_CLASS_SHIFT	13
+#endif
+
+static const char* type_name[STORE_CLASSES] = {"raw", "archive", "product", "log"};
+
+/* 产品和日志的根目录, 位于测量数据目录下, 其下为Y<year>目录 */
+static const char* product_root[] = {"CloudAge", "WeaFile"};
+static const char* log_root[] = {"Weather", "SQM", "Sensors"};	///< 另有云量相机的<prefix>目录
+
+/*
+ * 由名称末尾的数字提取日期: 8位为YYYYMMDD, 6位为YYMMDD. 无效时返回0
+ */
+static int unit_date(const std::string& name) {
+	int n = name.size(), i = n, date(0);
+	while (i > 0 && isdigit(name[i - 1])) --i;
+	if (n - i == 6) date = 20000000 + atoi(name.c_str() + i);
+	else if (n - i == 8) date = atoi(name.c_str() + i);
+	else return 0;
+
+	int y = date / 10000, m = date / 100 % 100, d = date % 100;
+	return (y >= 2000 && y < 2100 && m >= 1 && m <= 12 && d >= 1 && d <= 31) ? date : 0;
+}
+
+/*
+ * 距今days日的UTC日期, YYYYMMDD
+ */
+static int date_ago(int days) {
+	boost::gregorian::date d = boost::gregorian::day_clock::universal_day() - boost::gregorian::days(days);
+	return d.year() * 10000 + d.month().as_number() * 100 + d.day();
+}
+
+/*
+ * 读写限速: 累计字节数超过速率允许的量时等待
+ */
+struct Throttle {
+	double rate;	///< 速率, 字节/秒. <= 0: 不限制
+	uint64_t bytes;	///< 累计字节数
+	ptime tm0;		///< 起始时间
+
+	Throttle(int mbps) {
+		rate  = mbps * 1048576.0;
+		bytes = 0;
+		tm0   = microsec_clock::universal_time();
+	}
+
+	void Add(uint64_t n) {
+		bytes += n;
+		if (rate > 0.0) {
+			double ms = bytes / rate * 1000.0 - (microsec_clock::universal_time() - tm0).total_milliseconds();
+			if (ms >= 1.0) boost::this_thread::sleep_for(boost::chrono::milliseconds(int64_t(ms)));
+		}
+	}
+};
+
+/*
+ * 将文件原样写入一维字节图像扩展
+ */
+static void pack_bytes(fitsfile* fout, const path& filePath, uintmax_t size, Throttle& throttle, int* status) {
+	long naxes = long(size);
+	FILE* fp = fopen(filePath.c_str(), "rb");
+	if (!fp) {
+		*status = FILE_NOT_OPENED;
+		return;
+	}
+
+	std::vector<unsigned char> buff(1 << 20);
+	long long first(1);
+	size_t n;
+	fits_set_compression_type(fout, 0, status);	// 不压缩
+	fits_create_img(fout, BYTE_IMG, 1, &naxes, status);
+	try {
+		while (!*status && (n = fread(&buff[0], 1, buff.size(), fp)) > 0) {
+			fits_write_img(fout, TBYTE, first, n, &buff[0], status);
+			first += n;
+			throttle.Add(n);
+		}
+	}
+	catch(boost::thread_interrupted&) {
+		fclose(fp);
+		throw;
+	}
+	fclose(fp);
+	if (!*status && uintmax_t(first - 1) != size) *status = READ_ERROR;
+}
+
+/*
+ * 文件或目录树的字节数
+ */
+static uint64_t tree_size(const path& pathUnit) {
+	boost::system::error_code ec;
+	uint64_t bytes(0);
+
+	if (is_regular_file(pathUnit, ec)) return file_size(pathUnit, ec);
+	for (recursive_directory_iterator it(pathUnit, ec), end; !ec && it != end; it.increment(ec)) {
+		boost::system::error_code ec1;
+		if (is_regular_file(it->path(), ec1)) {
+			uintmax_t size = file_size(it->path(), ec1);
+			if (!ec1) bytes += size;
+		}
+	}
+	return bytes;
+}
+
+/*
+ * 枚举root/Y<year>/下的单元
+ * @param dir  true: 目录单元; false: 文件单元
+ */
+static void enumerate_yearly(const path& root, int type, bool dir, std::vector<StoreUnit>& units) {
+	boost::system::error_code ec;
+	if (!is_directory(root, ec)) return;
+	for (directory_iterator year(root, ec), end; !ec && year != end; year.increment(ec)) {
+		std::string name = year->path().filename().string();
+		if (name.size() != 5 || name[0] != 'Y' || !is_directory(year->path(), ec)) continue;
+		for (directory_iterator it(year->path(), ec); !ec && it != end; it.increment(ec)) {
+			boost::system::error_code ec1;
+			if (dir ? !is_directory(it->path(), ec1) : !is_regular_file(it->path(), ec1)) continue;
+
+			StoreUnit unit;
+			if (!(unit.date = unit_date(it->path().stem().string()))) continue;
+			unit.type  = type;
+			unit.bytes = 0;
+			unit.path  = it->path().string();
+			units.push_back(unit);
+		}
+		ec.clear();
+	}
+}
+
+StorageManager::StorageManager(const Parameter* param) {
+	param_ = param;
+	freeMin_ = freeTarget_ = 0;
+	for (int i = 0; i < STORE_CLASSES; ++i) retain_[i] = 0;
+	for (int i = 0; i < STORE_CLASSES; ++i) sameDevice_[i] = false;
+	dirty_ = false;
+	reqRefresh_ = reqFull_ = reqCheck_ = false;
+	freeLast_ = UINT64_MAX;
+	written_  = 0;
+	idCheck_ = idDaily_ = 0;
+}
+
+StorageManager::~StorageManager() {
+	Stop();
+}
+
+bool StorageManager::Start() {
+	path pathIndex(param_->sampleDir);
+	pathIndex /= STORE_INDEX_FILE;
+	pathIndex_ = pathIndex.string();
+	freeMin_    = param_->minDiskFree > 0 ? uint64_t(param_->minDiskFree) << 30 : 0;
+	freeTarget_ = uint64_t(std::max(param_->targetDiskFree, param_->minDiskFree)) << 30;
+	retain_[STORE_RAW]     = param_->retainRaw;
+	retain_[STORE_PRODUCT] = param_->retainProduct;
+	retain_[STORE_LOG]     = param_->retainLog;
+	retain_[STORE_ARCHIVE] = param_->retainArchive;
+	dirArchive_ = param_->archiveDir.empty() ? param_->dirRawImage : param_->archiveDir;
+	if (param_->archiveEnable) {
+		boost::system::error_code ec;
+		create_directories(dirArchive_, ec);
+		if (ec) _gLog.Write(LOG_FAULT, "[%s:%s], failed to create [%s]", __FILE__, __FUNCTION__, dirArchive_.c_str());
+	}
+
+	// 各类型单元是否与原始图像位于同一文件系统
+	struct stat st0, st;
+	const std::string* root[STORE_CLASSES] = {&param_->dirRawImage, &dirArchive_, &param_->sampleDir, &param_->sampleDir};
+	bool valid = !stat(param_->dirRawImage.c_str(), &st0);
+	for (int i = 0; i < STORE_CLASSES; ++i)
+		sameDevice_[i] = valid && !stat(root[i]->c_str(), &st) && st.st_dev == st0.st_dev;
+
+	bool loaded = load_index();
+	{
+		MtxLck lck(mtx_);
+		reqRefresh_ = reqCheck_ = true;
+		reqFull_ = !loaded;
+	}
+	thrdClean_.reset(new boost::thread(boost::bind(&StorageManager::thread_clean, this)));
+
+	int noon = int(((12 * 3600 + timezone) % 86400 + 86400) % 86400);	// 本地时正午
+	idCheck_ = _gSched.Every(keep_, "storage check", STORE_CHECK_PERIOD * 1000, boost::bind(&StorageManager::cycle_check, this));
+	idDaily_ = _gSched.Every(keep_, "storage daily", 86400 * 1000, boost::bind(&StorageManager::cycle_daily, this), noon * 1000);
+	return true;
+}
+
+void StorageManager::Stop() {
+	_gSched.Cancel(idCheck_);
+	_gSched.Cancel(idDaily_);
+	keep_.Stop();
+	if (thrdClean_.unique()) {
+		interrupt_thread(thrdClean_);
+		save_index();
+	}
+}
+
+void StorageManager::Account(const std::string& filePath, uint64_t bytes) {
+	path pathUnit = path(filePath).parent_path();
+	MtxLck lck(mtx_);
+
+	UnitMap::iterator it = units_.find(pathUnit.string());
+	if (it != units_.end()) it->second.bytes += bytes;
+	else {
+		StoreUnit unit;
+		if ((unit.date = unit_date(pathUnit.filename().string()))) {
+			unit.type  = STORE_RAW;
+			unit.bytes = bytes;
+			unit.path  = pathUnit.string();
+			units_[unit.path] = unit;
+		}
+	}
+	dirty_ = true;
+	written_ += bytes;
+	// 估计可用空间低于下限时立即检查
+	if (freeMin_ && !reqCheck_ && freeLast_ != UINT64_MAX && freeLast_ < freeMin_ + written_) {
+		reqCheck_ = true;
+		cvReq_.notify_one();
+	}
+}
+
+void StorageManager::cycle_check() {
+	MtxLck lck(mtx_);
+	reqCheck_ = true;
+	cvReq_.notify_one();
+}
+
+void StorageManager::cycle_daily() {
+	MtxLck lck(mtx_);
+	reqRefresh_ = true;
+	cvReq_.notify_one();
+}
+
+void StorageManager::thread_clean() {
+#ifdef __linux__
+	// 仅降低本线程的IO优先级
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+	while (true) {
+		bool daily, full;
+		{
+			MtxLck lck(mtx_);
+			while (!reqRefresh_ && !reqCheck_) cvReq_.wait(lck);
+			daily = reqRefresh_;
+			full  = reqFull_;
+			reqRefresh_ = reqFull_ = reqCheck_ = false;
+		}
+		if (daily) {
+			refresh(full);
+			expire();
+			archive();
+		}
+		reclaim();
+		save_index();
+	}
+}
+
+void StorageManager::enumerate(std::vector<StoreUnit>& units) {
+	boost::system::error_code ec;
+	path root(param_->dirRawImage), sample(param_->sampleDir);
+	size_t i;
+
+	units.clear();
+	// 原始图像: <dirRawImage>/<prefix><YYMMDD>
+	for (directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+		std::string name = it->path().filename().string();
+		boost::system::error_code ec1;
+		if (name.find(param_->prefixName) || !is_directory(it->path(), ec1)) continue;
+
+		StoreUnit unit;
+		if (!(unit.date = unit_date(name))) continue;
+		unit.type  = STORE_RAW;
+		unit.bytes = 0;
+		unit.path  = it->path().string();
+		units.push_back(unit);
+	}
+	// 归档: <dirArchive>/<prefix><YYMMDD>.fits
+	for (directory_iterator it(path(dirArchive_), ec), end; !ec && it != end; it.increment(ec)) {
+		std::string name = it->path().filename().string();
+		boost::system::error_code ec1;
+		if (name.find(param_->prefixName) || it->path().extension() != STORE_ARCHIVE_EXT
+				|| !is_regular_file(it->path(), ec1)) continue;
+
+		StoreUnit unit;
+		if (!(unit.date = unit_date(it->path().stem().string()))) continue;
+		unit.type  = STORE_ARCHIVE;
+		unit.bytes = 0;
+		unit.path  = it->path().string();
+		units.push_back(unit);
+	}
+	ec.clear();
+	for (i = 0; i < sizeof(product_root) / sizeof(char*); ++i)
+		enumerate_yearly(sample / product_root[i], STORE_PRODUCT, true, units);
+	for (i = 0; i < sizeof(log_root) / sizeof(char*); ++i)
+		enumerate_yearly(sample / log_root[i], STORE_LOG, false, units);
+	enumerate_yearly(sample / param_->prefixName, STORE_LOG, false, units);
+}
+
+void StorageManager::refresh(bool full) {
+	std::vector<StoreUnit> units;
+	UnitMap fresh;
+	int recent = date_ago(STORE_KEEP_DAYS), counted(0);
+
+	enumerate(units);
+	for (std::vector<StoreUnit>::iterator it = units.begin(); it != units.end(); ++it) {
+		if (!full && it->date < recent) {// 较早的单元不再变化: 沿用索引
+			MtxLck lck(mtx_);
+			UnitMap::iterator old = units_.find(it->path);
+			if (old != units_.end() && old->second.type == it->type) {
+				fresh[it->path] = old->second;
+				continue;
+			}
+		}
+		it->bytes = tree_size(it->path);
+		fresh[it->path] = *it;
+		++counted;
+		boost::this_thread::interruption_point();
+	}
+
+	uint64_t bytes[STORE_CLASSES] = {0};
+	for (UnitMap::iterator it = fresh.begin(); it != fresh.end(); ++it) bytes[it->second.type] += it->second.bytes;
+	{
+		MtxLck lck(mtx_);
+		units_.swap(fresh);
+		dirty_ = true;
+	}
+	_gLog.Write("storage index: %d units, %d counted, raw = %.1f GB, archive = %.1f GB, product = %.1f GB, log = %.1f GB",
+		int(units.size()), counted, bytes[STORE_RAW] / 1073741824.0, bytes[STORE_ARCHIVE] / 1073741824.0,
+		bytes[STORE_PRODUCT] / 1073741824.0, bytes[STORE_LOG] / 1073741824.0);
+}
+
+void StorageManager::expire() {
+	std::vector<StoreUnit> expired;
+	int recent = date_ago(STORE_KEEP_DAYS), cutoff[STORE_CLASSES];
+
+	for (int i = 0; i < STORE_CLASSES; ++i) cutoff[i] = retain_[i] > 0 ? std::min(date_ago(retain_[i]), recent) : 0;
+	{
+		MtxLck lck(mtx_);
+		for (UnitMap::iterator it = units_.begin(); it != units_.end(); ++it) {
+			if (it->second.date < cutoff[it->second.type]) expired.push_back(it->second);
+		}
+	}
+	for (size_t i = 0; i < expired.size(); ++i) remove_unit(expired[i]);
+}
+
+void StorageManager::reclaim() {
+	uint64_t avail = free_space();
+	{
+		MtxLck lck(mtx_);
+		freeLast_ = avail;
+		written_  = 0;
+	}
+	if (!freeMin_ || avail == UINT64_MAX || avail >= freeMin_) return;
+
+	int recent = date_ago(STORE_KEEP_DAYS), n(0);
+	uint64_t bytes(0);
+	_gLog.Write(LOG_WARN, "free disk capacity [%.1f] GB is less than threshold...starts erasing the oldest data",
+		avail / 1073741824.0);
+	while (avail < freeTarget_) {
+		StoreUnit victim;
+		bool found(false);
+		{// 最早的单元: 类型优先, 其次日期
+			MtxLck lck(mtx_);
+			for (UnitMap::iterator it = units_.begin(); it != units_.end(); ++it) {
+				const StoreUnit& unit = it->second;
+				if (unit.date >= recent || !sameDevice_[unit.type]) continue;
+				if (!found || unit.type < victim.type || (unit.type == victim.type && unit.date < victim.date)) {
+					victim = unit;
+					found  = true;
+				}
+			}
+		}
+		if (!found) {
+			_gLog.Write(LOG_WARN, "[%s:%s], no more history data to erase", __FILE__, __FUNCTION__);
+			break;
+		}
+		bytes += remove_unit(victim);
+		++n;
+		avail = free_space();
+	}
+	{
+		MtxLck lck(mtx_);
+		freeLast_ = avail;
+		written_  = 0;
+	}
+	_gLog.Write("disk erasing complete, %d units, %.1f GB erased, free capacity is %.1f GB",
+		n, bytes / 1073741824.0, avail / 1073741824.0);
+}
+
+uint64_t StorageManager::remove_unit(const StoreUnit& unit) {
+	boost::system::error_code ec;
+	path pathUnit(unit.path);
+	std::vector<path> files;
+	Throttle throttle(param_->cleanRate);
+	uint64_t bytes(0);
+
+	if (is_regular_file(pathUnit, ec)) files.push_back(pathUnit);
+	else {
+		for (recursive_directory_iterator it(pathUnit, ec), end; !ec && it != end; it.increment(ec)) {
+			boost::system::error_code ec1;
+			if (!is_directory(it->path(), ec1)) files.push_back(it->path());
+		}
+	}
+	for (size_t i = 0; i < files.size(); ++i) {
+		boost::system::error_code ec1;
+		uintmax_t size = file_size(files[i], ec1);
+		if (ec1) size = 0;
+		if (remove(files[i], ec1)) {
+			bytes += size;
+			throttle.Add(size);
+		}
+	}
+	remove_all(pathUnit, ec);
+
+	{
+		MtxLck lck(mtx_);
+		units_.erase(unit.path);
+		dirty_ = true;
+	}
+	_gLog.Write("storage: erased %s [%s], %.2f GB", type_name[unit.type], unit.path.c_str(), bytes / 1073741824.0);
+	return bytes;
+}
+
+void StorageManager::archive() {
+	if (!param_->archiveEnable || param_->archiveAfter <= 0) return;
+
+	std::vector<StoreUnit> nights;
+	int cutoff = std::min(date_ago(param_->archiveAfter), date_ago(STORE_KEEP_DAYS)), n(0);
+	uint64_t bytesIn(0), bytesOut(0);
+	{
+		MtxLck lck(mtx_);
+		for (UnitMap::iterator it = units_.begin(); it != units_.end(); ++it) {
+			if (it->second.type == STORE_RAW && it->second.date < cutoff) nights.push_back(it->second);
+		}
+	}
+	for (size_t i = 0; i < nights.size(); ++i) {
+		StoreUnit packed;
+		if (!pack_night(nights[i], packed)) continue;
+		remove_unit(nights[i]);
+		{
+			MtxLck lck(mtx_);
+			units_[packed.path] = packed;
+			dirty_ = true;
+		}
+		++n;
+		bytesIn  += nights[i].bytes;
+		bytesOut += packed.bytes;
+	}
+	if (n) _gLog.Write("storage: %d nights archived into [%s], %.2f GB -> %.2f GB",
+		n, dirArchive_.c_str(), bytesIn / 1073741824.0, bytesOut / 1073741824.0);
+}
+
+bool StorageManager::pack_night(const StoreUnit& unit, StoreUnit& packed) {
+	boost::system::error_code ec;
+	path pathNight(unit.path), pathArch(dirArchive_);
+	std::vector<path> files;
+
+	pathArch /= pathNight.filename().string() + STORE_ARCHIVE_EXT;
+	if (exists(pathArch, ec)) {
+		_gLog.Write(LOG_WARN, "[%s:%s], [%s] already exists", __FILE__, __FUNCTION__, pathArch.c_str());
+		return false;
+	}
+	for (directory_iterator it(pathNight, ec), end; !ec && it != end; it.increment(ec)) {
+		boost::system::error_code ec1;
+		if (is_regular_file(it->path(), ec1)) files.push_back(it->path());
+	}
+	if (ec) return false;
+	std::sort(files.begin(), files.end());
+
+	std::string pathTmp = pathArch.string() + ".tmp", night = pathNight.filename().string();
+	Throttle throttle(param_->archiveRate);
+	fitsfile *fout(NULL), *fin(NULL);
+	int status(0), nfile(files.size()), hdus(0);
+
+	try {
+		// 主HDU: 仅含头信息
+		fits_create_file(&fout, ("!" + pathTmp).c_str(), &status);
+		fits_create_img(fout, BYTE_IMG, 0, NULL, &status);
+		fits_write_key(fout, TSTRING, "NIGHT", (void*) night.c_str(), "night directory", &status);
+		fits_write_key(fout, TINT, "NFILES", &nfile, "number of packed files", &status);
+
+		for (size_t i = 0; i < files.size() && !status; ++i) {
+			std::string name = files[i].filename().string(), ext = files[i].extension().string();
+			boost::system::error_code ec1;
+			uintmax_t size = file_size(files[i], ec1);
+
+			if (ext == ".fit" || ext == ".fits") {// 图像: 分块压缩
+				int before(0), after(0);
+				fits_get_num_hdus(fout, &before, &status);
+				if (!status && !fits_open_file(&fin, files[i].c_str(), READONLY, &status)) {
+					fits_set_compression_type(fout, RICE_1, &status);
+					fits_img_compress(fin, fout, &status);
+				}
+				if (fin) {
+					int status1(0);
+					fits_close_file(fin, &status1);
+					fin = NULL;
+				}
+				if (status) {// 无法读取或压缩: 删除不完整的扩展, 原样打包
+					char txt[FLEN_STATUS] = "";
+					fits_get_errstatus(status, txt);
+					_gLog.Write(LOG_WARN, "[%s:%s], [%s] packed as bytes, %s", __FILE__, __FUNCTION__, files[i].c_str(), txt);
+					status = 0;
+					fits_get_num_hdus(fout, &after, &status);
+					if (!status && after > before) {
+						fits_movabs_hdu(fout, after, NULL, &status);
+						fits_delete_hdu(fout, NULL, &status);
+					}
+					if (!status) pack_bytes(fout, files[i], size, throttle, &status);
+				}
+				else if (!ec1) throttle.Add(size);
+			}
+			else pack_bytes(fout, files[i], size, throttle, &status);
+			fits_update_key(fout, TSTRING, "EXTNAME", (void*) name.c_str(), "original file name", &status);
+			if (status) _gLog.Write(LOG_FAULT, "[%s:%s], failed to pack [%s]", __FILE__, __FUNCTION__, files[i].c_str());
+		}
+	}
+	catch(boost::thread_interrupted&) {// 停止时放弃未完成的归档
+		int status1(0);
+		if (fin) fits_close_file(fin, &status1);
+		if (fout) fits_close_file(fout, &status1);
+		remove(pathTmp, ec);
+		throw;
+	}
+	if (fout) fits_close_file(fout, &status);
+
+	// 校验: 扩展数目
+	if (!status) {
+		fits_open_file(&fout, pathTmp.c_str(), READONLY, &status);
+		fits_get_num_hdus(fout, &hdus, &status);
+		fits_close_file(fout, &status);
+		if (!status && hdus != nfile + 1) status = BAD_HDU_NUM;
+	}
+	if (!status) rename(pathTmp, pathArch, ec);
+	if (status || ec) {
+		char txt[FLEN_STATUS] = "";
+		if (status) fits_get_errstatus(status, txt);
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to archive [%s], %s", __FILE__, __FUNCTION__,
+			unit.path.c_str(), status ? txt : ec.message().c_str());
+		remove(pathTmp, ec);
+		return false;
+	}
+
+	packed.type  = STORE_ARCHIVE;
+	packed.date  = unit.date;
+	packed.bytes = file_size(pathArch, ec);
+	packed.path  = pathArch.string();
+	if (ec) packed.bytes = 0;
+	return true;
+}
+
+uint64_t StorageManager::free_space() {
+	boost::system::error_code ec;
+	space_info si = space(path(param_->dirRawImage), ec);
+	return ec ? UINT64_MAX : uint64_t(si.available);
+}
+
+bool StorageManager::load_index() {
+	FILE* fp = fopen(pathIndex_.c_str(), "r");
+	if (!fp) return false;
+
+	char line[1024], type[20];
+	int date, pos, i;
+	unsigned long long bytes;
+	UnitMap units;
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#') continue;
+		line[strcspn(line, "\r\n")] = 0;
+		if (sscanf(line, "%19s %d %llu %n", type, &date, &bytes, &pos) < 3 || !line[pos]) continue;
+		for (i = 0; i < STORE_CLASSES && strcmp(type, type_name[i]); ++i);
+		if (i == STORE_CLASSES) continue;
+
+		StoreUnit unit;
+		unit.type  = i;
+		unit.date  = date;
+		unit.bytes = bytes;
+		unit.path  = line + pos;
+		units[unit.path] = unit;
+	}
+	fclose(fp);
+
+	MtxLck lck(mtx_);
+	units_.swap(units);
+	dirty_ = false;
+	return true;
+}
+
+void StorageManager::save_index() {
+	std::vector<StoreUnit> units;
+	{
+		MtxLck lck(mtx_);
+		if (!dirty_) return;
+		dirty_ = false;
+		for (UnitMap::iterator it = units_.begin(); it != units_.end(); ++it) units.push_back(it->second);
+	}
+
+	// 写入临时文件后替换
+	std::string pathTmp = pathIndex_ + ".tmp";
+	FILE* fp = fopen(pathTmp.c_str(), "w");
+	if (!fp) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to create [%s]", __FILE__, __FUNCTION__, pathTmp.c_str());
+		return;
+	}
+	fprintf(fp, "# type date bytes path\n");
+	for (size_t i = 0; i < units.size(); ++i) {
+		fprintf(fp, "%s %d %llu %s\n", type_name[units[i].type], units[i].date,
+			(unsigned long long) units[i].bytes, units[i].path.c_str());
+	}
+	bool ok = (fclose(fp) == 0);
+	boost::system::error_code ec;
+	if (ok) rename(pathTmp, pathIndex_, ec);
+	if (!ok || ec) {
+		_gLog.Write(LOG_FAULT, "[%s:%s], failed to write [%s]", __FILE__, __FUNCTION__, pathIndex_.c_str());
+		remove(pathTmp, ec);
+		MtxLck lck(mtx_);
+		dirty_ = true;
+	}
+}
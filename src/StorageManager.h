@@ -0,0 +1,175 @@
+/**
+ * @file StorageManager.h 存储空间管理: 按索引增量维护和清理历史数据
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 管理单元: 原始图像的夜间目录, 产品的日目录(CloudAge、WeaFile), 日志的日文件.
+ *   单元日期取自名称末尾的6位或8位数字
+ * - 索引文件Storage.idx位于测量数据目录, 记录各单元的类型、日期、字节数和路径.
+ *   索引缺失时全量扫描一次; 其后每日仅重新统计新增单元和近两日的单元
+ * - FITS写入后即时累计字节数, 据此估计可用空间, 低于下限时立即触发清理,
+ *   不必等待定时检查
+ * - 可用空间低于下限时, 按原始图像、归档、产品、日志的次序删除最早的单元, 直至恢复至目标值.
+ *   归档、产品和日志仅在与原始图像位于同一文件系统时参与. 不删除当日和前一日的单元
+ * - 各类型可独立设置保留天数, 超期单元在每日整理时删除
+ * - 删除在独立线程中逐文件进行, 线程IO优先级为idle, 并按设定速率限速
+ * - 分级存储: 超过设定天数的夜间目录在每日整理时打包为单个多扩展FITS文件<prefix>YYMMDD.fits,
+ *   图像以RICE_1分块压缩, 其它文件(如延时视频)以一维字节图像原样存入. 扩展名EXTNAME为原文件名.
+ *   归档可写入另一存储卷. 校验扩展数目后删除原目录
+ */
+
+#ifndef STORAGE_MANAGER_H_
+#define STORAGE_MANAGER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "BoostInclude.h"
+#include "Scheduler.h"
+#include "Parameter.h"
+
+#define STORE_INDEX_FILE	"Storage.idx"	///< 索引文件名
+#define STORE_CHECK_PERIOD	300		///< 可用空间检查周期, 秒
+#define STORE_KEEP_DAYS		1		///< 受保护的近期天数: 当日及前一日
+#define STORE_ARCHIVE_EXT	".fits"	///< 归档文件扩展名
+
+/**
+ * @brief 存储单元类型. 数值为空间不足时的删除次序
+ */
+enum {
+	STORE_RAW,		///< 原始图像
+	STORE_ARCHIVE,	///< 归档: 打包压缩后的原始图像
+	STORE_PRODUCT,	///< 产品: 云量分布、气象数据文件
+	STORE_LOG,		///< 日志: 测量记录
+	STORE_CLASSES
+};
+
+/**
+ * @brief 存储单元
+ */
+struct StoreUnit {
+	int type;		///< 类型
+	int date;		///< 日期, YYYYMMDD
+	uint64_t bytes;	///< 字节数
+	std::string path;	///< 目录或文件路径
+};
+
+class StorageManager {
+public:
+	typedef boost::shared_ptr<StorageManager> Pointer;
+
+public:
+	StorageManager(const Parameter* param);
+	~StorageManager();
+	static Pointer Create(const Parameter* param) {
+		return Pointer(new StorageManager(param));
+	}
+
+public:
+	/**
+	 * @brief 加载索引, 启动清理线程和定时检查
+	 */
+	bool Start();
+	/**
+	 * @brief 停止清理线程并保存索引
+	 */
+	void Stop();
+	/**
+	 * @brief 累计原始图像的写入量
+	 * @param filePath  文件路径. 归入所在的夜间目录
+	 * @param bytes     文件字节数
+	 */
+	void Account(const std::string& filePath, uint64_t bytes);
+
+protected:
+	typedef std::map<std::string, StoreUnit> UnitMap;	///< 索引: 路径 - 单元
+
+protected:
+	/**
+	 * @brief 调度任务: 检查可用空间
+	 */
+	void cycle_check();
+	/**
+	 * @brief 调度任务: 请求每日整理
+	 */
+	void cycle_daily();
+	/**
+	 * @brief 线程: 整理索引并删除单元
+	 */
+	void thread_clean();
+	/**
+	 * @brief 整理索引: 登记新单元, 重新统计近期单元, 移除已不存在的单元
+	 * @param full  重新统计全部单元
+	 */
+	void refresh(bool full);
+	/**
+	 * @brief 枚举磁盘上的单元
+	 */
+	void enumerate(std::vector<StoreUnit>& units);
+	/**
+	 * @brief 删除超过保留天数的单元
+	 */
+	void expire();
+	/**
+	 * @brief 删除最早的单元直至可用空间恢复至目标值
+	 */
+	void reclaim();
+	/**
+	 * @brief 打包超过设定天数的夜间目录
+	 */
+	void archive();
+	/**
+	 * @brief 将夜间目录打包为多扩展FITS文件
+	 * @param unit    夜间目录
+	 * @param packed  归档单元
+	 * @return
+	 * 打包并校验成功
+	 */
+	bool pack_night(const StoreUnit& unit, StoreUnit& packed);
+	/**
+	 * @brief 限速删除单元
+	 * @return
+	 * 删除的字节数
+	 */
+	uint64_t remove_unit(const StoreUnit& unit);
+	/**
+	 * @brief 可用空间, 字节. 失败时返回UINT64_MAX
+	 */
+	uint64_t free_space();
+	/**
+	 * @brief 加载索引文件
+	 */
+	bool load_index();
+	/**
+	 * @brief 写入索引文件
+	 */
+	void save_index();
+
+protected:
+	const Parameter* param_;	///< 配置参数
+	std::string pathIndex_;		///< 索引文件路径
+	uint64_t freeMin_;			///< 可用空间下限, 字节. 0: 不检查
+	uint64_t freeTarget_;		///< 清理后的可用空间目标, 字节
+	int retain_[STORE_CLASSES];	///< 保留天数. <= 0: 不限
+	bool sameDevice_[STORE_CLASSES];	///< 与原始图像位于同一文件系统, 可参与空间回收
+	std::string dirArchive_;	///< 归档目录
+
+	boost::mutex mtx_;			///< 互斥锁: 索引和请求标志
+	boost::condition_variable cvReq_;	///< 有新的请求
+	UnitMap units_;				///< 索引
+	bool dirty_;				///< 索引待写入
+	bool reqRefresh_;			///< 请求: 整理索引
+	bool reqFull_;				///< 请求: 全量统计
+	bool reqCheck_;				///< 请求: 检查可用空间, 不足时释放
+	uint64_t freeLast_;			///< 最近一次检查的可用空间, 字节
+	uint64_t written_;			///< 最近一次检查后的写入量, 字节
+
+	ThrdPtr thrdClean_;		///< 线程: 整理与清理
+	BoostAsioKeep keep_;	///< 线程池句柄
+	int idCheck_;			///< 调度任务: 检查可用空间
+	int idDaily_;			///< 调度任务: 每日整理
+};
+typedef StorageManager::Pointer StoragePtr;
+
+#endif
@@ -3,7 +3,6 @@
 #include <boost/bind/bind.hpp>
 #include <boost/bind/placeholders.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/format.hpp>
 #include "WeatherStation.h"
 #include "GLog.h"
 
@@ -12,273 +11,191 @@ using namespace boost::placeholders;
 using namespace boost::filesystem;
 
 // 气象站
-#define WEA_FUNC    0x03    // 功能码: 查询
-#define WEA_THP     0x66    // 地址: 温度、湿度、气压
-#define WEA_WIND    0xC8    // 地址: 风速、风向
-#define WEA_RAIN    0xCA    // 地址: 雨量
+#define WEA_THP     0x66    // 从站地址: 温度、湿度、气压
+#define WEA_WIND    0xC8    // 从站地址: 风速、风向
+// 独立雨水
+#define RAIN_SLAVE  0x01    // 从站地址: 降雨信号
 
-// MODBUS协议格式
-// 指令
+// MODBUS RTU协议格式
+// 指令: 读保持寄存器
 // 功能码: 0x03--查询; 0x06--修改
-//                           地址  功能码   寄存器地址    寄存器数量   校--验--码
-unsigned char qryTHP[]    = {0x66, 0x03, 0x00, 0x00, 0x00, 0x03, 0x0D, 0xDC};
-unsigned char qryWind[]   = {0xC8, 0x03, 0x00, 0x00, 0x00, 0x02, 0xD5, 0x92};
-// unsigned char qryRainy[]  = {0xCA, 0x03, 0x00, 0x00, 0x00, 0x02, 0xD4, 0x70};
+//                 地址  功能码   寄存器地址    寄存器数量   校--验--码
+// 温湿压:         0x66, 0x03, 0x00, 0x00, 0x00, 0x03, 0x0D, 0xDC
+// 风速风向:       0xC8, 0x03, 0x00, 0x00, 0x00, 0x02, 0xD5, 0x92
+// 降雨:           0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0A
 //
 // 反馈
-//                            地址  功能码  长度    数---值    校--验--码
-// unsigned char rspTemp[] = {0x66, 0x03, 0x02, 0x09, 0xC4, 0x8A, 0x4F};
+//                 地址  功能码  长度    数---值    校--验--码
+// 温度:           0x66, 0x03, 0x02, 0x09, 0xC4, 0x8A, 0x4F
+// 有雨:           0x01, 0x03, 0x02, 0x00, 0x01, 0x79, 0x84
+// 无雨:           0x01, 0x03, 0x02, 0x00, 0x00, 0xB8, 0x44
 // 以上
 
-// 独立雨水
-// 指令
-unsigned char qryRainy[]  = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0A};
-// 反馈
-// 有雨 : 0x01, 0x03, 0x02, 0x00, 0x01, 0x79, 0x84
-// 无雨 : 0x01, 0x03, 0x02, 0x00, 0x00, 0xB8, 0x44
-// 以上
+// 本周期已收到读数的设备
+#define GOT_THP     0x01
+#define GOT_WIND    0x02
+#define GOT_RAIN    0x04
+#define GOT_ALL     (GOT_THP | GOT_WIND | GOT_RAIN)
 
 WeatherStation::WeatherStation(const char*portwea, const char* portrain, const char* dirName) {
     if (dirName) dirRoot_ = dirName;
+    treeLog_ = _gDated.Tree((path(dirRoot_) / "Weather").string(), DATED_YEAR);
     portWea_ = portwea;
 	portRain_= portrain;
+    oldDay_  = 0;
+    cycle_   = 0;
+    idThp_ = idWind_ = idRain_ = 0;
+    got_     = 0;
+    failed_  = faulty_ = 0;
+    idCycle_ = 0;
+    errWea_  = 0;
+    info_.state    = WEA_FAIL_CONNECT;
+    info_.rainFall = 0;
 }
 
 WeatherStation::~WeatherStation() {
-    interrupt_thread(thrdQuery_);
-    if (weaPtr_.unique()) {
-        weaPtr_->Close();
-        weaPtr_.reset();
-    }
-	if (rainPtr_.unique()) {
-		rainPtr_->Close();
-		rainPtr_.reset();
-	}
-    if (fpLog_) fclose(fpLog_);
+    _gBus.RemoveDevice(idThp_);
+    _gBus.RemoveDevice(idWind_);
+    _gBus.RemoveDevice(idRain_);
+    keep_.Stop();
+    logFile_.Close();
     _gLog.Write("Weather Station: stopped");
 }
 
 bool WeatherStation::Start(int cycle) {
-    thrdQuery_.reset(new boost::thread(boost::bind(&WeatherStation::run, this, cycle)));
-
-    return true;
+    cycle_ = cycle;
+    // 气象站与雨水使用不同的串口和波特率
+    if (!_gBus.AddPort(portWea_) || !_gBus.AddPort(portRain_, 4800)) return false;
+
+    BusDevice dev;
+    dev.port   = portWea_;
+    dev.period = cycle * 1000;
+    dev.name   = "weather.thp";
+    dev.slave  = WEA_THP;
+    dev.count  = 3;
+    dev.scale.assign({0.01, 0.01, 0.1});
+    idThp_ = _gBus.AddDevice(dev, keep_.Wrap(boost::bind(&WeatherStation::query_thp, this, _1)));
+
+    dev.name     = "weather.wind";
+    dev.slave    = WEA_WIND;
+    dev.count    = 2;
+    dev.scale.assign({0.01, 1.0});
+    dev.priority = 1;
+    idWind_ = _gBus.AddDevice(dev, keep_.Wrap(boost::bind(&WeatherStation::query_wind, this, _1)));
+
+    dev.name     = "weather.rain";
+    dev.port     = portRain_;
+    dev.slave    = RAIN_SLAVE;
+    dev.count    = 1;
+    dev.scale.clear();
+    dev.priority = 2;
+    idRain_ = _gBus.AddDevice(dev, keep_.Wrap(boost::bind(&WeatherStation::query_rain, this, _1)));
+
+    return idThp_ && idWind_ && idRain_;
 }
 
 bool WeatherStation::IsRun() {
-    return weaPtr_.use_count();
+    return info_.state != WEA_FAIL_CONNECT;
 }
 
-void WeatherStation::run(int cycle) {
-   	int cntErrWea(0), cntErrRain(0), noReadWea(0), noReadRain(0), toWait;
-    ptime tmBeg = second_clock::universal_time();
-
-    while (1) {
-    	if (!weaPtr_.unique()) {// 连接串口
-            const SerialComm::CBSlot& slot = boost::bind(&WeatherStation::handle_receive_weather, this, _1, _2, _3);
-            weaPtr_ = SerialComm::Create();
-            if (!weaPtr_->Open(portWea_.c_str())) {
-                weaPtr_.reset();
-                info_.state = WEA_FAIL_CONNECT;
-                _gLog.Write(LOG_FAULT, "[%s:%d], failed to connect Weather Station[%s]",
-                    __FILE__, __LINE__, portWea_.c_str());
-            }
-            else {
-				weaPtr_->SetReadLength(7);
-	            weaPtr_->RegisterRead(slot);
-                info_.state = WEA_SUCCESS;
-                info_.utc   = to_iso_extended_string(second_clock::universal_time());
-                oldDay_   = 0;
-                noReadWea = 0;
-                _gLog.Write("Weather Station: connected");
-            }
-        }
-
-		if (!rainPtr_.unique()) {
-			const SerialComm::CBSlot& slot = boost::bind(&WeatherStation::handle_receive_rain, this, _1, _2, _3);
-			rainPtr_ = SerialComm::Create();
-			if (!rainPtr_->Open(portRain_.c_str(), 4800)) {
-				rainPtr_.reset();
-                _gLog.Write(LOG_FAULT, "[%s:%d], failed to connect Rain Monitor[%s]",
-                    __FILE__, __LINE__, portRain_.c_str());
-			}
-			else {
-				rainPtr_->SetReadLength(7);
-				rainPtr_->RegisterRead(slot);
-				info_.rainFall = 0;
-				noReadRain = 0;
-				_gLog.Write("Rain Monitor: connected");
-			}
-		}
-
-        if (weaPtr_.unique()) {// 查询气象信息
-            cntErrWea = 0;
-
-            qryType_ = WEA_THP;
-            weaPtr_->Write((const char*) qryTHP,    sizeof(qryTHP));
-            wait_response(cntErrWea);
-
-            qryType_ = WEA_WIND;
-            weaPtr_->Write((const char*) qryWind,   sizeof(qryWind));
-            wait_response(cntErrWea);
-
-            info_.state = cntErrWea ? WEA_NO_DATA : WEA_SUCCESS;
-            if (!cntErrWea) {
-                ptime::date_type today = tmBeg.date();
-                info_.utc   = to_iso_extended_string(tmBeg);
-                if (open_file(today.year(), today.month().as_number(), today.day())) {
-                	fprintf(fpLog_, "%s %5.1f %5.1f %6.1f %4.1f %3d %10u\n", info_.utc.c_str(),
-                    	    info_.temperature, info_.humidity, info_.pressure,
-                    	    info_.windSpeed, info_.windOrient,
-                    	    info_.rainFall);
-                	fflush(fpLog_);
-	            }
-
-                noReadWea = 0;
-	        }
-            else if (++noReadWea >= 3) {
-                weaPtr_->Close();
-                weaPtr_.reset();
-            }
-	    }
-
-		if (rainPtr_.unique()) {// 监测降雨信号
-			cntErrRain = 0;
-			rainPtr_->Write((const char*) qryRainy, sizeof(qryRainy));
-			wait_response(cntErrRain);
-
-			if (!cntErrRain) noReadRain = 0;
-			else if (++noReadRain >= 3) {
-				rainPtr_->Close();
-				rainPtr_.reset();
-			}
-		}
-
-	    // 延时等待
-        toWait = cycle - (second_clock::universal_time() - tmBeg).total_seconds();
-        tmBeg += seconds(cycle);
-        if (toWait > 0) boost::this_thread::sleep_for(boost::chrono::seconds(toWait));
+void WeatherStation::query_thp(const BusReading& reading) {
+    if (!reading.ec) {
+        info_.temperature = reading.values[0];
+        info_.humidity    = reading.values[1];
+        info_.pressure    = reading.values[2];
     }
+    query_done(GOT_THP, reading);
 }
 
-void WeatherStation::wait_response(int &cntErr) {
-    boost::mutex mtx;
-    MtxLck lck(mtx);
-    boost::chrono::seconds toWait(5); // 等待串口反馈
-    boost::chrono::seconds delay(1); // 连续指令间隔
-
-    if (cvGet_.wait_for(lck, toWait) == boost::cv_status::no_timeout) {
-        boost::this_thread::sleep_for(delay);
-    }
-    else {
-        ++cntErr;
+void WeatherStation::query_wind(const BusReading& reading) {
+    if (!reading.ec) {
+        info_.windSpeed  = reading.values[0];
+        info_.windOrient = reading.regs[1];
     }
+    query_done(GOT_WIND, reading);
 }
 
-void WeatherStation::handle_receive_weather(SerialComm* comm, int ec, size_t bytes) {
-	if (ec) info_.state = ec;
-	else {
-		static unsigned char flag[] = {0x03};
-		size_t len = sizeof(flag);
-		static unsigned char buff[20];
-		int Npck, datalen;
-		int pos = weaPtr_->Lookup((const char*) flag, len);
-		if (pos >= 1) {
-			weaPtr_->Read((char*) buff, 3, pos - 1, false); // 帧头
-			datalen = buff[0] == WEA_THP ? 6 : 4;
-			if (buff[2] != datalen) {// 容错:
-				weaPtr_->Read((char*) buff, 2, pos - 1);
-			}
-			else if (bytes >= (Npck = 5 + datalen)) {// 数据和校验码
-				weaPtr_->Read((char*) buff, Npck, pos - 1);
-				if (buff[0] == WEA_THP) {
-                    info_.temperature = ((buff[3] << 8) + buff[4]) * 0.01;
-					info_.humidity    = ((buff[5] << 8) + buff[6]) * 0.01;
-                    info_.pressure    = ((buff[7] << 8) + buff[8]) * 0.1;
-				}
-				else if (buff[0] == WEA_WIND) {
-                    info_.windSpeed   = ((buff[3] << 8) + buff[4]) * 0.01;
-                    info_.windOrient  = ((buff[5] << 8) + buff[6]);
-				}
-
-				cvGet_.notify_one();
-			}
-		}
-		else if (pos == 0) {// 容错
-			weaPtr_->Read((char*) buff, 1);
-		}
-	}
+void WeatherStation::query_rain(const BusReading& reading) {
+    if (!reading.ec) {
+        if (reading.regs[0] == 0x01) info_.rainFall = 1;
+        else if (reading.regs[0] == 0x00) info_.rainFall = 0;
+    }
+    query_done(GOT_RAIN, reading);
 }
 
-void WeatherStation::handle_receive_rain(SerialComm* comm, int ec, size_t bytes) {
-	if (ec) info_.state = ec;
-	else {
-		static unsigned char flag[] = {0x01, 0x03, 0x02};
-		size_t len = sizeof(flag);
-		static unsigned char buff[10];
-		int Npck(7);
-		int pos = rainPtr_->Lookup((const char*) flag, len);
-
-		if (pos >= 0 && bytes >= (Npck + pos)) {
-			rainPtr_->Read((char*) buff, Npck, pos);
-			if (buff[4] == 0x01) info_.rainFall = 1;
-			else if (buff[4] == 0x00) info_.rainFall  = 0;
-
-			cvGet_.notify_one();
-		}
-	}
+void WeatherStation::query_done(int bit, const BusReading& reading) {
+    // 各设备在UTC周期整数倍启动轮询: 读数时间取最近的周期起点作为周期序号
+    int64_t cycleMs = int64_t(cycle_) * 1000;
+    int64_t idCycle = ((reading.utc - ptime(boost::gregorian::date(1970, 1, 1))).total_milliseconds() + cycleMs / 2) / cycleMs;
+    if (idCycle != idCycle_) {// 新周期: 丢弃未收齐读数的前一周期
+        if (got_) _gLog.Write(LOG_WARN, "Weather Station: incomplete cycle dropped, readings = %#x", got_);
+        idCycle_ = idCycle;
+        got_     = 0;
+        failed_  = 0;
+        errWea_  = 0;
+        tmBeg_   = reading.utc;
+    }
+    if (reading.ec) {
+        failed_ |= bit;
+        if (!errWea_) errWea_ = reading.ec;
+    }
+    if ((got_ |= bit) == GOT_ALL) query_finish();
 }
 
-bool WeatherStation::open_file(int year, int month, int day) {
-    if (oldDay_ != day) {
-        if (fpLog_) fclose(fpLog_);
-        try {
-            // 创建目录
-            path pathName(dirRoot_);
-            pathName /= "Weather";
-            if (!exists(pathName)) {
-                create_directory(pathName);
-                permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-            }
-            pathName /= (boost::format("Y%d") % year).str();
-            if (!exists(pathName)) {
-                create_directory(pathName);
-                permissions(pathName, perms::group_write | perms::others_write | perms::remove_perms);
-            }
-            // 打开文件
-            boost::format fmtFile("Weather_%d%02d%02d.log");
-            pathName /= (fmtFile % year % month % day).str();
-            _gLog.Write("Weather File = %s", pathName.c_str());
-            fpLog_ = fopen(pathName.c_str(), "a+");
-
-            // 保存日期
-            oldDay_ = day;
+void WeatherStation::query_finish() {
+    if (failed_ != faulty_) {// 故障设备变化
+        if (failed_) _gLog.Write(LOG_FAULT, "[%s:%s], query failed:%s%s%s, ec = %d", __FILE__, __FUNCTION__,
+                failed_ & GOT_THP ? " thp" : "", failed_ & GOT_WIND ? " wind" : "", failed_ & GOT_RAIN ? " rain" : "",
+                errWea_);
+        else _gLog.Write("Weather Station: all queries recovered");
+        faulty_ = failed_;
+    }
+    // 气象信息
+    info_.state = errWea_ == BUS_PORT_ERR ? WEA_FAIL_CONNECT : (errWea_ ? WEA_NO_DATA : WEA_SUCCESS);
+    if (!errWea_) {
+        ptime::date_type today = tmBeg_.date();
+        info_.utc   = to_iso_extended_string(ptime(today, seconds(tmBeg_.time_of_day().total_seconds())));
+        if (open_file(today.year(), today.month().as_number(), today.day())) {
+            logFile_.Write("%s %5.1f %5.1f %6.1f %4.1f %3d %10u\n", info_.utc.c_str(),
+                    info_.temperature, info_.humidity, info_.pressure,
+                    info_.windSpeed, info_.windOrient,
+                    info_.rainFall);
         }
-        catch(filesystem_error& ex) {
-            _gLog.Write(LOG_FAULT, "[%s:%s], %s", __FILE__, __FUNCTION__, ex.what());
-            return false;
+    }
+    {// 发布到样本总线
+        static const char* names[] = {"temperature", "humidity", "pressure", "windSpeed", "windOrient", "rainFall"};
+        static const char* units[] = {"C", "%", "hPa", "m/s", "deg", ""};
+        static const int devs[]    = {GOT_THP, GOT_THP, GOT_THP, GOT_WIND, GOT_WIND, GOT_RAIN};
+        double values[] = {info_.temperature, info_.humidity, info_.pressure, info_.windSpeed,
+                           double(info_.windOrient), double(info_.rainFall)};
+        SampleVec samples(6);
+        for (int i = 0; i < 6; ++i) {
+            samples[i].sensor  = "weather";
+            samples[i].channel = names[i];
+            samples[i].unit    = units[i];
+            samples[i].value   = values[i];
+            samples[i].state   = failed_ & devs[i] ? SAMPLE_NO_DATA : SAMPLE_OK;
+            samples[i].utc     = tmBeg_;
         }
+        _gSamples.Publish(samples);
     }
-
-    return fpLog_ != NULL;
+    got_    = 0;
+    failed_ = 0;
+    errWea_ = 0;
 }
 
-unsigned short WeatherStation::modbus_crc16(unsigned char* data, unsigned int len) {
-	unsigned int i, j;
-	unsigned short CRC16, tmp;
-
-	CRC16 = 0xFFFF;
-	for (i = 0; i < len; ++i) {
-		CRC16 ^= data[i];
-		for (j = 0; j < 8; ++j) {
-			tmp = (unsigned short) (CRC16 & 0x0001);
-			CRC16 >>= 1;
-			if (tmp == 1) CRC16 ^= 0xA001;
-		}
-	}
-	return CRC16;
-}
+bool WeatherStation::open_file(int year, int month, int day) {
+    if (oldDay_ != day) {
+        logFile_.Close();
+        // 打开文件
+        string pathName = treeLog_->File(boost::gregorian::date(year, month, day), "Weather_", ".log");
+        if (pathName.empty()) return false;
+        _gLog.Write("Weather File = %s", pathName.c_str());
+        logFile_.Open(pathName, "Weather");
+
+        // 保存日期
+        oldDay_ = day;
+    }
 
-void WeatherStation::value2code(unsigned short crc, char* code) {
-    code[0] = (char) (crc & 0xFF);
-    code[1] = (char) ((crc >> 8) & 0xFF);
+    return logFile_.IsOpen();
 }
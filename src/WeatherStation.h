@@ -10,8 +10,12 @@
 #define _SRC_WEATHER_STATION_H_
 
 #include <string>
+#include <boost/date_time/posix_time/ptime.hpp>
 #include "BoostInclude.h"
-#include "SerialComm.h"
+#include "SerialBus.h"
+#include "SampleBus.h"
+#include "DatedPath.h"
+#include "AppendLog.h"
 
 using std::string;
 
@@ -48,18 +52,26 @@ public:
 
 protected:
     string  dirRoot_;   ///< 样本数据文件根目录
+    DatedTreePtr treeLog_;  ///< 日志目录: Weather/Y<year>
     string portWea_;   ///< 串口名称: 气象站
 	string portRain_;  ///< 串口名称: 雨水
     InfoWeather info_;  ///< 气象信息
-    FILE* fpLog_;   ///< 日志文件
+    AppendLog logFile_; ///< 日志文件
     int oldDay_;    ///< UTC日期
     uint32_t oldRainy_;  ///< 雨量
-    unsigned char qryType_;   ///< 查询类型
 
-    SerialPtr weaPtr_;  ///< 串口指针: 气象站
-	SerialPtr rainPtr_;	///< 串口指针: 雨水
-    ThrdPtr thrdQuery_; ///< 线程: 定时发送查询指令
-    boost::condition_variable cvGet_;   ///< 事件: 收到反馈
+    /* 查询流程 */
+    int cycle_;         ///< 采样周期, 秒
+    int idThp_;         ///< 总线设备: 温度、湿度、气压
+    int idWind_;        ///< 总线设备: 风速、风向
+    int idRain_;        ///< 总线设备: 降雨信号
+    int64_t idCycle_;   ///< 本周期序号: UTC时间/采样周期
+    int got_;           ///< 本周期已收到读数的设备, 按位标记
+    int failed_;        ///< 本周期查询失败的设备, 按位标记
+    int faulty_;        ///< 最近一次报告的故障设备, 按位标记
+    int errWea_;        ///< 本周期气象站错误. 0: 无错误
+    boost::posix_time::ptime tmBeg_;    ///< 本周期开始时间
+    BoostAsioKeep keep_;    ///< 线程池句柄
 
 public:
     const InfoWeather* GetInfo() {
@@ -82,20 +94,26 @@ public:
 // 气象站
 protected:
     /**
-     * @brief 线程: 定时发送查询指令
-     * @param cycle  采样周期
+     * @brief 读数: 温度、湿度、气压
+     * @param reading  总线读数
      */
-    void run(int cycle);
+    void query_thp(const BusReading& reading);
     /**
-     * @brief 串口接收信息回调函数
-     * @param ec   故障码
+     * @brief 读数: 风速、风向
      */
-    void handle_receive_weather(SerialComm* comm, int ec, size_t bytes);
+    void query_wind(const BusReading& reading);
     /**
-     * @brief 延时等待串口反馈
-     * @param cntErr   故障计数
+     * @brief 登记已收到读数的设备. 本周期全部设备均已返回时结束本周期
+     * @param bit      设备标记
+     * @param reading  总线读数
+     * @note
+     * 读数属于新周期时, 丢弃未收齐读数的前一周期
      */
-    void wait_response(int &cntErr);
+    void query_done(int bit, const BusReading& reading);
+    /**
+     * @brief 结束采样周期: 记录气象信息
+     */
+    void query_finish();
     /**
      * @brief  打开日志文件
      * @param  year  UTC年
@@ -104,29 +122,13 @@ protected:
      * @return 文件创建或打开结果
      */
     bool open_file(int year, int month, int day);
-    /**
-     * @brief 计算机MODBUS协议CRC校验码
-     * @param data   待校验数据
-     * @param len    数据长度, 字节
-     * @return 校验码
-     */
-    unsigned short modbus_crc16(unsigned char* data, unsigned int len);
-    /**
-     * @brief 将检验码转换为字符串
-     * @param crc   CRC16校验码
-     * @param code  字符串
-     * @note
-     * 校验码高低位转置
-     */
-    void value2code(unsigned short crc, char* code);
 
 // 雨水
 private:
     /**
-     * @brief 串口接收信息回调函数
-     * @param ec   故障码
+     * @brief 读数: 降雨信号
      */
-    void handle_receive_rain(SerialComm* comm, int ec, size_t bytes);
+    void query_rain(const BusReading& reading);
 };
 
 typedef WeatherStation::Pointer WeaStatPtr;
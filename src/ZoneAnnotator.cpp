@@ -0,0 +1,116 @@
+/**
+ * @file ZoneAnnotator.cpp 云量天区标注: 大气质量、月距和天光背景亮度
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ADefine.h"
+#include "ATimeSpace.h"
+#include "Ephemeris.h"
+#include "ZoneAnnotator.h"
+
+using namespace boost::posix_time;
+using namespace AstroUtil;
+
+/* 亮度单位转换: 星等@平方角秒 <--> nL(nanoLambert) */
+static double mag2nL(double mag) {
+	return 34.08 * exp(20.7233 - 0.92104 * mag);
+}
+
+static double nL2mag(double b) {
+	return (20.7233 - log(b / 34.08)) / 0.92104;
+}
+
+/* 大气质量: Krisciunas & Schaefer (1991)式(3), z为天顶距, 弧度 */
+static double ks_airmass(double z) {
+	double s = sin(z);
+	return 1.0 / sqrt(1.0 - 0.96 * s * s);
+}
+
+void ZoneAnnotator::Annotate(double lgt, double lat, double alt, const ptime& utc,
+		const CloudAgeSet& zones, double mpsas, CloudSky& sky) {
+	ATimeSpace ats;
+	double lst, ra, dec, ra1, dec1, r, azi, h;
+	double elong, phase, zmoon, b0, bz, offset;
+	int n = int(zones.size()), i;
+	bool night, moonUp, measured = mpsas > SKY_INVALID;
+
+	sky.Reset();
+	ats.SetSite(lgt, lat, alt, 0);
+	ats.SetMJD(Ephemeris::MJD(utc));
+	lst = ats.LocalSiderealTime();
+	// 太阳
+	ats.SunPosition(ra, dec);
+	ats.Eq2Horizon(lst - ra, dec, azi, h);
+	sky.sunAlt = float(h * AU_R2D);
+	// 月相: 由地心日月角距近似月相角
+	ats.MoonPosition(r, ra1, dec1);
+	elong = ats.SphereAngle(ra, dec, ra1, dec1);
+	phase = 180.0 - elong * AU_R2D;
+	sky.moonIllum = float((1.0 - cos(elong)) * 0.5);
+	// 月亮: 站心地平坐标, 方位角转换为北零点
+	ats.MoonTopo(r, ra, dec);
+	ats.Eq2Horizon(lst - ra, dec, azi, h);
+	sky.moonAlt = float(h * AU_R2D);
+	sky.moonAzi = float(cycmod(azi * AU_R2D + 180.0, 360.0));
+	zmoon  = AU_PI * 0.5 - h;
+	moonUp = h > 0.0;
+	night  = sky.sunAlt < SKY_SUN_LIMIT;
+
+	// 天区几何: 批量计算
+	azi_.resize(n);
+	alt_.resize(n);
+	am_.resize(n);
+	dist_.resize(n);
+	for (i = 0; i < n; ++i) {
+		azi_[i] = std::get<0>(zones[i]) * AU_D2R;
+		alt_[i] = std::get<1>(zones[i]) * AU_D2R;
+	}
+	if (n) {
+		ats.SphereAngleBatch(n, sky.moonAzi * AU_D2R, h, &azi_[0], &alt_[0], &dist_[0]);
+		ats.AirmassBatch(n, &alt_[0], &am_[0]);
+	}
+
+	// 天顶亮度: 模型值与SQM测量值之差作为零点改正
+	b0 = mag2nL(SKY_DARK_MAG);
+	bz = b0 + (moonUp ? moon_brightness(zmoon * AU_R2D, 0.0, zmoon, phase) : 0.0);
+	offset = measured ? mpsas - nL2mag(bz) : 0.0;
+	if (night) {
+		sky.zenithMag  = float(measured ? mpsas : nL2mag(bz));
+		sky.calibrated = measured;
+	}
+	else if (measured) sky.zenithMag = float(mpsas);
+
+	sky.zones.resize(n);
+	for (i = 0; i < n; ++i) {
+		ZoneSky& zs = sky.zones[i];
+		double z = AU_PI * 0.5 - alt_[i];
+		zs.airmass  = isnan(am_[i]) ? SKY_INVALID : float(am_[i]);
+		zs.moonDist = float(dist_[i] * AU_R2D);
+		if (!night || alt_[i] <= 0.0) zs.skyMag = SKY_INVALID;
+		else {
+			double b = dark_brightness(b0, z);
+			if (moonUp) b += moon_brightness(zs.moonDist, z, zmoon, phase);
+			zs.skyMag = float(nL2mag(b) + offset);
+		}
+	}
+	sky.valid = true;
+}
+
+double ZoneAnnotator::moon_brightness(double rho, double z, double zmoon, double phase) {
+	// 散射函数在月亮附近(<10°)未经标定, 按10°处理
+	if (rho < 10.0) rho = 10.0;
+	double c = cos(rho * AU_D2R);
+	double f = pow(10.0, 5.36) * (1.06 + c * c) + pow(10.0, 6.15 - rho / 40.0);
+	double a = fabs(phase);
+	double istar = pow(10.0, -0.4 * (3.84 + 0.026 * a + 4E-9 * pow(a, 4)));
+	double k = SKY_EXTINCTION;
+	return f * istar * pow(10.0, -0.4 * k * ks_airmass(zmoon)) * (1.0 - pow(10.0, -0.4 * k * ks_airmass(z)));
+}
+
+double ZoneAnnotator::dark_brightness(double b0, double z) {
+	double x = ks_airmass(z);
+	return b0 * pow(10.0, -0.4 * SKY_EXTINCTION * (x - 1.0)) * x;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file ZoneAnnotator.h 云量天区标注: 大气质量、月距和天光背景亮度
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 每幅云量分布计算一次, 结果缓存在InfoCloudage中, 发布时不再计算
+ * - 天区方位角: 角度, 北零点, 向东为正
+ * - 天光背景亮度: Krisciunas & Schaefer (1991)月光散射模型叠加暗夜天光,
+ *   以SQM天顶测量值校准零点. 太阳高度角高于SKY_SUN_LIMIT时模型无效
+ * - 测光透明度(CloudPhot)由云量引擎的测光环节(ZonePhotometry)生成, 随云量分布发布
+ */
+
+#ifndef ZONE_ANNOTATOR_H_
+#define ZONE_ANNOTATOR_H_
+
+#include <tuple>
+#include <vector>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+#define SKY_DARK_MAG	21.6	///< 暗夜天顶亮度, 星等@平方角秒, V波段
+#define SKY_EXTINCTION	0.172	///< 大气消光系数, 星等/大气质量, V波段
+#define SKY_SUN_LIMIT	-12.0	///< 太阳高度角上限, 角度
+#define SKY_INVALID		-99.9	///< 无效值
+
+typedef std::tuple<float, float, int> CloudAge;
+typedef std::vector<CloudAge> CloudAgeSet;
+
+/**
+ * @brief 单个天区的标注
+ */
+struct ZoneSky {
+	float airmass;	///< 大气质量. 地平线以下为SKY_INVALID
+	float moonDist;	///< 月距, 角度
+	float skyMag;	///< 天光背景亮度, 星等@平方角秒
+};
+typedef std::vector<ZoneSky> ZoneSkySet;
+
+/**
+ * @brief 一幅云量分布的标注
+ */
+struct CloudSky {
+	bool valid;			///< 已标注
+	float sunAlt;		///< 太阳高度角, 角度
+	float moonAlt;		///< 月亮高度角, 角度
+	float moonAzi;		///< 月亮方位角, 角度, 北零点
+	float moonIllum;	///< 月面照亮比例
+	float zenithMag;	///< 天顶亮度参考, 星等@平方角秒. SQM测量值或模型值
+	bool calibrated;	///< 已由SQM测量值校准
+	ZoneSkySet zones;	///< 与云量分布的天区一一对应
+
+public:
+	CloudSky() {
+		Reset();
+	}
+	void Reset() {
+		valid = calibrated = false;
+		sunAlt = moonAlt = moonAzi = moonIllum = zenithMag = SKY_INVALID;
+		zones.clear();
+	}
+};
+
+/**
+ * @brief 单个天区的测光透明度
+ */
+struct ZonePhot {
+	int stars;			///< 参与测光的星表星数量
+	float zeroPoint;	///< 零点, 星等: 仪器星等 - 星表星等 - 大气消光. 无星时为SKY_INVALID
+	float extinction;	///< 相对晴夜参考零点的消光, 星等. 无星时为SKY_INVALID
+};
+typedef std::vector<ZonePhot> ZonePhotSet;
+
+/**
+ * @brief 一幅云量分布的测光透明度
+ */
+struct CloudPhot {
+	bool valid;			///< 已测光
+	float zeroPoint;	///< 晴夜参考零点, 星等
+	int stars;			///< 天区内的星表星数量
+	int detected;		///< 检出的星表星数量
+	ZonePhotSet zones;	///< 与云量分布的天区一一对应
+
+public:
+	CloudPhot() {
+		Reset();
+	}
+	void Reset() {
+		valid = false;
+		zeroPoint = SKY_INVALID;
+		stars = detected = 0;
+		zones.clear();
+	}
+};
+
+class ZoneAnnotator {
+protected:
+	/* 计算缓冲区. 重复使用 */
+	std::vector<double> azi_;	///< 方位角, 弧度
+	std::vector<double> alt_;	///< 高度角, 弧度
+	std::vector<double> am_;	///< 大气质量
+	std::vector<double> dist_;	///< 月距, 弧度
+
+public:
+	/*!
+	 * @brief 标注云量分布
+	 * @param lgt    测站地理经度, 角度
+	 * @param lat    测站地理纬度, 角度
+	 * @param alt    测站海拔, 米
+	 * @param utc    云量分布的UTC时间
+	 * @param zones  云量分布
+	 * @param mpsas  SQM天顶测量值. 无有效测量值时为SKY_INVALID
+	 * @param sky    标注结果
+	 */
+	void Annotate(double lgt, double lat, double alt, const boost::posix_time::ptime& utc,
+		const CloudAgeSet& zones, double mpsas, CloudSky& sky);
+
+protected:
+	/*!
+	 * @brief 月光散射亮度, nL
+	 * @param rho    天区与月亮的角距, 角度
+	 * @param z      天区天顶距, 弧度
+	 * @param zmoon  月亮天顶距, 弧度
+	 * @param phase  月相角, 角度. 0: 满月
+	 */
+	static double moon_brightness(double rho, double z, double zmoon, double phase);
+	/*!
+	 * @brief 暗夜天光亮度, nL
+	 * @param b0  天顶亮度, nL
+	 * @param z   天区天顶距, 弧度
+	 */
+	static double dark_brightness(double b0, double z);
+};
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file ZonePhotometry.cpp 测光透明度: 由星表星流量计算天区零点和消光
+ * @version 0.1
+ * @date 2026-10-18
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ADefine.h"
+#include "Ephemeris.h"
+#include "ZonePhotometry.h"
+
+using namespace boost::posix_time;
+using namespace AstroUtil;
+
+ZonePhotometry::ZonePhotometry() {
+	eleMin_ = 0.0;
+	airp_   = 1013.25;
+	hasRef_ = false;
+	zpRef_  = 0.0;
+}
+
+void ZonePhotometry::Reset(const Parameter* param) {
+	eleMin_ = param->gridElMin;
+	LoadBrightStars(param->astroCatalog, catalog_);
+	ats_.SetSite(param->siteLon, param->siteLat, param->siteAlt, 0);
+	airp_   = SitePressure(param->siteAlt);
+	hasRef_ = false;
+}
+
+void ZonePhotometry::Measure(const ptime& utc, double expdur, const SkyProjection& proj,
+		const float* img, const double* bkg, const double* noise, CloudPhot& phot) {
+	int nz = proj.Zones(), w = proj.WidthBin(), h = proj.HeightBin(), bin = proj.Bin();
+	int side = 2 * PHOT_APERTURE + 1, n, i, k, x, y, z, xc, yc;
+	double xs, ys, flux, sigma, med;
+	const AllSkyLens& lens = proj.Lens();
+	const int16_t* index = proj.Index();
+	ZonePhot zero;
+
+	zero.stars = 0;
+	zero.zeroPoint = zero.extinction = SKY_INVALID;
+	phot.Reset();
+	phot.zones.assign(nz, zero);
+	if (!nz || catalog_.empty() || expdur <= 0.0) return;
+
+	ats_.SetMJD(Ephemeris::MJD(utc));
+	BrightStarHorizon(ats_, catalog_, airp_, eleMin_, stars_);
+	n = stars_.size();
+	zone_.assign(n, -1);
+	resid_.resize(n);
+	good_.clear();
+
+	// 方孔径测光. 合并像元为均值, 流量换算至原始像元
+	for (i = 0; i < n; ++i) {
+		const StarHorizon& star = stars_[i];
+		lens.Horizon2Pixel(star.azi, star.ele, xs, ys);
+		xc = int(floor((xs + 0.5) / bin));
+		yc = int(floor((ys + 0.5) / bin));
+		if (xc < PHOT_APERTURE || yc < PHOT_APERTURE || xc >= w - PHOT_APERTURE || yc >= h - PHOT_APERTURE) continue;
+		if ((z = index[yc * w + xc]) < 0) continue;
+
+		for (y = yc - PHOT_APERTURE, flux = 0.0; y <= yc + PHOT_APERTURE; ++y) {
+			const float* row = img + y * w;
+			for (x = xc - PHOT_APERTURE; x <= xc + PHOT_APERTURE; ++x) flux += row[x];
+		}
+		flux  = (flux - bkg[z] * side * side) * bin * bin;
+		sigma = (noise[z] > 1.0 ? noise[z] : 1.0) * side * bin * bin;
+		bool detected = flux >= PHOT_SNR_MIN * sigma;
+		if (!detected) flux = PHOT_SNR_MIN * sigma;
+
+		zone_[i]  = z;
+		resid_[i] = -2.5 * log10(flux / expdur) - catalog_[star.idx].mag - SKY_EXTINCTION * (star.airmass - 1.0);
+		if (detected) good_.push_back(resid_[i]);
+	}
+
+	// 按天区计数排序分组
+	offset_.assign(nz + 1, 0);
+	for (i = 0; i < n; ++i) {
+		if (zone_[i] >= 0) ++offset_[zone_[i] + 1];
+	}
+	for (z = 0; z < nz; ++z) offset_[z + 1] += offset_[z];
+	cursor_.assign(offset_.begin(), offset_.end() - 1);
+	group_.resize(offset_[nz]);
+	for (i = 0; i < n; ++i) {
+		if ((z = zone_[i]) >= 0) group_[cursor_[z]++] = resid_[i];
+	}
+	phot.stars    = offset_[nz];
+	phot.detected = good_.size();
+
+	// 晴夜参考零点
+	if (int(good_.size()) >= PHOT_STARS_MIN) {
+		k = int(PHOT_QUANTILE * (good_.size() - 1));
+		std::nth_element(good_.begin(), good_.begin() + k, good_.end());
+		if (!hasRef_ || good_[k] < zpRef_ + PHOT_ZP_DRIFT) zpRef_ = good_[k];
+		else zpRef_ += PHOT_ZP_DRIFT;
+		hasRef_ = true;
+	}
+
+	// 天区零点: 中值; 消光: 相对参考零点
+	for (z = 0; z < nz; ++z) {
+		if (!(k = offset_[z + 1] - offset_[z])) continue;
+		std::vector<double>::iterator first = group_.begin() + offset_[z];
+		std::nth_element(first, first + k / 2, first + k);
+		med = first[k / 2];
+
+		ZonePhot& zone = phot.zones[z];
+		zone.stars     = k;
+		zone.zeroPoint = float(med);
+		if (hasRef_) {
+			med -= zpRef_;
+			zone.extinction = float(med < 0.0 ? 0.0 : (med > PHOT_EXT_MAX ? PHOT_EXT_MAX : med));
+		}
+	}
+	if (hasRef_) {
+		phot.valid     = true;
+		phot.zeroPoint = float(zpRef_);
+	}
+}
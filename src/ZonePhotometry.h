@@ -0,0 +1,72 @@
+/**
+ * @file ZonePhotometry.h 测光透明度: 由星表星流量计算天区零点和消光
+ * @version 0.1
+ * @date 2026-10-18
+ * @note
+ * - 由镜头模型预测星表星的像元位置, 在合并图像上做方孔径测光, 扣除天区背景
+ * - 残差 = 仪器星等 - 星表星等 - SKY_EXTINCTION * (X - 1).
+ *   未检出的星以PHOT_SNR_MIN倍孔径噪声为流量上限, 对应消光下限, 厚云区不因缺星而无结果
+ * - 按天区索引计数排序分组, 各组取中值作为天区零点. 耗时与星数成线性
+ * - 晴夜参考零点: 各帧检出星残差低分位值的夜间最佳值, 并逐帧缓慢放宽以适应镜罩积尘、结露.
+ *   天区消光 = 天区零点 - 参考零点
+ * - 星表星数量决定天区覆盖率: 内置亮星表仅覆盖部分天区, 可由Astrometry.Catalog指定更深的星表
+ */
+
+#ifndef ZONE_PHOTOMETRY_H_
+#define ZONE_PHOTOMETRY_H_
+
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "BrightStar.h"
+#include "Parameter.h"
+#include "SkyProjection.h"
+#include "ZoneAnnotator.h"
+
+#define PHOT_APERTURE	2		///< 方孔径半宽, 合并像元
+#define PHOT_SNR_MIN	3.0		///< 检出阈值, 孔径噪声倍数
+#define PHOT_QUANTILE	0.2		///< 单帧零点取检出星残差的分位数
+#define PHOT_ZP_DRIFT	0.002	///< 参考零点的逐帧放宽量, 星等
+#define PHOT_STARS_MIN	10		///< 更新参考零点的最少检出星数
+#define PHOT_EXT_MAX	5.0		///< 消光上限, 星等
+
+class ZonePhotometry {
+public:
+	ZonePhotometry();
+
+public:
+	/*!
+	 * @brief 加载星表并设置测站
+	 */
+	void Reset(const Parameter* param);
+	/*!
+	 * @brief 测量各天区的零点和消光
+	 * @param utc     曝光中间时刻
+	 * @param expdur  曝光时间, 秒
+	 * @param proj    投影表: 镜头模型与合并像元的天区索引
+	 * @param img     合并图像
+	 * @param bkg     天区背景
+	 * @param noise   天区噪声
+	 * @param phot    测光结果. phot.zones与投影表的天区一一对应
+	 */
+	void Measure(const boost::posix_time::ptime& utc, double expdur, const SkyProjection& proj,
+		const float* img, const double* bkg, const double* noise, CloudPhot& phot);
+
+protected:
+	double eleMin_;			///< 最低高度角, 角度: 天区网格下限
+	BrightStarVec catalog_;	///< 星表
+	AstroUtil::ATimeSpace ats_;	///< 时空坐标转换
+	double airp_;			///< 测站气压, 毫巴
+	bool hasRef_;			///< 已建立晴夜参考零点
+	double zpRef_;			///< 晴夜参考零点, 星等
+
+	/* 计算缓冲区. 重复使用 */
+	StarHorizonVec stars_;		///< 可见星表星
+	std::vector<int> zone_;		///< 星所在天区. < 0: 图像外
+	std::vector<double> resid_;	///< 星的残差
+	std::vector<double> good_;	///< 检出星的残差
+	std::vector<int> offset_;	///< 天区分组的起始位置
+	std::vector<int> cursor_;	///< 天区分组的填充位置
+	std::vector<double> group_;	///< 按天区分组的残差
+};
+
+#endif
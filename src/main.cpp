@@ -10,6 +10,12 @@
 #include "Parameter.h"
 #include "EnvMonitor.h"
 #include "SQM.h"
+#include "AsioPool.h"
+#include "Scheduler.h"
+#include "SerialBus.h"
+#include "SampleBus.h"
+#include "Ephemeris.h"
+#include "DatedPath.h"
 
 using namespace std;
 
@@ -18,6 +24,12 @@ GLog _gLog(stdout);
 #else
 GLog _gLog(LOG_DIR, LOG_PREFIX);
 #endif
+AsioPool _gPool;
+Scheduler _gSched;
+SerialBus _gBus;
+SampleBus _gSamples;
+Ephemeris _gEphem;
+DatedPath _gDated;
 
 void PrintUsage();
 
@@ -70,11 +82,16 @@ int main(int argc, char** argv) {
 	Parameter param;
 	if (!param.Load(pathConfig.c_str())) return -5;
 
+	_gPool.Start(param.poolThreads);
+	_gSched.Start();
 	EnvMonitor wemon(&param);
 	if (wemon.Start()) {
 		_gLog.Write("Daemon goes running");
 		ios.run();
 		wemon.Stop();
+		_gBus.Stop();
+		_gSched.Stop();
+		_gPool.Stop();
 		_gLog.Write("Daemon stopped");
 	}
 	else {
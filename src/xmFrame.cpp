@@ -11,6 +11,11 @@ bool  xmFrame::Reset(const string& pathImageFile) {
 	// 重置关键成员变量
 	astroFix = photoFix = false;
 	fwhm = fwhmErr = 0.0;
+	zoneCols = zoneRows = 0;
+	fwhmField = tiltX = tiltY = curvature = 0.0;
+	fieldFit = false;
+	flag = 0;
+	zones.clear();
 	stars.clear();
 	// 解析文件路径
 	path pathName(pathImageFile);
@@ -15,10 +15,29 @@
 
 #include <string>
 #include <deque>
+#include <vector>
 #include "xmStar.h"
 
 using std::string;
 
+/**
+ * @brief 图像分区的星像统计结果
+ * @note
+ * 图像坐标系按ZONE_SIZE划分网格, 每个网格独立统计星像轮廓
+ */
+struct xmZone {
+	int col, row;		///< 网格列/行索引
+	double xc, yc;		///< 网格中心坐标
+	int count;			///< 星像数量
+	double fwhm;		///< 半高全宽中值. 0 == 无效
+	double fwhmErr;		///< 半高全宽离散度: 1.4826 * MAD
+	double elong;		///< 延展率中值
+	double elongErr;	///< 延展率离散度: 1.4826 * MAD
+	bool inSky;			///< 网格中心位于全天成像圆内
+	bool good;			///< 星像数量符合统计条件
+};
+typedef std::vector<xmZone> xmZoneVec;
+
 struct xmFrame {
 	// 文件名和路径
 	string fileName;	///< 文件名
@@ -47,6 +66,16 @@ struct xmFrame {
 	double fwhm;		///< 统计半高全宽. 0 == 无效
 	double fwhmErr;		///< 统计半高全宽误差
 
+	// 分区星像轮廓: FWHM分布图
+	int zoneCols;		///< 网格列数
+	int zoneRows;		///< 网格行数
+	xmZoneVec zones;	///< 分区统计结果, 行优先存储
+	double fwhmField;	///< 全视场有效网格的FWHM中值
+	double tiltX;		///< FWHM沿X轴的线性变化, 量纲: 像元/半视场. 反映像面倾斜
+	double tiltY;		///< FWHM沿Y轴的线性变化, 量纲: 像元/半视场
+	double curvature;	///< FWHM随半径平方的变化, 量纲: 像元/半视场^2. 反映场曲
+	bool fieldFit;		///< 倾斜/场曲拟合结果有效性
+
 	// 定位结果
 	bool astroFix;		///< 天文/轴系定位结果
 	double ra0, dec0;	///< 图像中心坐标, J2000
@@ -14,7 +14,6 @@
 #define STAR_COUNT_MIN      50  // 全图最少星数
 #define STAR_AREA_MIN		3   // 星像最小面积
 #define STAR_PER_ZONE       3   // 每个天区的最少星数
-#define BAD_ZONE_MAX        3   // 坏天区最大值
 
 // 星像模型
 #define SHAPE_POINT         2   // 模型中星像数量(不含中心、定向)